@@ -0,0 +1,66 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ Compact alternative to the JSON lines otest-shim writes to
+ OTEST_SHIM_STDOUT_FILE.  xctool asks for it by setting
+ OTEST_SHIM_EVENT_FRAMING=binary; shims that predate it ignore the variable
+ and keep writing JSON, which xctool tells apart by the stream's first byte.
+
+ A binary stream starts with kBinaryEventStreamMagic, followed by frames of a
+ 4-byte little-endian payload length and a payload holding one encoded value.
+ Values are a 1-byte tag followed by:
+
+   'D'  dictionary: uint32 count, then count key/value pairs (keys are values)
+   'A'  array: uint32 count, then count values
+   'S'  string: uint32 byte count, then UTF-8 bytes
+   'I'  int64
+   'R'  double
+   'T', 'F', 'N'  true, false, null: nothing
+
+ with all integers little-endian.  Empty frames carry no value and are
+ skipped.
+ */
+
+#define kOtestShimEventFramingEnvKey "OTEST_SHIM_EVENT_FRAMING"
+#define kOtestShimEventFramingBinary "binary"
+
+#define kBinaryEventStreamMagic "\0XCTEVB1"
+#define kBinaryEventStreamMagicLength (sizeof(kBinaryEventStreamMagic) - 1)
+
+#define kBinaryEventFrameHeaderLength 4
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ Returns a whole frame (length and payload) for `object`, which must be made
+ of dictionaries, arrays, strings, numbers and NSNull.  Returns nil for
+ anything else.
+ */
+NSData *BinaryEventFrameWithObject(id object);
+
+/**
+ Decodes a frame's payload.  Returns nil if it's malformed.
+ */
+id ObjectWithBinaryEventPayload(const void *bytes, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,215 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "EventFraming.h"
+
+#import <libkern/OSByteOrder.h>
+
+static void AppendTag(NSMutableData *data, char tag)
+{
+  [data appendBytes:&tag length:1];
+}
+
+static void AppendUInt32(NSMutableData *data, uint32_t value)
+{
+  uint32_t littleEndian = OSSwapHostToLittleInt32(value);
+  [data appendBytes:&littleEndian length:sizeof(littleEndian)];
+}
+
+static void AppendUInt64(NSMutableData *data, uint64_t value)
+{
+  uint64_t littleEndian = OSSwapHostToLittleInt64(value);
+  [data appendBytes:&littleEndian length:sizeof(littleEndian)];
+}
+
+static BOOL AppendValue(NSMutableData *data, id object)
+{
+  if ([object isKindOfClass:[NSString class]]) {
+    NSString *string = object;
+    NSUInteger length = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    AppendTag(data, 'S');
+    AppendUInt32(data, (uint32_t)length);
+    NSUInteger offset = [data length];
+    [data increaseLengthBy:length];
+    [string getBytes:(char *)[data mutableBytes] + offset
+           maxLength:length
+          usedLength:NULL
+            encoding:NSUTF8StringEncoding
+             options:0
+               range:NSMakeRange(0, [string length])
+      remainingRange:NULL];
+  } else if ([object isKindOfClass:[NSDictionary class]]) {
+    NSDictionary *dictionary = object;
+    AppendTag(data, 'D');
+    AppendUInt32(data, (uint32_t)[dictionary count]);
+    for (id key in dictionary) {
+      if (![key isKindOfClass:[NSString class]] ||
+          !AppendValue(data, key) ||
+          !AppendValue(data, dictionary[key])) {
+        return NO;
+      }
+    }
+  } else if ([object isKindOfClass:[NSArray class]]) {
+    NSArray *array = object;
+    AppendTag(data, 'A');
+    AppendUInt32(data, (uint32_t)[array count]);
+    for (id item in array) {
+      if (!AppendValue(data, item)) {
+        return NO;
+      }
+    }
+  } else if ([object isKindOfClass:[NSNumber class]]) {
+    if (CFGetTypeID((__bridge CFTypeRef)object) == CFBooleanGetTypeID()) {
+      AppendTag(data, [object boolValue] ? 'T' : 'F');
+    } else if (CFNumberIsFloatType((__bridge CFNumberRef)object)) {
+      double value = [object doubleValue];
+      uint64_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      AppendTag(data, 'R');
+      AppendUInt64(data, bits);
+    } else {
+      AppendTag(data, 'I');
+      AppendUInt64(data, (uint64_t)[object longLongValue]);
+    }
+  } else if ([object isKindOfClass:[NSNull class]]) {
+    AppendTag(data, 'N');
+  } else {
+    return NO;
+  }
+  return YES;
+}
+
+NSData *BinaryEventFrameWithObject(id object)
+{
+  NSMutableData *data = [NSMutableData dataWithLength:kBinaryEventFrameHeaderLength];
+  if (!AppendValue(data, object)) {
+    return nil;
+  }
+  uint32_t payloadLength = OSSwapHostToLittleInt32((uint32_t)([data length] - kBinaryEventFrameHeaderLength));
+  memcpy([data mutableBytes], &payloadLength, sizeof(payloadLength));
+  return data;
+}
+
+typedef struct {
+  const uint8_t *next;
+  const uint8_t *end;
+} payload_cursor;
+
+static BOOL ReadUInt32(payload_cursor *cursor, uint32_t *value)
+{
+  if (cursor->end - cursor->next < (ptrdiff_t)sizeof(*value)) {
+    return NO;
+  }
+  *value = OSReadLittleInt32(cursor->next, 0);
+  cursor->next += sizeof(*value);
+  return YES;
+}
+
+static BOOL ReadUInt64(payload_cursor *cursor, uint64_t *value)
+{
+  if (cursor->end - cursor->next < (ptrdiff_t)sizeof(*value)) {
+    return NO;
+  }
+  *value = OSReadLittleInt64(cursor->next, 0);
+  cursor->next += sizeof(*value);
+  return YES;
+}
+
+static id ReadValue(payload_cursor *cursor)
+{
+  if (cursor->next >= cursor->end) {
+    return nil;
+  }
+  char tag = (char)*cursor->next++;
+
+  switch (tag) {
+    case 'S': {
+      uint32_t length = 0;
+      if (!ReadUInt32(cursor, &length) || cursor->end - cursor->next < (ptrdiff_t)length) {
+        return nil;
+      }
+      CFStringRef string = CFStringCreateWithBytes(NULL, cursor->next, length, kCFStringEncodingUTF8, false);
+      cursor->next += length;
+      return CFBridgingRelease(string);
+    }
+    case 'D': {
+      uint32_t count = 0;
+      if (!ReadUInt32(cursor, &count)) {
+        return nil;
+      }
+      // Every pair takes at least two bytes, so don't trust bigger counts.
+      NSMutableDictionary *dictionary =
+        [NSMutableDictionary dictionaryWithCapacity:MIN(count, (uint32_t)(cursor->end - cursor->next) / 2)];
+      for (uint32_t i = 0; i < count; i++) {
+        id key = ReadValue(cursor);
+        if (![key isKindOfClass:[NSString class]]) {
+          return nil;
+        }
+        id value = ReadValue(cursor);
+        if (value == nil) {
+          return nil;
+        }
+        dictionary[key] = value;
+      }
+      return dictionary;
+    }
+    case 'A': {
+      uint32_t count = 0;
+      if (!ReadUInt32(cursor, &count)) {
+        return nil;
+      }
+      NSMutableArray *array =
+        [NSMutableArray arrayWithCapacity:MIN(count, (uint32_t)(cursor->end - cursor->next))];
+      for (uint32_t i = 0; i < count; i++) {
+        id value = ReadValue(cursor);
+        if (value == nil) {
+          return nil;
+        }
+        [array addObject:value];
+      }
+      return array;
+    }
+    case 'I': {
+      uint64_t value = 0;
+      return ReadUInt64(cursor, &value) ? @((long long)value) : nil;
+    }
+    case 'R': {
+      uint64_t bits = 0;
+      if (!ReadUInt64(cursor, &bits)) {
+        return nil;
+      }
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      return @(value);
+    }
+    case 'T':
+      return @YES;
+    case 'F':
+      return @NO;
+    case 'N':
+      return [NSNull null];
+    default:
+      return nil;
+  }
+}
+
+id ObjectWithBinaryEventPayload(const void *bytes, size_t length)
+{
+  payload_cursor cursor = {bytes, (const uint8_t *)bytes + length};
+  id object = ReadValue(&cursor);
+  // Trailing garbage means the frame wasn't what we think it is.
+  return cursor.next == cursor.end ? object : nil;
+}
@@ -23,4 +23,13 @@
  */
 - (void)publishDataForEvent:(NSData *)data;
 
+@optional
+
+/**
+ Called instead of -publishDataForEvent: if implemented, for consumers that
+ would otherwise have to decode `data` again, or that only want some events.
+ `event` is the dictionary that `data` was encoded from.
+ */
+- (void)publishEvent:(NSDictionary *)event data:(NSData *)data;
+
 @end
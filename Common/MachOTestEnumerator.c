@@ -0,0 +1,1243 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "MachOTestEnumerator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// The handful of Mach-O and dyld constants we need, spelled out so that this
+// file doesn't depend on <mach-o/loader.h> and friends.
+#define kMachMagic32 0xfeedfaceu
+#define kMachMagic64 0xfeedfacfu
+#define kFatMagic32 0xcafebabeu
+#define kFatMagic64 0xcafebabfu
+
+#define kLoadCommandRequiresDyld 0x80000000u
+#define kLoadCommandSegment32 0x1u
+#define kLoadCommandSegment64 0x19u
+#define kLoadCommandLoadDylib 0xcu
+#define kLoadCommandLoadWeakDylib (0x18u | kLoadCommandRequiresDyld)
+#define kLoadCommandReexportDylib (0x1fu | kLoadCommandRequiresDyld)
+#define kLoadCommandLazyLoadDylib 0x20u
+#define kLoadCommandLoadUpwardDylib (0x23u | kLoadCommandRequiresDyld)
+#define kLoadCommandDyldInfo 0x22u
+#define kLoadCommandDyldInfoOnly (0x22u | kLoadCommandRequiresDyld)
+#define kLoadCommandDyldChainedFixups (0x34u | kLoadCommandRequiresDyld)
+
+#define kChainedPointerFormat64 2
+#define kChainedPointerFormat32 3
+#define kChainedPointerFormat64Offset 6
+
+// method_list_t flag for lists of relative (12 byte) method entries.
+#define kSmallMethodListFlag 0x80000000u
+#define kMethodListEntrySizeMask 0x0000fffcu
+
+// Sanity limits so that a corrupt file can't send us off allocating the world.
+#define kMaxMethodsPerList (1u << 20)
+#define kMaxBindRepeat (1u << 24)
+
+static const char *const kClassSymbolPrefix = "_OBJC_CLASS_$_";
+
+// Class methods that let a test class decide at runtime what its tests are.
+static const char *const kDynamicTestHooks[] = {
+  "testInvocations",
+  "defaultTestSuite",
+  "isInheritingTestCases",
+  "load",
+  "initialize",
+};
+
+#pragma mark Reading
+
+static uint16_t ReadU16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t ReadU32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t ReadU64(const uint8_t *p)
+{
+  return (uint64_t)ReadU32(p) | ((uint64_t)ReadU32(p + 4) << 32);
+}
+
+static uint32_t ReadBigEndianU32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint64_t ReadBigEndianU64(const uint8_t *p)
+{
+  return ((uint64_t)ReadBigEndianU32(p) << 32) | (uint64_t)ReadBigEndianU32(p + 4);
+}
+
+static int ReadULEB128(const uint8_t **p, const uint8_t *end, uint64_t *value)
+{
+  uint64_t result = 0;
+  unsigned shift = 0;
+  while (*p < end) {
+    uint8_t byte = *(*p)++;
+    if (shift < 64) {
+      result |= (uint64_t)(byte & 0x7f) << shift;
+    }
+    shift += 7;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int SkipSLEB128(const uint8_t **p, const uint8_t *end)
+{
+  while (*p < end) {
+    if ((*(*p)++ & 0x80) == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+#pragma mark Image
+
+typedef struct {
+  char name[17];
+  uint64_t vmaddr;
+  uint64_t fileoff;
+  uint64_t filesize;
+} Segment;
+
+typedef struct {
+  uint64_t address;
+  const char *symbol;
+  int libraryOrdinal;
+} Binding;
+
+typedef struct {
+  const uint8_t *bytes;
+  size_t length;
+  int is64;
+  uint32_t pointerSize;
+  // Preferred load address, i.e. where __TEXT starts.
+  uint64_t baseAddress;
+
+  Segment *segments;
+  uint32_t segmentCount;
+
+  // Install names of linked dylibs, indexed by library ordinal - 1.
+  const char **dylibs;
+  uint32_t dylibCount;
+
+  // Binds from LC_DYLD_INFO, sorted by address.
+  Binding *bindings;
+  size_t bindingCount;
+  size_t bindingCapacity;
+
+  // From LC_DYLD_CHAINED_FIXUPS.
+  int hasChainedFixups;
+  uint16_t chainedPointerFormat;
+  const uint8_t *chainedImports;
+  uint32_t chainedImportCount;
+  uint32_t chainedImportFormat;
+  const char *chainedSymbols;
+  size_t chainedSymbolsLength;
+
+  uint64_t classListAddress;
+  uint64_t classListSize;
+  uint64_t categoryListAddress;
+  uint64_t categoryListSize;
+  int hasObjC1Metadata;
+} Image;
+
+/**
+ A pointer-sized value in the image, after applying fixups: either the address
+ of something in the image, or a reference to a symbol in some other image.
+ */
+typedef struct {
+  int isBind;
+  uint64_t target;
+  const char *symbol;
+  int libraryOrdinal;
+} Pointer;
+
+static const uint8_t *BytesAtFileOffset(const Image *image, uint64_t offset, uint64_t size)
+{
+  if (offset > image->length || size > image->length - offset) {
+    return NULL;
+  }
+  return image->bytes + offset;
+}
+
+static const Segment *SegmentContainingAddress(const Image *image, uint64_t address)
+{
+  for (uint32_t i = 0; i < image->segmentCount; i++) {
+    const Segment *segment = &image->segments[i];
+    if (address >= segment->vmaddr && address - segment->vmaddr < segment->filesize) {
+      return segment;
+    }
+  }
+  return NULL;
+}
+
+static const uint8_t *BytesAtAddress(const Image *image, uint64_t address, uint64_t size)
+{
+  const Segment *segment = SegmentContainingAddress(image, address);
+  if (segment == NULL) {
+    return NULL;
+  }
+  uint64_t offset = address - segment->vmaddr;
+  if (size > segment->filesize - offset) {
+    return NULL;
+  }
+  return BytesAtFileOffset(image, segment->fileoff + offset, size);
+}
+
+static const char *StringAtAddress(const Image *image, uint64_t address)
+{
+  const Segment *segment = SegmentContainingAddress(image, address);
+  if (segment == NULL) {
+    return NULL;
+  }
+  uint64_t offset = address - segment->vmaddr;
+  uint64_t available = segment->filesize - offset;
+  const uint8_t *bytes = BytesAtFileOffset(image, segment->fileoff + offset, 0);
+  if (bytes == NULL) {
+    return NULL;
+  }
+  if (available > (uint64_t)(image->bytes + image->length - bytes)) {
+    available = (uint64_t)(image->bytes + image->length - bytes);
+  }
+  if (memchr(bytes, '\0', (size_t)available) == NULL) {
+    return NULL;
+  }
+  return (const char *)bytes;
+}
+
+static int AddBinding(Image *image, uint64_t address, const char *symbol, int libraryOrdinal)
+{
+  if (image->bindingCount == image->bindingCapacity) {
+    size_t capacity = image->bindingCapacity ? image->bindingCapacity * 2 : 64;
+    Binding *bindings = realloc(image->bindings, capacity * sizeof(Binding));
+    if (bindings == NULL) {
+      return 0;
+    }
+    image->bindings = bindings;
+    image->bindingCapacity = capacity;
+  }
+  image->bindings[image->bindingCount++] = (Binding){address, symbol, libraryOrdinal};
+  return 1;
+}
+
+static int CompareBindings(const void *a, const void *b)
+{
+  uint64_t left = ((const Binding *)a)->address;
+  uint64_t right = ((const Binding *)b)->address;
+  return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+static const Binding *BindingAtAddress(const Image *image, uint64_t address)
+{
+  size_t low = 0;
+  size_t high = image->bindingCount;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    uint64_t candidate = image->bindings[middle].address;
+    if (candidate == address) {
+      return &image->bindings[middle];
+    } else if (candidate < address) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return NULL;
+}
+
+/**
+ Runs the (non-lazy) bind opcodes from LC_DYLD_INFO, recording which symbol
+ each bound location refers to.
+ */
+static MachOTestEnumeratorResult ParseBindOpcodes(Image *image, const uint8_t *p, const uint8_t *end)
+{
+  int libraryOrdinal = 0;
+  const char *symbol = NULL;
+  uint64_t address = 0;
+  uint64_t value = 0;
+  uint64_t count = 0;
+  uint64_t skip = 0;
+
+#define BIND_OR_FAIL() \
+  do { \
+    if (symbol == NULL || !AddBinding(image, address, symbol, libraryOrdinal)) { \
+      return kMachOTestEnumeratorNotMachO; \
+    } \
+  } while (0)
+
+  while (p < end) {
+    uint8_t opcode = *p & 0xf0;
+    uint8_t immediate = *p & 0x0f;
+    p++;
+
+    switch (opcode) {
+      case 0x00: // BIND_OPCODE_DONE
+        return kMachOTestEnumeratorSuccess;
+      case 0x10: // BIND_OPCODE_SET_DYLIB_ORDINAL_IMM
+        libraryOrdinal = immediate;
+        break;
+      case 0x20: // BIND_OPCODE_SET_DYLIB_ORDINAL_ULEB
+        if (!ReadULEB128(&p, end, &value)) {
+          return kMachOTestEnumeratorNotMachO;
+        }
+        libraryOrdinal = (int)value;
+        break;
+      case 0x30: // BIND_OPCODE_SET_DYLIB_SPECIAL_IMM
+        libraryOrdinal = immediate == 0 ? 0 : (int)(int8_t)(0xf0 | immediate);
+        break;
+      case 0x40: { // BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM
+        const uint8_t *terminator = memchr(p, '\0', (size_t)(end - p));
+        if (terminator == NULL) {
+          return kMachOTestEnumeratorNotMachO;
+        }
+        symbol = (const char *)p;
+        p = terminator + 1;
+        break;
+      }
+      case 0x50: // BIND_OPCODE_SET_TYPE_IMM
+        break;
+      case 0x60: // BIND_OPCODE_SET_ADDEND_SLEB
+        if (!SkipSLEB128(&p, end)) {
+          return kMachOTestEnumeratorNotMachO;
+        }
+        break;
+      case 0x70: // BIND_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB
+        if (immediate >= image->segmentCount || !ReadULEB128(&p, end, &value)) {
+          return kMachOTestEnumeratorNotMachO;
+        }
+        address = image->segments[immediate].vmaddr + value;
+        break;
+      case 0x80: // BIND_OPCODE_ADD_ADDR_ULEB
+        if (!ReadULEB128(&p, end, &value)) {
+          return kMachOTestEnumeratorNotMachO;
+        }
+        address += value;
+        break;
+      case 0x90: // BIND_OPCODE_DO_BIND
+        BIND_OR_FAIL();
+        address += image->pointerSize;
+        break;
+      case 0xa0: // BIND_OPCODE_DO_BIND_ADD_ADDR_ULEB
+        BIND_OR_FAIL();
+        if (!ReadULEB128(&p, end, &value)) {
+          return kMachOTestEnumeratorNotMachO;
+        }
+        address += value + image->pointerSize;
+        break;
+      case 0xb0: // BIND_OPCODE_DO_BIND_ADD_ADDR_IMM_SCALED
+        BIND_OR_FAIL();
+        address += (uint64_t)immediate * image->pointerSize + image->pointerSize;
+        break;
+      case 0xc0: // BIND_OPCODE_DO_BIND_ULEB_TIMES_SKIPPING_ULEB
+        if (!ReadULEB128(&p, end, &count) ||
+            !ReadULEB128(&p, end, &skip) ||
+            count > kMaxBindRepeat) {
+          return kMachOTestEnumeratorNotMachO;
+        }
+        for (uint64_t i = 0; i < count; i++) {
+          BIND_OR_FAIL();
+          address += skip + image->pointerSize;
+        }
+        break;
+      default:
+        // BIND_OPCODE_THREADED (arm64e) or something newer than us.
+        return kMachOTestEnumeratorUnsupported;
+    }
+  }
+
+#undef BIND_OR_FAIL
+
+  return kMachOTestEnumeratorSuccess;
+}
+
+static MachOTestEnumeratorResult ParseChainedFixups(Image *image, uint32_t dataOffset, uint32_t dataSize)
+{
+  const uint8_t *data = BytesAtFileOffset(image, dataOffset, dataSize);
+  if (data == NULL || dataSize < 28) {
+    return kMachOTestEnumeratorNotMachO;
+  }
+
+  // dyld_chained_fixups_header
+  uint32_t startsOffset = ReadU32(data + 4);
+  uint32_t importsOffset = ReadU32(data + 8);
+  uint32_t symbolsOffset = ReadU32(data + 12);
+  uint32_t importsCount = ReadU32(data + 16);
+  uint32_t importsFormat = ReadU32(data + 20);
+  uint32_t symbolsFormat = ReadU32(data + 24);
+
+  if (symbolsFormat != 0) {
+    // Compressed symbol names.
+    return kMachOTestEnumeratorUnsupported;
+  }
+
+  // dyld_chained_starts_in_image, then one dyld_chained_starts_in_segment per
+  // segment with fixups; all we need is the pointer format they use.
+  if (startsOffset > dataSize || dataSize - startsOffset < 4) {
+    return kMachOTestEnumeratorNotMachO;
+  }
+  uint32_t segmentCount = ReadU32(data + startsOffset);
+  if ((uint64_t)segmentCount * 4 > dataSize - startsOffset - 4) {
+    return kMachOTestEnumeratorNotMachO;
+  }
+  uint16_t pointerFormat = 0;
+  for (uint32_t i = 0; i < segmentCount; i++) {
+    uint32_t segmentInfoOffset = ReadU32(data + startsOffset + 4 + 4 * i);
+    if (segmentInfoOffset == 0) {
+      continue;
+    }
+    uint64_t position = (uint64_t)startsOffset + segmentInfoOffset;
+    if (position + 8 > dataSize) {
+      return kMachOTestEnumeratorNotMachO;
+    }
+    uint16_t segmentPointerFormat = ReadU16(data + position + 6);
+    if (pointerFormat != 0 && segmentPointerFormat != pointerFormat) {
+      return kMachOTestEnumeratorUnsupported;
+    }
+    pointerFormat = segmentPointerFormat;
+  }
+
+  switch (pointerFormat) {
+    case 0:
+    case kChainedPointerFormat64:
+    case kChainedPointerFormat64Offset:
+    case kChainedPointerFormat32:
+      break;
+    default:
+      // arm64e and kernel/firmware formats.
+      return kMachOTestEnumeratorUnsupported;
+  }
+
+  uint32_t importSize = 0;
+  switch (importsFormat) {
+    case 1: importSize = 4; break;   // DYLD_CHAINED_IMPORT
+    case 2: importSize = 8; break;   // DYLD_CHAINED_IMPORT_ADDEND
+    case 3: importSize = 16; break;  // DYLD_CHAINED_IMPORT_ADDEND64
+    default:
+      return kMachOTestEnumeratorUnsupported;
+  }
+  if (importsOffset > dataSize ||
+      (uint64_t)importsCount * importSize > dataSize - importsOffset ||
+      symbolsOffset > dataSize) {
+    return kMachOTestEnumeratorNotMachO;
+  }
+
+  image->hasChainedFixups = 1;
+  image->chainedPointerFormat = pointerFormat;
+  image->chainedImports = data + importsOffset;
+  image->chainedImportCount = importsCount;
+  image->chainedImportFormat = importsFormat;
+  image->chainedSymbols = (const char *)data + symbolsOffset;
+  image->chainedSymbolsLength = dataSize - symbolsOffset;
+  return kMachOTestEnumeratorSuccess;
+}
+
+static int ChainedImport(const Image *image, uint64_t ordinal, Pointer *pointer)
+{
+  if (ordinal >= image->chainedImportCount) {
+    return 0;
+  }
+
+  uint32_t nameOffset = 0;
+  if (image->chainedImportFormat == 3) {
+    uint64_t import = ReadU64(image->chainedImports + 16 * ordinal);
+    pointer->libraryOrdinal = (int)(int16_t)(import & 0xffff);
+    nameOffset = (uint32_t)(import >> 32);
+  } else {
+    size_t stride = image->chainedImportFormat == 1 ? 4 : 8;
+    uint32_t import = ReadU32(image->chainedImports + stride * ordinal);
+    pointer->libraryOrdinal = (int)(int8_t)(import & 0xff);
+    nameOffset = import >> 9;
+  }
+
+  if (nameOffset >= image->chainedSymbolsLength ||
+      memchr(image->chainedSymbols + nameOffset, '\0', image->chainedSymbolsLength - nameOffset) == NULL) {
+    return 0;
+  }
+  pointer->isBind = 1;
+  pointer->symbol = image->chainedSymbols + nameOffset;
+  return 1;
+}
+
+static int ReadPointer(const Image *image, uint64_t address, Pointer *pointer)
+{
+  memset(pointer, 0, sizeof(*pointer));
+
+  const Binding *binding = BindingAtAddress(image, address);
+  if (binding != NULL) {
+    pointer->isBind = 1;
+    pointer->symbol = binding->symbol;
+    pointer->libraryOrdinal = binding->libraryOrdinal;
+    return 1;
+  }
+
+  const uint8_t *bytes = BytesAtAddress(image, address, image->pointerSize);
+  if (bytes == NULL) {
+    return 0;
+  }
+  uint64_t raw = image->is64 ? ReadU64(bytes) : ReadU32(bytes);
+
+  if (!image->hasChainedFixups || image->chainedPointerFormat == 0 || raw == 0) {
+    pointer->target = raw;
+    return 1;
+  }
+
+  switch (image->chainedPointerFormat) {
+    case kChainedPointerFormat64:
+    case kChainedPointerFormat64Offset:
+      if (raw >> 63) {
+        return ChainedImport(image, raw & 0xffffff, pointer);
+      }
+      // The top byte (bits 36-43) only carries tags; objc metadata never uses it.
+      pointer->target = raw & 0xfffffffffULL;
+      if (image->chainedPointerFormat == kChainedPointerFormat64Offset) {
+        pointer->target += image->baseAddress;
+      }
+      return 1;
+    case kChainedPointerFormat32:
+      if (raw >> 31) {
+        return ChainedImport(image, raw & 0xfffff, pointer);
+      }
+      pointer->target = raw & 0x3ffffff;
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ Reads a pointer that must point somewhere inside the image.
+ */
+static int ReadLocalPointer(const Image *image, uint64_t address, uint64_t *target)
+{
+  Pointer pointer;
+  if (!ReadPointer(image, address, &pointer) || pointer.isBind) {
+    return 0;
+  }
+  *target = pointer.target;
+  return 1;
+}
+
+static int SectionNameEquals(const uint8_t *field, const char *name)
+{
+  return strncmp((const char *)field, name, 16) == 0;
+}
+
+static MachOTestEnumeratorResult ParseImage(Image *image)
+{
+  if (image->length < 28) {
+    return kMachOTestEnumeratorNotMachO;
+  }
+
+  uint32_t magic = ReadU32(image->bytes);
+  if (magic == kMachMagic64) {
+    image->is64 = 1;
+  } else if (magic != kMachMagic32) {
+    return kMachOTestEnumeratorNotMachO;
+  }
+  image->pointerSize = image->is64 ? 8 : 4;
+
+  size_t headerSize = image->is64 ? 32 : 28;
+  uint32_t commandCount = ReadU32(image->bytes + 16);
+  uint32_t commandsSize = ReadU32(image->bytes + 20);
+  if (image->length < headerSize ||
+      commandsSize > image->length - headerSize ||
+      commandCount > commandsSize / 8) {
+    return kMachOTestEnumeratorNotMachO;
+  }
+
+  image->segments = calloc(commandCount + 1, sizeof(Segment));
+  image->dylibs = calloc(commandCount + 1, sizeof(const char *));
+  if (image->segments == NULL || image->dylibs == NULL) {
+    return kMachOTestEnumeratorNotMachO;
+  }
+
+  uint32_t bindOffset = 0;
+  uint32_t bindSize = 0;
+  uint32_t chainedFixupsOffset = 0;
+  uint32_t chainedFixupsSize = 0;
+  int hasChainedFixupsCommand = 0;
+
+  size_t offset = headerSize;
+  size_t end = headerSize + commandsSize;
+  for (uint32_t i = 0; i < commandCount; i++) {
+    if (end - offset < 8) {
+      return kMachOTestEnumeratorNotMachO;
+    }
+    const uint8_t *command = image->bytes + offset;
+    uint32_t cmd = ReadU32(command);
+    uint32_t cmdsize = ReadU32(command + 4);
+    if (cmdsize < 8 || cmdsize > end - offset) {
+      return kMachOTestEnumeratorNotMachO;
+    }
+
+    switch (cmd) {
+      case kLoadCommandSegment32:
+      case kLoadCommandSegment64: {
+        int is64 = cmd == kLoadCommandSegment64;
+        size_t segmentHeaderSize = is64 ? 72 : 56;
+        size_t sectionSize = is64 ? 80 : 68;
+        if (cmdsize < segmentHeaderSize) {
+          return kMachOTestEnumeratorNotMachO;
+        }
+        Segment *segment = &image->segments[image->segmentCount++];
+        memcpy(segment->name, command + 8, 16);
+        segment->vmaddr = is64 ? ReadU64(command + 24) : ReadU32(command + 24);
+        segment->fileoff = is64 ? ReadU64(command + 40) : ReadU32(command + 32);
+        segment->filesize = is64 ? ReadU64(command + 48) : ReadU32(command + 36);
+        uint32_t sectionCount = ReadU32(command + (is64 ? 64 : 48));
+        if ((uint64_t)sectionCount * sectionSize > cmdsize - segmentHeaderSize) {
+          return kMachOTestEnumeratorNotMachO;
+        }
+
+        if (strcmp(segment->name, "__TEXT") == 0) {
+          image->baseAddress = segment->vmaddr;
+        } else if (strcmp(segment->name, "__OBJC") == 0) {
+          image->hasObjC1Metadata = 1;
+        }
+
+        for (uint32_t j = 0; j < sectionCount; j++) {
+          const uint8_t *section = command + segmentHeaderSize + j * sectionSize;
+          uint64_t address = is64 ? ReadU64(section + 32) : ReadU32(section + 32);
+          uint64_t size = is64 ? ReadU64(section + 40) : ReadU32(section + 36);
+          uint64_t *addressField = NULL;
+          uint64_t *sizeField = NULL;
+          if (SectionNameEquals(section, "__objc_classlist")) {
+            addressField = &image->classListAddress;
+            sizeField = &image->classListSize;
+          } else if (SectionNameEquals(section, "__objc_catlist")) {
+            addressField = &image->categoryListAddress;
+            sizeField = &image->categoryListSize;
+          } else {
+            continue;
+          }
+          if (*sizeField != 0) {
+            // The linker merges these; more than one means something unusual.
+            return kMachOTestEnumeratorUnsupported;
+          }
+          *addressField = address;
+          *sizeField = size;
+        }
+        break;
+      }
+      case kLoadCommandLoadDylib:
+      case kLoadCommandLoadWeakDylib:
+      case kLoadCommandReexportDylib:
+      case kLoadCommandLazyLoadDylib:
+      case kLoadCommandLoadUpwardDylib: {
+        uint32_t nameOffset = cmdsize >= 12 ? ReadU32(command + 8) : cmdsize;
+        if (nameOffset >= cmdsize ||
+            memchr(command + nameOffset, '\0', cmdsize - nameOffset) == NULL) {
+          return kMachOTestEnumeratorNotMachO;
+        }
+        image->dylibs[image->dylibCount++] = (const char *)command + nameOffset;
+        break;
+      }
+      case kLoadCommandDyldInfo:
+      case kLoadCommandDyldInfoOnly:
+        if (cmdsize < 48) {
+          return kMachOTestEnumeratorNotMachO;
+        }
+        bindOffset = ReadU32(command + 16);
+        bindSize = ReadU32(command + 20);
+        break;
+      case kLoadCommandDyldChainedFixups:
+        if (cmdsize < 16) {
+          return kMachOTestEnumeratorNotMachO;
+        }
+        hasChainedFixupsCommand = 1;
+        chainedFixupsOffset = ReadU32(command + 8);
+        chainedFixupsSize = ReadU32(command + 12);
+        break;
+    }
+
+    offset += cmdsize;
+  }
+
+  // Binds refer to segments by index, so wait until we've seen them all.
+  if (bindSize > 0) {
+    const uint8_t *opcodes = BytesAtFileOffset(image, bindOffset, bindSize);
+    if (opcodes == NULL) {
+      return kMachOTestEnumeratorNotMachO;
+    }
+    MachOTestEnumeratorResult result = ParseBindOpcodes(image, opcodes, opcodes + bindSize);
+    if (result != kMachOTestEnumeratorSuccess) {
+      return result;
+    }
+    if (image->bindingCount > 0) {
+      qsort(image->bindings, image->bindingCount, sizeof(Binding), CompareBindings);
+    }
+  }
+
+  if (hasChainedFixupsCommand) {
+    MachOTestEnumeratorResult result = ParseChainedFixups(image, chainedFixupsOffset, chainedFixupsSize);
+    if (result != kMachOTestEnumeratorSuccess) {
+      return result;
+    }
+  }
+
+  return kMachOTestEnumeratorSuccess;
+}
+
+static void FreeImage(Image *image)
+{
+  free(image->segments);
+  free(image->dylibs);
+  free(image->bindings);
+}
+
+static const uint8_t *SelectSlice(const uint8_t *bytes,
+                                  size_t length,
+                                  int32_t preferredCPUType,
+                                  size_t *sliceLength)
+{
+  if (length < 8) {
+    return NULL;
+  }
+
+  uint32_t magic = ReadBigEndianU32(bytes);
+  if (magic != kFatMagic32 && magic != kFatMagic64) {
+    *sliceLength = length;
+    return bytes;
+  }
+
+  // Fat headers are always big-endian.
+  int is64 = magic == kFatMagic64;
+  size_t archSize = is64 ? 32 : 20;
+  uint32_t archCount = ReadBigEndianU32(bytes + 4);
+  if ((uint64_t)archCount * archSize > length - 8) {
+    return NULL;
+  }
+
+  const uint8_t *firstSlice = NULL;
+  size_t firstSliceLength = 0;
+  for (uint32_t i = 0; i < archCount; i++) {
+    const uint8_t *arch = bytes + 8 + i * archSize;
+    int32_t cpuType = (int32_t)ReadBigEndianU32(arch);
+    uint64_t offset = is64 ? ReadBigEndianU64(arch + 8) : ReadBigEndianU32(arch + 8);
+    uint64_t size = is64 ? ReadBigEndianU64(arch + 16) : ReadBigEndianU32(arch + 12);
+    if (offset > length || size > length - offset) {
+      return NULL;
+    }
+    if (cpuType == preferredCPUType) {
+      *sliceLength = (size_t)size;
+      return bytes + offset;
+    }
+    if (firstSlice == NULL) {
+      firstSlice = bytes + offset;
+      firstSliceLength = (size_t)size;
+    }
+  }
+
+  *sliceLength = firstSliceLength;
+  return firstSlice;
+}
+
+#pragma mark Objective-C metadata
+
+typedef enum {
+  kClassUnclassified = 0,
+  kClassBeingClassified,
+  kClassIsTestCase,
+  kClassIsNotTestCase,
+} ClassKind;
+
+typedef struct {
+  uint64_t address;
+  const char *name;
+  Pointer superclass;
+  uint64_t methodList;
+  uint64_t classMethodList;
+  ClassKind kind;
+} ClassInfo;
+
+typedef struct {
+  const Image *image;
+  ClassInfo *classes;
+  size_t classCount;
+} Metadata;
+
+/**
+ Reads the name and base method list out of a class_ro_t.
+ */
+static int ReadClassData(const Image *image, uint64_t classAddress, const char **name, uint64_t *methodList)
+{
+  uint64_t data = 0;
+  // class_t is {isa, superclass, cache, vtable, data}; the low bits of `data`
+  // are flags (e.g. for Swift classes), three of them on 64-bit and two on
+  // 32-bit where class_ro_t is only 4-byte aligned.
+  if (!ReadLocalPointer(image, classAddress + 4 * image->pointerSize, &data)) {
+    return 0;
+  }
+  data &= image->is64 ? ~(uint64_t)7 : ~(uint64_t)3;
+
+  // class_ro_t is {flags, instanceStart, instanceSize, [reserved on 64-bit],
+  // ivarLayout, name, baseMethods, ...}.
+  uint64_t nameField = data + (image->is64 ? 24 : 16);
+  uint64_t methodsField = nameField + image->pointerSize;
+
+  uint64_t nameAddress = 0;
+  if (!ReadLocalPointer(image, nameField, &nameAddress) ||
+      !ReadLocalPointer(image, methodsField, methodList)) {
+    return 0;
+  }
+  if (name != NULL) {
+    *name = StringAtAddress(image, nameAddress);
+    if (*name == NULL) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int ReadClass(const Image *image, uint64_t address, ClassInfo *info)
+{
+  memset(info, 0, sizeof(*info));
+  info->address = address;
+
+  uint64_t metaclass = 0;
+  if (!ReadLocalPointer(image, address, &metaclass) ||
+      !ReadPointer(image, address + image->pointerSize, &info->superclass) ||
+      !ReadClassData(image, address, &info->name, &info->methodList) ||
+      !ReadClassData(image, metaclass, NULL, &info->classMethodList)) {
+    return 0;
+  }
+  return 1;
+}
+
+static int CompareClasses(const void *a, const void *b)
+{
+  uint64_t left = ((const ClassInfo *)a)->address;
+  uint64_t right = ((const ClassInfo *)b)->address;
+  return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+static ClassInfo *ClassAtAddress(const Metadata *metadata, uint64_t address)
+{
+  ClassInfo key = {0};
+  key.address = address;
+  return bsearch(&key, metadata->classes, metadata->classCount, sizeof(ClassInfo), CompareClasses);
+}
+
+/**
+ Returns the in-image superclass of `info`, or NULL if it's a root class or its
+ superclass lives in another image.
+ */
+static ClassInfo *LocalSuperclass(const Metadata *metadata, const ClassInfo *info)
+{
+  if (info->superclass.isBind || info->superclass.target == 0) {
+    return NULL;
+  }
+  return ClassAtAddress(metadata, info->superclass.target);
+}
+
+typedef int (*MethodVisitor)(const char *name, const char *types, void *context);
+
+/**
+ Calls `visitor` for each method in a method_list_t, stopping early (and
+ returning 0) if the visitor returns 0.
+ */
+static MachOTestEnumeratorResult EnumerateMethods(const Image *image,
+                                                  uint64_t listAddress,
+                                                  MethodVisitor visitor,
+                                                  void *context,
+                                                  int *stopped)
+{
+  *stopped = 0;
+  if (listAddress == 0) {
+    return kMachOTestEnumeratorSuccess;
+  }
+
+  const uint8_t *header = BytesAtAddress(image, listAddress, 8);
+  if (header == NULL) {
+    return kMachOTestEnumeratorNotMachO;
+  }
+  uint32_t entrySizeAndFlags = ReadU32(header);
+  uint32_t count = ReadU32(header + 4);
+  int isSmall = (entrySizeAndFlags & kSmallMethodListFlag) != 0;
+  uint32_t entrySize = entrySizeAndFlags & kMethodListEntrySizeMask;
+  if (entrySize < (isSmall ? 12 : 3 * image->pointerSize) || count > kMaxMethodsPerList) {
+    return kMachOTestEnumeratorNotMachO;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t entry = listAddress + 8 + (uint64_t)i * entrySize;
+    uint64_t nameAddress = 0;
+    uint64_t typesAddress = 0;
+
+    if (isSmall) {
+      // {int32 name, int32 types, int32 imp}, each relative to its own field;
+      // `name` points at a selector reference rather than the string.
+      const uint8_t *fields = BytesAtAddress(image, entry, 12);
+      if (fields == NULL) {
+        return kMachOTestEnumeratorNotMachO;
+      }
+      uint64_t selectorReference = entry + (uint64_t)(int64_t)(int32_t)ReadU32(fields);
+      typesAddress = entry + 4 + (uint64_t)(int64_t)(int32_t)ReadU32(fields + 4);
+      if (!ReadLocalPointer(image, selectorReference, &nameAddress)) {
+        return kMachOTestEnumeratorUnsupported;
+      }
+    } else {
+      if (!ReadLocalPointer(image, entry, &nameAddress) ||
+          !ReadLocalPointer(image, entry + image->pointerSize, &typesAddress)) {
+        return kMachOTestEnumeratorNotMachO;
+      }
+    }
+
+    const char *name = StringAtAddress(image, nameAddress);
+    const char *types = StringAtAddress(image, typesAddress);
+    if (name == NULL || types == NULL) {
+      return kMachOTestEnumeratorNotMachO;
+    }
+    if (!visitor(name, types, context)) {
+      *stopped = 1;
+      return kMachOTestEnumeratorSuccess;
+    }
+  }
+  return kMachOTestEnumeratorSuccess;
+}
+
+static int IsTestMethod(const char *name, const char *types)
+{
+  // Same rule as XCTest and SenTestingKit: an instance method named test*
+  // that takes no arguments and returns void.
+  return strncmp(name, "test", 4) == 0 && strchr(name, ':') == NULL && types[0] == 'v';
+}
+
+static int StopAtDynamicTestHook(const char *name, const char *types, void *context)
+{
+  for (size_t i = 0; i < sizeof(kDynamicTestHooks) / sizeof(kDynamicTestHooks[0]); i++) {
+    if (strcmp(name, kDynamicTestHooks[i]) == 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int StopAtTestMethod(const char *name, const char *types, void *context)
+{
+  return !IsTestMethod(name, types);
+}
+
+static int HasPrefix(const char *string, const char *prefix)
+{
+  return strncmp(string, prefix, strlen(prefix)) == 0;
+}
+
+static int IsTestCaseRootName(const char *name)
+{
+  return strcmp(name, "XCTestCase") == 0 || strcmp(name, "SenTestCase") == 0;
+}
+
+/**
+ Decides whether a class from another image is a test case class.  We can only
+ tell for the test case roots themselves, and for classes from the system or
+ the testing frameworks, which are never test cases.
+ */
+static MachOTestEnumeratorResult ClassifyExternalClass(const Image *image, const Pointer *pointer, ClassKind *kind)
+{
+  if (pointer->symbol == NULL || !HasPrefix(pointer->symbol, kClassSymbolPrefix)) {
+    return kMachOTestEnumeratorUnsupported;
+  }
+  const char *name = pointer->symbol + strlen(kClassSymbolPrefix);
+  if (IsTestCaseRootName(name)) {
+    *kind = kClassIsTestCase;
+    return kMachOTestEnumeratorSuccess;
+  }
+
+  if (pointer->libraryOrdinal >= 1 && (uint32_t)pointer->libraryOrdinal <= image->dylibCount) {
+    const char *installName = image->dylibs[pointer->libraryOrdinal - 1];
+    if (HasPrefix(installName, "/System/Library/") ||
+        HasPrefix(installName, "/usr/lib/") ||
+        strstr(installName, "/XCTest.framework/") != NULL ||
+        strstr(installName, "/SenTestingKit.framework/") != NULL) {
+      *kind = kClassIsNotTestCase;
+      return kMachOTestEnumeratorSuccess;
+    }
+  }
+
+  // From the host app, another framework of the project, or a flat namespace
+  // lookup: it might be a test case class we can't see.
+  return kMachOTestEnumeratorUnsupported;
+}
+
+static MachOTestEnumeratorResult ClassifyClass(const Metadata *metadata, ClassInfo *info)
+{
+  if (info->kind == kClassIsTestCase || info->kind == kClassIsNotTestCase) {
+    return kMachOTestEnumeratorSuccess;
+  }
+  if (info->kind == kClassBeingClassified) {
+    // Superclass cycle.
+    return kMachOTestEnumeratorNotMachO;
+  }
+
+  if (info->superclass.isBind) {
+    return ClassifyExternalClass(metadata->image, &info->superclass, &info->kind);
+  }
+  if (info->superclass.target == 0) {
+    info->kind = kClassIsNotTestCase;
+    return kMachOTestEnumeratorSuccess;
+  }
+
+  ClassInfo *superclass = LocalSuperclass(metadata, info);
+  if (superclass == NULL) {
+    return kMachOTestEnumeratorUnsupported;
+  }
+
+  info->kind = kClassBeingClassified;
+  MachOTestEnumeratorResult result = ClassifyClass(metadata, superclass);
+  info->kind = superclass->kind;
+  return result;
+}
+
+/**
+ Categories can add tests or test hooks to any class, so bail if one that
+ targets a test case class does.
+ */
+static MachOTestEnumeratorResult CheckCategories(const Metadata *metadata)
+{
+  const Image *image = metadata->image;
+  uint64_t count = image->categoryListSize / image->pointerSize;
+
+  for (uint64_t i = 0; i < count; i++) {
+    uint64_t category = 0;
+    if (!ReadLocalPointer(image, image->categoryListAddress + i * image->pointerSize, &category)) {
+      return kMachOTestEnumeratorNotMachO;
+    }
+
+    // category_t is {name, cls, instanceMethods, classMethods, ...}.
+    Pointer target;
+    uint64_t instanceMethods = 0;
+    uint64_t classMethods = 0;
+    if (!ReadPointer(image, category + image->pointerSize, &target) ||
+        !ReadLocalPointer(image, category + 2 * image->pointerSize, &instanceMethods) ||
+        !ReadLocalPointer(image, category + 3 * image->pointerSize, &classMethods)) {
+      return kMachOTestEnumeratorNotMachO;
+    }
+
+    ClassKind kind = kClassUnclassified;
+    if (target.isBind) {
+      if (ClassifyExternalClass(image, &target, &kind) != kMachOTestEnumeratorSuccess) {
+        // A category on some class we can't see into; harmless unless it adds
+        // test-looking methods.
+        kind = kClassIsTestCase;
+      }
+    } else if (target.target != 0) {
+      ClassInfo *info = ClassAtAddress(metadata, target.target);
+      if (info == NULL) {
+        return kMachOTestEnumeratorUnsupported;
+      }
+      kind = info->kind;
+    }
+    if (kind != kClassIsTestCase) {
+      continue;
+    }
+
+    int stopped = 0;
+    MachOTestEnumeratorResult result = EnumerateMethods(image, instanceMethods, StopAtTestMethod, NULL, &stopped);
+    if (result != kMachOTestEnumeratorSuccess) {
+      return result;
+    }
+    if (stopped) {
+      return kMachOTestEnumeratorDynamicTests;
+    }
+    result = EnumerateMethods(image, classMethods, StopAtDynamicTestHook, NULL, &stopped);
+    if (result != kMachOTestEnumeratorSuccess) {
+      return result;
+    }
+    if (stopped) {
+      return kMachOTestEnumeratorDynamicTests;
+    }
+  }
+  return kMachOTestEnumeratorSuccess;
+}
+
+typedef struct {
+  const char **names;
+  size_t count;
+  size_t capacity;
+  int failed;
+} TestMethodSet;
+
+static int CollectTestMethod(const char *name, const char *types, void *context)
+{
+  TestMethodSet *set = context;
+  if (!IsTestMethod(name, types)) {
+    return 1;
+  }
+  // Overrides of inherited tests are the same test.
+  for (size_t i = 0; i < set->count; i++) {
+    if (strcmp(set->names[i], name) == 0) {
+      return 1;
+    }
+  }
+  if (set->count == set->capacity) {
+    size_t capacity = set->capacity ? set->capacity * 2 : 32;
+    const char **names = realloc((void *)set->names, capacity * sizeof(const char *));
+    if (names == NULL) {
+      set->failed = 1;
+      return 0;
+    }
+    set->names = names;
+    set->capacity = capacity;
+  }
+  set->names[set->count++] = name;
+  return 1;
+}
+
+static MachOTestEnumeratorResult EnumerateTests(const Image *image,
+                                                MachOTestEnumeratorCallback callback,
+                                                void *context)
+{
+  if (image->classListSize == 0) {
+    return image->hasObjC1Metadata ? kMachOTestEnumeratorUnsupported : kMachOTestEnumeratorSuccess;
+  }
+
+  if (BytesAtAddress(image, image->classListAddress, image->classListSize) == NULL) {
+    return kMachOTestEnumeratorNotMachO;
+  }
+
+  Metadata metadata = {image, NULL, (size_t)(image->classListSize / image->pointerSize)};
+  metadata.classes = calloc(metadata.classCount, sizeof(ClassInfo));
+  if (metadata.classes == NULL) {
+    return kMachOTestEnumeratorNotMachO;
+  }
+
+  MachOTestEnumeratorResult result = kMachOTestEnumeratorSuccess;
+  TestMethodSet methods = {NULL, 0, 0, 0};
+
+  for (size_t i = 0; i < metadata.classCount; i++) {
+    uint64_t address = 0;
+    if (!ReadLocalPointer(image, image->classListAddress + i * image->pointerSize, &address) ||
+        !ReadClass(image, address, &metadata.classes[i])) {
+      result = kMachOTestEnumeratorNotMachO;
+      goto done;
+    }
+  }
+  qsort(metadata.classes, metadata.classCount, sizeof(ClassInfo), CompareClasses);
+
+  for (size_t i = 0; i < metadata.classCount; i++) {
+    result = ClassifyClass(&metadata, &metadata.classes[i]);
+    if (result != kMachOTestEnumeratorSuccess) {
+      goto done;
+    }
+  }
+
+  result = CheckCategories(&metadata);
+  if (result != kMachOTestEnumeratorSuccess) {
+    goto done;
+  }
+
+  // Check every test class before reporting anything, so that we don't emit
+  // half a list.
+  for (size_t i = 0; i < metadata.classCount; i++) {
+    ClassInfo *info = &metadata.classes[i];
+    if (info->kind != kClassIsTestCase) {
+      continue;
+    }
+    if (HasPrefix(info->name, "_Tt") || strchr(info->name, '.') != NULL) {
+      // Swift: the runtime name is demangled from this.
+      result = kMachOTestEnumeratorUnsupported;
+      goto done;
+    }
+    for (ClassInfo *cls = info; cls != NULL; cls = LocalSuperclass(&metadata, cls)) {
+      int stopped = 0;
+      result = EnumerateMethods(image, cls->classMethodList, StopAtDynamicTestHook, NULL, &stopped);
+      if (result == kMachOTestEnumeratorSuccess && stopped) {
+        result = kMachOTestEnumeratorDynamicTests;
+      }
+      if (result != kMachOTestEnumeratorSuccess) {
+        goto done;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < metadata.classCount; i++) {
+    ClassInfo *info = &metadata.classes[i];
+    if (info->kind != kClassIsTestCase) {
+      continue;
+    }
+    methods.count = 0;
+    for (ClassInfo *cls = info; cls != NULL; cls = LocalSuperclass(&metadata, cls)) {
+      int stopped = 0;
+      result = EnumerateMethods(image, cls->methodList, CollectTestMethod, &methods, &stopped);
+      if (result != kMachOTestEnumeratorSuccess) {
+        goto done;
+      }
+      if (methods.failed) {
+        result = kMachOTestEnumeratorNotMachO;
+        goto done;
+      }
+    }
+    for (size_t j = 0; j < methods.count; j++) {
+      callback(info->name, methods.names[j], context);
+    }
+  }
+
+done:
+  free((void *)methods.names);
+  free(metadata.classes);
+  return result;
+}
+
+#pragma mark Public
+
+MachOTestEnumeratorResult MachOEnumerateTestMethods(const void *bytes,
+                                                    size_t length,
+                                                    int32_t preferredCPUType,
+                                                    MachOTestEnumeratorCallback callback,
+                                                    void *context)
+{
+  Image image;
+  memset(&image, 0, sizeof(image));
+  image.bytes = SelectSlice(bytes, length, preferredCPUType, &image.length);
+  if (image.bytes == NULL) {
+    return kMachOTestEnumeratorNotMachO;
+  }
+
+  MachOTestEnumeratorResult result = ParseImage(&image);
+  if (result == kMachOTestEnumeratorSuccess) {
+    result = EnumerateTests(&image, callback, context);
+  }
+  FreeImage(&image);
+  return result;
+}
+
+const char *MachOTestEnumeratorResultDescription(MachOTestEnumeratorResult result)
+{
+  switch (result) {
+    case kMachOTestEnumeratorSuccess:
+      return "success";
+    case kMachOTestEnumeratorNotMachO:
+      return "not a valid Mach-O image";
+    case kMachOTestEnumeratorUnsupported:
+      return "uses metadata that can't be read statically";
+    case kMachOTestEnumeratorDynamicTests:
+      return "may generate tests at runtime";
+  }
+  return "unknown";
+}
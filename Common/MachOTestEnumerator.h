@@ -0,0 +1,84 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/**
+ Lists the XCTest/SenTestingKit test methods in a Mach-O image by reading its
+ Objective-C metadata (class list, superclass chains and method lists) straight
+ from the file, without loading it.
+
+ This is plain C with its own copies of the few Mach-O and objc2 structures it
+ needs, so it builds and can be tested on any platform.
+
+ Anything that can't be interpreted with certainty is reported as such rather
+ than guessed at, and the caller is expected to fall back to loading the bundle:
+ superclasses from libraries other than the system's or the testing
+ framework's, Swift class names, objc1 metadata, arm64e pointers, and test
+ classes (or categories) that implement +testInvocations, +defaultTestSuite or
+ similar hooks that generate tests at runtime.
+ */
+
+#ifndef MachOTestEnumerator_h
+#define MachOTestEnumerator_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  kMachOTestEnumeratorSuccess = 0,
+  // Not a Mach-O image, or truncated/malformed.
+  kMachOTestEnumeratorNotMachO,
+  // Uses metadata or fixup formats we can't read with certainty.
+  kMachOTestEnumeratorUnsupported,
+  // Some test class may generate its tests at runtime.
+  kMachOTestEnumeratorDynamicTests,
+} MachOTestEnumeratorResult;
+
+typedef void (*MachOTestEnumeratorCallback)(const char *className,
+                                            const char *methodName,
+                                            void *context);
+
+/**
+ Calls `callback` once for every test method of every test case class in the
+ image, including test methods inherited from superclasses in the same image.
+ Tests come out grouped by class, in no particular order.
+
+ The callback may already have been called when an error is returned, so
+ callers should only use the results after kMachOTestEnumeratorSuccess.
+
+ @param bytes Contents of the executable; thin or fat.
+ @param preferredCPUType For fat files, the `cputype` of the slice to read.  If
+   there is no such slice, the first one is used.
+ */
+MachOTestEnumeratorResult MachOEnumerateTestMethods(const void *bytes,
+                                                    size_t length,
+                                                    int32_t preferredCPUType,
+                                                    MachOTestEnumeratorCallback callback,
+                                                    void *context);
+
+/**
+ Short human readable explanation of a result, for diagnostics.
+ */
+const char *MachOTestEnumeratorResultDescription(MachOTestEnumeratorResult result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
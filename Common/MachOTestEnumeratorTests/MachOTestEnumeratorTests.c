@@ -0,0 +1,294 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/**
+ Runs MachOTestEnumerator against the Mach-O fixtures under TestData and
+ checks it lists the same tests StaticTestQueryTests expects.  It's plain C so
+ the reader can be tested, and run under sanitizers, on any platform:
+
+   make -C Common/MachOTestEnumeratorTests test
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MachOTestEnumerator.h"
+
+// From <mach/machine.h>, which isn't around everywhere.
+#define TEST_CPU_TYPE_I386 ((int32_t)7)
+#define TEST_CPU_TYPE_X86_64 ((int32_t)(7 | 0x01000000))
+
+typedef struct {
+  char **names;
+  size_t count;
+  size_t capacity;
+} TestNames;
+
+static int failureCount = 0;
+
+#define CHECK(condition, ...) \
+  do { \
+    if (!(condition)) { \
+      fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+      fprintf(stderr, __VA_ARGS__); \
+      fprintf(stderr, "\n"); \
+      failureCount++; \
+    } \
+  } while (0)
+
+static void AddTestName(const char *className, const char *methodName, void *context)
+{
+  TestNames *testNames = context;
+  if (testNames->count == testNames->capacity) {
+    testNames->capacity = testNames->capacity ? testNames->capacity * 2 : 16;
+    testNames->names = realloc(testNames->names, testNames->capacity * sizeof(char *));
+    if (testNames->names == NULL) {
+      abort();
+    }
+  }
+  size_t length = strlen(className) + 1 + strlen(methodName) + 1;
+  char *name = malloc(length);
+  if (name == NULL) {
+    abort();
+  }
+  snprintf(name, length, "%s/%s", className, methodName);
+  testNames->names[testNames->count++] = name;
+}
+
+static void FreeTestNames(TestNames *testNames)
+{
+  for (size_t i = 0; i < testNames->count; i++) {
+    free(testNames->names[i]);
+  }
+  free(testNames->names);
+  memset(testNames, 0, sizeof(*testNames));
+}
+
+static int CompareStrings(const void *a, const void *b)
+{
+  return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static uint8_t *ReadFile(const char *path, size_t *length)
+{
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  uint8_t *bytes = NULL;
+  if (fseek(file, 0, SEEK_END) == 0) {
+    long size = ftell(file);
+    if (size >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+      // Exactly as long as the file, so reading past it trips ASan.
+      bytes = malloc(size > 0 ? (size_t)size : 1);
+      if (bytes != NULL && fread(bytes, 1, (size_t)size, file) == (size_t)size) {
+        *length = (size_t)size;
+      } else {
+        free(bytes);
+        bytes = NULL;
+      }
+    }
+  }
+  fclose(file);
+  return bytes;
+}
+
+/**
+ Enumerates the tests in the executable at `path` (relative to TestData) and
+ checks the result, and for kMachOTestEnumeratorSuccess the sorted list of
+ tests, which `expected` ends with NULL.
+ */
+static void CheckEnumeration(const char *testDataDir,
+                             const char *path,
+                             int32_t cpuType,
+                             MachOTestEnumeratorResult expectedResult,
+                             const char **expected)
+{
+  char fullPath[4096];
+  snprintf(fullPath, sizeof(fullPath), "%s/%s", testDataDir, path);
+
+  size_t length = 0;
+  uint8_t *bytes = ReadFile(fullPath, &length);
+  CHECK(bytes != NULL, "Couldn't read %s", fullPath);
+  if (bytes == NULL) {
+    return;
+  }
+
+  TestNames testNames = {0};
+  MachOTestEnumeratorResult result = MachOEnumerateTestMethods(bytes, length, cpuType, AddTestName, &testNames);
+  CHECK(result == expectedResult, "%s: expected '%s', got '%s'", path,
+        MachOTestEnumeratorResultDescription(expectedResult),
+        MachOTestEnumeratorResultDescription(result));
+
+  if (result == kMachOTestEnumeratorSuccess && expectedResult == kMachOTestEnumeratorSuccess) {
+    size_t expectedCount = 0;
+    while (expected[expectedCount] != NULL) {
+      expectedCount++;
+    }
+    CHECK(testNames.count == expectedCount, "%s: expected %zu tests, got %zu",
+          path, expectedCount, testNames.count);
+
+    qsort(testNames.names, testNames.count, sizeof(char *), CompareStrings);
+    for (size_t i = 0; i < expectedCount && i < testNames.count; i++) {
+      CHECK(strcmp(expected[i], testNames.names[i]) == 0, "%s: expected test %zu to be %s, got %s",
+            path, i, expected[i], testNames.names[i]);
+    }
+  }
+
+  FreeTestNames(&testNames);
+  free(bytes);
+}
+
+static void CheckRejectsTruncatedAndNonMachOData(const char *testDataDir)
+{
+  char fullPath[4096];
+  snprintf(fullPath, sizeof(fullPath), "%s/%s", testDataDir,
+           "tests-osx-test-bundle/TestProject-Library-XCTest-OSXTests.xctest/Contents/MacOS/TestProject-Library-XCTest-OSXTests");
+  size_t length = 0;
+  uint8_t *bytes = ReadFile(fullPath, &length);
+  CHECK(bytes != NULL, "Couldn't read %s", fullPath);
+  if (bytes == NULL) {
+    return;
+  }
+
+  // Anything short of the whole file loses the linkedit data at its end.  Each
+  // prefix gets a buffer of its own so reads past it are caught.
+  for (size_t prefixLength = 0; prefixLength < length / 2; prefixLength += 97) {
+    uint8_t *prefix = malloc(prefixLength > 0 ? prefixLength : 1);
+    if (prefix == NULL) {
+      abort();
+    }
+    memcpy(prefix, bytes, prefixLength);
+    MachOTestEnumeratorResult result = MachOEnumerateTestMethods(prefix, prefixLength, TEST_CPU_TYPE_X86_64, NULL, NULL);
+    CHECK(result == kMachOTestEnumeratorNotMachO, "First %zu bytes: expected '%s', got '%s'", prefixLength,
+          MachOTestEnumeratorResultDescription(kMachOTestEnumeratorNotMachO),
+          MachOTestEnumeratorResultDescription(result));
+    free(prefix);
+  }
+  free(bytes);
+
+  const char *text = "#!/bin/sh\necho not a binary\n";
+  CHECK(MachOEnumerateTestMethods(text, strlen(text), TEST_CPU_TYPE_X86_64, NULL, NULL) == kMachOTestEnumeratorNotMachO,
+        "Expected a shell script not to be taken for Mach-O");
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s path/to/TestData\n", argv[0]);
+    return 2;
+  }
+  const char *testDataDir = argv[1];
+
+  CheckEnumeration(testDataDir,
+                   "tests-osx-test-bundle/TestProject-Library-XCTest-OSXTests.xctest/Contents/MacOS/TestProject-Library-XCTest-OSXTests",
+                   TEST_CPU_TYPE_X86_64,
+                   kMachOTestEnumeratorSuccess,
+                   (const char *[]){
+                     "TestProject_Library_XCTest_OSXTests/testOutput",
+                     "TestProject_Library_XCTest_OSXTests/testWillFail",
+                     "TestProject_Library_XCTest_OSXTests/testWillPass",
+                     NULL,
+                   });
+
+  CheckEnumeration(testDataDir,
+                   "TestProject-App-OSX/Build/Products/Debug/TestProject-App-OSXTests.xctest/Contents/MacOS/TestProject-App-OSXTests",
+                   TEST_CPU_TYPE_X86_64,
+                   kMachOTestEnumeratorSuccess,
+                   (const char *[]){
+                     "TestProject_App_OSXTests/testCanUseSymbolsFromTestHost",
+                     "TestProject_App_OSXTests/testOutput",
+                     "TestProject_App_OSXTests/testStandardDirectories",
+                     "TestProject_App_OSXTests/testWillFail",
+                     "TestProject_App_OSXTests/testWillPass",
+                     NULL,
+                   });
+
+  // i386 + x86_64; both slices have the same tests.
+  const char *iOSXCTestNames[] = {
+    "OtherTests/testSomething",
+    "SetupTimeoutTests/testNothing",
+    "SomeTests/testAborts",
+    "SomeTests/testBacktraceOutputIsCaptured",
+    "SomeTests/testCrash",
+    "SomeTests/testExits",
+    "SomeTests/testHandlingOfUnicodeStrings",
+    "SomeTests/testOutputMerging",
+    "SomeTests/testPrintSDK",
+    "SomeTests/testStream",
+    "SomeTests/testTimeout",
+    "SomeTests/testWillFail",
+    "SomeTests/testWillPass",
+    "TeardownTimeoutTests/testNothing",
+    "TimeoutTests/testTimeout",
+    NULL,
+  };
+  CheckEnumeration(testDataDir,
+                   "tests-ios-test-bundle/TestProject-Library-XCTest-iOSTests.xctest/TestProject-Library-XCTest-iOSTests",
+                   TEST_CPU_TYPE_X86_64,
+                   kMachOTestEnumeratorSuccess,
+                   iOSXCTestNames);
+  CheckEnumeration(testDataDir,
+                   "tests-ios-test-bundle/TestProject-Library-XCTest-iOSTests.xctest/TestProject-Library-XCTest-iOSTests",
+                   TEST_CPU_TYPE_I386,
+                   kMachOTestEnumeratorSuccess,
+                   iOSXCTestNames);
+
+  CheckEnumeration(testDataDir,
+                   "tests-ios-test-bundle/TestProject-LibraryTests.octest/TestProject-LibraryTests",
+                   TEST_CPU_TYPE_I386,
+                   kMachOTestEnumeratorSuccess,
+                   (const char *[]){
+                     "OtherTests/testSomething",
+                     "SomeTests/testBacktraceOutputIsCaptured",
+                     "SomeTests/testOutputMerging",
+                     "SomeTests/testPrintSDK",
+                     "SomeTests/testStream",
+                     "SomeTests/testTimeout",
+                     "SomeTests/testWillFail",
+                     "SomeTests/testWillPass",
+                     NULL,
+                   });
+
+  CheckEnumeration(testDataDir,
+                   "tests-osx-test-bundle/TestProject-Library-XCTest-CustomTests.xctest/Contents/MacOS/TestProject-Library-XCTest-CustomTests",
+                   TEST_CPU_TYPE_X86_64,
+                   kMachOTestEnumeratorDynamicTests,
+                   NULL);
+
+  // Kiwi specs create their test methods at runtime.
+  CheckEnumeration(testDataDir,
+                   "KiwiTests/Build/Products/Debug-iphonesimulator/KiwiTests-XCTest.xctest/KiwiTests-XCTest",
+                   TEST_CPU_TYPE_I386,
+                   kMachOTestEnumeratorDynamicTests,
+                   NULL);
+  CheckEnumeration(testDataDir,
+                   "KiwiTests/Build/Products/Debug-iphonesimulator/KiwiTests-OCUnit.octest/KiwiTests-OCUnit",
+                   TEST_CPU_TYPE_I386,
+                   kMachOTestEnumeratorDynamicTests,
+                   NULL);
+
+  CheckRejectsTruncatedAndNonMachOData(testDataDir);
+
+  if (failureCount > 0) {
+    fprintf(stderr, "%d check(s) failed.\n", failureCount);
+    return 1;
+  }
+  printf("All MachOTestEnumerator checks passed.\n");
+  return 0;
+}
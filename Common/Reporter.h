@@ -16,15 +16,46 @@
 
 #import <Foundation/Foundation.h>
 
+/**
+ Key in a reporter executable's embedded Info.plist (its __TEXT,__info_plist
+ section) listing the names of the events it handles.  xctool doesn't send a
+ reporter any other events; without the key, it sends every event.
+ */
+#define kReporterSubscribedEventsInfoKey @"XCToolSubscribedEvents"
+
 @interface Reporter : NSObject
 {
 @protected
   NSFileHandle *_outputHandle;
+@private
+  NSMutableDictionary *_eventsByBucket;
 }
 
 + (void)readFromInput:(NSFileHandle *)inputHandle
           andOutputTo:(NSFileHandle *)outputHandle;
 
+/**
+ Creates a reporter that writes to `outputHandle`, for running inside xctool
+ rather than as a separate process.  The caller is responsible for calling
+ -willBeginReporting, -handleEvent: and -didFinishReporting in order.
+ */
++ (instancetype)reporterWithOutputHandle:(NSFileHandle *)outputHandle;
+
+/**
+ Names of the events this reporter handles, or nil if it needs every event.
+ By default, the events whose handler methods (e.g. -beginTest:) the subclass
+ implements, or nil if it overrides -handleEvent:.
+ */
++ (NSSet *)subscribedEvents;
+
+/**
+ Whether the events of concurrently running buckets (see kReporter_BucketKey)
+ are held back until their `end-bucket` and then handled one bucket at a time,
+ as if the buckets had run one after the other.  For reporters whose output is
+ grouped by test suite.  Defaults to NO, so events are handled as they arrive.
+ */
++ (BOOL)groupsEventsByBucket;
+
 /**
  Called before any events are processed, right after the process starts.
  */
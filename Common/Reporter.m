@@ -21,13 +21,87 @@
 #import "ReporterEvents.h"
 #import "TaskUtil.h"
 
+static SEL SelectorForEventName(NSString *event)
+{
+  NSMutableString *selectorName = [NSMutableString string];
+
+  int i = 0;
+  for (NSString *part in [event componentsSeparatedByString:@"-"]) {
+    if (i++ == 0) {
+      [selectorName appendString:[part lowercaseString]];
+    } else {
+      [selectorName appendString:[[part lowercaseString] capitalizedString]];
+    }
+  }
+  [selectorName appendString:@":"];
+
+  return sel_registerName([selectorName UTF8String]);
+}
+
 @implementation Reporter
 
-+ (void)readFromInput:(NSFileHandle *)inputHandle
-          andOutputTo:(NSFileHandle *)outputHandle
++ (instancetype)reporterWithOutputHandle:(NSFileHandle *)outputHandle
 {
   Reporter *reporter = [[[self class] alloc] init];
   reporter->_outputHandle = outputHandle;
+  return reporter;
+}
+
++ (NSSet *)subscribedEvents
+{
+  if ([self instanceMethodForSelector:@selector(handleEvent:)] !=
+      [Reporter instanceMethodForSelector:@selector(handleEvent:)]) {
+    return nil;
+  }
+
+  NSArray *allEvents = @[
+    kReporter_Events_BeginAction,
+    kReporter_Events_EndAction,
+    kReporter_Events_BeginOCUnit,
+    kReporter_Events_EndOCUnit,
+    kReporter_Events_BeginTestSuite,
+    kReporter_Events_EndTestSuite,
+    kReporter_Events_BeginTest,
+    kReporter_Events_EndTest,
+    kReporter_Events_TestOuput,
+    kReporter_Events_BeginXcodebuild,
+    kReporter_Events_EndXcodebuild,
+    kReporter_Events_BeginBuildCommand,
+    kReporter_Events_EndBuildCommand,
+    kReporter_Events_BeginBuildTarget,
+    kReporter_Events_EndBuildTarget,
+    kReporter_Events_BeginStatus,
+    kReporter_Events_EndStatus,
+    kReporter_Events_AnalyzerResult,
+    kReporter_Events_OutputBeforeTestBundleStarts,
+    kReporter_Events_SimulatorOuput,
+  ];
+
+  NSMutableSet *events = [NSMutableSet set];
+  if ([self groupsEventsByBucket]) {
+    [events addObject:kReporter_Events_EndBucket];
+  }
+  for (NSString *event in allEvents) {
+    SEL sel = SelectorForEventName(event);
+    // The empty handlers in Reporter don't count.
+    if ([self instancesRespondToSelector:sel] &&
+        (![Reporter instancesRespondToSelector:sel] ||
+         [self instanceMethodForSelector:sel] != [Reporter instanceMethodForSelector:sel])) {
+      [events addObject:event];
+    }
+  }
+  return events;
+}
+
++ (BOOL)groupsEventsByBucket
+{
+  return NO;
+}
+
++ (void)readFromInput:(NSFileHandle *)inputHandle
+          andOutputTo:(NSFileHandle *)outputHandle
+{
+  Reporter *reporter = [self reporterWithOutputHandle:outputHandle];
 
   [reporter willBeginReporting];
 
@@ -79,19 +153,33 @@
   NSString *event = eventDict[kReporter_Event_Key];
   NSAssert(event != nil && [event length] > 0, @"Event name was empty for event: %@", eventDict);
 
-  NSMutableString *selectorName = [NSMutableString string];
-
-  int i = 0;
-  for (NSString *part in [event componentsSeparatedByString:@"-"]) {
-    if (i++ == 0) {
-      [selectorName appendString:[part lowercaseString]];
-    } else {
-      [selectorName appendString:[[part lowercaseString] capitalizedString]];
+  if ([[self class] groupsEventsByBucket]) {
+    id bucket = eventDict[kReporter_BucketKey];
+    if ([event isEqualToString:kReporter_Events_EndBucket]) {
+      NSArray *bucketEvents = _eventsByBucket[bucket];
+      [_eventsByBucket removeObjectForKey:bucket];
+      for (NSDictionary *bucketEvent in bucketEvents) {
+        [self dispatchEvent:bucketEvent named:bucketEvent[kReporter_Event_Key]];
+      }
+      return;
+    } else if (bucket != nil) {
+      if (_eventsByBucket == nil) {
+        _eventsByBucket = [[NSMutableDictionary alloc] init];
+      }
+      if (_eventsByBucket[bucket] == nil) {
+        _eventsByBucket[bucket] = [NSMutableArray array];
+      }
+      [_eventsByBucket[bucket] addObject:eventDict];
+      return;
     }
   }
-  [selectorName appendString:@":"];
 
-  SEL sel = sel_registerName([selectorName UTF8String]);
+  [self dispatchEvent:eventDict named:event];
+}
+
+- (void)dispatchEvent:(NSDictionary *)eventDict named:(NSString *)event
+{
+  SEL sel = SelectorForEventName(event);
 
   if ([self respondsToSelector:sel]) {
     ((void (*)(id, SEL, NSDictionary *))[self methodForSelector:sel])(self, sel, eventDict);
@@ -16,6 +16,9 @@
 #define kReporter_TimestampKey @"timestamp"
 
 #define kReporter_Event_Key @"event"
+// With -streamParallelOutput, set on every event a bucket of tests publishes,
+// so that the interleaved events of concurrent buckets can be told apart.
+#define kReporter_BucketKey @"bucket"
 
 #define kReporter_Events_BeginAction @"begin-action"
 #define kReporter_Events_EndAction @"end-action"
@@ -37,6 +40,7 @@
 #define kReporter_Events_AnalyzerResult @"analyzer-result"
 #define kReporter_Events_OutputBeforeTestBundleStarts @"output-before-test-bundle-starts"
 #define kReporter_Events_SimulatorOuput @"simulator-output"
+#define kReporter_Events_EndBucket @"end-bucket"
 
 #define kReporter_BeginAction_NameKey @"name"
 #define kReporter_BeginAction_WorkspaceKey @"workspace"
@@ -88,6 +92,9 @@
 #define kReporter_EndTest_Exception_FilePathInProjectKey @"filePathInProject"
 #define kReporter_EndTest_Exception_LineNumberKey @"lineNumber"
 #define kReporter_EndTest_Exception_ReasonKey @"reason"
+// Only set on tests that were retried with -retryFailures.
+#define kReporter_EndTest_AttemptsKey @"attempts"
+#define kReporter_EndTest_FlakyKey @"flaky"
 
 #define kReporter_TestOutput_OutputKey @"output"
 
@@ -125,6 +132,9 @@
 #define kReporter_EndStatus_MessageKey @"message"
 #define kReporter_EndStatus_LevelKey @"level"
 
+#define kReporter_EndBucket_BucketKey @"bucket"
+#define kReporter_EndBucket_SucceededKey @"succeeded"
+
 #define kReporter_AnalyzerResult_ProjectKey @"project"
 #define kReporter_AnalyzerResult_TargetKey @"target"
 #define kReporter_AnalyzerResult_FileKey @"file"
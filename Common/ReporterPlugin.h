@@ -0,0 +1,43 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ Key in a reporter bundle's Info.plist whose presence marks it as a reporter
+ plugin.  The bundle's principal class must conform to ReporterPlugin.
+ */
+#define kReporterPluginBundleKey @"XCToolReporterPlugin"
+
+/**
+ Principal class of a bundle of reporters that xctool loads into its own
+ process.  Such reporters get event dictionaries straight from xctool instead
+ of decoding them from a pipe.
+ */
+@protocol ReporterPlugin <NSObject>
+
+/**
+ Names of the reporters (as passed to `-reporter`) this bundle provides.
+ */
++ (NSArray *)reporterNames;
+
+/**
+ Returns the Reporter subclass to use for `name`, which will write to
+ `outputHandle`.
+ */
++ (Class)reporterClassNamed:(NSString *)name outputHandle:(NSFileHandle *)outputHandle;
+
+@end
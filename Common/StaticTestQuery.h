@@ -0,0 +1,32 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ This file is shared by otest-query and xctool.
+ */
+
+/**
+ Lists the tests in a test bundle by reading the Objective-C metadata of its
+ executable (see MachOTestEnumerator.h), without loading it.
+
+ @param bundlePath Path to the .xctest or .octest bundle.
+ @param reason Optional out param; set when the bundle can't be listed this way.
+ @return Sorted list of test cases as "Class/method", or nil if the bundle has
+   to be loaded to find out what its tests are.
+ */
+NSArray *StaticallyQueryTestBundle(NSString *bundlePath, NSString **reason);
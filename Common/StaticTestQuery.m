@@ -0,0 +1,80 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "StaticTestQuery.h"
+
+#import <mach/machine.h>
+
+#import "MachOTestEnumerator.h"
+
+static void AddTestName(const char *className, const char *methodName, void *context)
+{
+  NSMutableArray *testNames = (__bridge NSMutableArray *)context;
+  [testNames addObject:[NSString stringWithFormat:@"%s/%s", className, methodName]];
+}
+
+static cpu_type_t CurrentCPUType(void)
+{
+#if defined(__x86_64__)
+  return CPU_TYPE_X86_64;
+#elif defined(__i386__)
+  return CPU_TYPE_I386;
+#elif defined(__arm64__)
+  return CPU_TYPE_ARM64;
+#else
+  return CPU_TYPE_ANY;
+#endif
+}
+
+NSArray *StaticallyQueryTestBundle(NSString *bundlePath, NSString **reason)
+{
+  NSString *executablePath = [[NSBundle bundleWithPath:bundlePath] executablePath];
+  if (executablePath == nil) {
+    if (reason) {
+      *reason = [NSString stringWithFormat:@"No executable in bundle '%@'.", bundlePath];
+    }
+    return nil;
+  }
+
+  NSError *error = nil;
+  NSData *data = [NSData dataWithContentsOfFile:executablePath
+                                        options:NSDataReadingMappedIfSafe
+                                          error:&error];
+  if (data == nil) {
+    if (reason) {
+      *reason = [NSString stringWithFormat:@"Failed to read '%@': %@",
+                 executablePath, [error localizedDescription]];
+    }
+    return nil;
+  }
+
+  NSMutableArray *testNames = [NSMutableArray array];
+  MachOTestEnumeratorResult result = MachOEnumerateTestMethods([data bytes],
+                                                               [data length],
+                                                               CurrentCPUType(),
+                                                               AddTestName,
+                                                               (__bridge void *)testNames);
+  if (result != kMachOTestEnumeratorSuccess) {
+    if (reason) {
+      *reason = [NSString stringWithFormat:@"'%@' %s.",
+                 executablePath, MachOTestEnumeratorResultDescription(result)];
+    }
+    return nil;
+  }
+
+  [testNames sortUsingSelector:@selector(compare:)];
+  return testNames;
+}
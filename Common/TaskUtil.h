@@ -19,6 +19,28 @@
 @class NSConcreteTask, SimulatorInfo;
 
 typedef void (^FdOutputLineFeedBlock)(int fd, NSString *);
+
+/**
+ * Receives either a line (NSString) or, for a binary event stream, a decoded
+ * event (see EventFraming.h).
+ */
+typedef void (^FdOutputFeedBlock)(int fd, id output);
+
+typedef NS_ENUM(NSInteger, TestOutputType) {
+  // An event written by otest-shim: either a line of JSON or, if the shim used
+  // binary framing, the already-decoded NSDictionary.
+  TestOutputTypeEvent,
+  // A line the test process printed to stdout or stderr, without its newline.
+  TestOutputTypeRawLine,
+};
+
+/**
+ * Receives the output of a test process in order.  Raw lines are handed over
+ * as-is, so they only get encoded (as part of a `simulator-output` event) if and
+ * when they reach a reporter.
+ */
+typedef void (^TestOutputFeedBlock)(TestOutputType type, id output);
+
 typedef void (^BlockToRunWhileReading)(void);
 
 NSString *StripAnsi(NSString *inputString);
@@ -56,6 +78,22 @@ void ReadOutputsAndFeedOuputLinesToBlockOnQueue(
   BOOL waitUntilFdsAreClosed
 );
 
+/**
+ * Like ReadOutputsAndFeedOuputLinesToBlockOnQueue(), except that `eventFd` (one
+ * of `fildes`, or -1) may carry otest-shim's binary event stream.  That's
+ * detected from the stream's first bytes; binary events are fed to `block` as
+ * decoded objects, and anything else as lines.
+ */
+void ReadOutputsAndEventsAndFeedToBlockOnQueue(
+  int * const fildes,
+  const NSUInteger sz,
+  int eventFd,
+  FdOutputFeedBlock block,
+  dispatch_queue_t blockDispatchQueue,
+  BlockToRunWhileReading blockToRunWhileReading,
+  BOOL waitUntilFdsAreClosed
+);
+
 /**
  * Launchs a task, waits for exit, and returns a dictionary like
  * { @"stdout": "...", @"stderr": "..." }
@@ -74,10 +112,10 @@ NSString *LaunchTaskAndCaptureOutputInCombinedStream(NSTask *task, NSString *des
 void LaunchTaskAndFeedOuputLinesToBlock(NSTask *task, NSString *description, FdOutputLineFeedBlock block);
 
 /**
- * Launchs a task, waits for exit, and feeds lines from stdout and stderr to a block as simulator output events
- * and forwards all otest-shim events directly to a feed block.
+ * Launchs a task, waits for exit, and feeds lines from stdout and stderr to a block as raw lines
+ * and all otest-shim events to it as events.
  */
-void LaunchTaskAndFeedSimulatorOutputAndOtestShimEventsToBlock(NSTask *task, NSString *description, NSString *otestShimOutputFilePath, FdOutputLineFeedBlock block);
+void LaunchTaskAndFeedSimulatorOutputAndOtestShimEventsToBlock(NSTask *task, NSString *description, NSString *otestShimOutputFilePath, TestOutputFeedBlock block);
 
 /**
  * Returns an NSTask that is configured NOT to start a new process group.  This
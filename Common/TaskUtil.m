@@ -17,19 +17,47 @@
 #import "TaskUtil.h"
 
 #import <iconv.h>
+#import <libkern/OSByteOrder.h>
 
 #import <sys/stat.h>
 
+#import "EventFraming.h"
 #import "EventGenerator.h"
 #import "NSConcreteTask.h"
+#import "ReporterEvents.h"
 #import "Swizzle.h"
 #import "XCToolUtil.h"
 
+/**
+ * Bytes read from one fd that haven't been handed out as lines yet.
+ *
+ * Chunks are appended as they arrive; lines are cut off the front.  The
+ * consumed prefix is only reclaimed when the buffer would otherwise have to
+ * grow, so each byte is copied in once and moved at most a few times, and
+ * `scanned` remembers how far we've already looked for a newline so a long
+ * line that arrives in many chunks isn't searched again from its start.
+ */
+typedef struct line_buffer {
+  char *bytes;
+  size_t capacity;
+  size_t start;   // first byte not yet handed out
+  size_t end;     // one past the last byte appended
+  size_t scanned; // [start, scanned) is known not to contain a newline
+} line_buffer;
+
+typedef NS_ENUM(NSInteger, OutputFraming) {
+  OutputFramingLines,
+  // Could be either; decided by the first bytes that arrive.
+  OutputFramingUndecided,
+  OutputFramingBinaryEvents,
+};
+
 typedef struct io_read_info {
   int fd;
   BOOL done;
   dispatch_io_t io;
-  dispatch_data_t data;
+  line_buffer buffer;
+  OutputFraming framing;
   BOOL trailingNewline;
 } io_read_info;
 
@@ -105,52 +133,139 @@ NSString *StringFromDispatchDataWithBrokenUTF8Encoding(const char *dataPtr, size
   return outputString;
 }
 
-static NSArray *LinesFromDispatchData(dispatch_data_t data, BOOL omitNewlineCharacters, BOOL forceUntilTheEnd, size_t *convertedSize)
+static void LineBufferAppend(line_buffer *buffer, const void *bytes, size_t length)
 {
-  const char *dataPtr;
-  size_t dataSz;
-  size_t processedSize = 0;
-
-  if (data == NULL) {
-    return @[];
-  }
-
-  dispatch_data_t contig = dispatch_data_create_map(data, (const void **)&dataPtr, &dataSz);
-  NSMutableArray *lines = [NSMutableArray new];
-
-  while (processedSize < dataSz) {
-    size_t lineLength;
-    const char *newlineLocation = memchr(dataPtr, '\n', dataSz - processedSize);
-    if (newlineLocation == NULL) {
-      if (!forceUntilTheEnd) {
-        break;
+  if (buffer->end + length > buffer->capacity) {
+    size_t pending = buffer->end - buffer->start;
+    if (buffer->start > 0) {
+      memmove(buffer->bytes, buffer->bytes + buffer->start, pending);
+      buffer->scanned -= buffer->start;
+      buffer->start = 0;
+      buffer->end = pending;
+    }
+    if (pending + length > buffer->capacity) {
+      size_t capacity = MAX(MAX(buffer->capacity * 2, pending + length), (size_t)16 * 1024);
+      char *bytes = realloc(buffer->bytes, capacity);
+      if (bytes == NULL) {
+        // We can't hold on to the output, and dropping it would silently
+        // lose test results.
+        NSLog(@"Failed to grow line buffer to %zu bytes: %s", capacity, strerror(errno));
+        abort();
       }
-      // process remaining bytes
-      lineLength = dataSz - processedSize;
-      processedSize += lineLength;
-    } else {
-      lineLength = (size_t)(newlineLocation - dataPtr) + (omitNewlineCharacters ? 0 : sizeof(char));
-      processedSize += lineLength + (omitNewlineCharacters ? sizeof(char) : 0);
+      buffer->bytes = bytes;
+      buffer->capacity = capacity;
     }
+  }
+  memcpy(buffer->bytes + buffer->end, bytes, length);
+  buffer->end += length;
+}
 
-    NSString *line = [[NSString alloc] initWithBytes:dataPtr length:lineLength encoding:NSUTF8StringEncoding];
+static NSString *StringFromLineBytes(const char *bytes, size_t length)
+{
+  NSString *line = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+  if (!line) {
+    // discard invalid UTF-8 characters in the data
+    line = StringFromDispatchDataWithBrokenUTF8Encoding(bytes, length);
+  }
+  return line;
+}
 
-    if (!line) {
-      // discard invalid UTF-8 characters in the data
-      line = StringFromDispatchDataWithBrokenUTF8Encoding(dataPtr, lineLength);
+/**
+ * Returns the next complete line (without its newline), or nil if there is
+ * none yet.  If `flush` is set, whatever follows the last newline is returned
+ * as a line too.
+ *
+ * Since '\n' never occurs inside a multibyte UTF-8 sequence, a line is always
+ * made of whole characters no matter where chunk boundaries fell.
+ */
+static NSString *LineBufferNextLine(line_buffer *buffer, BOOL flush, BOOL *endsWithNewline)
+{
+  const char *newline = NULL;
+  if (buffer->scanned < buffer->end) {
+    newline = memchr(buffer->bytes + buffer->scanned, '\n', buffer->end - buffer->scanned);
+  }
+  if (newline == NULL) {
+    buffer->scanned = buffer->end;
+    if (!flush || buffer->start == buffer->end) {
+      return nil;
     }
+    NSString *line = StringFromLineBytes(buffer->bytes + buffer->start, buffer->end - buffer->start);
+    buffer->start = buffer->scanned = buffer->end;
+    *endsWithNewline = NO;
+    return line;
+  }
 
-    dataPtr = newlineLocation + sizeof(char); // omit newline character
+  size_t lineEnd = (size_t)(newline - buffer->bytes);
+  NSString *line = StringFromLineBytes(buffer->bytes + buffer->start, lineEnd - buffer->start);
+  buffer->start = buffer->scanned = lineEnd + 1;
+  *endsWithNewline = YES;
+  return line;
+}
 
-    [lines addObject:line];
+/**
+ * Settles whether the stream is binary events or lines, once enough of it has
+ * arrived, and drops the binary stream's magic.
+ */
+static OutputFraming LineBufferDetectFraming(line_buffer *buffer, BOOL done)
+{
+  size_t pending = buffer->end - buffer->start;
+  if (pending == 0) {
+    return done ? OutputFramingLines : OutputFramingUndecided;
   }
-
-  if (convertedSize != NULL) {
-    *convertedSize = processedSize;
+  // Lines never start with a NUL, the magic always does.
+  if (buffer->bytes[buffer->start] != '\0') {
+    return OutputFramingLines;
   }
+  if (pending < kBinaryEventStreamMagicLength) {
+    return done ? OutputFramingLines : OutputFramingUndecided;
+  }
+  if (memcmp(buffer->bytes + buffer->start, kBinaryEventStreamMagic, kBinaryEventStreamMagicLength) != 0) {
+    return OutputFramingLines;
+  }
+  buffer->start = buffer->scanned = buffer->start + kBinaryEventStreamMagicLength;
+  return OutputFramingBinaryEvents;
+}
 
-  dispatch_release(contig);
-  return lines;
+/**
+ * Appends the objects decoded from every complete frame to `events`.  Empty
+ * frames are skipped.  A frame that can't be decoded is reported in its place
+ * as an error status, so a broken event doesn't just vanish from the stream.
+ */
+static void LineBufferTakeBinaryEvents(line_buffer *buffer, int fd, NSMutableArray *events)
+{
+  for (;;) {
+    size_t pending = buffer->end - buffer->start;
+    if (pending < kBinaryEventFrameHeaderLength) {
+      return;
+    }
+    uint32_t payloadLength = OSReadLittleInt32(buffer->bytes + buffer->start, 0);
+    if (pending - kBinaryEventFrameHeaderLength < payloadLength) {
+      return;
+    }
+
+    const char *payload = buffer->bytes + buffer->start + kBinaryEventFrameHeaderLength;
+    buffer->start = buffer->scanned = buffer->start + kBinaryEventFrameHeaderLength + payloadLength;
+    if (payloadLength == 0) {
+      continue;
+    }
+
+    id object = ObjectWithBinaryEventPayload(payload, payloadLength);
+    if (object == nil) {
+      NSString *message = [NSString stringWithFormat:
+                           @"Skipped a malformed event of %u bytes from the test process (fd %d).",
+                           payloadLength, fd];
+      [events addObject:EventDictionaryWithNameAndContent(
+        kReporter_Events_BeginStatus,
+        @{kReporter_BeginStatus_MessageKey: message,
+          kReporter_BeginStatus_LevelKey: @"Error"})];
+      [events addObject:EventDictionaryWithNameAndContent(
+        kReporter_Events_EndStatus,
+        @{kReporter_EndStatus_MessageKey: message,
+          kReporter_EndStatus_LevelKey: @"Error"})];
+      continue;
+    }
+    [events addObject:object];
+  }
 }
 
 void ReadOutputsAndFeedOuputLinesToBlockOnQueue(
@@ -161,27 +276,34 @@ void ReadOutputsAndFeedOuputLinesToBlockOnQueue(
   BlockToRunWhileReading blockToRunWhileReading,
   BOOL waitUntilFdsAreClosed)
 {
-  void (^callOutputLineFeedBlock)(int, NSString *) = ^(int fd, NSString *lineToFeed) {
+  ReadOutputsAndEventsAndFeedToBlockOnQueue(fildes,
+                                            sz,
+                                            -1,
+                                            block ? ^(int fd, id output) { block(fd, output); } : nil,
+                                            queue,
+                                            blockToRunWhileReading,
+                                            waitUntilFdsAreClosed);
+}
+
+void ReadOutputsAndEventsAndFeedToBlockOnQueue(
+  int * const fildes,
+  const NSUInteger sz,
+  int eventFd,
+  FdOutputFeedBlock block,
+  dispatch_queue_t queue,
+  BlockToRunWhileReading blockToRunWhileReading,
+  BOOL waitUntilFdsAreClosed)
+{
+  void (^callOutputFeedBlock)(int, id) = ^(int fd, id outputToFeed) {
     if (queue == NULL) {
-      block(fd, lineToFeed);
+      block(fd, outputToFeed);
     } else {
       dispatch_async(queue, ^{
-        block(fd, lineToFeed);
+        block(fd, outputToFeed);
       });
     }
   };
 
-  size_t (^feedUnprocessedLinesToBlock)(int, dispatch_data_t, BOOL) = ^(int fd, dispatch_data_t unprocessedPart, BOOL forceUntilTheEnd) {
-    size_t processedSize = 0;
-    NSArray *lines = LinesFromDispatchData(unprocessedPart, YES, forceUntilTheEnd, &processedSize);
-
-    for (NSString *lineToFeed in lines) {
-      callOutputLineFeedBlock(fd, lineToFeed);
-    }
-
-    return processedSize;
-  };
-
   NSString *ioQueueName = [NSString stringWithFormat:@"com.facebook.xctool.%f.%d", [[NSDate date] timeIntervalSince1970], fildes[0]];
   dispatch_queue_t ioQueue = dispatch_queue_create([ioQueueName UTF8String], DISPATCH_QUEUE_SERIAL);
   io_read_info *infos = calloc(sz, sizeof(io_read_info));
@@ -191,6 +313,7 @@ void ReadOutputsAndFeedOuputLinesToBlockOnQueue(
     io_read_info *info = infos+i;
     int fd = fildes[i];
     info->fd = fd;
+    info->framing = (fd == eventFd ? OutputFramingUndecided : OutputFramingLines);
     info->io = dispatch_io_create(DISPATCH_IO_STREAM, fd, ioQueue, ^(int error) {
       if (error != 0) {
         NSLog(@"xctool[%d]: Errored [%d] while creating IO channel", fd, error);
@@ -210,36 +333,30 @@ void ReadOutputsAndFeedOuputLinesToBlockOnQueue(
         info->done = YES;
       }
       if (!info->done && data != NULL) {
-        if (info->data == NULL) {
-          dispatch_retain(data);
-          info->data = data;
-        } else {
-          dispatch_data_t combined = dispatch_data_create_concat(info->data, data);
-          dispatch_release(info->data);
-          info->data = combined;
-        }
+        dispatch_data_apply(data, ^bool(dispatch_data_t region, size_t offset, const void *buffer, size_t size) {
+          LineBufferAppend(&info->buffer, buffer, size);
+          return true;
+        });
       }
-      if (block && info->data != NULL) {
-        // feed to block unprocessed lines
-        size_t size = dispatch_data_get_size(info->data);
-        if (size > 0) {
-          size_t chomped = feedUnprocessedLinesToBlock(info->fd, info->data, info->done);
-
-          // Check for trailing newline before advancing the buffer, this will
-          // be used to determine whether to emit an empty line should the
-          // stream end in a newline, which would otherwise be omitted.
-          if (chomped > 0) {
-            dispatch_data_t subdata = dispatch_data_create_subrange(info->data, chomped - 1, 1);
-            const char *lastCharPtr;
-            dispatch_data_t ch = dispatch_data_create_map(subdata, (const void **)&lastCharPtr, NULL);
-            info->trailingNewline = (*lastCharPtr == '\n');
-            dispatch_release(ch);
-            dispatch_release(subdata);
-          }
-
-          dispatch_data_t remaining = dispatch_data_create_subrange(info->data, chomped, size - chomped);
-          dispatch_release(info->data);
-          info->data = remaining;
+      if (info->framing == OutputFramingUndecided) {
+        info->framing = LineBufferDetectFraming(&info->buffer, info->done);
+      }
+      if (block && info->framing == OutputFramingBinaryEvents) {
+        // feed to block the events that are now complete
+        NSMutableArray *events = [NSMutableArray array];
+        LineBufferTakeBinaryEvents(&info->buffer, info->fd, events);
+        for (id event in events) {
+          callOutputFeedBlock(info->fd, event);
+        }
+      } else if (block && info->framing == OutputFramingLines) {
+        // feed to block the lines that are now complete
+        BOOL endsWithNewline = NO;
+        NSString *line = nil;
+        while ((line = LineBufferNextLine(&info->buffer, info->done, &endsWithNewline)) != nil) {
+          // Used to emit an empty line should the stream end in a newline,
+          // which would otherwise be omitted.
+          info->trailingNewline = endsWithNewline;
+          callOutputFeedBlock(info->fd, line);
         }
       }
       if (info->done) {
@@ -271,11 +388,9 @@ void ReadOutputsAndFeedOuputLinesToBlockOnQueue(
         info->done = YES;
       }
       if (info->trailingNewline) {
-        callOutputLineFeedBlock(info->fd, @"");
-      }
-      if (info->data != NULL) {
-        dispatch_release(info->data);
+        callOutputFeedBlock(info->fd, @"");
       }
+      free(info->buffer.bytes);
       dispatch_io_close(info->io, DISPATCH_IO_STOP);
       dispatch_release(info->io);
     });
@@ -375,9 +490,9 @@ void LaunchTaskAndFeedSimulatorOutputAndOtestShimEventsToBlock(
   NSTask *task,
   NSString *description,
   NSString *otestShimOutputFilePath,
-  FdOutputLineFeedBlock block)
+  TestOutputFeedBlock block)
 {
-  // intercept stdout, stderr and post as simulator-output events
+  // intercept stdout, stderr and post as raw lines
   int stdoutPipefd[2];
   pipe(stdoutPipefd);
   NSFileHandle *stdoutHandle = [[NSFileHandle alloc] initWithFileDescriptor:stdoutPipefd[1]];
@@ -405,18 +520,8 @@ void LaunchTaskAndFeedSimulatorOutputAndOtestShimEventsToBlock(
   int fildes[2] = {stdoutReadFd, otestShimOutputReadFD};
   NSString *feedQueueName = [NSString stringWithFormat:@"com.facebook.events.feed.queue.%f.%d", [[NSDate date] timeIntervalSince1970], fildes[1]];
   dispatch_queue_t feedQueue = dispatch_queue_create([feedQueueName UTF8String], DISPATCH_QUEUE_SERIAL);
-  ReadOutputsAndFeedOuputLinesToBlockOnQueue(fildes, 2, ^(int fd, NSString *line) {
-    if (fd != otestShimOutputReadFD) {
-      NSDictionary *event = EventDictionaryWithNameAndContent(
-        kReporter_Events_SimulatorOuput,
-        @{kReporter_SimulatorOutput_OutputKey: StripAnsi([line stringByAppendingString:@"\n"])}
-      );
-      NSData *data = [NSJSONSerialization dataWithJSONObject:event options:0 error:nil];
-      line = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
-    }
-    if (line) {
-      block(fd, line);
-    }
+  ReadOutputsAndEventsAndFeedToBlockOnQueue(fildes, 2, otestShimOutputReadFD, ^(int fd, id output) {
+    block(fd == otestShimOutputReadFD ? TestOutputTypeEvent : TestOutputTypeRawLine, output);
   },
   // all events should be processed serially on the same queue
   feedQueue,
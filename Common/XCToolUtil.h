@@ -20,6 +20,12 @@
 extern "C" {
 #endif
 
+/**
+ * Parses the output of `xcodebuild -showBuildSettings` into a dictionary of
+ * target name -> build settings.  The output may hold blocks for any number
+ * of targets, in any order; lines outside of a block are ignored, and a
+ * target whose settings are split across several blocks gets them merged.
+ */
 NSDictionary *BuildSettingsFromOutput(NSString *output);
 NSString *XCToolLibPath(void);
 NSString *XCToolLibExecPath(void);
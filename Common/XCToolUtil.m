@@ -32,77 +32,86 @@ static NSString * const DYLD_INSERT_LIBRARIES = @"DYLD_INSERT_LIBRARIES";
 
 static NSString *__tempDirectoryForAction = nil;
 
-NSDictionary *BuildSettingsFromOutput(NSString *output)
+/**
+ * Returns the target named by a line like...
+ * 'Build settings for action build and target SomeTarget:'
+ *
+ * or, if there are spaces in the target name...
+ * 'Build settings for action build and target "Some Target Name":'
+ *
+ * Returns nil for any other line.
+ */
+static NSString *TargetFromBuildSettingsHeader(NSString *line)
 {
-  NSScanner *scanner = [NSScanner scannerWithString:output];
-  [scanner setCharactersToBeSkipped:nil];
-
-  NSMutableDictionary *settings = [NSMutableDictionary dictionary];
-
-  void (^scanUntilEmptyLine)(void) = ^{
-    // Advance until we hit an empty line.
-    while (![scanner scanString:@"\n" intoString:NULL]) {
-      [scanner scanUpToString:@"\n" intoString:NULL];
-      [scanner scanString:@"\n" intoString:NULL];
-    }
-  };
-
-  if ([scanner scanString:@"User defaults from command line:\n" intoString:NULL]) {
-    scanUntilEmptyLine();
+  if (![line hasPrefix:@"Build settings for action "] || ![line hasSuffix:@":"]) {
+    return nil;
   }
-
-  if ([scanner scanString:@"Build settings from command line:\n" intoString:NULL]) {
-    scanUntilEmptyLine();
-  }
-
-  if ([scanner scanString:@"Build settings from configuration file" intoString:NULL]) {
-    scanUntilEmptyLine();
+  NSRange targetRange = [line rangeOfString:@" and target "];
+  if (targetRange.location == NSNotFound) {
+    return nil;
   }
+  NSString *target = [line substringWithRange:NSMakeRange(NSMaxRange(targetRange),
+                                                          line.length - 1 - NSMaxRange(targetRange))];
+  // Target names with spaces will be quoted.
+  return [target stringByTrimmingCharactersInSet:
+          [NSCharacterSet characterSetWithCharactersInString:@"\""]];
+}
 
-  for (;;) {
-    NSString *target = nil;
-    NSMutableDictionary *targetSettings = [NSMutableDictionary dictionary];
-
-    // Line with look like...
-    // 'Build settings for action build and target SomeTarget:'
-    //
-    // or, if there are spaces in the target name...
-    // 'Build settings for action build and target "Some Target Name":'
-    if (!([scanner scanString:@"Build settings for action test and target " intoString:NULL] ||
-          [scanner scanString:@"Build settings for action build and target " intoString:NULL] ||
-          [scanner scanString:@"Build settings for action analyze and target " intoString:NULL])) {
-      break;
-    }
-
-    [scanner scanUpToString:@":\n" intoString:&target];
-    [scanner scanString:@":\n" intoString:NULL];
-
-    // Target names with spaces will be quoted.
-    target = [target stringByTrimmingCharactersInSet:
-              [NSCharacterSet characterSetWithCharactersInString:@"\""]];
-
-    for (;;) {
+NSDictionary *BuildSettingsFromOutput(NSString *output)
+{
+  NSMutableDictionary *settings = [NSMutableDictionary dictionary];
 
-      if ([scanner scanString:@"\n" intoString:NULL]) {
-        // We know we've reached the end when we see one empty line.
-        break;
+  // Settings of the block we're in, or nil between blocks.  Blocks end with
+  // an empty line, though the last one may just end with the output.  Other
+  // sections ('Build settings from command line:', 'User defaults from
+  // command line:', ...) and anything xcodebuild logs between blocks are
+  // skipped.
+  NSMutableDictionary *targetSettings = nil;
+
+  for (NSString *line in [output componentsSeparatedByString:@"\n"]) {
+    NSString *target = TargetFromBuildSettingsHeader(line);
+    if (target != nil) {
+      // A target may show up in more than one block; later values win.
+      if (settings[target] == nil) {
+        settings[target] = [NSMutableDictionary dictionary];
       }
+      targetSettings = settings[target];
+      continue;
+    }
 
-      // Each line / setting looks like: "    SOME_KEY = some value\n"
-      NSString *key = nil;
-      NSString *value = nil;
+    if (targetSettings == nil) {
+      continue;
+    }
 
-      [scanner scanString:@"    " intoString:NULL];
-      [scanner scanUpToString:@" = " intoString:&key];
-      [scanner scanString:@" = " intoString:NULL];
+    if (line.length == 0) {
+      targetSettings = nil;
+      continue;
+    }
 
-      [scanner scanUpToString:@"\n" intoString:&value];
-      [scanner scanString:@"\n" intoString:NULL];
+    // Each line / setting looks like: "    SOME_KEY = some value"
+    if (![line hasPrefix:@" "]) {
+      // Not a setting, so the block was cut short.
+      targetSettings = nil;
+      continue;
+    }
 
-      targetSettings[key] = (value == nil) ? @"" : value;
+    NSRange separatorRange = [line rangeOfString:@" = "];
+    NSString *key = nil;
+    NSString *value = nil;
+    if (separatorRange.location != NSNotFound) {
+      key = [line substringToIndex:separatorRange.location];
+      value = [line substringFromIndex:NSMaxRange(separatorRange)];
+    } else if ([line hasSuffix:@" ="]) {
+      key = [line substringToIndex:line.length - 2];
+      value = @"";
+    } else {
+      continue;
     }
 
-    settings[target] = targetSettings;
+    key = [key stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    if (key.length > 0) {
+      targetSettings[key] = value;
+    }
   }
 
   return settings;
@@ -705,12 +714,21 @@ void CleanupTemporaryDirectoryForAction()
 
 void PublishEventToReporters(NSArray *reporters, NSDictionary *event)
 {
+  if (reporters.count == 0) {
+    return;
+  }
+
   NSError *error = nil;
   NSData *jsonData = [NSJSONSerialization dataWithJSONObject:event options:0 error:&error];
   NSCAssert(jsonData != nil, @"Error while encoding event into JSON: %@", [error localizedFailureReason]);
 
+  // Every sink gets the same immutable buffer; ReporterTask just queues it.
   for (id<EventSink> reporter in reporters) {
-    [reporter publishDataForEvent:jsonData];
+    if ([reporter respondsToSelector:@selector(publishEvent:data:)]) {
+      [reporter publishEvent:event data:jsonData];
+    } else {
+      [reporter publishDataForEvent:jsonData];
+    }
   }
 }
 
@@ -723,7 +741,9 @@ NSArray *AvailableReporters()
                                                                           error:&error];
   NSCAssert(contents != nil,
             @"Failed to read from reporters directory '%@': %@", reportersPath, [error localizedFailureReason]);
-  return contents;
+  // Reporter executables have no extension; skip BuiltinReporters.bundle.
+  return [contents filteredArrayUsingPredicate:
+          [NSPredicate predicateWithFormat:@"pathExtension == ''"]];
 }
 
 NSString *AbsolutePathFromRelative(NSString *path)
@@ -21,4 +21,15 @@
 
 + (void)queryTestBundlePath:(NSString *)testBundlePath;
 
+/**
+ Lists the tests of several bundles in one process, so that process launch and
+ loading the testing framework are paid for once rather than per bundle.
+
+ Writes a JSON dictionary mapping each bundle path to either
+ `{"tests": ["Class/method", ...]}` or `{"error": "..."}`.  Bundles with an
+ error (e.g. ones that fail to load, or that define the same classes as another
+ bundle) should be queried again on their own.
+ */
++ (void)queryTestBundlePaths:(NSArray *)testBundlePaths;
+
 @end
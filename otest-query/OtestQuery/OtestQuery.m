@@ -18,62 +18,59 @@
 #import "OtestQuery.h"
 
 #import <dlfcn.h>
+#import <mach-o/dyld.h>
 #import <objc/runtime.h>
 #import <stdio.h>
+#import <sys/param.h>
 
 #import "DuplicateTestNameFix.h"
 #import "NSInvocationInSetFix.h"
 #import "ParseTestName.h"
 #import "SenIsSuperclassOfClassPerformanceFix.h"
+#import "StaticTestQuery.h"
 #import "TestingFramework.h"
 
-@implementation OtestQuery
-
 /**
- Crawls through the test suite hierarchy and returns a list of all test case
- names in the format of ...
-
-   @[@"-[SomeClass someMethod]",
-     @"-[SomeClass otherMethod]"]
+ Returns the "Class/method" name of a test in the suite hierarchy.
  */
-+ (NSArray *)testNamesFromSuite:(id)testSuite
+static NSString *TestCaseNameForTest(id test)
 {
-  NSMutableArray *names = [NSMutableArray array];
+  NSString *fullTestName = [test performSelector:@selector(description)];
+  NSCAssert(fullTestName != nil, @"Can't get name for test: %@", test);
 
-  for (id test in TestsFromSuite(testSuite)) {
-    NSString *name = [test performSelector:@selector(description)];
-    NSAssert(name != nil, @"Can't get name for test: %@", test);
-    [names addObject:name];
-  }
-
-  return names;
+  NSString *className = nil;
+  NSString *methodName = nil;
+  ParseClassAndMethodFromTestName(&className, &methodName, fullTestName);
+  return [NSString stringWithFormat:@"%@/%@", className, methodName];
 }
 
-+ (void)queryTestBundlePath:(NSString *)testBundlePath
+/**
+ Returns the name dyld knows the image at `path` by, once it's loaded.
+ */
+static NSString *LoadedImageNameForPath(NSString *path)
 {
-  NSString *outputFile = [NSProcessInfo processInfo].environment[@"OTEST_QUERY_OUTPUT_FILE"];
-  NSAssert(outputFile, @"Output path wasn't set in the enviroment: %@", [NSProcessInfo processInfo].environment);
-  NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingAtPath:outputFile];
-
-  NSBundle *bundle = [NSBundle bundleWithPath:testBundlePath];
-  if (!bundle) {
-    fprintf(stderr, "Bundle '%s' does not identify an accessible bundle directory.\n",
-            [testBundlePath UTF8String]);
-    _exit(kBundleOpenError);
+  char wantedPath[MAXPATHLEN];
+  if (realpath([path fileSystemRepresentation], wantedPath) == NULL) {
+    return nil;
   }
 
-  NSDictionary *framework = FrameworkInfoForTestBundleAtPath(testBundlePath);
-  if (!framework) {
-    const char *bundleExtension = [[testBundlePath pathExtension] UTF8String];
-    fprintf(stderr, "The bundle extension '%s' is not supported.\n", bundleExtension);
-    _exit(kUnsupportedFramework);
+  // Most recently loaded images come last.
+  for (uint32_t i = _dyld_image_count(); i > 0; i--) {
+    const char *imageName = _dyld_get_image_name(i - 1);
+    char imagePath[MAXPATHLEN];
+    if (imageName != NULL &&
+        realpath(imageName, imagePath) != NULL &&
+        strcmp(imagePath, wantedPath) == 0) {
+      return [NSString stringWithUTF8String:imageName];
+    }
   }
+  return nil;
+}
 
-  if (![bundle executablePath]) {
-    fprintf(stderr, "The bundle at %s does not contain an executable.\n", [testBundlePath UTF8String]);
-    _exit(kMissingExecutable);
-  }
+@implementation OtestQuery
 
++ (void)prepareToLoadTestBundlesUsingFramework:(NSDictionary *)framework
+{
   // Make sure the 'SenTest' or 'XCTest' preference is cleared before we load the
   // test bundle - otherwise otest-query will accidentally start running tests.
   //
@@ -94,14 +91,13 @@
   [[NSUserDefaults standardUserDefaults] removeObjectForKey:
    [framework objectForKey:kTestingFrameworkFilterTestArgsKey]];
   [[NSUserDefaults standardUserDefaults] synchronize];
+}
 
-  // We use dlopen() instead of -[NSBundle loadAndReturnError] because, if
-  // something goes wrong, dlerror() gives us a much more helpful error message.
-  if (dlopen([[bundle executablePath] UTF8String], RTLD_LAZY) == NULL) {
-    fprintf(stderr, "%s\n", dlerror());
-    _exit(kDLOpenError);
-  }
-
+/**
+ Returns every test of every test bundle loaded so far.
+ */
++ (NSArray *)allTestsUsingFramework:(NSDictionary *)framework
+{
   [[NSBundle allFrameworks] makeObjectsPerformSelector:@selector(principalClass)];
 
   XTApplySenIsSuperclassOfClassPerformanceFix();
@@ -118,15 +114,68 @@
   id allTestsSuite = [testSuiteClass performSelector:@selector(allTests)];
   NSCAssert(allTestsSuite, @"Should have gotten a test suite from allTests");
 
-  NSArray *fullTestNames = [self testNamesFromSuite:allTestsSuite];
-  NSMutableArray *testNames = [NSMutableArray array];
+  return TestsFromSuite(allTestsSuite);
+}
+
++ (NSFileHandle *)outputFileHandle
+{
+  NSString *outputFile = [NSProcessInfo processInfo].environment[@"OTEST_QUERY_OUTPUT_FILE"];
+  NSAssert(outputFile, @"Output path wasn't set in the enviroment: %@", [NSProcessInfo processInfo].environment);
+  return [NSFileHandle fileHandleForWritingAtPath:outputFile];
+}
 
-  for (NSString *fullTestName in fullTestNames) {
-    NSString *className = nil;
-    NSString *methodName = nil;
-    ParseClassAndMethodFromTestName(&className, &methodName, fullTestName);
++ (BOOL)shouldTryStaticEnumeration
+{
+  return ![[NSProcessInfo processInfo].environment[@"OTEST_QUERY_SKIP_STATIC_ENUMERATION"] isEqualToString:@"YES"];
+}
 
-    [testNames addObject:[NSString stringWithFormat:@"%@/%@", className, methodName]];
++ (void)queryTestBundlePath:(NSString *)testBundlePath
+{
+  NSFileHandle *fileHandle = [self outputFileHandle];
+
+  NSBundle *bundle = [NSBundle bundleWithPath:testBundlePath];
+  if (!bundle) {
+    fprintf(stderr, "Bundle '%s' does not identify an accessible bundle directory.\n",
+            [testBundlePath UTF8String]);
+    _exit(kBundleOpenError);
+  }
+
+  NSDictionary *framework = FrameworkInfoForTestBundleAtPath(testBundlePath);
+  if (!framework) {
+    const char *bundleExtension = [[testBundlePath pathExtension] UTF8String];
+    fprintf(stderr, "The bundle extension '%s' is not supported.\n", bundleExtension);
+    _exit(kUnsupportedFramework);
+  }
+
+  if (![bundle executablePath]) {
+    fprintf(stderr, "The bundle at %s does not contain an executable.\n", [testBundlePath UTF8String]);
+    _exit(kMissingExecutable);
+  }
+
+  // Most bundles can be listed from their objc metadata alone, which saves
+  // loading the bundle, its dependencies and the testing framework.  Bundles
+  // that decide on their tests at runtime (e.g. by overriding
+  // +testInvocations) are loaded as before.
+  if ([self shouldTryStaticEnumeration]) {
+    NSArray *testNames = StaticallyQueryTestBundle(testBundlePath, NULL);
+    if (testNames) {
+      [fileHandle writeData:[NSJSONSerialization dataWithJSONObject:testNames options:0 error:nil]];
+      _exit(kSuccess);
+    }
+  }
+
+  [self prepareToLoadTestBundlesUsingFramework:framework];
+
+  // We use dlopen() instead of -[NSBundle loadAndReturnError] because, if
+  // something goes wrong, dlerror() gives us a much more helpful error message.
+  if (dlopen([[bundle executablePath] UTF8String], RTLD_LAZY) == NULL) {
+    fprintf(stderr, "%s\n", dlerror());
+    _exit(kDLOpenError);
+  }
+
+  NSMutableArray *testNames = [NSMutableArray array];
+  for (id test in [self allTestsUsingFramework:framework]) {
+    [testNames addObject:TestCaseNameForTest(test)];
   }
 
   [testNames sortUsingSelector:@selector(compare:)];
@@ -136,4 +185,128 @@
   _exit(kSuccess);
 }
 
++ (void)queryTestBundlePaths:(NSArray *)testBundlePaths
+{
+  NSFileHandle *fileHandle = [self outputFileHandle];
+  NSMutableDictionary *results = [NSMutableDictionary dictionary];
+  void (^fail)(NSString *, NSString *) = ^(NSString *testBundlePath, NSString *message) {
+    results[testBundlePath] = @{@"error" : message};
+  };
+
+  // All bundles that have to be loaded must use the same testing framework.
+  NSDictionary *framework = nil;
+  NSMutableArray *bundlePathsToLoad = [NSMutableArray array];
+
+  for (NSString *testBundlePath in testBundlePaths) {
+    NSBundle *bundle = [NSBundle bundleWithPath:testBundlePath];
+    NSDictionary *bundleFramework = FrameworkInfoForTestBundleAtPath(testBundlePath);
+    if (!bundle) {
+      fail(testBundlePath, @"Not an accessible bundle directory.");
+      continue;
+    }
+    if (!bundleFramework) {
+      fail(testBundlePath, [NSString stringWithFormat:@"The bundle extension '%@' is not supported.",
+                            [testBundlePath pathExtension]]);
+      continue;
+    }
+    if (![bundle executablePath]) {
+      fail(testBundlePath, @"The bundle does not contain an executable.");
+      continue;
+    }
+
+    NSArray *testNames = [self shouldTryStaticEnumeration] ? StaticallyQueryTestBundle(testBundlePath, NULL) : nil;
+    if (testNames) {
+      results[testBundlePath] = @{@"tests" : testNames};
+    } else if (framework && ![framework isEqual:bundleFramework]) {
+      fail(testBundlePath, @"Uses a different testing framework than the other bundles.");
+    } else {
+      framework = bundleFramework;
+      [bundlePathsToLoad addObject:testBundlePath];
+    }
+  }
+
+  if ([bundlePathsToLoad count] > 0) {
+    [self prepareToLoadTestBundlesUsingFramework:framework];
+
+    // Tests are attributed to bundles by the image their class comes from.
+    // If a bundle defines a class that an earlier one already did, the
+    // runtime only uses the earlier one's, and the later bundle's tests in
+    // that class would go missing.
+    NSMutableDictionary *bundlePathsByClassName = [NSMutableDictionary dictionary];
+    NSMutableDictionary *bundlePathsByImageName = [NSMutableDictionary dictionary];
+    NSMutableDictionary *testNamesByBundlePath = [NSMutableDictionary dictionary];
+    // Bundles that were loaded but can't be listed here.
+    NSMutableSet *rejectedImageNames = [NSMutableSet set];
+
+    for (NSString *testBundlePath in bundlePathsToLoad) {
+      NSString *executablePath = [[NSBundle bundleWithPath:testBundlePath] executablePath];
+      if (dlopen([executablePath UTF8String], RTLD_LAZY) == NULL) {
+        fail(testBundlePath, [NSString stringWithUTF8String:dlerror()]);
+        continue;
+      }
+
+      NSString *imageName = LoadedImageNameForPath(executablePath);
+      unsigned int classCount = 0;
+      const char **classNames = imageName ? objc_copyClassNamesForImage([imageName UTF8String], &classCount) : NULL;
+      NSMutableArray *bundleClassNames = [NSMutableArray array];
+      NSString *clashingClassName = nil;
+      for (unsigned int i = 0; i < classCount; i++) {
+        NSString *className = [NSString stringWithUTF8String:classNames[i]];
+        if (bundlePathsByClassName[className]) {
+          clashingClassName = className;
+          break;
+        }
+        [bundleClassNames addObject:className];
+      }
+      free(classNames);
+
+      if (imageName == nil) {
+        fail(testBundlePath, @"Couldn't find the bundle's image after loading it.");
+      } else if (clashingClassName) {
+        [rejectedImageNames addObject:imageName];
+        fail(testBundlePath, [NSString stringWithFormat:@"Class '%@' is also defined by '%@'.",
+                              clashingClassName, bundlePathsByClassName[clashingClassName]]);
+      } else {
+        for (NSString *className in bundleClassNames) {
+          bundlePathsByClassName[className] = testBundlePath;
+        }
+        bundlePathsByImageName[imageName] = testBundlePath;
+        testNamesByBundlePath[testBundlePath] = [NSMutableArray array];
+      }
+    }
+
+    NSString *strayTestName = nil;
+    for (id test in [self allTestsUsingFramework:framework]) {
+      const char *cImageName = class_getImageName([test class]);
+      NSString *imageName = cImageName ? [NSString stringWithUTF8String:cImageName] : nil;
+      if (imageName && [rejectedImageNames containsObject:imageName]) {
+        continue;
+      }
+      NSString *testBundlePath = imageName ? bundlePathsByImageName[imageName] : nil;
+      if (testBundlePath == nil) {
+        // A test case class that lives in some other image, e.g. a framework
+        // linked by several of the bundles.  Loaded on its own, each of those
+        // bundles would list its tests.
+        strayTestName = TestCaseNameForTest(test);
+        break;
+      }
+      [testNamesByBundlePath[testBundlePath] addObject:TestCaseNameForTest(test)];
+    }
+
+    for (NSString *testBundlePath in testNamesByBundlePath) {
+      if (strayTestName) {
+        fail(testBundlePath, [NSString stringWithFormat:@"Can't tell which bundle '%@' belongs to.", strayTestName]);
+      } else {
+        NSMutableArray *testNames = testNamesByBundlePath[testBundlePath];
+        [testNames sortUsingSelector:@selector(compare:)];
+        results[testBundlePath] = @{@"tests" : testNames};
+      }
+    }
+  }
+
+  NSData *json = [NSJSONSerialization dataWithJSONObject:results options:0 error:nil];
+  [fileHandle writeData:json];
+  _exit(kSuccess);
+}
+
 @end
@@ -18,6 +18,13 @@
 
 __attribute__((constructor)) static void EntryPoint(void)
 {
+  // Several bundles can be queried at once by listing them, separated by
+  // colons, in 'OtestQueryBundlePaths'.
+  NSString *otestQueryBundlePaths = [[[NSProcessInfo processInfo] environment] objectForKey:@"OtestQueryBundlePaths"];
+  if (otestQueryBundlePaths != nil) {
+    [OtestQuery queryTestBundlePaths:[otestQueryBundlePaths componentsSeparatedByString:@":"]];
+  }
+
   NSString *otestQueryBundlePath = [[[NSProcessInfo processInfo] environment] objectForKey:@"OtestQueryBundlePath"];
   NSCAssert(otestQueryBundlePath != nil,
             @"The environment variable 'OtestQueryBundlePath' is missing.");
@@ -22,13 +22,19 @@
 int main(int argc, const char * argv[])
 {
   @autoreleasepool {
-    NSString *bundlePath = nil;
-    if (argc != 2) {
-      fprintf(stderr, "otest-query only takes one argument, which is the bundle path.\n");
+    if (argc < 2) {
+      fprintf(stderr, "usage: otest-query <bundle path> [<bundle path> ...]\n");
       return -1;
     }
-    bundlePath = [NSString stringWithUTF8String:argv[1]];
-    [OtestQuery queryTestBundlePath:bundlePath];
+    if (argc == 2) {
+      [OtestQuery queryTestBundlePath:[NSString stringWithUTF8String:argv[1]]];
+    } else {
+      NSMutableArray *bundlePaths = [NSMutableArray array];
+      for (int i = 1; i < argc; i++) {
+        [bundlePaths addObject:[NSString stringWithUTF8String:argv[i]]];
+      }
+      [OtestQuery queryTestBundlePaths:bundlePaths];
+    }
   }
   return 0;
 }
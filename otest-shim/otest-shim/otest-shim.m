@@ -15,6 +15,9 @@
 //
 
 #import <dlfcn.h>
+#import <errno.h>
+#import <pthread.h>
+#import <unistd.h>
 
 #import <Foundation/Foundation.h>
 
@@ -23,6 +26,7 @@
 #import "DuplicateTestNameFix.h"
 #import "dyld-interposing.h"
 #import "dyld_priv.h"
+#import "EventFraming.h"
 #import "EventGenerator.h"
 #import "ParseTestName.h"
 #import "ReporterEvents.h"
@@ -34,6 +38,17 @@
 #import "XCTest.h"
 
 static char *const kEventQueueLabel = "xctool.events";
+static char *const kEventWriterQueueLabel = "xctool.events.writer";
+
+// Batched events are handed to the writer once this much is pending, or after
+// this delay.
+static const NSUInteger kEventBatchFlushSize = 64 * 1024;
+// Leaves room for events printed while the writer is busy with the last batch.
+static const NSUInteger kEventBatchCapacity = 4 * kEventBatchFlushSize;
+static const int64_t kEventBatchFlushDelay = 20 * NSEC_PER_MSEC;
+
+// Printed on its own line after every batch in worker mode, see RunWorkerBatches().
+static const char *const kWorkerBatchFinishedMarker = "__XCTOOL_WORKER_BATCH_FINISHED__";
 
 @interface XCToolAssertionHandler : NSAssertionHandler
 @end
@@ -59,12 +74,32 @@ static char *const kEventQueueLabel = "xctool.events";
 
 static FILE *__stdout;
 static FILE *__stderr;
+// YES if xctool asked for events in binary frames rather than JSON lines.
+static BOOL __binaryEventFraming = NO;
+// YES if events go to their own file, so holding them back a little can't
+// reorder them with respect to what the tests print.
+static BOOL __batchEvents = NO;
+// File descriptor behind `__stdout`, for writes that can't go through stdio.
+static int __eventsFD = -1;
+// Preallocated, so the crash handler never needs to allocate.  Events are
+// copied into the pending buffer; the writer swaps it for the spare one and
+// writes that out.
+static char *__pendingEventBytes = NULL;
+static size_t __pendingEventLength = 0;
+static char *__spareEventBytes = NULL;
+static pthread_mutex_t __pendingEventsLock = PTHREAD_MUTEX_INITIALIZER;
+// Held while writing to `__eventsFD`, so batches go out whole and in order.
+static pthread_mutex_t __eventsFDLock = PTHREAD_MUTEX_INITIALIZER;
 
 static NSMutableArray *__testExceptions = nil;
 static int __testSuiteDepth = 0;
 
 static NSString *__testScope = nil;
 
+static char *__workerControlFilePath = NULL;
+static int __testSuitePerformDepth = 0;
+static BOOL __runningWorkerBatches = NO;
+
 static dispatch_queue_t EventQueue()
 {
   static dispatch_queue_t eventQueue = {0};
@@ -78,8 +113,142 @@ static dispatch_queue_t EventQueue()
   return eventQueue;
 }
 
-static void PrintJSON(id JSONObject)
+#pragma mark - Event writer
+
+/*
+ *  Writing and flushing every event from the test's thread costs a syscall per
+ *  event and stalls the test whenever xctool falls behind reading the FIFO.  So
+ *  when batching, events are only copied into `__pendingEventBytes`, and a
+ *  serial writer queue writes them out once enough have piled up or shortly
+ *  after the first one.  FlushEvents() writes them out right away; it's used
+ *  when a test begins, since the process might die during the test and xctool
+ *  must know exactly which test that was.  The crash handler writes out
+ *  whatever is still pending.
+ *
+ *  Batches are written with write(2) straight to `__eventsFD`, which (unlike
+ *  stdio, GCD or allocating) is safe from the crash handler.
+ */
+static dispatch_queue_t EventWriterQueue()
+{
+  static dispatch_queue_t writerQueue = {0};
+  static dispatch_once_t onceToken;
+
+  dispatch_once(&onceToken, ^{
+    writerQueue = dispatch_queue_create(kEventWriterQueueLabel, DISPATCH_QUEUE_SERIAL);
+  });
+
+  return writerQueue;
+}
+
+static void WriteFully(int fd, const void *bytes, size_t length)
 {
+  const char *cursor = bytes;
+  while (length > 0) {
+    ssize_t written = write(fd, cursor, length);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    cursor += written;
+    length -= (size_t)written;
+  }
+}
+
+// Must hold `__eventsFDLock`.  Events can keep being added while the batch
+// is written, since it's moved to the spare buffer first.
+static void WritePendingEventsHoldingFDLock()
+{
+  pthread_mutex_lock(&__pendingEventsLock);
+  char *bytes = __pendingEventBytes;
+  size_t length = __pendingEventLength;
+  __pendingEventBytes = __spareEventBytes;
+  __pendingEventLength = 0;
+  __spareEventBytes = bytes;
+  pthread_mutex_unlock(&__pendingEventsLock);
+
+  if (length > 0 && __eventsFD >= 0) {
+    WriteFully(__eventsFD, bytes, length);
+  }
+}
+
+static void WritePendingEvents()
+{
+  pthread_mutex_lock(&__eventsFDLock);
+  WritePendingEventsHoldingFDLock();
+  pthread_mutex_unlock(&__eventsFDLock);
+}
+
+/**
+ *  Returns once every event printed so far has been written out.
+ */
+static void FlushEvents()
+{
+  if (__batchEvents) {
+    WritePendingEvents();
+  }
+}
+
+static void WriteEventBytes(const void *bytes, size_t length)
+{
+  if (!__batchEvents) {
+    fwrite(bytes, 1, length, __stdout);
+    fflush(__stdout);
+    return;
+  }
+
+  if (length > kEventBatchCapacity) {
+    // Too big to batch; write it out after whatever is pending.
+    pthread_mutex_lock(&__eventsFDLock);
+    WritePendingEventsHoldingFDLock();
+    if (__eventsFD >= 0) {
+      WriteFully(__eventsFD, bytes, length);
+    }
+    pthread_mutex_unlock(&__eventsFDLock);
+    return;
+  }
+
+  pthread_mutex_lock(&__pendingEventsLock);
+  while (__pendingEventLength + length > kEventBatchCapacity) {
+    // The writer only falls this far behind when xctool does, in which case
+    // the test would be held up no matter who does the writing.
+    pthread_mutex_unlock(&__pendingEventsLock);
+    WritePendingEvents();
+    pthread_mutex_lock(&__pendingEventsLock);
+  }
+  BOOL wasEmpty = (__pendingEventLength == 0);
+  BOOL reachedFlushSize = (__pendingEventLength < kEventBatchFlushSize &&
+                           __pendingEventLength + length >= kEventBatchFlushSize);
+  memcpy(__pendingEventBytes + __pendingEventLength, bytes, length);
+  __pendingEventLength += length;
+  pthread_mutex_unlock(&__pendingEventsLock);
+
+  if (reachedFlushSize) {
+    dispatch_async(EventWriterQueue(), ^{
+      WritePendingEvents();
+    });
+  } else if (wasEmpty) {
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kEventBatchFlushDelay), EventWriterQueue(), ^{
+      WritePendingEvents();
+    });
+  }
+}
+
+static void PrintEvent(id JSONObject)
+{
+  if (__binaryEventFraming) {
+    NSData *frame = BinaryEventFrameWithObject(JSONObject);
+    if (frame == nil) {
+      fprintf(__stderr,
+              "ERROR: Error framing object: %s\n",
+              [[JSONObject description] UTF8String]);
+      exit(1);
+    }
+    WriteEventBytes([frame bytes], [frame length]);
+    return;
+  }
+
   NSError *error = nil;
   NSData *data = [NSJSONSerialization dataWithJSONObject:JSONObject options:0 error:&error];
 
@@ -91,9 +260,9 @@ static void PrintJSON(id JSONObject)
     exit(1);
   }
 
-  fwrite([data bytes], 1, [data length], __stdout);
-  fputs("\n", __stdout);
-  fflush(__stdout);
+  NSMutableData *line = [NSMutableData dataWithData:data];
+  [line appendBytes:"\n" length:1];
+  WriteEventBytes([line bytes], [line length]);
 }
 
 #pragma mark - XCToolLog function declarations
@@ -128,7 +297,7 @@ static void XCToolLog_testSuiteDidStart(NSString *testDescription)
 {
   if (__testSuiteDepth == 0) {
     dispatch_sync(EventQueue(), ^{
-      PrintJSON(EventDictionaryWithNameAndContent(
+      PrintEvent(EventDictionaryWithNameAndContent(
         kReporter_Events_BeginTestSuite,
         @{kReporter_BeginTestSuite_SuiteKey : kReporter_TestSuite_TopLevelSuiteName}
       ));
@@ -176,7 +345,7 @@ static void XCToolLog_testSuiteDidStop(NSDictionary *json)
 
   if (__testSuiteDepth == 0) {
     dispatch_sync(EventQueue(), ^{
-      PrintJSON(json);
+      PrintEvent(json);
     });
   }
 }
@@ -208,12 +377,14 @@ static void XCToolLog_testCaseDidStart(NSString *fullTestName)
     NSString *methodName = nil;
     ParseClassAndMethodFromTestName(&className, &methodName, fullTestName);
 
-    PrintJSON(EventDictionaryWithNameAndContent(
+    PrintEvent(EventDictionaryWithNameAndContent(
       kReporter_Events_BeginTest, @{
         kReporter_BeginTest_TestKey : fullTestName,
         kReporter_BeginTest_ClassNameKey : className,
         kReporter_BeginTest_MethodNameKey : methodName,
     }));
+    // If the test crashes, xctool blames whichever test it last saw begin.
+    FlushEvents();
 
     [__testExceptions release];
     __testExceptions = [[NSMutableArray alloc] init];
@@ -274,7 +445,7 @@ static void XCToolLog_testCaseDidStop(NSString *fullTestName, NSNumber *unexpect
     });
     [retExceptions release];
 
-    PrintJSON(json);
+    PrintEvent(json);
   });
 }
 
@@ -419,13 +590,14 @@ static void XCWaitForDebuggerIfNeeded()
       int pid = [[NSProcessInfo processInfo] processIdentifier];
       NSString *beginMessage = [NSString stringWithFormat:@"Waiting for debugger to be attached to pid '%d' ...", pid];
       dispatch_sync(EventQueue(), ^{
-        PrintJSON(EventDictionaryWithNameAndContent(
+        PrintEvent(EventDictionaryWithNameAndContent(
           kReporter_Events_BeginStatus,
           @{
             kReporter_BeginStatus_MessageKey : beginMessage,
             kReporter_BeginStatus_LevelKey : @"Info"
           }
         ));
+        FlushEvents();
       });
 
       // Halt process execution until a debugger is attached
@@ -433,7 +605,7 @@ static void XCWaitForDebuggerIfNeeded()
 
       NSString *endMessage = [NSString stringWithFormat:@"Debugger was successfully attached to pid '%d'.", pid];
       dispatch_sync(EventQueue(), ^{
-        PrintJSON(EventDictionaryWithNameAndContent(
+        PrintEvent(EventDictionaryWithNameAndContent(
           kReporter_Events_EndStatus,
           @{
             kReporter_BeginStatus_MessageKey : endMessage,
@@ -466,11 +638,111 @@ static void XCTestCaseSuite_performTest(id self, SEL sel, id arg1)
     XCPerformTestWithSuppressedExpectedAssertionFailures(self, originalSelector, arg1);
 }
 
+static void RunWorkerBatches(void);
+
 static void XCTestSuite_performTest(id self, SEL sel, id arg1)
 {
   SEL originalSelector = @selector(__XCTestSuite_performTest:);
   XCWaitForDebuggerIfNeeded();
+  __testSuitePerformDepth++;
   XCPerformTestWithSuppressedExpectedAssertionFailures(self, originalSelector, arg1);
+  __testSuitePerformDepth--;
+
+  // Once the top-level suite is done, stick around and run whatever else
+  // xctool hands us instead of letting xctest exit.
+  if (__testSuitePerformDepth == 0 && __workerControlFilePath != NULL && !__runningWorkerBatches) {
+    __runningWorkerBatches = YES;
+    RunWorkerBatches();
+    __runningWorkerBatches = NO;
+  }
+}
+
+#pragma mark - Worker Mode
+
+/*
+ *  In worker mode (OTEST_SHIM_WORKER_CONTROL_FILE is set) the process runs
+ *  successive batches of tests without being relaunched, so the bundle is only
+ *  loaded once.  The first batch is whatever xctest was launched with.  After
+ *  each batch we print kWorkerBatchFinishedMarker and read a line from the
+ *  control FIFO: either the path to a file listing the next batch's test cases
+ *  ("Class/method", one per line), or an empty line, in which case we return
+ *  and let xctest exit as usual.
+ */
+static XCTestSuite *TestSuiteForTestCases(NSArray *testCases)
+{
+  XCTestSuite *suite = [NSClassFromString(@"XCTestSuite") testSuiteWithName:@"Selected tests"];
+  NSMutableDictionary *suitesByClassName = [NSMutableDictionary dictionary];
+
+  for (NSString *testCase in testCases) {
+    if ([testCase length] == 0) {
+      continue;
+    }
+    NSArray *components = [testCase componentsSeparatedByString:@"/"];
+    Class testClass = NSClassFromString(components[0]);
+    if ([components count] != 2 || testClass == nil) {
+      // xctool will notice that the test never started and run it again in a
+      // fresh process.
+      fprintf(__stderr, "WARNING: Can't find test case '%s'.\n", [testCase UTF8String]);
+      continue;
+    }
+
+    XCTestSuite *classSuite = suitesByClassName[components[0]];
+    if (classSuite == nil) {
+      classSuite = [NSClassFromString(@"XCTestCaseSuite") emptyTestSuiteForTestCaseClass:testClass];
+      suitesByClassName[components[0]] = classSuite;
+      [suite addTest:classSuite];
+    }
+    [classSuite addTest:[testClass testCaseWithSelector:NSSelectorFromString(components[1])]];
+  }
+
+  return suite;
+}
+
+static void RunWorkerBatches(void)
+{
+  FILE *control = fopen(__workerControlFilePath, "r");
+  if (control == NULL) {
+    fprintf(__stderr, "ERROR: Failed to open worker control file '%s'.\n", __workerControlFilePath);
+    return;
+  }
+
+  char *line = NULL;
+  size_t lineCapacity = 0;
+  for (;;) {
+    dispatch_sync(EventQueue(), ^{
+      if (__binaryEventFraming) {
+        PrintEvent(@(kWorkerBatchFinishedMarker));
+      } else {
+        WriteEventBytes(kWorkerBatchFinishedMarker, strlen(kWorkerBatchFinishedMarker));
+        WriteEventBytes("\n", 1);
+      }
+      // xctool won't hand out the next batch until it sees the marker.
+      FlushEvents();
+    });
+
+    ssize_t lineLength = getline(&line, &lineCapacity, control);
+    if (lineLength <= 1) {
+      break;
+    }
+
+    @autoreleasepool {
+      NSString *testListPath = [[NSString stringWithUTF8String:line]
+                                stringByTrimmingCharactersInSet:[NSCharacterSet newlineCharacterSet]];
+      NSError *readError = nil;
+      NSString *testList = [NSString stringWithContentsOfFile:testListPath encoding:NSUTF8StringEncoding error:&readError];
+      NSCAssert(testList, @"Failed to read file at path %@ with error %@", testListPath, readError);
+
+      XCTestSuite *suite = TestSuiteForTestCases([testList componentsSeparatedByString:@"\n"]);
+      if ([suite respondsToSelector:@selector(runTest)]) {
+        ((void (*)(id, SEL))objc_msgSend)(suite, @selector(runTest));
+      } else {
+        [suite run];
+      }
+    }
+  }
+
+  free(line);
+  fclose(control);
 }
 
 #pragma mark - UI Tests
@@ -525,16 +797,38 @@ static void UpdateTestScope()
  *  to the pipe reader. Printing "\n" should be safe because reader is skipping
  *  empty lines.
  */
-static void PrintNewlineAndCloseFDs()
+static void CloseEventsFD()
 {
   if (__stdout == NULL) {
     return;
   }
-  fprintf(__stdout, "\n");
+  if (__binaryEventFraming) {
+    // An empty frame, which the reader skips just like an empty line.
+    static const char emptyFrame[kBinaryEventFrameHeaderLength] = {0};
+    fwrite(emptyFrame, 1, sizeof(emptyFrame), __stdout);
+  } else {
+    fprintf(__stdout, "\n");
+  }
   fclose(__stdout);
   __stdout = NULL;
 }
 
+static void PrintNewlineAndCloseFDs()
+{
+  if (__batchEvents) {
+    // Holding the writer off, so nothing pending is lost or written after
+    // closing.
+    pthread_mutex_lock(&__eventsFDLock);
+    WritePendingEventsHoldingFDLock();
+    CloseEventsFD();
+    __eventsFD = -1;
+    pthread_mutex_unlock(&__eventsFDLock);
+  } else {
+    CloseEventsFD();
+    __eventsFD = -1;
+  }
+}
+
 #pragma mark - Entry
 
 static void SwizzleXCTestMethodsIfAvailable()
@@ -667,7 +961,38 @@ static id NSBundle_loadAndReturnError(id self, SEL sel, NSError **error)
 
 void handle_signal(int signal)
 {
-  PrintNewlineAndCloseFDs();
+  // Only async-signal-safe calls from here on: the crash may have happened
+  // inside malloc, or on a thread holding one of the locks.  If the writer is
+  // partway through a batch, anything we wrote would land in the middle of
+  // it, so the pending events are given up rather than corrupting the stream
+  // (the test that crashed was already flushed when it began).  The locks
+  // stay held, so no other thread writes after us.
+  BOOL canWrite = YES;
+  if (__batchEvents) {
+    canWrite = (pthread_mutex_trylock(&__eventsFDLock) == 0);
+    if (canWrite && pthread_mutex_trylock(&__pendingEventsLock) == 0) {
+      if (__pendingEventLength > 0 && __eventsFD >= 0) {
+        WriteFully(__eventsFD, __pendingEventBytes, __pendingEventLength);
+      }
+      __pendingEventLength = 0;
+    }
+  }
+  if (canWrite && __eventsFD >= 0) {
+    if (__binaryEventFraming) {
+      // An empty frame, which the reader skips just like an empty line.
+      static const char emptyFrame[kBinaryEventFrameHeaderLength] = {0};
+      WriteFully(__eventsFD, emptyFrame, sizeof(emptyFrame));
+    } else {
+      WriteFully(__eventsFD, "\n", 1);
+    }
+  }
+
+  // Let the signal take its course once we return, whether it's abort()
+  // raising it again or a crashing instruction being retried.
+  struct sigaction sa_default;
+  memset(&sa_default, 0, sizeof(sa_default));
+  sa_default.sa_handler = SIG_DFL;
+  sigaction(signal, &sa_default, NULL);
 }
 
 __attribute__((constructor)) static void EntryPoint()
@@ -675,10 +1000,23 @@ __attribute__((constructor)) static void EntryPoint()
   const char *stdoutFileKey = "OTEST_SHIM_STDOUT_FILE";
   if (getenv(stdoutFileKey)) {
     __stdout = fopen(getenv(stdoutFileKey), "w");
+
+    // Only when events go to their own file: on the real stdout they'd be
+    // interleaved with whatever the tests print.
+    const char *framing = getenv(kOtestShimEventFramingEnvKey);
+    __pendingEventBytes = malloc(kEventBatchCapacity);
+    __spareEventBytes = malloc(kEventBatchCapacity);
+    __batchEvents = (__stdout != NULL && __pendingEventBytes != NULL && __spareEventBytes != NULL);
+    if (__stdout != NULL && framing != NULL && strcmp(framing, kOtestShimEventFramingBinary) == 0) {
+      __binaryEventFraming = YES;
+      fwrite(kBinaryEventStreamMagic, 1, kBinaryEventStreamMagicLength, __stdout);
+      fflush(__stdout);
+    }
   } else {
     int stdoutHandle = dup(STDOUT_FILENO);
     __stdout = fdopen(stdoutHandle, "w");
   }
+  __eventsFD = (__stdout != NULL) ? fileno(__stdout) : -1;
 
   const char *stderrFileKey = "OTEST_SHIM_STDERR_FILE";
   if (getenv(stderrFileKey)) {
@@ -690,9 +1028,23 @@ __attribute__((constructor)) static void EntryPoint()
 
   UpdateTestScope();
 
-  struct sigaction sa_abort;
-  sa_abort.sa_handler = &handle_signal;
-  sigaction(SIGABRT, &sa_abort, NULL);
+  // Worker mode is only supported with XCTest.
+  const char *workerControlFileKey = "OTEST_SHIM_WORKER_CONTROL_FILE";
+  if (getenv(workerControlFileKey)) {
+    __workerControlFilePath = strdup(getenv(workerControlFileKey));
+    unsetenv(workerControlFileKey);
+  }
+
+  // Crashes other than abort() need the same treatment now that events may be
+  // pending in memory: one that wasn't written would point xctool at the wrong
+  // test.
+  struct sigaction sa_crash;
+  memset(&sa_crash, 0, sizeof(sa_crash));
+  sa_crash.sa_handler = &handle_signal;
+  int crashSignals[] = {SIGABRT, SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGTRAP};
+  for (size_t i = 0; i < sizeof(crashSignals) / sizeof(crashSignals[0]); i++) {
+    sigaction(crashSignals[i], &sa_crash, NULL);
+  }
 
   // Let's register to get notified when libraries are initialized
   XTSwizzleSelectorForFunction([NSBundle class], @selector(loadAndReturnError:), (IMP)NSBundle_loadAndReturnError);
@@ -0,0 +1,27 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "ReporterPlugin.h"
+
+/**
+ Principal class of BuiltinReporters.bundle, which packages xctool's own
+ reporters so that they can run inside xctool.  The standalone executables
+ are still built for anyone who runs them directly.
+ */
+@interface BuiltinReporters : NSObject <ReporterPlugin>
+@end
@@ -0,0 +1,58 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "BuiltinReporters.h"
+
+#import "JSONCompilationDatabaseReporter.h"
+#import "JUnitReporter.h"
+#import "PhabricatorReporter.h"
+#import "TeamCityReporter.h"
+#import "TextReporter.h"
+
+@implementation BuiltinReporters
+
++ (NSDictionary *)reporterClassesByName
+{
+  return @{
+    @"plain": [PlainTextReporter class],
+    @"phabricator": [PhabricatorReporter class],
+    @"junit": [JUnitReporter class],
+    @"teamcity": [TeamCityReporter class],
+    @"json-compilation-database": [JSONCompilationDatabaseReporter class],
+  };
+}
+
++ (NSArray *)reporterNames
+{
+  return [@[@"pretty"] arrayByAddingObjectsFromArray:[[self reporterClassesByName] allKeys]];
+}
+
++ (Class)reporterClassNamed:(NSString *)name outputHandle:(NSFileHandle *)outputHandle
+{
+  if ([name isEqualToString:@"pretty"]) {
+    // Same choice text/main.m makes for the `pretty` executable.
+    if (isatty([outputHandle fileDescriptor]) ||
+        NSProcessInfo.processInfo.environment[@"XCTOOL_FORCE_TTY"]) {
+      return [PrettyTextReporter class];
+    } else {
+      return [NoOverwritePrettyTextReporter class];
+    }
+  }
+
+  return [self reporterClassesByName][name];
+}
+
+@end
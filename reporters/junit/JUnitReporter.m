@@ -37,6 +37,12 @@
 #pragma mark Implementation
 @implementation JUnitReporter
 
++ (BOOL)groupsEventsByBucket
+{
+  // Test cases are collected into whichever suite began last.
+  return YES;
+}
+
 #pragma mark Memory Management
 - (instancetype)init
 {
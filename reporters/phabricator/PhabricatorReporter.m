@@ -158,14 +158,6 @@
    }];
 }
 
-- (void)testOutput:(NSDictionary *)event
-{
-}
-
-- (void)message:(NSDictionary *)event
-{
-}
-
 - (NSString *)arcUnitJSON
 {
   NSError *error = nil;
@@ -0,0 +1,121 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "EventGenerator.h"
+#import "Reporter.h"
+#import "ReporterEvents.h"
+
+/**
+ * Records "begin:<test>" / "end:<test>" / "status:<message>" as it handles
+ * events.
+ */
+@interface RecordingReporter : Reporter
+@property (nonatomic, strong) NSMutableArray *calls;
+@end
+
+@implementation RecordingReporter
+
+- (instancetype)init
+{
+  if (self = [super init]) {
+    _calls = [NSMutableArray array];
+  }
+  return self;
+}
+
+- (void)beginTest:(NSDictionary *)event
+{
+  [_calls addObject:[@"begin:" stringByAppendingString:event[kReporter_BeginTest_TestKey]]];
+}
+
+- (void)endTest:(NSDictionary *)event
+{
+  [_calls addObject:[@"end:" stringByAppendingString:event[kReporter_EndTest_TestKey]]];
+}
+
+- (void)beginStatus:(NSDictionary *)event
+{
+  [_calls addObject:[@"status:" stringByAppendingString:event[kReporter_BeginStatus_MessageKey]]];
+}
+
+@end
+
+@interface GroupingRecordingReporter : RecordingReporter
+@end
+
+@implementation GroupingRecordingReporter
+
++ (BOOL)groupsEventsByBucket
+{
+  return YES;
+}
+
+@end
+
+static NSDictionary *BucketEvent(NSNumber *bucket, NSString *name, NSDictionary *content)
+{
+  NSMutableDictionary *event = [EventDictionaryWithNameAndContent(name, content) mutableCopy];
+  if (bucket) {
+    event[kReporter_BucketKey] = bucket;
+  }
+  return event;
+}
+
+static NSArray *InterleavedEventsOfTwoBuckets(void)
+{
+  return @[
+    BucketEvent(@1, kReporter_Events_BeginTest, @{kReporter_BeginTest_TestKey: @"-[A a]"}),
+    BucketEvent(@2, kReporter_Events_BeginTest, @{kReporter_BeginTest_TestKey: @"-[B b]"}),
+    BucketEvent(nil, kReporter_Events_BeginStatus, @{kReporter_BeginStatus_MessageKey: @"In Progress"}),
+    BucketEvent(@2, kReporter_Events_EndTest, @{kReporter_EndTest_TestKey: @"-[B b]"}),
+    BucketEvent(@1, kReporter_Events_EndTest, @{kReporter_EndTest_TestKey: @"-[A a]"}),
+    BucketEvent(@2, kReporter_Events_EndBucket, @{kReporter_EndBucket_SucceededKey: @YES}),
+    BucketEvent(@1, kReporter_Events_EndBucket, @{kReporter_EndBucket_SucceededKey: @YES}),
+  ];
+}
+
+@interface ReporterBucketGroupingTests : XCTestCase
+@end
+
+@implementation ReporterBucketGroupingTests
+
+- (void)testEventsAreHandledAsTheyArriveByDefault
+{
+  RecordingReporter *reporter = [[RecordingReporter alloc] init];
+  for (NSDictionary *event in InterleavedEventsOfTwoBuckets()) {
+    [reporter handleEvent:event];
+  }
+  XCTAssertEqualObjects(reporter.calls, (@[@"begin:-[A a]", @"begin:-[B b]", @"status:In Progress",
+                                           @"end:-[B b]", @"end:-[A a]"]));
+  XCTAssertFalse([[RecordingReporter subscribedEvents] containsObject:kReporter_Events_EndBucket]);
+}
+
+- (void)testGroupingReporterHandlesOneBucketAtATime
+{
+  GroupingRecordingReporter *reporter = [[GroupingRecordingReporter alloc] init];
+  for (NSDictionary *event in InterleavedEventsOfTwoBuckets()) {
+    [reporter handleEvent:event];
+  }
+  // Untagged events aren't held back; buckets come in the order they ended.
+  XCTAssertEqualObjects(reporter.calls, (@[@"status:In Progress",
+                                           @"begin:-[B b]", @"end:-[B b]",
+                                           @"begin:-[A a]", @"end:-[A a]"]));
+  XCTAssertTrue([[GroupingRecordingReporter subscribedEvents] containsObject:kReporter_Events_EndBucket]);
+}
+
+@end
@@ -0,0 +1,75 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "JSONCompilationDatabaseReporter.h"
+#import "JUnitReporter.h"
+#import "PhabricatorReporter.h"
+#import "Reporter.h"
+#import "ReporterEvents.h"
+#import "TeamCityReporter.h"
+#import "TextReporter.h"
+#import "UserNotificationsReporter.h"
+
+@interface ReporterWithCatchAllHandler : Reporter
+@end
+
+@implementation ReporterWithCatchAllHandler
+- (void)handleEvent:(NSDictionary *)event {}
+@end
+
+@interface ReporterSubscribedEventsTests : XCTestCase
+@end
+
+@implementation ReporterSubscribedEventsTests
+
+- (void)testSubscribedEventsAreTheEventsWithHandlers
+{
+  assertThat([JUnitReporter subscribedEvents],
+             equalTo([NSSet setWithArray:@[kReporter_Events_BeginTestSuite,
+                                           kReporter_Events_EndTestSuite,
+                                           kReporter_Events_EndTest]]));
+}
+
+- (void)testReporterThatOverridesHandleEventTakesEveryEvent
+{
+  assertThat([ReporterWithCatchAllHandler subscribedEvents], nilValue());
+}
+
+- (void)testEmbeddedInfoPlistsMatchSubscribedEvents
+{
+  // Each reporter executable embeds its Info.plist, which is what xctool reads
+  // to decide which events to send it; keep them in sync with the code.
+  NSArray *reportersAndInfoPlists = @[
+    @[[PrettyTextReporter class], @"text/text-Info.plist"],
+    @[[PlainTextReporter class], @"text/text-Info.plist"],
+    @[[PhabricatorReporter class], @"phabricator/phabricator-Info.plist"],
+    @[[JUnitReporter class], @"junit/junit-Info.plist"],
+    @[[JSONCompilationDatabaseReporter class], @"json-compilation-database/json-compilation-database-Info.plist"],
+    @[[TeamCityReporter class], @"teamcity/teamcity-Info.plist"],
+    @[[UserNotificationsReporter class], @"user-notifications/user-notifications-Info.plist"],
+  ];
+
+  for (NSArray *reporterAndInfoPlist in reportersAndInfoPlists) {
+    NSString *path = [@XCTOOL_SRCROOT stringByAppendingPathComponent:reporterAndInfoPlist[1]];
+    NSDictionary *info = [NSDictionary dictionaryWithContentsOfFile:path];
+    assertThat([NSSet setWithArray:info[kReporterSubscribedEventsInfoKey]],
+               equalTo([reporterAndInfoPlist[0] subscribedEvents]));
+  }
+}
+
+@end
@@ -16,6 +16,12 @@
 #pragma mark Implementation
 @implementation TeamCityReporter
 
++ (BOOL)groupsEventsByBucket
+{
+  // TeamCity expects a suite's tests to start and finish one at a time.
+  return YES;
+}
+
 #pragma mark Memory Management
 - (instancetype)init
 {
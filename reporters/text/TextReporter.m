@@ -187,6 +187,12 @@ static NSString *abbreviatePath(NSString *string) {
 
 @implementation TextReporter
 
++ (BOOL)groupsEventsByBucket
+{
+  // Test output is indented under its test bundle.
+  return YES;
+}
+
 - (instancetype)init
 {
   if (self = [super init]) {
@@ -7,6 +7,9 @@ BUILD_OUTPUT_DIR="$OUTPUT_DIR"/build
 RELEASE_OUTPUT_DIR="$OUTPUT_DIR"/release
 XCTOOL_DIR=$(cd $(dirname $0)/..; pwd)
 
+# The Mach-O test enumerator is plain C and has a test driver of its own.
+make -C "$XCTOOL_DIR"/Common/MachOTestEnumeratorTests test
+
 [[ -n "${TRAVIS}" ]] && echo "travis_fold:start:build_xctool_tests"
 [[ -n "${TRAVIS}" ]] && echo "Build xctool and tests"
 
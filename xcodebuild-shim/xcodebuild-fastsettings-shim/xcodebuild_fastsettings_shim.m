@@ -34,18 +34,51 @@
 @interface Xcode3TargetProduct : Xcode3TargetBuildable
 @end
 
+/**
+ * Target names from SHOW_ONLY_BUILD_SETTINGS_FOR_TARGET (a single name) and
+ * SHOW_ONLY_BUILD_SETTINGS_FOR_TARGETS (newline-separated names, since target
+ * names may contain spaces and most punctuation), or nil if neither is set.
+ */
+static NSSet *TargetNamesToShow(void)
+{
+  NSDictionary *environment = [[NSProcessInfo processInfo] environment];
+  NSString *showOnlyBuildSettingsForTarget = environment[@"SHOW_ONLY_BUILD_SETTINGS_FOR_TARGET"];
+  NSString *showOnlyBuildSettingsForTargets = environment[@"SHOW_ONLY_BUILD_SETTINGS_FOR_TARGETS"];
+
+  if (showOnlyBuildSettingsForTarget == nil && showOnlyBuildSettingsForTargets == nil) {
+    return nil;
+  }
+
+  NSMutableSet *targetNames = [NSMutableSet set];
+  if (showOnlyBuildSettingsForTarget != nil) {
+    [targetNames addObject:showOnlyBuildSettingsForTarget];
+  }
+  for (NSString *targetName in [showOnlyBuildSettingsForTargets componentsSeparatedByString:@"\n"]) {
+    if (targetName.length > 0) {
+      [targetNames addObject:targetName];
+    }
+  }
+  return targetNames;
+}
+
 static NSArray *FilterBuildables(NSArray *buildables)
 {
-  NSString *showOnlyBuildsettingsForTarget = [[NSProcessInfo processInfo] environment][@"SHOW_ONLY_BUILD_SETTINGS_FOR_TARGET"];
+  static NSSet *targetNamesToShow = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    targetNamesToShow = TargetNamesToShow();
+  });
   NSString *showOnlyBuildsettingsForFirstBuildable = [[NSProcessInfo processInfo] environment][@"SHOW_ONLY_BUILD_SETTINGS_FOR_FIRST_BUILDABLE"];
 
-  if (showOnlyBuildsettingsForTarget != nil) {
+  if (targetNamesToShow != nil) {
+    // Keep Xcode's order, so settings are printed as they would be otherwise.
+    NSMutableArray *filteredBuildables = [NSMutableArray array];
     for (Xcode3TargetProduct *buildable in buildables) {
-      if ([[[buildable xcode3Target] name] isEqualToString:showOnlyBuildsettingsForTarget]) {
-        return @[buildable];
+      if ([targetNamesToShow containsObject:[[buildable xcode3Target] name]]) {
+        [filteredBuildables addObject:buildable];
       }
     }
-    return @[];
+    return filteredBuildables;
   } else if ([showOnlyBuildsettingsForFirstBuildable isEqualToString:@"YES"]) {
     return buildables.count > 0 ? @[buildables[0]] : @[];
   } else {
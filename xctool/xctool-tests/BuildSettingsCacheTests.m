@@ -0,0 +1,127 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "BuildSettingsCache.h"
+#import "XCToolUtil.h"
+
+@interface BuildSettingsCacheTests : XCTestCase
+@end
+
+@implementation BuildSettingsCacheTests
+
+/**
+ * Makes a minimal project referencing Base.xcconfig, which #includes
+ * Shared.xcconfig, and returns the path to the .xcodeproj.
+ */
+- (NSString *)makeProject
+{
+  NSString *directory = MakeTemporaryDirectory(@"build-settings-cache-XXXXXXX");
+  NSString *projectPath = [directory stringByAppendingPathComponent:@"Some.xcodeproj"];
+  [[NSFileManager defaultManager] createDirectoryAtPath:projectPath
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+  [@{@"objects": @{
+       @"PROJECT": @{@"isa": @"PBXProject", @"projectDirPath": @""},
+       @"XCCONFIG": @{@"isa": @"PBXFileReference", @"path": @"Base.xcconfig", @"sourceTree": @"<group>"},
+       }} writeToFile:[projectPath stringByAppendingPathComponent:@"project.pbxproj"] atomically:YES];
+  [@"#include \"Shared.xcconfig\"\nOTHER_CFLAGS = -DBASE\n" writeToFile:[directory stringByAppendingPathComponent:@"Base.xcconfig"]
+                                                              atomically:YES
+                                                                encoding:NSUTF8StringEncoding
+                                                                   error:nil];
+  [@"GCC_OPTIMIZATION_LEVEL = 0\n" writeToFile:[directory stringByAppendingPathComponent:@"Shared.xcconfig"]
+                                    atomically:YES
+                                      encoding:NSUTF8StringEncoding
+                                         error:nil];
+  return projectPath;
+}
+
+- (void)testOnlyBuildSettingsByTargetAreReturned
+{
+  BuildSettingsCache *cache = [[BuildSettingsCache alloc] initWithDirectory:MakeTemporaryDirectory(@"build-settings-cache-XXXXXXX")];
+  NSDictionary *buildSettings = @{@"SomeTarget": @{@"SDK_NAME": @"macosx10.11"}};
+  [cache setBuildSettings:buildSettings forKey:@"abc"];
+  assertThat([cache buildSettingsForKey:@"abc"], equalTo(buildSettings));
+
+  [cache setJSONObject:@{} forKey:@"abc"];
+  assertThat([cache buildSettingsForKey:@"abc"], nilValue());
+  [cache setJSONObject:@{@"SomeTarget": @"macosx10.11"} forKey:@"abc"];
+  assertThat([cache buildSettingsForKey:@"abc"], nilValue());
+}
+
+- (void)testKeyChangesWithArgumentsAndEnvironment
+{
+  BuildSettingsCache *cache = [[BuildSettingsCache alloc] initWithDirectory:MakeTemporaryDirectory(@"build-settings-cache-XXXXXXX")];
+  NSArray *arguments = @[@"-project", [self makeProject], @"-target", @"Some", @"build", @"-showBuildSettings"];
+
+  NSString *key = [cache keyForXcodebuildArguments:arguments environment:@{@"A": @"1"}];
+  assertThat(key, equalTo([cache keyForXcodebuildArguments:arguments environment:@{@"A": @"1"}]));
+  assertThat([cache keyForXcodebuildArguments:arguments environment:@{@"A": @"2"}], isNot(equalTo(key)));
+  assertThat([cache keyForXcodebuildArguments:[arguments arrayByAddingObject:@"SDKROOT=iphoneos"]
+                                  environment:@{@"A": @"1"}],
+             isNot(equalTo(key)));
+}
+
+- (void)testKeyChangesWhenProjectOrIncludedXcconfigChanges
+{
+  BuildSettingsCache *cache = [[BuildSettingsCache alloc] initWithDirectory:MakeTemporaryDirectory(@"build-settings-cache-XXXXXXX")];
+  NSString *projectPath = [self makeProject];
+  NSString *directory = [projectPath stringByDeletingLastPathComponent];
+  NSArray *arguments = @[@"-project", projectPath, @"build", @"-showBuildSettings"];
+
+  NSString *key = [cache keyForXcodebuildArguments:arguments environment:@{}];
+
+  [@"GCC_OPTIMIZATION_LEVEL = s\n" writeToFile:[directory stringByAppendingPathComponent:@"Shared.xcconfig"]
+                                    atomically:YES
+                                      encoding:NSUTF8StringEncoding
+                                         error:nil];
+  NSString *xcconfigChangedKey = [cache keyForXcodebuildArguments:arguments environment:@{}];
+  assertThat(xcconfigChangedKey, isNot(equalTo(key)));
+
+  [@{@"objects": @{
+       @"PROJECT": @{@"isa": @"PBXProject", @"projectDirPath": @""},
+       }} writeToFile:[projectPath stringByAppendingPathComponent:@"project.pbxproj"] atomically:YES];
+  NSString *projectChangedKey = [cache keyForXcodebuildArguments:arguments environment:@{}];
+  assertThat(projectChangedKey, isNot(equalTo(xcconfigChangedKey)));
+}
+
+- (void)testKeyChangesWhenOverridingXcconfigChanges
+{
+  BuildSettingsCache *cache = [[BuildSettingsCache alloc] initWithDirectory:MakeTemporaryDirectory(@"build-settings-cache-XXXXXXX")];
+  NSString *projectPath = [self makeProject];
+  NSString *directory = [projectPath stringByDeletingLastPathComponent];
+  NSString *xcconfigPath = [directory stringByAppendingPathComponent:@"Override.xcconfig"];
+  NSString *environmentXcconfigPath = [directory stringByAppendingPathComponent:@"Environment.xcconfig"];
+  NSArray *arguments = @[@"-project", projectPath, @"-xcconfig", xcconfigPath, @"build", @"-showBuildSettings"];
+  NSDictionary *environment = @{@"XCODE_XCCONFIG_FILE": environmentXcconfigPath};
+
+  [@"OTHER_LDFLAGS = -ObjC\n" writeToFile:xcconfigPath atomically:YES encoding:NSUTF8StringEncoding error:nil];
+  [@"ONLY_ACTIVE_ARCH = NO\n" writeToFile:environmentXcconfigPath atomically:YES encoding:NSUTF8StringEncoding error:nil];
+  NSString *key = [cache keyForXcodebuildArguments:arguments environment:environment];
+
+  // Same size, and likely within the same second as the original.
+  [@"OTHER_LDFLAGS = -lObj\n" writeToFile:xcconfigPath atomically:NO encoding:NSUTF8StringEncoding error:nil];
+  NSString *xcconfigChangedKey = [cache keyForXcodebuildArguments:arguments environment:environment];
+  assertThat(xcconfigChangedKey, isNot(equalTo(key)));
+
+  [@"ONLY_ACTIVE_ARCH = YES\n" writeToFile:environmentXcconfigPath atomically:YES encoding:NSUTF8StringEncoding error:nil];
+  NSString *environmentChangedKey = [cache keyForXcodebuildArguments:arguments environment:environment];
+  assertThat(environmentChangedKey, isNot(equalTo(xcconfigChangedKey)));
+}
+
+@end
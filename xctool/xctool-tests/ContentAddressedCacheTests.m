@@ -0,0 +1,76 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "ContentAddressedCache.h"
+#import "XCToolUtil.h"
+
+@interface ContentAddressedCacheTests : XCTestCase
+@end
+
+@implementation ContentAddressedCacheTests
+
+- (void)setModificationDate:(NSDate *)date ofEntryAtPath:(NSString *)path
+{
+  [[NSFileManager defaultManager] setAttributes:@{NSFileModificationDate: date}
+                                   ofItemAtPath:path
+                                          error:nil];
+}
+
+- (NSDate *)modificationDateOfEntryAtPath:(NSString *)path
+{
+  return [[[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil] fileModificationDate];
+}
+
+- (void)testRoundTripsEntries
+{
+  NSString *directory = MakeTemporaryDirectory(@"content-addressed-cache-XXXXXXX");
+  ContentAddressedCache *cache = [[ContentAddressedCache alloc] initWithDirectory:directory maxEntryAge:60];
+  assertThat([cache JSONObjectForKey:@"abc"], nilValue());
+
+  [cache setJSONObject:@{@"a": @[@1, @2]} forKey:@"abc"];
+  assertThat([cache JSONObjectForKey:@"abc"], equalTo(@{@"a": @[@1, @2]}));
+
+  // A fresh instance on the same directory sees the entry too.
+  ContentAddressedCache *otherCache = [[ContentAddressedCache alloc] initWithDirectory:directory maxEntryAge:60];
+  assertThat([otherCache JSONObjectForKey:@"abc"], equalTo(@{@"a": @[@1, @2]}));
+}
+
+- (void)testFirstWritePrunesEntriesNotUsedLately
+{
+  NSString *directory = MakeTemporaryDirectory(@"content-addressed-cache-XXXXXXX");
+  NSString *stalePath = [directory stringByAppendingPathComponent:@"stale.json"];
+  NSString *readPath = [directory stringByAppendingPathComponent:@"read.json"];
+  ContentAddressedCache *seedCache = [[ContentAddressedCache alloc] initWithDirectory:directory maxEntryAge:60];
+  [seedCache setJSONObject:@[@"stale"] forKey:@"stale"];
+  [seedCache setJSONObject:@[@"read"] forKey:@"read"];
+  NSDate *longAgo = [NSDate dateWithTimeIntervalSinceNow:-120];
+  [self setModificationDate:longAgo ofEntryAtPath:stalePath];
+  [self setModificationDate:longAgo ofEntryAtPath:readPath];
+
+  ContentAddressedCache *cache = [[ContentAddressedCache alloc] initWithDirectory:directory maxEntryAge:60];
+  // Reading an entry keeps it from being pruned.
+  assertThat([cache JSONObjectForKey:@"read"], equalTo(@[@"read"]));
+  assertThatBool([[self modificationDateOfEntryAtPath:readPath] compare:longAgo] == NSOrderedDescending, isTrue());
+
+  [cache setJSONObject:@[@"new"] forKey:@"new"];
+  assertThat([cache JSONObjectForKey:@"stale"], nilValue());
+  assertThat([cache JSONObjectForKey:@"read"], equalTo(@[@"read"]));
+  assertThat([cache JSONObjectForKey:@"new"], equalTo(@[@"new"]));
+}
+
+@end
@@ -0,0 +1,189 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import <mach/mach.h>
+
+#import "EventBuffer.h"
+#import "ReporterEvents.h"
+#import "XCToolUtil.h"
+
+static uint64_t ResidentMemorySize(void)
+{
+  struct mach_task_basic_info info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  kern_return_t result = task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count);
+  NSCAssert(result == KERN_SUCCESS, @"task_info failed: %d", result);
+  return info.resident_size;
+}
+
+/**
+ * Checks that chunks arrive in the order they were published, without holding
+ * on to any of them.
+ */
+@interface SequenceCheckingSink : NSObject <EventSink>
+@property (nonatomic, assign) uint64_t chunkCount;
+@property (nonatomic, assign) uint64_t byteCount;
+@property (nonatomic, assign) BOOL outOfOrder;
+@end
+
+@implementation SequenceCheckingSink
+
+- (void)publishDataForEvent:(NSData *)data
+{
+  uint64_t sequenceNumber = 0;
+  [data getBytes:&sequenceNumber length:sizeof(sequenceNumber)];
+  if (sequenceNumber != _chunkCount) {
+    _outOfOrder = YES;
+  }
+  _chunkCount++;
+  _byteCount += [data length];
+}
+
+@end
+
+/**
+ * Remembers which events it was handed with -publishEvent:data:, as a
+ * reporter that filters on the event would see them.
+ */
+@interface EventTakingSink : NSObject <EventSink>
+@property (nonatomic, strong) NSMutableArray *eventsPublishedWithEvent;
+@property (nonatomic, assign) NSUInteger dataOnlyCount;
+@end
+
+@implementation EventTakingSink
+
+- (instancetype)init
+{
+  if (self = [super init]) {
+    _eventsPublishedWithEvent = [NSMutableArray array];
+  }
+  return self;
+}
+
+- (void)publishDataForEvent:(NSData *)data
+{
+  _dataOnlyCount++;
+}
+
+- (void)publishEvent:(NSDictionary *)event data:(NSData *)data
+{
+  [_eventsPublishedWithEvent addObject:event];
+}
+
+@end
+
+@interface EventBufferTests : XCTestCase
+@end
+
+@implementation EventBufferTests
+
+- (void)testEventsPastTheMemoryLimitAreFlushedInOrder
+{
+  EventBuffer *sink = [[EventBuffer alloc] init];
+  EventBuffer *buffer = [EventBuffer eventBufferForSink:sink];
+  buffer.memoryLimit = 100;
+
+  NSMutableArray *events = [NSMutableArray array];
+  for (int i = 0; i < 20; i++) {
+    NSDictionary *event = @{
+      kReporter_Event_Key: kReporter_Events_TestOuput,
+      kReporter_TestOutput_OutputKey: [NSString stringWithFormat:@"line %d\n", i],
+    };
+    [events addObject:event];
+    PublishEventToReporters(@[buffer], event);
+  }
+
+  XCTAssertEqualObjects(buffer.events, events);
+  XCTAssertEqualObjects(sink.events, @[]);
+
+  [buffer flush];
+
+  XCTAssertEqualObjects(buffer.events, @[]);
+  XCTAssertEqualObjects(sink.events, events);
+}
+
+- (void)testSpilledEventsAreFlushedWithTheirEvent
+{
+  EventTakingSink *sink = [[EventTakingSink alloc] init];
+  EventBuffer *buffer = [EventBuffer eventBufferForSink:sink];
+  buffer.memoryLimit = 100;
+
+  NSMutableArray *events = [NSMutableArray array];
+  for (int i = 0; i < 20; i++) {
+    NSDictionary *event = @{
+      kReporter_Event_Key: kReporter_Events_TestOuput,
+      kReporter_TestOutput_OutputKey: [NSString stringWithFormat:@"line %d\n", i],
+    };
+    [events addObject:event];
+    PublishEventToReporters(@[buffer], event);
+  }
+  [buffer flush];
+
+  XCTAssertEqualObjects(sink.eventsPublishedWithEvent, events);
+  XCTAssertEqual(sink.dataOnlyCount, (NSUInteger)0);
+}
+
+/**
+ * Pushes events through a buffer with a small memory limit and checks that the
+ * process doesn't grow with them.  Defaults to 16 MB through a 256 KB limit so
+ * it's quick enough to run with the other tests; set
+ * XCTOOL_EVENT_BUFFER_TEST_MB to e.g. 4096 to push 4 GB.
+ */
+- (void)testResidentMemoryStaysBoundedWhenSpillingToDisk
+{
+  uint64_t totalMegabytes = 16;
+  NSString *megabytesFromEnv = [[NSProcessInfo processInfo] environment][@"XCTOOL_EVENT_BUFFER_TEST_MB"];
+  if ([megabytesFromEnv longLongValue] > 0) {
+    totalMegabytes = (uint64_t)[megabytesFromEnv longLongValue];
+  }
+
+  const NSUInteger memoryLimit = 256 * 1024;
+  const NSUInteger chunkSize = 16 * 1024;
+  const uint64_t chunkCount = totalMegabytes * 1024 * 1024 / chunkSize;
+
+  SequenceCheckingSink *sink = [[SequenceCheckingSink alloc] init];
+  EventBuffer *buffer = [EventBuffer eventBufferForSink:sink];
+  buffer.memoryLimit = memoryLimit;
+
+  uint64_t residentAtStart = ResidentMemorySize();
+  uint64_t residentPeak = residentAtStart;
+  NSMutableData *chunk = [NSMutableData dataWithLength:chunkSize];
+  for (uint64_t i = 0; i < chunkCount; i++) {
+    @autoreleasepool {
+      memcpy([chunk mutableBytes], &i, sizeof(i));
+      [buffer publishDataForEvent:[chunk copy]];
+    }
+    if (i % 64 == 0) {
+      residentPeak = MAX(residentPeak, ResidentMemorySize());
+    }
+  }
+
+  [buffer flush];
+  residentPeak = MAX(residentPeak, ResidentMemorySize());
+
+  XCTAssertEqual(sink.chunkCount, chunkCount);
+  XCTAssertEqual(sink.byteCount, chunkCount * chunkSize);
+  XCTAssertFalse(sink.outOfOrder);
+  // The limit, plus slack for the allocator and stdio holding on to pages;
+  // well under what was pushed through, even at the default size.
+  XCTAssertLessThan(residentPeak - residentAtStart, (uint64_t)(memoryLimit + 8 * 1024 * 1024),
+                    @"Pushing %llu MB through the buffer grew resident memory by %llu MB",
+                    totalMegabytes, (residentPeak - residentAtStart) / (1024 * 1024));
+}
+
+@end
@@ -0,0 +1,92 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import <libkern/OSByteOrder.h>
+
+#import "EventFraming.h"
+
+static id RoundTrip(id object)
+{
+  NSData *frame = BinaryEventFrameWithObject(object);
+  if (frame == nil) {
+    return nil;
+  }
+  NSCAssert(OSReadLittleInt32(frame.bytes, 0) == frame.length - kBinaryEventFrameHeaderLength,
+            @"Frame length should cover the payload.");
+  return ObjectWithBinaryEventPayload((const char *)frame.bytes + kBinaryEventFrameHeaderLength,
+                                      frame.length - kBinaryEventFrameHeaderLength);
+}
+
+@interface EventFramingTests : XCTestCase
+@end
+
+@implementation EventFramingTests
+
+- (void)testEventsSurviveRoundTrip
+{
+  NSDictionary *event = @{
+    @"event": @"end-test",
+    @"test": @"-[SomeTests testSomething] \U00010196",
+    @"succeeded": @YES,
+    @"totalDuration": @0.25,
+    @"count": @(-3),
+    @"big": @(INT64_MAX),
+    @"exceptions": @[@{@"filePathInProject": @"A.m", @"lineNumber": @12}],
+    @"output": @"",
+    @"nothing": [NSNull null],
+  };
+  XCTAssertEqualObjects(RoundTrip(event), event);
+  XCTAssertEqualObjects(RoundTrip(@"__marker__"), @"__marker__");
+}
+
+- (void)testBooleansAndDoublesKeepTheirTypes
+{
+  NSDictionary *decoded = RoundTrip(@{@"flag": @NO, @"duration": @1.0});
+  XCTAssertEqual(CFGetTypeID((__bridge CFTypeRef)decoded[@"flag"]), CFBooleanGetTypeID());
+  XCTAssertTrue(CFNumberIsFloatType((__bridge CFNumberRef)decoded[@"duration"]));
+}
+
+- (void)testUnsupportedObjectsCannotBeFramed
+{
+  XCTAssertNil(BinaryEventFrameWithObject(@{@"date": [NSDate date]}));
+  XCTAssertNil(BinaryEventFrameWithObject(@{@1: @"non-string key"}));
+}
+
+- (void)testMalformedPayloadsAreRejected
+{
+  NSData *frame = BinaryEventFrameWithObject(@{@"event": @"begin-test"});
+  const char *payload = (const char *)frame.bytes + kBinaryEventFrameHeaderLength;
+  size_t length = frame.length - kBinaryEventFrameHeaderLength;
+
+  XCTAssertNotNil(ObjectWithBinaryEventPayload(payload, length));
+  // Truncated anywhere.
+  for (size_t i = 0; i < length; i++) {
+    XCTAssertNil(ObjectWithBinaryEventPayload(payload, i));
+  }
+  // Trailing bytes.
+  NSMutableData *padded = [NSMutableData dataWithBytes:payload length:length];
+  [padded appendBytes:"N" length:1];
+  XCTAssertNil(ObjectWithBinaryEventPayload(padded.bytes, padded.length));
+  // Unknown tag.
+  XCTAssertNil(ObjectWithBinaryEventPayload("X", 1));
+  // A count far beyond what's there.
+  const unsigned char hugeArray[] = {'A', 0xff, 0xff, 0xff, 0x7f, 'N'};
+  XCTAssertNil(ObjectWithBinaryEventPayload(hugeArray, sizeof(hugeArray)));
+}
+
+@end
@@ -34,7 +34,7 @@
   lastLineIndex = -1;
 }
 
-- (void)runTestsAndFeedOutputTo:(FdOutputLineFeedBlock)outputLineBlock
+- (void)runTestsAndFeedOutputTo:(TestOutputFeedBlock)outputLineBlock
                    startupError:(NSString **)startupError
                     otherErrors:(NSString **)otherErrors
 {
@@ -42,7 +42,7 @@
     if ([_outputLines[lastLineIndex] isEqualToString:@"__break__"]) {
       return;
     }
-    outputLineBlock(0, _outputLines[lastLineIndex]);
+    outputLineBlock(TestOutputTypeEvent, _outputLines[lastLineIndex]);
   }
 }
 
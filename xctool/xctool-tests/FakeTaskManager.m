@@ -216,6 +216,15 @@ __attribute__((constructor)) static void initialize()
                 [[FakeTaskManager sharedManager] hideTaskFromLaunchedTasks:task];
               }
             },
+           // Build settings that run-tests prefetches for several targets of a
+           // project at once.  Targets missing from the output are fetched one
+           // at a time, which is what most tests expect to see.
+           ^(FakeTask *task){
+             if ([[task launchPath] hasSuffix:@"usr/bin/xcodebuild"] &&
+                 [task environment][@"SHOW_ONLY_BUILD_SETTINGS_FOR_TARGETS"] != nil) {
+               [[FakeTaskManager sharedManager] hideTaskFromLaunchedTasks:task];
+             }
+           },
            ];
 }
 
@@ -0,0 +1,157 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "InProcessReporterTask.h"
+#import "Reporter.h"
+#import "XCToolUtil.h"
+
+/**
+ Writes one line per callback so the tests can check what it was given.
+ */
+@interface FakeInProcessReporter : Reporter
+@end
+
+@implementation FakeInProcessReporter
+
+- (void)willBeginReporting
+{
+  [_outputHandle writeData:[@"will-begin\n" dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+- (void)handleEvent:(NSDictionary *)event
+{
+  NSString *line = [NSString stringWithFormat:@"%@ %@\n",
+                    event[@"event"],
+                    [event isKindOfClass:[NSDictionary class]] ? @"dictionary" : @"other"];
+  [_outputHandle writeData:[line dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+- (void)didFinishReporting
+{
+  [_outputHandle writeData:[@"did-finish\n" dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+@end
+
+/**
+ Only handles begin-test, so shouldn't be sent anything else.
+ */
+@interface FakeBeginTestReporter : Reporter
+@end
+
+@implementation FakeBeginTestReporter
+
+- (void)beginTest:(NSDictionary *)event
+{
+  [_outputHandle writeData:[[event[@"event"] stringByAppendingString:@"\n"] dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+@end
+
+@interface FakeReporterPlugin : NSObject <ReporterPlugin>
+@end
+
+@implementation FakeReporterPlugin
+
++ (NSArray *)reporterNames
+{
+  return @[@"fake", @"fake-begin-test"];
+}
+
++ (Class)reporterClassNamed:(NSString *)name outputHandle:(NSFileHandle *)outputHandle
+{
+  return @{@"fake": [FakeInProcessReporter class],
+           @"fake-begin-test": [FakeBeginTestReporter class]}[name];
+}
+
+@end
+
+@interface InProcessReporterTaskTests : XCTestCase
+@end
+
+@implementation InProcessReporterTaskTests
+
+- (void)testEventsAreHandedToReporterInOrder
+{
+  NSString *outputPath = MakeTempFileWithPrefix(@"in-process-reporter-output");
+
+  InProcessReporterTask *rt = [[InProcessReporterTask alloc] initWithPlugin:[FakeReporterPlugin class]
+                                                               reporterName:@"fake"
+                                                                 outputPath:outputPath];
+  NSString *error = nil;
+  BOOL opened = [rt openWithStandardOutput:[NSFileHandle fileHandleWithNullDevice]
+                             standardError:[NSFileHandle fileHandleWithStandardError]
+                                     error:&error];
+  assertThatBool(opened, isTrue());
+
+  for (NSUInteger i = 0; i < 3; i++) {
+    PublishEventToReporters(@[rt], @{@"event":[NSString stringWithFormat:@"fake-event-%lu", (unsigned long)i]});
+  }
+  [rt close];
+
+  NSString *output = [NSString stringWithContentsOfFile:outputPath
+                                               encoding:NSUTF8StringEncoding
+                                                  error:nil];
+  assertThat(output, equalTo(@"will-begin\n"
+                             @"fake-event-0 dictionary\n"
+                             @"fake-event-1 dictionary\n"
+                             @"fake-event-2 dictionary\n"
+                             @"did-finish\n"));
+  assertThatInteger(rt.publishedEventCount, equalToInteger(3));
+}
+
+- (void)testEventsTheReporterDoesNotHandleAreNotQueued
+{
+  NSString *outputPath = MakeTempFileWithPrefix(@"in-process-reporter-output");
+
+  InProcessReporterTask *rt = [[InProcessReporterTask alloc] initWithPlugin:[FakeReporterPlugin class]
+                                                               reporterName:@"fake-begin-test"
+                                                                 outputPath:outputPath];
+  NSString *error = nil;
+  BOOL opened = [rt openWithStandardOutput:[NSFileHandle fileHandleWithNullDevice]
+                             standardError:[NSFileHandle fileHandleWithStandardError]
+                                     error:&error];
+  assertThatBool(opened, isTrue());
+  assertThat(rt.subscribedEvents, equalTo([NSSet setWithObject:@"begin-test"]));
+
+  PublishEventToReporters(@[rt], @{@"event":@"begin-test"});
+  PublishEventToReporters(@[rt], @{@"event":@"test-output"});
+  PublishEventToReporters(@[rt], @{@"event":@"end-test"});
+  [rt close];
+
+  NSString *output = [NSString stringWithContentsOfFile:outputPath
+                                               encoding:NSUTF8StringEncoding
+                                                  error:nil];
+  assertThat(output, equalTo(@"begin-test\n"));
+  assertThatInteger(rt.publishedEventCount, equalToInteger(1));
+}
+
+- (void)testOpenFailsForReporterThePluginDoesNotProvide
+{
+  InProcessReporterTask *rt = [[InProcessReporterTask alloc] initWithPlugin:[FakeReporterPlugin class]
+                                                               reporterName:@"missing"
+                                                                 outputPath:@"-"];
+  NSString *error = nil;
+  BOOL opened = [rt openWithStandardOutput:[NSFileHandle fileHandleWithNullDevice]
+                             standardError:[NSFileHandle fileHandleWithStandardError]
+                                     error:&error];
+  assertThatBool(opened, isFalse());
+  assertThat(error, equalTo(@"Reporter plugin FakeReporterPlugin doesn't provide a reporter named 'missing'."));
+}
+
+@end
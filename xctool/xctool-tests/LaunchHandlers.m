@@ -196,22 +196,40 @@ BOOL IsSimctlSpawnXctestTask(NSTask *task)
   return [^(FakeTask *task){
 
     NSString *otestQueryOutputFilePath = nil;
+    // Set if several bundles are queried at once.
+    NSArray *batchedBundlePaths = nil;
 
     if ([[task launchPath] hasSuffix:@"usr/bin/simctl"]) {
       // iOS tests get queried through the 'simctl' launcher.
       for (NSString *arg in [task arguments]) {
         if ([arg hasSuffix:@"otest-query-ios"] || [arg hasSuffix:@"otest-query-appletv"]) {
           otestQueryOutputFilePath = task.environment[@"SIMCTL_CHILD_OTEST_QUERY_OUTPUT_FILE"];
+          batchedBundlePaths = [task.environment[@"SIMCTL_CHILD_OtestQueryBundlePaths"] componentsSeparatedByString:@":"];
           break;
         }
       }
     } else if ([[[task launchPath] lastPathComponent] hasPrefix:@"otest-query-"]) {
       otestQueryOutputFilePath = task.environment[@"OTEST_QUERY_OUTPUT_FILE"];
+      batchedBundlePaths = [task.environment[@"OtestQueryBundlePaths"] componentsSeparatedByString:@":"];
+      if (batchedBundlePaths == nil && [[task arguments] count] > 1) {
+        // otest-query-osx takes the bundles as its arguments.
+        batchedBundlePaths = [task arguments];
+      }
     }
 
     if (otestQueryOutputFilePath) {
+      // A batched query lists the tests of each bundle under its path.
+      id output = testList;
+      if (batchedBundlePaths) {
+        NSMutableDictionary *testListsByBundlePath = [NSMutableDictionary dictionary];
+        for (NSString *bundlePath in batchedBundlePaths) {
+          testListsByBundlePath[bundlePath] = @{@"tests" : testList};
+        }
+        output = testListsByBundlePath;
+      }
+
       [task pretendExitStatusOf:0];
-      [[NSJSONSerialization dataWithJSONObject:testList options:0 error:nil] writeToFile:otestQueryOutputFilePath atomically:YES];
+      [[NSJSONSerialization dataWithJSONObject:output options:0 error:nil] writeToFile:otestQueryOutputFilePath atomically:YES];
       [[FakeTaskManager sharedManager] hideTaskFromLaunchedTasks:task];
     }
   } copy];
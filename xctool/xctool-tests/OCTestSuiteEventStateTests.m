@@ -16,11 +16,14 @@
 
 #import <XCTest/XCTest.h>
 
+#import <QuartzCore/QuartzCore.h>
+
 #import "EventBuffer.h"
 #import "EventGenerator.h"
 #import "OCTestEventState.h"
 #import "OCTestSuiteEventState.h"
 #import "ReporterEvents.h"
+#import "TestRunState.h"
 #import "TestUtil.h"
 
 static NSDictionary *BeginEventForTestSuiteWithTestName(NSString * testName)
@@ -35,6 +38,39 @@ static NSDictionary *EndEventForTestSuiteWithTestName(NSString * testName)
                                            @{kReporter_EndTestSuite_SuiteKey:testName});
 }
 
+/**
+ * Feeds begin-test, output and end-test events for the last `sampleCount`
+ * tests of a suite of `testCount` tests through TestRunState, and returns the
+ * average time spent per event.
+ */
+static CFTimeInterval SecondsPerEventInSuiteOfSize(NSUInteger testCount, NSUInteger sampleCount)
+{
+  NSMutableArray *testCases = [NSMutableArray arrayWithCapacity:testCount];
+  for (NSUInteger i = 0; i < testCount; i++) {
+    [testCases addObject:[NSString stringWithFormat:@"Cls%lu/testMethod", (unsigned long)i]];
+  }
+
+  TestRunState *state = [[TestRunState alloc] initWithTests:testCases reporters:@[]];
+  [state handleEvent:@{@"event": kReporter_Events_BeginTestSuite,
+                       kReporter_BeginTestSuite_SuiteKey: kReporter_TestSuite_TopLevelSuiteName}];
+
+  CFTimeInterval start = CACurrentMediaTime();
+  for (NSUInteger i = testCount - sampleCount; i < testCount; i++) {
+    NSString *testName = [NSString stringWithFormat:@"-[Cls%lu testMethod]", (unsigned long)i];
+    [state handleEvent:@{@"event": kReporter_Events_BeginTest,
+                         kReporter_BeginTest_TestKey: testName}];
+    [state handleEvent:@{@"event": kReporter_Events_SimulatorOuput,
+                         kReporter_SimulatorOutput_OutputKey: @"output\n",
+                         kReporter_TimestampKey: @0}];
+    [state handleEvent:@{@"event": kReporter_Events_EndTest,
+                         kReporter_EndTest_TestKey: testName,
+                         kReporter_EndTest_SucceededKey: @YES,
+                         kReporter_EndTest_ResultKey: @"success",
+                         kReporter_EndTest_TotalDurationKey: @0.01}];
+  }
+  return (CACurrentMediaTime() - start) / (sampleCount * 3);
+}
+
 @interface OCTestSuiteEventStateTests : XCTestCase
 
 @end
@@ -296,6 +332,40 @@ static NSDictionary *EndEventForTestSuiteWithTestName(NSString * testName)
   assertThat([state runningTest], is(testBState));
 }
 
+- (void)testPerEventCostDoesNotGrowWithSuiteSize
+{
+  CFTimeInterval small = SecondsPerEventInSuiteOfSize(1000, 1000);
+  CFTimeInterval large = SecondsPerEventInSuiteOfSize(100000, 1000);
+
+  // With 100x as many tests, a scan per event would make events ~100x
+  // slower; allow plenty of room for noise.
+  XCTAssertLessThan(large, small * 5,
+                    @"%.2fus per event with 1k tests, %.2fus with 100k tests",
+                    small * 1e6, large * 1e6);
+}
+
+- (void)testCountersFollowTestStateChanges
+{
+  OCTestSuiteEventState *state =
+    [[OCTestSuiteEventState alloc] initWithName:@"ATestSuite"];
+  [state addTestsFromArray:@[@"ATestClass/aTestMethod", @"ATestClass/bTestMethod"]];
+  OCTestEventState *testAState = state.tests[0];
+
+  assertThatInteger([state unstartedTestCount], equalToInteger(2));
+  assertThatInteger([state totalErrors], equalToInteger(2));
+
+  [testAState stateBeginTest];
+  assertThat([state runningTest], is(testAState));
+  assertThatInteger([state unstartedTestCount], equalToInteger(1));
+
+  [testAState stateEndTest:YES result:@"success" duration:2.0];
+  assertThat([state runningTest], nilValue());
+  assertThatInteger([state totalSuccesses], equalToInteger(1));
+  assertThatInteger([state totalErrors], equalToInteger(1));
+  assertThatDouble([state testDuration], closeTo(2.0, 0.01));
+  assertThat([state finishedTests], equalTo(@[testAState]));
+}
+
 - (void)testFailedAndErroredTests
 {
   EventBuffer *eventBuffer = [[EventBuffer alloc] init];
@@ -38,6 +38,44 @@
 
 @interface OCUnitTestRunner ()
 @property (nonatomic, copy) SimulatorInfo *simulatorInfo;
+@property (nonatomic, assign) NSUInteger crashBisectionLaunchCount;
+- (BOOL)testCasesCrashTestProcess:(NSArray *)testCases;
+- (NSString *)bisectCrashAfterTestCases:(NSArray *)testCases;
+@end
+
+/**
+ * Pretends the process crashes whenever `crashingTestCase` runs after all of
+ * `culprits`, instead of launching anything.
+ */
+@interface CrashBisectionTestRunner : OCUnitOSXLogicTestRunner
+@property (nonatomic, copy) NSString *crashingTestCase;
+@property (nonatomic, copy) NSArray *culprits;
+@property (nonatomic, strong) NSMutableArray *launchedTestCases;
+@end
+
+@implementation CrashBisectionTestRunner
+
+- (BOOL)testCasesCrashTestProcess:(NSArray *)testCases
+{
+  self.crashBisectionLaunchCount++;
+  if (_launchedTestCases == nil) {
+    _launchedTestCases = [NSMutableArray array];
+  }
+  [_launchedTestCases addObject:testCases];
+
+  NSUInteger crashingIndex = [testCases indexOfObject:_crashingTestCase];
+  if (crashingIndex == NSNotFound) {
+    return NO;
+  }
+  for (NSString *culprit in _culprits) {
+    NSUInteger culpritIndex = [testCases indexOfObject:culprit];
+    if (culpritIndex == NSNotFound || culpritIndex > crashingIndex) {
+      return NO;
+    }
+  }
+  return YES;
+}
+
 @end
 
 static id TestRunnerWithTestListsAndProcessEnv(Class cls, NSDictionary *settings, NSArray *focusedTestCases, NSArray *allTestCases, NSDictionary *processEnvironment)
@@ -835,4 +873,77 @@ static int NumberOfEntries(NSArray *array, NSObject *target)
   assertThat(error, nilValue());
 }
 
+- (CrashBisectionTestRunner *)crashBisectionRunnerWithLaunchLimit:(NSUInteger)launchLimit
+{
+  NSDictionary *allSettings =
+  BuildSettingsFromOutput([NSString stringWithContentsOfFile:TEST_DATA @"OSX-Logic-Test-showBuildSettings.txt"
+                                                    encoding:NSUTF8StringEncoding
+                                                       error:nil]);
+  CrashBisectionTestRunner *runner = TestRunner([CrashBisectionTestRunner class], allSettings[@"TestProject-Library-OSXTests"]);
+  runner.crashBisectionLaunchLimit = launchLimit;
+  return runner;
+}
+
+- (NSArray *)bisectionTestCases
+{
+  return @[@"Cls/test1", @"Cls/test2", @"Cls/test3", @"Cls/test4",
+           @"Cls/test5", @"Cls/test6", @"Cls/test7", @"Cls/test8"];
+}
+
+- (void)testCrashBisectionBlamesTheLastTestWhenItCrashesOnItsOwn
+{
+  CrashBisectionTestRunner *runner = [self crashBisectionRunnerWithLaunchLimit:10];
+  runner.crashingTestCase = @"Cls/test8";
+  runner.culprits = @[];
+
+  NSString *diagnosis = [runner bisectCrashAfterTestCases:[self bisectionTestCases]];
+
+  assertThat(diagnosis, equalTo(@"Crash bisection (1 extra launch): 'Cls/test8' crashes the process when run on its own."));
+  assertThat(runner.launchedTestCases, equalTo(@[@[@"Cls/test8"]]));
+}
+
+- (void)testCrashBisectionFindsEarlierTestThatCausesTheCrash
+{
+  CrashBisectionTestRunner *runner = [self crashBisectionRunnerWithLaunchLimit:10];
+  runner.crashingTestCase = @"Cls/test8";
+  runner.culprits = @[@"Cls/test6"];
+
+  NSString *diagnosis = [runner bisectCrashAfterTestCases:[self bisectionTestCases]];
+
+  assertThat(diagnosis, equalTo(@"Crash bisection (6 extra launches): running 'Cls/test6' before 'Cls/test8' "
+                                @"crashes the process; 'Cls/test6' is the likely culprit."));
+  assertThat(runner.launchedTestCases, equalTo(@[
+    @[@"Cls/test8"],
+    @[@"Cls/test1", @"Cls/test2", @"Cls/test3", @"Cls/test8"],
+    @[@"Cls/test4", @"Cls/test5", @"Cls/test6", @"Cls/test7", @"Cls/test8"],
+    @[@"Cls/test4", @"Cls/test5", @"Cls/test8"],
+    @[@"Cls/test6", @"Cls/test7", @"Cls/test8"],
+    @[@"Cls/test6", @"Cls/test8"],
+  ]));
+}
+
+- (void)testCrashBisectionReportsTestsSpreadAcrossBothHalves
+{
+  CrashBisectionTestRunner *runner = [self crashBisectionRunnerWithLaunchLimit:10];
+  runner.crashingTestCase = @"Cls/test8";
+  runner.culprits = @[@"Cls/test1", @"Cls/test7"];
+
+  NSString *diagnosis = [runner bisectCrashAfterTestCases:[self bisectionTestCases]];
+
+  assertThat(diagnosis, startsWith(@"Crash bisection (3 extra launches): neither half of the 7 tests"));
+}
+
+- (void)testCrashBisectionStopsAtTheLaunchLimit
+{
+  CrashBisectionTestRunner *runner = [self crashBisectionRunnerWithLaunchLimit:2];
+  runner.crashingTestCase = @"Cls/test8";
+  runner.culprits = @[@"Cls/test2"];
+
+  NSString *diagnosis = [runner bisectCrashAfterTestCases:[self bisectionTestCases]];
+
+  assertThatInteger([runner.launchedTestCases count], equalToInteger(2));
+  assertThat(diagnosis, equalTo(@"Crash bisection (2 extra launches): ran out of launches; one of these 3 tests, "
+                                @"run before 'Cls/test8', is the likely culprit: Cls/test1, Cls/test2, Cls/test3"));
+}
+
 @end
@@ -39,6 +39,22 @@
 }
 @end
 
+@interface OCUnitTestQueryRunner ()
+- (NSArray *)lookUpTestCasesWithoutQueryingWithCacheKey:(NSString **)cacheKey;
+@end
+
+@interface LookUpCountingQueryRunner : OCUnitOSXLogicTestQueryRunner
+@property (nonatomic, assign) NSUInteger lookUpCount;
+@end
+
+@implementation LookUpCountingQueryRunner
+- (NSArray *)lookUpTestCasesWithoutQueryingWithCacheKey:(NSString **)cacheKey
+{
+  _lookUpCount++;
+  return [super lookUpTestCasesWithoutQueryingWithCacheKey:cacheKey];
+}
+@end
+
 @interface OTestQueryTests : XCTestCase
 @end
 
@@ -136,6 +152,75 @@
                        @"TestProject_Library_XCTest_CustomTests/customTestWithInteger:"]));
 }
 
+- (void)testCanBatchQueryOSXBundles
+{
+  OCUnitTestQueryRunner *(^runnerForBundle)(NSString *, NSString *) = ^(NSString *dir, NSString *bundle) {
+    NSDictionary *buildSettings = @{
+      Xcode_BUILT_PRODUCTS_DIR : AbsolutePathFromRelative(dir),
+      Xcode_FULL_PRODUCT_NAME : bundle,
+      Xcode_TARGETED_DEVICE_FAMILY : @"1",
+    };
+    return [[OCUnitOSXLogicTestQueryRunner alloc] initWithSimulatorInfo:
+            [SimulatorInfo simulatorInfoWithBuildSettings:buildSettings deviceName:nil]];
+  };
+  NSArray *runners = @[
+    runnerForBundle(TEST_DATA @"tests-osx-test-bundle", @"TestProject-Library-XCTest-OSXTests.xctest"),
+    runnerForBundle(TEST_DATA @"tests-osx-test-bundle", @"TestProject-Library-XCTest-CustomTests.xctest"),
+    // Has build products of its own, so it gets a query of its own, which
+    // fails just as it would unbatched.
+    runnerForBundle(TEST_DATA @"tests-ios-test-bundle", @"TestProject-LibraryTests.octest"),
+  ];
+  assertThatBool([runners[0] needsBatchableQuery], isTrue());
+
+  NSArray *errors = nil;
+  NSArray *results = [OCUnitTestQueryRunner runQueriesWithRunners:runners errors:&errors];
+  assertThat(results[0], equalTo(@[@"TestProject_Library_XCTest_OSXTests/testOutput",
+                                   @"TestProject_Library_XCTest_OSXTests/testWillFail",
+                                   @"TestProject_Library_XCTest_OSXTests/testWillPass"]));
+  assertThat(errors[0], equalTo([NSNull null]));
+  assertThat(results[1], equalTo(@[@"TestProject_Library_XCTest_CustomTests/customTest",
+                                   @"TestProject_Library_XCTest_CustomTests/customTestWithInteger:"]));
+  assertThat(errors[1], equalTo([NSNull null]));
+  assertThat(results[2], equalTo([NSNull null]));
+  assertThat(errors[2], containsString(@"no suitable image found."));
+}
+
+- (void)testBundleIsOnlyLookedUpOnceBeforeQuerying
+{
+  NSDictionary *buildSettings = @{
+    Xcode_BUILT_PRODUCTS_DIR : AbsolutePathFromRelative(TEST_DATA @"tests-osx-test-bundle"),
+    Xcode_FULL_PRODUCT_NAME : @"TestProject-Library-XCTest-OSXTests.xctest",
+    Xcode_TARGETED_DEVICE_FAMILY : @"1",
+  };
+  LookUpCountingQueryRunner *runner =
+  [[LookUpCountingQueryRunner alloc] initWithSimulatorInfo:
+   [SimulatorInfo simulatorInfoWithBuildSettings:buildSettings deviceName:nil]];
+  assertThatBool([runner needsBatchableQuery], isTrue());
+
+  NSArray *errors = nil;
+  NSArray *results = [OCUnitTestQueryRunner runQueriesWithRunners:@[runner] errors:&errors];
+  assertThat(errors[0], equalTo([NSNull null]));
+  assertThat(results[0], equalTo(@[@"TestProject_Library_XCTest_OSXTests/testOutput",
+                                   @"TestProject_Library_XCTest_OSXTests/testWillFail",
+                                   @"TestProject_Library_XCTest_OSXTests/testWillPass"]));
+  assertThatInteger(runner.lookUpCount, equalToInteger(1));
+}
+
+- (void)testAppTestsAreNotBatched
+{
+  NSDictionary *buildSettings = @{
+    Xcode_BUILT_PRODUCTS_DIR : AbsolutePathFromRelative(TEST_DATA @"TestProject-App-OSX/Build/Products/Debug"),
+    Xcode_FULL_PRODUCT_NAME : @"TestProject-App-OSXTests.xctest",
+    Xcode_SDK_NAME : GetAvailableSDKsAndAliases()[@"macosx"],
+    Xcode_TEST_HOST : AbsolutePathFromRelative(TEST_DATA @"TestProject-App-OSX/Build/Products/Debug/TestProject-App-OSX.app/Contents/MacOS/TestProject-App-OSX"),
+    Xcode_TARGETED_DEVICE_FAMILY : @"1",
+  };
+  OCUnitTestQueryRunner *runner =
+  [[OCUnitOSXAppTestQueryRunner alloc] initWithSimulatorInfo:
+   [SimulatorInfo simulatorInfoWithBuildSettings:buildSettings deviceName:nil]];
+  assertThatBool([runner needsBatchableQuery], isFalse());
+}
+
 - (void)testCanQueryClassesFromIOSBundle
 {
   if (ToolchainIsXcode7OrBetter()) {
@@ -17,6 +17,7 @@
 #import <XCTest/XCTest.h>
 
 #import "ContainsAssertionFailure.h"
+#import "EventGenerator.h"
 #import "OCUnitIOSLogicTestQueryRunner.h"
 #import "OCUnitIOSLogicTestRunner.h"
 #import "OCUnitOSXLogicTestQueryRunner.h"
@@ -24,6 +25,7 @@
 #import "ReporterEvents.h"
 #import "TaskUtil.h"
 #import "TestUtil.h"
+#import "WarmTestWorkerPool.h"
 #import "XCToolUtil.h"
 #import "XcodeBuildSettings.h"
 
@@ -165,6 +167,41 @@ static NSTask *OtestShimTaskOSX(NSString *settingsPath, NSString *targetName, NS
                        otestShimOutputPath);
 }
 
+// Appends each event (and each line of output, as a simulator-output event)
+// to `resultBuilder`.
+static TestOutputFeedBlock EventCollectingBlock(NSMutableArray *resultBuilder)
+{
+  return ^(TestOutputType type, id output) {
+    NSError *error = nil;
+
+    if ([output isKindOfClass:[NSDictionary class]]) {
+      // The shim used binary framing, so the event comes decoded.
+      [resultBuilder addObject:output];
+      return;
+    }
+
+    NSString *line = output;
+    if (type == TestOutputTypeRawLine) {
+      [resultBuilder addObject:EventDictionaryWithNameAndContent(
+        kReporter_Events_SimulatorOuput,
+        @{kReporter_SimulatorOutput_OutputKey: StripAnsi([line stringByAppendingString:@"\n"])})];
+      return;
+    }
+
+    if (([line isEqualToString:@""])) {
+      return;
+    }
+
+    NSData *data = [line dataUsingEncoding:NSUTF8StringEncoding];
+    NSDictionary *jsonObj = [NSJSONSerialization JSONObjectWithData:data
+                                                            options:0
+                                                              error:&error];
+
+    NSCAssert(!error, @"Each line should be a well-formed JSON object.");
+    [resultBuilder addObject:jsonObj];
+  };
+}
+
 // returns nil when an error is encountered
 static NSArray *RunOtestAndParseResult(NSTask *task, NSString *otestShimOutputPath)
 {
@@ -175,21 +212,7 @@ static NSArray *RunOtestAndParseResult(NSTask *task, NSString *otestShimOutputPa
       task,
       @"running otest/xctest",
       otestShimOutputPath,
-      ^(int fd, NSString *line) {
-        NSError *error = nil;
-
-        if (([line isEqualToString:@""])) {
-          return;
-        }
-
-        NSData *data = [line dataUsingEncoding:NSUTF8StringEncoding];
-        NSDictionary *jsonObj = [NSJSONSerialization JSONObjectWithData:data
-                                                                options:0
-                                                                  error:&error];
-
-        NSCAssert(!error, @"Each line should be a well-formed JSON object.");
-        [resultBuilder addObject:jsonObj];
-    });
+      EventCollectingBlock(resultBuilder));
   } else {
     LaunchTaskAndFeedOuputLinesToBlock(task,
                                        @"running otest/xctest",
@@ -218,6 +241,32 @@ static NSArray *RunOtestAndParseResult(NSTask *task, NSString *otestShimOutputPa
   return [resultBuilder copy];
 }
 
+// Returns "Class/method" for each end-test event, in order.
+static NSArray *EndedTests(NSArray *events)
+{
+  NSMutableArray *tests = [NSMutableArray array];
+  for (NSDictionary *event in events) {
+    if ([event[@"event"] isEqualToString:kReporter_Events_EndTest]) {
+      [tests addObject:[NSString stringWithFormat:@"%@/%@",
+                        event[kReporter_EndTest_ClassNameKey],
+                        event[kReporter_EndTest_MethodNameKey]]];
+    }
+  }
+  return tests;
+}
+
+// Concatenates the output of every simulator-output event.
+static NSString *SimulatorOutput(NSArray *events)
+{
+  NSMutableString *output = [NSMutableString string];
+  for (NSDictionary *event in events) {
+    if ([event[@"event"] isEqualToString:kReporter_Events_SimulatorOuput]) {
+      [output appendString:event[kReporter_SimulatorOutput_OutputKey]];
+    }
+  }
+  return output;
+}
+
 static NSDictionary *ExtractEvent(NSArray *events, NSString *eventType)
 {
   static NSString *eventNameKey = @"event";
@@ -394,4 +443,64 @@ static NSDictionary *ExtractEvent(NSArray *events, NSString *eventType)
   assertThat(testOutput, containsString(@"Test -[TimeoutTests testTimeout] ran longer than specified test time limit: 1 second(s)"));
 }
 
+- (void)testWorkerRunsSuccessiveBatchesFromTheControlFile
+{
+  NSString *bundlePath = TEST_DATA @"tests-osx-test-bundle/TestProject-Library-XCTest-OSXTests.xctest";
+  NSString *targetName = @"TestProject-Library-XCTest-OSXTests";
+  NSString *settingsPath = TEST_DATA @"TestProject-Library-XCTest-OSX-showBuildSettings.txt";
+  NSArray *allTests = AllTestCasesInTestBundleOSX(bundlePath);
+
+  NSString *otestShimOutputPath;
+  NSTask *task = OtestShimTaskOSX(settingsPath,
+                                  targetName,
+                                  bundlePath,
+                                  @[@"TestProject_Library_XCTest_OSXTests/testWillPass"],
+                                  allTests,
+                                  &otestShimOutputPath);
+
+  WarmTestWorker *worker = [[WarmTestWorker alloc] initWithControlPath:MakeTempFileWithPrefix(@"otest_worker_control")];
+  NSMutableDictionary *environment = [[task environment] mutableCopy];
+  environment[[WarmTestWorker controlFileEnvironmentKey]] = worker.controlPath;
+  [task setEnvironment:environment];
+
+  // The first batch is whatever the task was launched with.
+  NSMutableArray *firstBatchEvents = [NSMutableArray array];
+  assertThatBool([worker launchTask:task
+                otestShimOutputPath:otestShimOutputPath
+                       feedOutputTo:EventCollectingBlock(firstBatchEvents)], isTrue());
+  assertThat(EndedTests(firstBatchEvents),
+             equalTo(@[@"TestProject_Library_XCTest_OSXTests/testWillPass"]));
+
+  // Later batches come over the control file, in the same process.
+  NSMutableArray *secondBatchEvents = [NSMutableArray array];
+  assertThatBool([worker runTestCases:@[@"TestProject_Library_XCTest_OSXTests/testWillFail"]
+                         feedOutputTo:EventCollectingBlock(secondBatchEvents)], isTrue());
+  assertThat(EndedTests(secondBatchEvents),
+             equalTo(@[@"TestProject_Library_XCTest_OSXTests/testWillFail"]));
+  assertThat(ExtractEvent(secondBatchEvents, kReporter_Events_EndTest)[kReporter_EndTest_SucceededKey],
+             equalTo(@NO));
+
+  // A test case the worker can't find is warned about and skipped, and the
+  // rest of the batch still runs.
+  NSMutableArray *thirdBatchEvents = [NSMutableArray array];
+  assertThatBool([worker runTestCases:@[@"NoSuchTestClass/testNothing",
+                                        @"TestProject_Library_XCTest_OSXTests/testOutput"]
+                         feedOutputTo:EventCollectingBlock(thirdBatchEvents)], isTrue());
+  assertThat(EndedTests(thirdBatchEvents),
+             equalTo(@[@"TestProject_Library_XCTest_OSXTests/testOutput"]));
+  assertThat(SimulatorOutput(thirdBatchEvents),
+             containsString(@"WARNING: Can't find test case 'NoSuchTestClass/testNothing'."));
+
+  // The worker is still usable after a batch with a missing test.
+  NSMutableArray *fourthBatchEvents = [NSMutableArray array];
+  assertThatBool([worker runTestCases:@[@"TestProject_Library_XCTest_OSXTests/testWillPass"]
+                         feedOutputTo:EventCollectingBlock(fourthBatchEvents)], isTrue());
+  assertThat(EndedTests(fourthBatchEvents),
+             equalTo(@[@"TestProject_Library_XCTest_OSXTests/testWillPass"]));
+
+  [worker terminate];
+  assertThatBool([worker.task isRunning], isFalse());
+  assertThatBool([[NSFileManager defaultManager] fileExistsAtPath:worker.controlPath], isFalse());
+}
+
 @end
@@ -295,6 +295,31 @@
    @"Reporter with name or path 'blah' could not be found."];
 }
 
+- (void)testReporterBufferOptionsAreAppliedToEveryReporter
+{
+  Options *options = [[Options optionsFrom:@[
+    @"-reporter", @"pretty",
+    @"-reporter", @"plain",
+    @"-reporterBufferSize", @"16",
+    @"-reporterOverflow", @"spill",
+    ]] assertReporterOptionsValidate];
+
+  for (ReporterTask *reporterTask in options.reporters) {
+    assertThatInteger(reporterTask.bufferCapacity, equalToInteger(16));
+    assertThatInteger(reporterTask.overflowPolicy, equalToInteger(ReporterTaskOverflowPolicySpillToDisk));
+  }
+
+  [[Options optionsFrom:@[
+    @"-reporterOverflow", @"drop",
+    ]] assertReporterOptionsFailToValidateWithError:
+   @"-reporterOverflow must be 'block' or 'spill', got 'drop'."];
+
+  [[Options optionsFrom:@[
+    @"-reporterBufferSize", @"0",
+    ]] assertReporterOptionsFailToValidateWithError:
+   @"-reporterBufferSize must be a positive number of events, got '0'."];
+}
+
 - (void)testArgumentsFlowThroughToCommonXcodebuildArguments
 {
   NSArray *arguments = @[@"-configuration", @"SomeConfig",
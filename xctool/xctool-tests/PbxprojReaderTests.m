@@ -35,6 +35,18 @@
   ]]));
 }
 
+- (void)testXcconfigFilesInProject
+{
+  NSString *projectPath = TEST_DATA "KiwiTests/KiwiTests.xcodeproj";
+  NSSet *set = XcconfigFilesReferencedInProjectAtPath(projectPath);
+  assertThat(set, equalTo([NSSet setWithArray:@[
+    TEST_DATA "KiwiTests/Pods/Pods-KiwiTests-OCUnit-AppTests.xcconfig",
+    TEST_DATA "KiwiTests/Pods/Pods-KiwiTests-OCUnit.xcconfig",
+    TEST_DATA "KiwiTests/Pods/Pods-KiwiTests-XCTest-AppTests.xcconfig",
+    TEST_DATA "KiwiTests/Pods/Pods-KiwiTests-XCTest.xcconfig",
+  ]]));
+}
+
 - (void)testSimpleProject
 {
   NSString *projectPath = TEST_DATA "TestProject-App-OSX/TestProject-App-OSX.xcodeproj";
@@ -20,6 +20,58 @@
 #import "ReporterTask.h"
 #import "XCToolUtil.h"
 
+/**
+ Returns the path to a reporter that sleeps before it starts reading, so that
+ events pile up behind it once the pipe is full.
+ */
+static NSString *SlowReporterPath()
+{
+  NSString *path = MakeTempFileWithPrefix(@"slow-reporter");
+  [@"#!/bin/sh\nsleep 1\nexec cat\n" writeToFile:path
+                                      atomically:NO
+                                        encoding:NSUTF8StringEncoding
+                                           error:nil];
+  [[NSFileManager defaultManager] setAttributes:@{NSFilePosixPermissions: @0755}
+                                   ofItemAtPath:path
+                                          error:nil];
+  return path;
+}
+
+static NSString *FakeEventName(NSUInteger index)
+{
+  // Big enough that the pipe to the reporter fills up after a few events.
+  return [NSString stringWithFormat:@"fake-event-%lu-%@",
+          (unsigned long)index, [@"" stringByPaddingToLength:4096 withString:@"x" startingAtIndex:0]];
+}
+
+static NSString *PublishEventsToSlowReporter(ReporterTask *rt, NSUInteger count)
+{
+  NSString *outputPath = MakeTempFileWithPrefix(@"slow-reporter-output");
+  NSString *error = nil;
+  BOOL opened = [rt openWithStandardOutput:[NSFileHandle fileHandleForWritingAtPath:outputPath]
+                             standardError:[NSFileHandle fileHandleWithNullDevice]
+                                     error:&error];
+  NSCAssert(opened, @"Failed to open reporter: %@", error);
+
+  for (NSUInteger i = 0; i < count; i++) {
+    PublishEventToReporters(@[rt], @{@"event":FakeEventName(i)});
+  }
+  [rt close];
+
+  return [NSString stringWithContentsOfFile:outputPath
+                                   encoding:NSUTF8StringEncoding
+                                      error:nil];
+}
+
+static NSString *ExpectedOutputForEventCount(NSUInteger count)
+{
+  NSMutableString *expected = [NSMutableString string];
+  for (NSUInteger i = 0; i < count; i++) {
+    [expected appendFormat:@"{\"event\":\"%@\"}\n", FakeEventName(i)];
+  }
+  return expected;
+}
+
 @interface ReporterTaskTests : XCTestCase
 @end
 
@@ -75,4 +127,34 @@
   assertThat(fakeStandardOutput, equalTo(@""));
 }
 
+- (void)testFullBufferBlocksPublisherUntilReporterCatchesUp
+{
+  ReporterTask *rt = [[ReporterTask alloc] initWithReporterPath:SlowReporterPath()
+                                                      outputPath:@"-"];
+  rt.bufferCapacity = 4;
+
+  NSString *output = PublishEventsToSlowReporter(rt, 100);
+
+  assertThat(output, equalTo(ExpectedOutputForEventCount(100)));
+  assertThatInteger(rt.publishedEventCount, equalToInteger(100));
+  assertThatInteger(rt.maxQueuedEventCount, equalToInteger(4));
+  assertThatInteger(rt.spilledEventCount, equalToInteger(0));
+  assertThatDouble(rt.blockedDuration, greaterThan(@0.5));
+}
+
+- (void)testFullBufferSpillsToDiskWithoutReorderingEvents
+{
+  ReporterTask *rt = [[ReporterTask alloc] initWithReporterPath:SlowReporterPath()
+                                                      outputPath:@"-"];
+  rt.bufferCapacity = 4;
+  rt.overflowPolicy = ReporterTaskOverflowPolicySpillToDisk;
+
+  NSString *output = PublishEventsToSlowReporter(rt, 100);
+
+  assertThat(output, equalTo(ExpectedOutputForEventCount(100)));
+  assertThatInteger(rt.spilledEventCount, greaterThan(@0));
+  assertThatDouble(rt.blockedDuration, equalToDouble(0));
+  assertThatDouble(rt.maxLag, greaterThan(@0.5));
+}
+
 @end
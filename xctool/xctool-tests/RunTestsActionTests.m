@@ -17,6 +17,7 @@
 #import <XCTest/XCTest.h>
 
 #import "Action.h"
+#import "ActionScripts.h"
 #import "ContainsArray.h"
 #import "FakeTask.h"
 #import "FakeTaskManager.h"
@@ -24,6 +25,7 @@
 #import "OCUnitTestRunner.h"
 #import "Options+Testing.h"
 #import "Options.h"
+#import "ReporterEvents.h"
 #import "RunTestsAction.h"
 #import "Swizzler.h"
 #import "TaskUtil.h"
@@ -37,6 +39,33 @@
 @property (nonatomic, copy) SimulatorInfo *simulatorInfo;
 @end
 
+@interface RunTestsAction ()
+- (BOOL)recordsTestDurations;
+@end
+
+/**
+ * Stands in for the scheme's action scripts, noting when the pre-test scripts
+ * would have run.
+ */
+@interface RecordingActionScripts : ActionScripts
+@property (nonatomic, strong) NSMutableArray *log;
+@end
+
+@implementation RecordingActionScripts
+
+- (void)preTestWithOptions:(Options *)options
+{
+  @synchronized (_log) {
+    [_log addObject:@"pre-test"];
+  }
+}
+
+- (void)postTestWithOptions:(Options *)options
+{
+}
+
+@end
+
 static BOOL areEqualJsonOutputsIgnoringKeys(NSString *output1, NSString *output2, NSArray *keys)
 {
   NSArray *output1Array = [[output1 stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] componentsSeparatedByString:@"\n"];
@@ -96,6 +125,128 @@ static BOOL areEqualJsonOutputsIgnoringKeys(NSString *output1, NSString *output2
    ];
 }
 
+- (void)testOverlapAppTestsRequiresParallelize
+{
+  [[Options optionsFrom:@[
+    @"-project", TEST_DATA @"TestProject-Library/TestProject-Library.xcodeproj",
+    @"-scheme", @"TestProject-Library",
+    @"-sdk", @"iphonesimulator6.1",
+    @"run-tests",
+    @"-overlapAppTests",
+    ]]
+   assertOptionsFailToValidateWithError:
+   @"run-tests: -overlapAppTests requires -parallelize."
+   withBuildSettingsFromFile:
+   TEST_DATA @"TestProject-Library-TestProject-Library-showBuildSettings.txt"
+   ];
+}
+
+- (void)testOverlapAppTestsCannotBeCombinedWithFreshSimulator
+{
+  [[Options optionsFrom:@[
+    @"-project", TEST_DATA @"TestProject-Library/TestProject-Library.xcodeproj",
+    @"-scheme", @"TestProject-Library",
+    @"-sdk", @"iphonesimulator6.1",
+    @"run-tests",
+    @"-parallelize",
+    @"-overlapAppTests",
+    @"-freshSimulator",
+    ]]
+   assertOptionsFailToValidateWithError:
+   @"run-tests: -overlapAppTests cannot be combined with -freshSimulator, -resetSimulator or -newSimulatorInstance."
+   withBuildSettingsFromFile:
+   TEST_DATA @"TestProject-Library-TestProject-Library-showBuildSettings.txt"
+   ];
+}
+
+- (void)testSimulatorPoolSizeRequiresParallelize
+{
+  [[Options optionsFrom:@[
+    @"-project", TEST_DATA @"TestProject-Library/TestProject-Library.xcodeproj",
+    @"-scheme", @"TestProject-Library",
+    @"-sdk", @"iphonesimulator6.1",
+    @"run-tests",
+    @"-simulatorPoolSize", @"4",
+    ]]
+   assertOptionsFailToValidateWithError:
+   @"run-tests: -simulatorPoolSize requires -parallelize."
+   withBuildSettingsFromFile:
+   TEST_DATA @"TestProject-Library-TestProject-Library-showBuildSettings.txt"
+   ];
+}
+
+- (void)testSimulatorPoolSizeCannotBeCombinedWithResetSimulator
+{
+  [[Options optionsFrom:@[
+    @"-project", TEST_DATA @"TestProject-Library/TestProject-Library.xcodeproj",
+    @"-scheme", @"TestProject-Library",
+    @"-sdk", @"iphonesimulator6.1",
+    @"run-tests",
+    @"-parallelize",
+    @"-simulatorPoolSize", @"4",
+    @"-resetSimulator",
+    ]]
+   assertOptionsFailToValidateWithError:
+   @"run-tests: -simulatorPoolSize cannot be combined with -freshSimulator, -resetSimulator or -newSimulatorInstance."
+   withBuildSettingsFromFile:
+   TEST_DATA @"TestProject-Library-TestProject-Library-showBuildSettings.txt"
+   ];
+}
+
+- (void)testFailFastRequiresPositiveCount
+{
+  [[Options optionsFrom:@[
+    @"-project", TEST_DATA @"TestProject-Library/TestProject-Library.xcodeproj",
+    @"-scheme", @"TestProject-Library",
+    @"-sdk", @"iphonesimulator6.1",
+    @"run-tests",
+    @"-failFast=0",
+    ]]
+   assertOptionsFailToValidateWithError:
+   @"run-tests: -failFast=N requires a positive number of failing tests."
+   withBuildSettingsFromFile:
+   TEST_DATA @"TestProject-Library-TestProject-Library-showBuildSettings.txt"
+   ];
+}
+
+- (void)testShardsDontRecordTestDurations
+{
+  NSString *durationsPath = [MakeTemporaryDirectory(@"testDurations-XXXXXXX")
+                             stringByAppendingPathComponent:@"test-durations.json"];
+  NSArray *arguments = @[
+                         @"-project", TEST_DATA @"TestProject-Library/TestProject-Library.xcodeproj",
+                         @"-scheme", @"TestProject-Library",
+                         @"-sdk", @"iphonesimulator6.1",
+                         @"run-tests",
+                         @"-testDurations", durationsPath,
+                         ];
+
+  Options *options = [[Options optionsFrom:arguments] assertOptionsValidateWithBuildSettingsFromFile:
+                      TEST_DATA @"TestProject-Library-TestProject-Library-showBuildSettings.txt"];
+  assertThatBool([(RunTestsAction *)options.actions[0] recordsTestDurations], isTrue());
+
+  options = [[Options optionsFrom:[arguments arrayByAddingObjectsFromArray:@[@"-shard", @"1/4"]]]
+             assertOptionsValidateWithBuildSettingsFromFile:
+             TEST_DATA @"TestProject-Library-TestProject-Library-showBuildSettings.txt"];
+  assertThatBool([(RunTestsAction *)options.actions[0] recordsTestDurations], isFalse());
+}
+
+- (void)testShardRequiresIndexBelowCount
+{
+  [[Options optionsFrom:@[
+    @"-project", TEST_DATA @"TestProject-Library/TestProject-Library.xcodeproj",
+    @"-scheme", @"TestProject-Library",
+    @"-sdk", @"iphonesimulator6.1",
+    @"run-tests",
+    @"-shard", @"4/4",
+    ]]
+   assertOptionsFailToValidateWithError:
+   @"run-tests: -shard must be of the form INDEX/COUNT with 0 <= INDEX < COUNT, e.g. -shard 0/4."
+   withBuildSettingsFromFile:
+   TEST_DATA @"TestProject-Library-TestProject-Library-showBuildSettings.txt"
+   ];
+}
+
 - (void)testOnlyListIsCollected
 {
   Options *options = [[Options optionsFrom:@[
@@ -343,6 +494,73 @@ static BOOL areEqualJsonOutputsIgnoringKeys(NSString *output1, NSString *output2
   }];
 }
 
+- (void)testBuildSettingsMissingFromThePrefetchAreFetchedPerTarget
+{
+  if (!ToolchainIsXcode7OrBetter()) {
+    return;
+  }
+
+  NSString *projectPath = TEST_DATA @"TestProject-TVFramework/TestProject-TVFramework.xcodeproj";
+  NSString *scheme = @"TestProject-TVFramework";
+  NSString *testTarget = @"TestProject-TVFrameworkTests";
+  NSMutableArray *prefetchTasks = [NSMutableArray array];
+
+  [[FakeTaskManager sharedManager] runBlockWithFakeTasks:^{
+    [[FakeTaskManager sharedManager] addLaunchHandlerBlocks:@[
+     [LaunchHandlers handlerForShowBuildSettingsWithProject:projectPath
+                                                     scheme:scheme
+                                               settingsPath:TEST_DATA @"TestProject-TVFramework-TestProject-TVFramework-showBuildSettings.txt"],
+     // The test target and its host are fetched together, but the output
+     // only has settings for the host.
+     ^(FakeTask *task){
+       if ([[task launchPath] hasSuffix:@"xcodebuild"] &&
+           [task environment][@"SHOW_ONLY_BUILD_SETTINGS_FOR_TARGETS"] != nil) {
+         @synchronized (prefetchTasks) {
+           [prefetchTasks addObject:task];
+         }
+         [task pretendTaskReturnsStandardOutput:
+          [NSString stringWithContentsOfFile:TEST_DATA @"TestProject-TVFramework-TestProject-TVFramework-showBuildSettings.txt"
+                                    encoding:NSUTF8StringEncoding
+                                       error:nil]];
+       }
+     },
+     [LaunchHandlers handlerForShowBuildSettingsWithProject:projectPath
+                                                     target:testTarget
+                                               settingsPath:TEST_DATA @"TestProject-TVFramework-TestProject-TVFrameworkTests-showBuildSettings.txt"
+                                                       hide:NO],
+     [LaunchHandlers handlerForOtestQueryReturningTestList:@[@"TestProject_TVFrameworkTests/testWillPass"]],
+     [LaunchHandlers handlerForSimctlXctestRunReturningTestEvents:
+       [NSData dataWithContentsOfFile:TEST_DATA @"TestProject-TVFramework-TestProject-TVFrameworkTests-test-results.txt"]
+     ],
+    ]];
+
+    XCTool *tool = [[XCTool alloc] init];
+    tool.arguments = @[
+      @"-project", projectPath,
+      @"-scheme", scheme,
+      @"-configuration", @"Debug",
+      @"-sdk", @"appletvsimulator",
+      @"run-tests",
+      @"-reporter", @"plain",
+    ];
+
+    [TestUtil runWithFakeStreams:tool];
+
+    assertThatInteger([prefetchTasks count], equalToInteger(1));
+    assertThat([prefetchTasks[0] arguments],
+               containsArray(@[@"-target", testTarget, @"-target", @"TestProjectTVFramework"]));
+    assertThat([prefetchTasks[0] environment][@"SHOW_ONLY_BUILD_SETTINGS_FOR_TARGETS"],
+               equalTo([@[testTarget, @"TestProjectTVFramework"] componentsJoinedByString:@"\n"]));
+
+    // The test target's settings weren't in the prefetch, so they're fetched
+    // on their own before its tests run.
+    NSArray *launchedTasks = [[FakeTaskManager sharedManager] launchedTasks];
+    assertThatInteger([launchedTasks count], equalToInteger(2));
+    assertThat([launchedTasks[0] environment][@"SHOW_ONLY_BUILD_SETTINGS_FOR_TARGET"], equalTo(testTarget));
+    assertThat([launchedTasks[1] environment][@"SIMCTL_CHILD_XCTestConfigurationFilePath"], notNilValue());
+  }];
+}
+
 - (void)testRunTestsActionAgainstProjectWithNonExistingTargetInScheme
 {
   [[FakeTaskManager sharedManager] runBlockWithFakeTasks:^{
@@ -1029,6 +1247,144 @@ static BOOL areEqualJsonOutputsIgnoringKeys(NSString *output1, NSString *output2
   assertThat(BucketizeTestCasesByTestClass(@[], 3), equalTo(@[@[]]));
 }
 
+- (void)testShardsPartitionTestCasesByClass
+{
+  NSMutableArray *testCases = [NSMutableArray array];
+  for (int i = 0; i < 20; i++) {
+    [testCases addObject:[NSString stringWithFormat:@"Cls%d/test1", i]];
+    [testCases addObject:[NSString stringWithFormat:@"Cls%d/test2", i]];
+  }
+
+  NSMutableArray *allShardedTestCases = [NSMutableArray array];
+  NSMutableSet *seenClasses = [NSMutableSet set];
+  for (NSUInteger shard = 0; shard < 3; shard++) {
+    NSArray *shardTestCases = ShardTestCases(testCases, shard, 3, nil, @"Target");
+    // Every host must compute the same partition.
+    assertThat(ShardTestCases(testCases, shard, 3, nil, @"Target"), equalTo(shardTestCases));
+
+    NSMutableSet *classes = [NSMutableSet set];
+    for (NSString *testCase in shardTestCases) {
+      [classes addObject:[testCase componentsSeparatedByString:@"/"][0]];
+    }
+    // Classes aren't split across shards.
+    XCTAssertFalse([classes intersectsSet:seenClasses]);
+    [seenClasses unionSet:classes];
+    [allShardedTestCases addObjectsFromArray:shardTestCases];
+  }
+
+  assertThat([allShardedTestCases sortedArrayUsingSelector:@selector(compare:)],
+             equalTo([testCases sortedArrayUsingSelector:@selector(compare:)]));
+}
+
+- (void)testShardsBalanceTestCasesByDuration
+{
+  NSArray *testCases = @[
+                         @"Cls1/test1",
+                         @"Cls2/test1",
+                         @"Cls3/test1",
+                         @"Cls4/test1",
+                         @"Cls5/test1",
+                         ];
+  NSDictionary *durations = @{
+                              @"Cls1/test1": @10,
+                              @"Cls2/test1": @6,
+                              @"Cls3/test1": @4,
+                              @"Cls4/test1": @3,
+                              @"Cls5/test1": @3,
+                              };
+  // Longest first onto the least loaded shard: {Cls1} and {Cls2, Cls3} get
+  // 10s each, and Cls4 and Cls5 then go one to each.
+  NSArray *shard0 = ShardTestCases(testCases, 0, 2, durations, @"Target");
+  NSArray *shard1 = ShardTestCases(testCases, 1, 2, durations, @"Target");
+  NSArray *withCls1 = [shard0 containsObject:@"Cls1/test1"] ? shard0 : shard1;
+  NSArray *withoutCls1 = (withCls1 == shard0) ? shard1 : shard0;
+  assertThat(withCls1, equalTo(@[@"Cls1/test1", @"Cls4/test1"]));
+  assertThat(withoutCls1, equalTo(@[@"Cls2/test1", @"Cls3/test1", @"Cls5/test1"]));
+}
+
+- (void)testCanBucketizeTestCasesByDuration
+{
+  NSArray *testCases = @[
+                         @"Cls1/test1",
+                         @"Cls1/test2",
+                         @"Cls2/test1",
+                         @"Cls2/test2",
+                         @"Cls3/test1",
+                         @"Cls3/test2",
+                         @"Cls4/test1",
+                         ];
+  NSDictionary *durations = @{
+                              @"Cls1/test1": @10,
+                              @"Cls1/test2": @1,
+                              @"Cls2/test1": @4,
+                              @"Cls2/test2": @3,
+                              @"Cls3/test1": @2,
+                              @"Cls3/test2": @2,
+                              };
+  // 6 tests with known durations and a bucket size of 3 yield 2 buckets,
+  // packed longest-first.  The unknown test gets its own count-based bucket.
+  assertThat(BucketizeTestCasesByDuration(testCases, 3, durations, NO),
+             equalTo(@[
+                       @[
+                         @"Cls1/test1",
+                         @"Cls1/test2",
+                         ],
+                       @[
+                         @"Cls2/test1",
+                         @"Cls2/test2",
+                         @"Cls3/test1",
+                         @"Cls3/test2",
+                         ],
+                       @[
+                         @"Cls4/test1",
+                         ],
+                       ]));
+
+  // With no known durations we fall back to count-based bucketing.
+  assertThat(BucketizeTestCasesByDuration(testCases, 3, @{}, NO),
+             equalTo(BucketizeTestCasesByTestCase(testCases, 3)));
+  // If there are no tests, we should get an empty bucket.
+  assertThat(BucketizeTestCasesByDuration(@[], 3, durations, NO), equalTo(@[@[]]));
+}
+
+- (void)testCanBucketizeTestCasesByClassDuration
+{
+  NSArray *testCases = @[
+                         @"Cls1/test1",
+                         @"Cls1/test2",
+                         @"Cls2/test1",
+                         @"Cls2/test2",
+                         @"Cls3/test1",
+                         @"Cls4/test1",
+                         @"Cls5/test1",
+                         ];
+  // Cls2/test2 is new, so it is assumed to take the average known duration
+  // (3s), making Cls2 the second heaviest class.
+  NSDictionary *durations = @{
+                              @"Cls1/test1": @1,
+                              @"Cls1/test2": @1,
+                              @"Cls2/test1": @3,
+                              @"Cls3/test1": @8,
+                              @"Cls4/test1": @2,
+                              };
+  assertThat(BucketizeTestCasesByDuration(testCases, 2, durations, YES),
+             equalTo(@[
+                       @[
+                         @"Cls3/test1",
+                         @"Cls4/test1",
+                         ],
+                       @[
+                         @"Cls1/test1",
+                         @"Cls1/test2",
+                         @"Cls2/test1",
+                         @"Cls2/test2",
+                         ],
+                       @[
+                         @"Cls5/test1",
+                         ],
+                       ]));
+}
+
 - (void)testTestRunningWithNoTestsPresentInOptions
 {
   [[FakeTaskManager sharedManager] runBlockWithFakeTasks:^{
@@ -1333,6 +1689,227 @@ static BOOL areEqualJsonOutputsIgnoringKeys(NSString *output1, NSString *output2
   }];
 }
 
+- (void)testTestablesFinishingOutOfOrderAreReportedOneAfterTheOther
+{
+  NSString *slowBundle = TEST_DATA @"tests-ios-test-bundle/TestProject-LibraryTests.octest";
+  NSString *fastBundle = TEST_DATA @"tests-ios-test-bundle/TestProject-Library-XCTest-iOSTests.xctest";
+  NSDictionary *testListsByBundleName = @{
+    [slowBundle lastPathComponent]: @[@"SlowTests/testA", @"SlowTests/testB"],
+    [fastBundle lastPathComponent]: @[@"FastTests/testA", @"FastTests/testB"],
+  };
+  NSMutableArray *log = [NSMutableArray array];
+  RecordingActionScripts *actionScripts = [[RecordingActionScripts alloc] init];
+  actionScripts.log = log;
+
+  [[FakeTaskManager sharedManager] runBlockWithFakeTasks:^{
+    [[FakeTaskManager sharedManager] addLaunchHandlerBlocks:@[
+      ^(FakeTask *task) {
+        // iOS tests get queried through 'simctl', which prefixes the
+        // environment it passes on.
+        NSString *outputPath = (task.environment[@"SIMCTL_CHILD_OTEST_QUERY_OUTPUT_FILE"] ?:
+                                task.environment[@"OTEST_QUERY_OUTPUT_FILE"]);
+        NSString *bundleName = [(task.environment[@"SIMCTL_CHILD_OtestQueryBundlePath"] ?:
+                                 task.environment[@"OtestQueryBundlePath"]) lastPathComponent];
+        if (outputPath == nil || bundleName == nil) {
+          return;
+        }
+        @synchronized (log) {
+          [log addObject:[@"query " stringByAppendingString:bundleName]];
+        }
+        [task pretendExitStatusOf:0];
+        [[NSJSONSerialization dataWithJSONObject:testListsByBundleName[bundleName] options:0 error:nil]
+         writeToFile:outputPath atomically:YES];
+        [[FakeTaskManager sharedManager] hideTaskFromLaunchedTasks:task];
+      },
+    ]];
+
+    XCTool *tool = [[XCTool alloc] init];
+    tool.arguments = @[@"-sdk", @"iphonesimulator6.1",
+                       @"run-tests",
+                       @"-parallelize",
+                       @"-logicTest", slowBundle,
+                       @"-logicTest", fastBundle,
+                       @"-reporter", @"json-stream",
+                       ];
+
+    // The slow bundle's tests fail and finish well after the fast one's pass.
+    __block NSDictionary *output = nil;
+    [Swizzler whileSwizzlingSelector:@selector(actionScripts)
+                 forInstancesOfClass:[XcodeSubjectInfo class]
+                           withBlock:^(id self, SEL sel) { return actionScripts; }
+                            runBlock:^{
+      [Swizzler whileSwizzlingSelector:@selector(runTests)
+                   forInstancesOfClass:[OCUnitTestRunner class]
+                             withBlock:
+       ^(OCUnitTestRunner *runner, SEL sel) {
+         NSString *bundleName = [[runner.simulatorInfo productBundlePath] lastPathComponent];
+         BOOL slow = [bundleName isEqualToString:[slowBundle lastPathComponent]];
+         if (slow) {
+           [NSThread sleepForTimeInterval:0.5];
+         }
+         for (NSString *testCase in testListsByBundleName[bundleName]) {
+           NSArray *parts = [testCase componentsSeparatedByString:@"/"];
+           PublishEventToReporters(runner.reporters, @{
+             kReporter_Event_Key: kReporter_Events_BeginTest,
+             kReporter_BeginTest_ClassNameKey: parts[0],
+             kReporter_BeginTest_MethodNameKey: parts[1],
+           });
+           PublishEventToReporters(runner.reporters, @{
+             kReporter_Event_Key: kReporter_Events_EndTest,
+             kReporter_EndTest_ClassNameKey: parts[0],
+             kReporter_EndTest_MethodNameKey: parts[1],
+             kReporter_EndTest_SucceededKey: @(!slow),
+           });
+         }
+         return (BOOL)!slow;
+       }
+                              runBlock:^{
+        output = [TestUtil runWithFakeStreams:tool];
+      }];
+    }];
+
+    // Pre-test scripts run before any testable is collected; testables are
+    // collected side by side, in either order.
+    assertThat(log[0], equalTo(@"pre-test"));
+    assertThat([log subarrayWithRange:NSMakeRange(1, [log count] - 1)],
+               containsInAnyOrder([@"query " stringByAppendingString:[slowBundle lastPathComponent]],
+                                  [@"query " stringByAppendingString:[fastBundle lastPathComponent]],
+                                  nil));
+
+    NSMutableArray *events = [NSMutableArray array];
+    for (NSString *line in [output[@"stdout"] componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]]) {
+      if ([line length] > 0) {
+        [events addObject:[NSJSONSerialization JSONObjectWithData:[line dataUsingEncoding:NSUTF8StringEncoding]
+                                                          options:0
+                                                            error:nil]];
+      }
+    }
+
+    // Each testable's events come out together, between its own begin-ocunit
+    // and end-ocunit, with that testable's result.
+    NSMutableArray *reportedBundleNames = [NSMutableArray array];
+    NSString *currentBundleName = nil;
+    NSMutableArray *currentTestCases = nil;
+    for (NSDictionary *event in events) {
+      NSString *eventName = event[kReporter_Event_Key];
+      if ([eventName isEqualToString:kReporter_Events_BeginOCUnit]) {
+        assertThat(currentBundleName, nilValue());
+        currentBundleName = [event[kReporter_BeginOCUnit_TargetNameKey] lastPathComponent];
+        currentTestCases = [NSMutableArray array];
+        [reportedBundleNames addObject:currentBundleName];
+      } else if ([eventName isEqualToString:kReporter_Events_EndTest]) {
+        assertThat(currentBundleName, notNilValue());
+        [currentTestCases addObject:[NSString stringWithFormat:@"%@/%@",
+                                     event[kReporter_EndTest_ClassNameKey],
+                                     event[kReporter_EndTest_MethodNameKey]]];
+      } else if ([eventName isEqualToString:kReporter_Events_EndOCUnit]) {
+        assertThat(currentTestCases, equalTo(testListsByBundleName[currentBundleName]));
+        assertThat(event[kReporter_EndOCUnit_SucceededKey],
+                   equalTo(@(![currentBundleName isEqualToString:[slowBundle lastPathComponent]])));
+        currentBundleName = nil;
+      }
+    }
+    assertThat(currentBundleName, nilValue());
+    // The fast testable didn't have to wait for the slow one to be reported.
+    assertThat(reportedBundleNames, equalTo(@[[fastBundle lastPathComponent], [slowBundle lastPathComponent]]));
+    assertThatInteger(tool.exitStatus, equalToInteger(1));
+  }];
+}
+
+- (void)testLogicTestBundlesAreQueriedTogetherBeforeTheyRun
+{
+  NSString *firstBundle = TEST_DATA @"tests-ios-test-bundle/TestProject-LibraryTests.octest";
+  NSString *secondBundle = TEST_DATA @"tests-ios-test-bundle/TestProject-Library-XCTest-iOSTests.xctest";
+  NSDictionary *testListsByBundleName = @{
+    [firstBundle lastPathComponent]: @[@"FirstTests/testA", @"FirstTests/testB"],
+    [secondBundle lastPathComponent]: @[@"SecondTests/testA"],
+  };
+  NSMutableArray *queries = [NSMutableArray array];
+
+  [[FakeTaskManager sharedManager] runBlockWithFakeTasks:^{
+    [[FakeTaskManager sharedManager] addLaunchHandlerBlocks:@[
+      ^(FakeTask *task) {
+        NSString *outputPath = task.environment[@"SIMCTL_CHILD_OTEST_QUERY_OUTPUT_FILE"];
+        if (outputPath == nil) {
+          return;
+        }
+        // A bundle queried on its own gets a plain list; a batch gets each
+        // bundle's list under its path.
+        NSString *bundlePath = task.environment[@"SIMCTL_CHILD_OtestQueryBundlePath"];
+        NSArray *bundlePaths = [task.environment[@"SIMCTL_CHILD_OtestQueryBundlePaths"] componentsSeparatedByString:@":"];
+        id output = nil;
+        if (bundlePaths) {
+          NSMutableDictionary *testListsByBundlePath = [NSMutableDictionary dictionary];
+          for (NSString *path in bundlePaths) {
+            testListsByBundlePath[path] = @{@"tests" : testListsByBundleName[[path lastPathComponent]]};
+          }
+          output = testListsByBundlePath;
+        } else if (bundlePath) {
+          bundlePaths = @[bundlePath];
+          output = testListsByBundleName[[bundlePath lastPathComponent]];
+        } else {
+          return;
+        }
+        @synchronized (queries) {
+          [queries addObject:[bundlePaths valueForKey:@"lastPathComponent"]];
+        }
+        [task pretendExitStatusOf:0];
+        [[NSJSONSerialization dataWithJSONObject:output options:0 error:nil]
+         writeToFile:outputPath atomically:YES];
+        [[FakeTaskManager sharedManager] hideTaskFromLaunchedTasks:task];
+      },
+    ]];
+
+    XCTool *tool = [[XCTool alloc] init];
+    tool.arguments = @[@"-sdk", @"iphonesimulator6.1",
+                       @"run-tests",
+                       @"-parallelize",
+                       @"-logicTest", firstBundle,
+                       @"-logicTest", secondBundle,
+                       @"-reporter", @"json-stream",
+                       ];
+
+    NSMutableDictionary *testCasesByBundleName = [NSMutableDictionary dictionary];
+    __block NSDictionary *output = nil;
+    [Swizzler whileSwizzlingSelector:@selector(runTests)
+                 forInstancesOfClass:[OCUnitTestRunner class]
+                           withBlock:
+     ^(OCUnitTestRunner *runner, SEL sel) {
+       @synchronized (testCasesByBundleName) {
+         testCasesByBundleName[[[runner.simulatorInfo productBundlePath] lastPathComponent]] =
+           [runner valueForKey:@"allTestCases"];
+       }
+       return YES;
+     }
+                            runBlock:^{
+      output = [TestUtil runWithFakeStreams:tool];
+    }];
+
+    // Both bundles were listed by one otest-query, and neither on its own.
+    assertThat(queries, equalTo(@[@[[firstBundle lastPathComponent], [secondBundle lastPathComponent]]]));
+
+    // Each testable was scheduled once queried, with its own bundle's tests.
+    assertThat(testCasesByBundleName, equalTo(testListsByBundleName));
+
+    NSMutableArray *reportedBundleNames = [NSMutableArray array];
+    for (NSString *line in [output[@"stdout"] componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]]) {
+      if ([line length] == 0) {
+        continue;
+      }
+      NSDictionary *event = [NSJSONSerialization JSONObjectWithData:[line dataUsingEncoding:NSUTF8StringEncoding]
+                                                            options:0
+                                                              error:nil];
+      if ([event[kReporter_Event_Key] isEqualToString:kReporter_Events_BeginOCUnit]) {
+        [reportedBundleNames addObject:[event[kReporter_BeginOCUnit_TargetNameKey] lastPathComponent]];
+      }
+    }
+    assertThat(reportedBundleNames, containsInAnyOrder([firstBundle lastPathComponent],
+                                                       [secondBundle lastPathComponent],
+                                                       nil));
+    assertThatInteger(tool.exitStatus, equalToInteger(0));
+  }];
+}
+
 - (void)testPassingLogicTestViaCommandLine
 {
   [[FakeTaskManager sharedManager] runBlockWithFakeTasks:^{
@@ -0,0 +1,135 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "FakeSimDevice.h"
+#import "SimDevice.h"
+#import "SimulatorPool.h"
+
+static FakeSimDevice *MakeFakeDevice(NSString *UDIDString)
+{
+  FakeSimDevice *device = [FakeSimDevice new];
+  device.fakeAvailable = YES;
+  device.fakeUDID = [[NSUUID alloc] initWithUUIDString:UDIDString];
+  device.fakeState = SimDeviceStateShutdown;
+  return device;
+}
+
+@interface SimulatorPoolTests : XCTestCase
+{
+  FakeSimDevice *_device1;
+  FakeSimDevice *_device2;
+}
+@end
+
+@implementation SimulatorPoolTests
+
+- (void)setUp
+{
+  [super setUp];
+  _device1 = MakeFakeDevice(@"E621E1F8-C36C-495A-93FC-0C247A3E6E5F");
+  _device2 = MakeFakeDevice(@"1F0C2D6B-8D1E-4E0A-9C3A-5B8F1C2D3E4F");
+}
+
+- (void)testLeasesEachDeviceOnlyOnce
+{
+  SimulatorPool *pool = [[SimulatorPool alloc] initWithDevices:@[_device1, _device2]];
+
+  SimDevice *lease1 = [pool leaseDevice];
+  SimDevice *lease2 = [pool leaseDevice];
+  assertThat(lease1, sameInstance(_device1));
+  assertThat(lease2, sameInstance(_device2));
+}
+
+- (void)testMostRecentlyReturnedDeviceIsLeasedFirst
+{
+  SimulatorPool *pool = [[SimulatorPool alloc] initWithDevices:@[_device1, _device2]];
+
+  SimDevice *lease1 = [pool leaseDevice];
+  SimDevice *lease2 = [pool leaseDevice];
+  [pool returnDevice:lease2];
+  [pool returnDevice:lease1];
+
+  assertThat([pool leaseDevice], sameInstance(_device1));
+  assertThat([pool leaseDevice], sameInstance(_device2));
+}
+
+- (void)testLeaseBlocksUntilDeviceIsReturned
+{
+  SimulatorPool *pool = [[SimulatorPool alloc] initWithDevices:@[_device1]];
+  SimDevice *lease = [pool leaseDevice];
+
+  __block SimDevice *secondLease = nil;
+  dispatch_semaphore_t leased = dispatch_semaphore_create(0);
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    secondLease = [pool leaseDevice];
+    dispatch_semaphore_signal(leased);
+  });
+
+  long timedOut = dispatch_semaphore_wait(leased, dispatch_time(DISPATCH_TIME_NOW, 200 * NSEC_PER_MSEC));
+  assertThatLong(timedOut, isNot(equalToLong(0)));
+  assertThat(secondLease, nilValue());
+
+  [pool returnDevice:lease];
+  timedOut = dispatch_semaphore_wait(leased, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC));
+  assertThatLong(timedOut, equalToLong(0));
+  assertThat(secondLease, sameInstance(_device1));
+  dispatch_release(leased);
+}
+
+- (void)testConcurrentBucketsNeverShareADevice
+{
+  SimulatorPool *pool = [[SimulatorPool alloc] initWithDevices:@[_device1, _device2]];
+  NSMutableSet *devicesInUse = [NSMutableSet set];
+  __block NSUInteger maxDevicesInUse = 0;
+  __block BOOL deviceWasShared = NO;
+
+  dispatch_apply(32, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+    SimDevice *device = [pool leaseDevice];
+    @synchronized (devicesInUse) {
+      deviceWasShared |= [devicesInUse containsObject:device.UDID];
+      [devicesInUse addObject:device.UDID];
+      maxDevicesInUse = MAX(maxDevicesInUse, devicesInUse.count);
+    }
+    [NSThread sleepForTimeInterval:0.001];
+    @synchronized (devicesInUse) {
+      [devicesInUse removeObject:device.UDID];
+    }
+    [pool returnDevice:device];
+  });
+
+  assertThatBool(deviceWasShared, isFalse());
+  assertThatUnsignedInteger(maxDevicesInUse, lessThanOrEqualTo(@2));
+}
+
+- (void)testTracksInstalledTestHostsPerDevice
+{
+  SimulatorPool *pool = [[SimulatorPool alloc] initWithDevices:@[_device1, _device2]];
+
+  assertThatBool([pool isTestHostBundleID:@"com.example.host" fromBundlePath:@"/tmp/Host.app" installedOnDevice:_device1], isFalse());
+
+  [pool setTestHostBundleID:@"com.example.host" fromBundlePath:@"/tmp/Host.app" installedOnDevice:_device1];
+  assertThatBool([pool isTestHostBundleID:@"com.example.host" fromBundlePath:@"/tmp/Host.app" installedOnDevice:_device1], isTrue());
+  assertThatBool([pool isTestHostBundleID:@"com.example.host" fromBundlePath:@"/tmp/Host.app" installedOnDevice:_device2], isFalse());
+  // A different build of the same app has to be installed again.
+  assertThatBool([pool isTestHostBundleID:@"com.example.host" fromBundlePath:@"/tmp/Other/Host.app" installedOnDevice:_device1], isFalse());
+
+  [pool forgetInstalledTestHostsOnDevice:_device1];
+  assertThatBool([pool isTestHostBundleID:@"com.example.host" fromBundlePath:@"/tmp/Host.app" installedOnDevice:_device1], isFalse());
+}
+
+@end
@@ -0,0 +1,148 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import <mach/machine.h>
+
+#import "MachOTestEnumerator.h"
+#import "StaticTestQuery.h"
+#import "TaskUtil.h"
+#import "TestUtil.h"
+#import "XCToolUtil.h"
+
+@interface StaticTestQueryTests : XCTestCase
+@end
+
+@implementation StaticTestQueryTests
+
+- (void)testListsOSXXCTestBundle
+{
+  NSString *reason = nil;
+  NSArray *testNames = StaticallyQueryTestBundle(TEST_DATA @"tests-osx-test-bundle/TestProject-Library-XCTest-OSXTests.xctest", &reason);
+  assertThat(reason, nilValue());
+  assertThat(testNames, equalTo(@[@"TestProject_Library_XCTest_OSXTests/testOutput",
+                                  @"TestProject_Library_XCTest_OSXTests/testWillFail",
+                                  @"TestProject_Library_XCTest_OSXTests/testWillPass"]));
+}
+
+- (void)testListsOSXAppTestBundle
+{
+  NSArray *testNames = StaticallyQueryTestBundle(TEST_DATA @"TestProject-App-OSX/Build/Products/Debug/TestProject-App-OSXTests.xctest", NULL);
+  assertThat(testNames, equalTo(@[@"TestProject_App_OSXTests/testCanUseSymbolsFromTestHost",
+                                  @"TestProject_App_OSXTests/testOutput",
+                                  @"TestProject_App_OSXTests/testStandardDirectories",
+                                  @"TestProject_App_OSXTests/testWillFail",
+                                  @"TestProject_App_OSXTests/testWillPass"]));
+}
+
+- (void)testListsFatIOSXCTestBundle
+{
+  // i386 + x86_64; both slices have the same tests.
+  NSArray *testNames = StaticallyQueryTestBundle(TEST_DATA @"tests-ios-test-bundle/TestProject-Library-XCTest-iOSTests.xctest", NULL);
+  assertThat(testNames, equalTo(@[@"OtherTests/testSomething",
+                                  @"SetupTimeoutTests/testNothing",
+                                  @"SomeTests/testAborts",
+                                  @"SomeTests/testBacktraceOutputIsCaptured",
+                                  @"SomeTests/testCrash",
+                                  @"SomeTests/testExits",
+                                  @"SomeTests/testHandlingOfUnicodeStrings",
+                                  @"SomeTests/testOutputMerging",
+                                  @"SomeTests/testPrintSDK",
+                                  @"SomeTests/testStream",
+                                  @"SomeTests/testTimeout",
+                                  @"SomeTests/testWillFail",
+                                  @"SomeTests/testWillPass",
+                                  @"TeardownTimeoutTests/testNothing",
+                                  @"TimeoutTests/testTimeout"]));
+}
+
+- (void)testListsI386SenTestingKitBundle
+{
+  NSArray *testNames = StaticallyQueryTestBundle(TEST_DATA @"tests-ios-test-bundle/TestProject-LibraryTests.octest", NULL);
+  assertThat(testNames, equalTo(@[@"OtherTests/testSomething",
+                                  @"SomeTests/testBacktraceOutputIsCaptured",
+                                  @"SomeTests/testOutputMerging",
+                                  @"SomeTests/testPrintSDK",
+                                  @"SomeTests/testStream",
+                                  @"SomeTests/testTimeout",
+                                  @"SomeTests/testWillFail",
+                                  @"SomeTests/testWillPass"]));
+}
+
+- (void)testBundleOverridingTestInvocationsMustBeLoaded
+{
+  NSString *reason = nil;
+  NSArray *testNames = StaticallyQueryTestBundle(TEST_DATA @"tests-osx-test-bundle/TestProject-Library-XCTest-CustomTests.xctest", &reason);
+  assertThat(testNames, nilValue());
+  assertThat(reason, containsString(@"may generate tests at runtime"));
+}
+
+- (void)testKiwiBundlesMustBeLoaded
+{
+  // Kiwi specs create their test methods at runtime.
+  assertThat(StaticallyQueryTestBundle(TEST_DATA @"KiwiTests/Build/Products/Debug-iphonesimulator/KiwiTests-XCTest.xctest", NULL),
+             nilValue());
+  assertThat(StaticallyQueryTestBundle(TEST_DATA @"KiwiTests/Build/Products/Debug-iphonesimulator/KiwiTests-OCUnit.octest", NULL),
+             nilValue());
+}
+
+- (void)testRejectsTruncatedAndNonMachOData
+{
+  NSString *path = TEST_DATA @"tests-osx-test-bundle/TestProject-Library-XCTest-OSXTests.xctest/Contents/MacOS/TestProject-Library-XCTest-OSXTests";
+  NSData *data = [NSData dataWithContentsOfFile:path];
+
+  // Anything short of the whole file loses the linkedit data at its end.
+  for (NSUInteger length = 0; length < [data length] / 2; length += 97) {
+    MachOTestEnumeratorResult result = MachOEnumerateTestMethods([data bytes], length, CPU_TYPE_X86_64, NULL, NULL);
+    assertThatInt(result, equalToInt(kMachOTestEnumeratorNotMachO));
+  }
+
+  const char *text = "#!/bin/sh\necho not a binary\n";
+  assertThatInt(MachOEnumerateTestMethods(text, strlen(text), CPU_TYPE_X86_64, NULL, NULL),
+                equalToInt(kMachOTestEnumeratorNotMachO));
+}
+
+/**
+ The static listing has to agree with what otest-query finds by loading the
+ bundle.
+ */
+- (void)testStaticQueryMatchesLoadingTheBundle
+{
+  NSString *bundlePath = AbsolutePathFromRelative(TEST_DATA @"tests-osx-test-bundle/TestProject-Library-XCTest-OSXTests.xctest");
+  NSArray *staticTestNames = StaticallyQueryTestBundle(bundlePath, NULL);
+
+  NSString *outputPath = MakeTempFileWithPrefix(@"otest-query-output");
+  NSTask *task = CreateTaskInSameProcessGroup();
+  [task setLaunchPath:[XCToolLibExecPath() stringByAppendingPathComponent:@"otest-query-osx"]];
+  [task setArguments:@[bundlePath]];
+  [task setEnvironment:@{
+    @"DYLD_FALLBACK_FRAMEWORK_PATH" : OSXTestFrameworkDirectories(),
+    @"NSArgumentDomain" : @"otest-query-osx",
+    @"__CFPREFERENCES_AVOID_DAEMON" : @"YES",
+    @"OTEST_QUERY_OUTPUT_FILE" : outputPath,
+    @"OTEST_QUERY_SKIP_STATIC_ENUMERATION" : @"YES",
+  }];
+  LaunchTaskAndCaptureOutput(task, @"running otest-query");
+
+  NSArray *loadedTestNames = [NSJSONSerialization JSONObjectWithData:[NSData dataWithContentsOfFile:outputPath]
+                                                             options:0
+                                                               error:nil];
+  assertThat(staticTestNames, notNilValue());
+  assertThat(staticTestNames, equalTo(loadedTestNames));
+}
+
+@end
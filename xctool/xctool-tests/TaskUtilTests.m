@@ -15,9 +15,42 @@
 //
 
 #import "TaskUtil.h"
+#import "EventFraming.h"
 #import "FakeTask.h"
+#import "ReporterEvents.h"
 #import <XCTest/XCTest.h>
 
+/**
+ * Writes each of `chunks` to a pipe as a separate write, pausing in between so
+ * the reader sees them separately, and returns what was read from the pipe.
+ * If `isEventFd`, the pipe may carry a binary event stream.
+ */
+static NSArray *OutputsReadFromPipeWrittenInChunks(NSArray<NSData *> *chunks, BOOL isEventFd)
+{
+  int fds[2];
+  pipe(fds);
+  int writeFd = fds[1];
+
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    for (NSData *chunk in chunks) {
+      write(writeFd, chunk.bytes, chunk.length);
+      [NSThread sleepForTimeInterval:0.05];
+    }
+    close(writeFd);
+  });
+
+  NSMutableArray *outputs = [NSMutableArray array];
+  ReadOutputsAndEventsAndFeedToBlockOnQueue(fds, 1, isEventFd ? fds[0] : -1, ^(int fd, id output) {
+    [outputs addObject:output];
+  }, NULL, NULL, YES);
+  return outputs;
+}
+
+static NSArray *LinesReadFromPipeWrittenInChunks(NSArray<NSData *> *chunks)
+{
+  return OutputsReadFromPipeWrittenInChunks(chunks, NO);
+}
+
 @interface TaskUtilTests : XCTestCase
 @end
 
@@ -80,6 +113,146 @@
   }
 }
 
+- (void)testLinesAndCharactersSplitAcrossReadsArePutBackTogether
+{
+  // U+10196 ROMAN DENARIUS SIGN is F0 90 86 96 in UTF-8; split it in two.
+  const char part1[] = "ab";
+  const char part2[] = "c\n\xF0\x90";
+  const char part3[] = "\x86\x96d\nlast";
+  NSArray *lines = LinesReadFromPipeWrittenInChunks(@[
+    [NSData dataWithBytes:part1 length:strlen(part1)],
+    [NSData dataWithBytes:part2 length:strlen(part2)],
+    [NSData dataWithBytes:part3 length:strlen(part3)],
+  ]);
+  XCTAssertEqualObjects(lines, (@[@"abc", @"\U00010196d", @"last"]));
+}
+
+- (void)testTrailingNewlineYieldsEmptyLastLine
+{
+  NSArray *lines = LinesReadFromPipeWrittenInChunks(@[[@"one\ntwo\n" dataUsingEncoding:NSUTF8StringEncoding]]);
+  XCTAssertEqualObjects(lines, (@[@"one", @"two", @""]));
+}
+
+- (void)testBinaryEventFramesSplitAcrossReadsAreDecoded
+{
+  NSMutableData *stream = [NSMutableData dataWithBytes:kBinaryEventStreamMagic
+                                                length:kBinaryEventStreamMagicLength];
+  [stream appendData:BinaryEventFrameWithObject(@{@"event": @"begin-test", @"test": @"-[A b]"})];
+  [stream appendData:BinaryEventFrameWithObject(@"__marker__")];
+  const char emptyFrame[kBinaryEventFrameHeaderLength] = {0};
+  [stream appendBytes:emptyFrame length:sizeof(emptyFrame)];
+
+  // Cut the magic, a frame header and a payload in two.
+  NSMutableArray *chunks = [NSMutableArray array];
+  NSUInteger offsets[] = {0, 3, kBinaryEventStreamMagicLength + 2, kBinaryEventStreamMagicLength + 9, stream.length};
+  for (int i = 0; i < 4; i++) {
+    [chunks addObject:[stream subdataWithRange:NSMakeRange(offsets[i], offsets[i + 1] - offsets[i])]];
+  }
+
+  NSArray *outputs = OutputsReadFromPipeWrittenInChunks(chunks, YES);
+  XCTAssertEqualObjects(outputs, (@[@{@"event": @"begin-test", @"test": @"-[A b]"}, @"__marker__"]));
+}
+
+- (void)testMalformedBinaryEventFrameIsReportedAsAnErrorStatus
+{
+  NSMutableData *stream = [NSMutableData dataWithBytes:kBinaryEventStreamMagic
+                                                length:kBinaryEventStreamMagicLength];
+  // A one-byte payload with a type tag the decoder doesn't know.
+  const char malformedFrame[] = {1, 0, 0, 0, 'Z'};
+  [stream appendBytes:malformedFrame length:sizeof(malformedFrame)];
+  [stream appendData:BinaryEventFrameWithObject(@"__marker__")];
+
+  NSArray *outputs = OutputsReadFromPipeWrittenInChunks(@[stream], YES);
+  XCTAssertEqual(outputs.count, 3);
+  XCTAssertEqualObjects(outputs[0][kReporter_Event_Key], kReporter_Events_BeginStatus);
+  XCTAssertEqualObjects(outputs[0][kReporter_BeginStatus_LevelKey], @"Error");
+  XCTAssertTrue([outputs[0][kReporter_BeginStatus_MessageKey] containsString:@"malformed event of 1 bytes"]);
+  XCTAssertEqualObjects(outputs[1][kReporter_Event_Key], kReporter_Events_EndStatus);
+  XCTAssertEqualObjects(outputs[1][kReporter_EndStatus_LevelKey], @"Error");
+  // The stream carries on after the bad frame.
+  XCTAssertEqualObjects(outputs[2], @"__marker__");
+}
+
+- (void)testEventFdWithoutMagicIsReadAsLines
+{
+  NSArray *outputs = OutputsReadFromPipeWrittenInChunks(
+    @[[@"{\"event\":\"begin-test\"}\n" dataUsingEncoding:NSUTF8StringEncoding]], YES);
+  XCTAssertEqualObjects(outputs, (@[@"{\"event\":\"begin-test\"}", @""]));
+}
+
+/**
+ * Pushes lines of mixed lengths, including some multi-megabyte ones, through
+ * a pipe and checks every byte comes out.  Defaults to 20 MB so it's quick
+ * enough to run with the other tests; set XCTOOL_LINE_SPLITTER_BENCHMARK_MB
+ * to e.g. 1024 to push 1 GB and have the throughput reported.
+ */
+- (void)testLinesOfMixedLengthsComeThroughIntact
+{
+  unsigned long long totalMegabytes = 20;
+  NSString *megabytesFromEnv = [[NSProcessInfo processInfo] environment][@"XCTOOL_LINE_SPLITTER_BENCHMARK_MB"];
+  BOOL benchmarking = [megabytesFromEnv longLongValue] > 0;
+  if (benchmarking) {
+    totalMegabytes = (unsigned long long)[megabytesFromEnv longLongValue];
+  }
+  const unsigned long long totalBytes = totalMegabytes * 1024 * 1024;
+
+  // 0 B, 80 B, 4 KB and 8 MB lines, in a repeating pattern.
+  const size_t lineLengths[] = {0, 80, 80, 80, 4096, 80, 8 * 1024 * 1024, 80};
+  const size_t lineLengthCount = sizeof(lineLengths) / sizeof(lineLengths[0]);
+
+  __block unsigned long long expectedBytes = 0;
+  __block unsigned long long expectedLines = 0;
+  {
+    unsigned long long written = 0;
+    for (size_t i = 0; written < totalBytes; i++) {
+      size_t length = lineLengths[i % lineLengthCount];
+      written += length + 1;
+      expectedBytes += length;
+      expectedLines++;
+    }
+  }
+
+  int fds[2];
+  XCTAssertEqual(pipe(fds), 0, @"pipe failed: %s", strerror(errno));
+  int writeFd = fds[1];
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    const size_t maxLength = 8 * 1024 * 1024 + 1;
+    char *line = malloc(maxLength);
+    memset(line, 'x', maxLength);
+    for (unsigned long long i = 0; i < expectedLines; i++) {
+      size_t length = lineLengths[i % lineLengthCount];
+      line[length] = '\n';
+      for (size_t offset = 0; offset < length + 1;) {
+        ssize_t result = write(writeFd, line + offset, MIN(length + 1 - offset, (size_t)64 * 1024));
+        NSCAssert(result > 0, @"write failed: %s", strerror(errno));
+        offset += (size_t)result;
+      }
+      line[length] = 'x';
+    }
+    free(line);
+    close(writeFd);
+  });
+
+  __block unsigned long long readBytes = 0;
+  __block unsigned long long readLines = 0;
+  CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+  ReadOutputsAndFeedOuputLinesToBlockOnQueue(fds, 1, ^(int fd, NSString *line) {
+    readBytes += line.length;
+    readLines++;
+  }, NULL, NULL, YES);
+  CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+
+  if (benchmarking) {
+    NSLog(@"Split %llu lines (%llu MB) in %.2fs: %.1f MB/s",
+          readLines, expectedBytes / (1024 * 1024), elapsed,
+          expectedBytes / (1024.0 * 1024.0) / elapsed);
+  }
+
+  // The stream ends in a newline, so there's one extra, empty line.
+  XCTAssertEqual(readLines, expectedLines + 1);
+  XCTAssertEqual(readBytes, expectedBytes);
+}
+
 - (void)testConversionToUT8OfBrokenUTF8SequenceOfBytes
 {
   NSData *data = [NSData dataWithContentsOfFile:TEST_DATA @"BrokenUTF8EncodingInFile.txt"];
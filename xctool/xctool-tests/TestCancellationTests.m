@@ -0,0 +1,111 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "ReporterEvents.h"
+#import "TestCancellation.h"
+
+static NSData *EndTestEvent(BOOL succeeded)
+{
+  NSDictionary *event = @{
+    kReporter_Event_Key: kReporter_Events_EndTest,
+    kReporter_EndTest_TestKey: @"-[OtherTests testSomething]",
+    kReporter_EndTest_SucceededKey: @(succeeded),
+  };
+  return [NSJSONSerialization dataWithJSONObject:event options:0 error:nil];
+}
+
+@interface TestCancellationTests : XCTestCase
+@end
+
+@implementation TestCancellationTests
+
+- (void)testCancelsOnceMaxFailuresIsReached
+{
+  TestCancellation *cancellation = [[TestCancellation alloc] initWithMaxFailures:2];
+
+  [cancellation publishDataForEvent:EndTestEvent(NO)];
+  assertThatBool([cancellation isCancelled], isFalse());
+
+  [cancellation publishDataForEvent:EndTestEvent(NO)];
+  assertThatBool([cancellation isCancelled], isTrue());
+  assertThat([cancellation reason], equalTo(@"the run was cancelled after 2 failing tests (-failFast)."));
+}
+
+- (void)testPassingTestsAndOtherEventsAreNotCounted
+{
+  TestCancellation *cancellation = [[TestCancellation alloc] initWithMaxFailures:1];
+
+  [cancellation publishDataForEvent:EndTestEvent(YES)];
+  [cancellation publishDataForEvent:
+   [NSJSONSerialization dataWithJSONObject:@{kReporter_Event_Key: kReporter_Events_BeginTest}
+                                   options:0
+                                     error:nil]];
+  assertThatBool([cancellation isCancelled], isFalse());
+}
+
+- (void)testCancellingTerminatesRegisteredTasks
+{
+  TestCancellation *cancellation = [[TestCancellation alloc] initWithMaxFailures:1];
+
+  NSTask *task = [[NSTask alloc] init];
+  [task setLaunchPath:@"/bin/sleep"];
+  [task setArguments:@[@"60"]];
+  [task launch];
+  [cancellation addTask:task];
+
+  [cancellation cancelWithReason:@"cupcakes"];
+  [task waitUntilExit];
+
+  assertThatInteger([task terminationReason], equalToInteger(NSTaskTerminationReasonUncaughtSignal));
+  assertThat([cancellation reason], equalTo(@"cupcakes"));
+}
+
+- (void)testTaskCancelledBeforeItLaunchesIsTerminatedOnceItDoes
+{
+  TestCancellation *cancellation = [[TestCancellation alloc] initWithMaxFailures:1];
+
+  NSTask *task = [[NSTask alloc] init];
+  [task setLaunchPath:@"/bin/sleep"];
+  [task setArguments:@[@"60"]];
+  [cancellation addTask:task];
+
+  [cancellation cancelWithReason:@"cupcakes"];
+  [task launch];
+  [task waitUntilExit];
+  [cancellation removeTask:task];
+
+  assertThatInteger([task terminationReason], equalToInteger(NSTaskTerminationReasonUncaughtSignal));
+}
+
+- (void)testTaskAddedAfterCancellingIsTerminatedOnceItLaunches
+{
+  TestCancellation *cancellation = [[TestCancellation alloc] initWithMaxFailures:1];
+  [cancellation cancelWithReason:@"cupcakes"];
+
+  NSTask *task = [[NSTask alloc] init];
+  [task setLaunchPath:@"/bin/sleep"];
+  [task setArguments:@[@"60"]];
+  [cancellation addTask:task];
+  [task launch];
+  [task waitUntilExit];
+  [cancellation removeTask:task];
+
+  assertThatInteger([task terminationReason], equalToInteger(NSTaskTerminationReasonUncaughtSignal));
+}
+
+@end
@@ -0,0 +1,114 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "BucketEventStream.h"
+#import "EventGenerator.h"
+#import "ReporterEvents.h"
+#import "TestDurationStore.h"
+#import "XCToolUtil.h"
+
+@interface TestDurationStoreTests : XCTestCase
+@end
+
+@implementation TestDurationStoreTests
+
+- (void)testMissingFileYieldsEmptyStore
+{
+  NSString *path = [MakeTemporaryDirectory(@"durations-XXXXXXX") stringByAppendingPathComponent:@"durations.json"];
+  NSString *errorMessage = nil;
+  TestDurationStore *store = [TestDurationStore storeWithContentsOfFile:path errorMessage:&errorMessage];
+  assertThat(store, notNilValue());
+  assertThat([store durationsForTarget:@"SomeTarget"], equalTo(@{}));
+}
+
+- (void)testMalformedFileIsAnError
+{
+  NSString *path = MakeTempFileWithPrefix(@"durations");
+  [@"[1, 2, 3]" writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil];
+  NSString *errorMessage = nil;
+  TestDurationStore *store = [TestDurationStore storeWithContentsOfFile:path errorMessage:&errorMessage];
+  assertThat(store, nilValue());
+  assertThat(errorMessage, containsString(@"is not a JSON dictionary"));
+}
+
+- (void)testRecordsDurationsFromEndTestEventsAndRoundTrips
+{
+  NSString *path = [MakeTemporaryDirectory(@"durations-XXXXXXX") stringByAppendingPathComponent:@"durations.json"];
+  NSString *errorMessage = nil;
+  TestDurationStore *store = [TestDurationStore storeWithContentsOfFile:path errorMessage:&errorMessage];
+
+  PublishEventToReporters(@[store], EventDictionaryWithNameAndContent(kReporter_Events_BeginOCUnit, @{
+    kReporter_BeginOCUnit_TargetNameKey: @"SomeTarget",
+  }));
+  PublishEventToReporters(@[store], EventDictionaryWithNameAndContent(kReporter_Events_EndTest, @{
+    kReporter_EndTest_ClassNameKey: @"Cls1",
+    kReporter_EndTest_MethodNameKey: @"test1",
+    kReporter_EndTest_TotalDurationKey: @(1.5),
+  }));
+  PublishEventToReporters(@[store], EventDictionaryWithNameAndContent(kReporter_Events_EndOCUnit, @{
+    kReporter_BeginOCUnit_TargetNameKey: @"SomeTarget",
+  }));
+  // Outside of a begin-ocunit/end-ocunit pair there's no target to record to.
+  PublishEventToReporters(@[store], EventDictionaryWithNameAndContent(kReporter_Events_EndTest, @{
+    kReporter_EndTest_ClassNameKey: @"Cls1",
+    kReporter_EndTest_MethodNameKey: @"test2",
+    kReporter_EndTest_TotalDurationKey: @(2.5),
+  }));
+
+  assertThat([store durationsForTarget:@"SomeTarget"], equalTo(@{@"Cls1/test1": @(1.5)}));
+  assertThatBool([store writeWithErrorMessage:&errorMessage], isTrue());
+
+  TestDurationStore *reloaded = [TestDurationStore storeWithContentsOfFile:path errorMessage:&errorMessage];
+  assertThat([reloaded durationsForTarget:@"SomeTarget"], equalTo(@{@"Cls1/test1": @(1.5)}));
+}
+
+- (void)testInterleavedBucketsAreAttributedToTheirOwnTargets
+{
+  NSString *path = [MakeTemporaryDirectory(@"durations-XXXXXXX") stringByAppendingPathComponent:@"durations.json"];
+  NSString *errorMessage = nil;
+  TestDurationStore *store = [TestDurationStore storeWithContentsOfFile:path errorMessage:&errorMessage];
+  BucketEventStream *bucket1 = [[BucketEventStream alloc] initWithBucket:1 sinks:@[store] lock:self];
+  BucketEventStream *bucket2 = [[BucketEventStream alloc] initWithBucket:2 sinks:@[store] lock:self];
+
+  PublishEventToReporters(@[bucket1], EventDictionaryWithNameAndContent(kReporter_Events_BeginOCUnit, @{
+    kReporter_BeginOCUnit_TargetNameKey: @"Target1",
+  }));
+  PublishEventToReporters(@[bucket2], EventDictionaryWithNameAndContent(kReporter_Events_BeginOCUnit, @{
+    kReporter_BeginOCUnit_TargetNameKey: @"Target2",
+  }));
+  PublishEventToReporters(@[bucket1], EventDictionaryWithNameAndContent(kReporter_Events_EndTest, @{
+    kReporter_EndTest_ClassNameKey: @"Cls1",
+    kReporter_EndTest_MethodNameKey: @"test1",
+    kReporter_EndTest_TotalDurationKey: @(1.5),
+  }));
+  PublishEventToReporters(@[bucket2], EventDictionaryWithNameAndContent(kReporter_Events_EndOCUnit, @{
+    kReporter_BeginOCUnit_TargetNameKey: @"Target2",
+  }));
+  [bucket2 finishWithSuccess:YES];
+  PublishEventToReporters(@[bucket1], EventDictionaryWithNameAndContent(kReporter_Events_EndTest, @{
+    kReporter_EndTest_ClassNameKey: @"Cls1",
+    kReporter_EndTest_MethodNameKey: @"test2",
+    kReporter_EndTest_TotalDurationKey: @(2.5),
+  }));
+  [bucket1 finishWithSuccess:YES];
+
+  assertThat([store durationsForTarget:@"Target1"], equalTo(@{@"Cls1/test1": @(1.5), @"Cls1/test2": @(2.5)}));
+  assertThat([store durationsForTarget:@"Target2"], equalTo(@{}));
+}
+
+@end
@@ -0,0 +1,189 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "FakeTask.h"
+#import "FakeTaskManager.h"
+#import "LaunchHandlers.h"
+#import "OCUnitIOSLogicTestQueryRunner.h"
+#import "OCUnitOSXLogicTestQueryRunner.h"
+#import "SimulatorInfo.h"
+#import "TestListCache.h"
+#import "TestUtil.h"
+#import "XCToolUtil.h"
+#import "XcodeBuildSettings.h"
+
+@interface TestListCacheTests : XCTestCase
+@end
+
+@implementation TestListCacheTests
+
+- (void)tearDown
+{
+  // Caching is off under test unless a test turns it on.
+  [TestListCache setSharedCache:nil];
+  [super tearDown];
+}
+
+/**
+ * Makes a minimal OS X style bundle whose executable contains `contents`.
+ */
+- (NSString *)makeBundleWithExecutableContents:(NSString *)contents
+{
+  NSString *bundlePath = [MakeTemporaryDirectory(@"test-list-cache-XXXXXXX")
+                          stringByAppendingPathComponent:@"SomeTests.xctest"];
+  NSString *macOSPath = [bundlePath stringByAppendingPathComponent:@"Contents/MacOS"];
+  [[NSFileManager defaultManager] createDirectoryAtPath:macOSPath
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+  [@{@"CFBundleExecutable": @"SomeTests"} writeToFile:[bundlePath stringByAppendingPathComponent:@"Contents/Info.plist"]
+                                           atomically:YES];
+  [contents writeToFile:[macOSPath stringByAppendingPathComponent:@"SomeTests"]
+             atomically:YES
+               encoding:NSUTF8StringEncoding
+                  error:nil];
+  return bundlePath;
+}
+
+- (void)testOnlyListsOfTestCasesAreReturned
+{
+  TestListCache *cache = [[TestListCache alloc] initWithDirectory:MakeTemporaryDirectory(@"test-list-cache-XXXXXXX")];
+  [cache setTestCases:@[@"Cls1/test1", @"Cls2/test2"] forKey:@"abc"];
+  assertThat([cache testCasesForKey:@"abc"], equalTo(@[@"Cls1/test1", @"Cls2/test2"]));
+
+  [cache setJSONObject:@{@"Cls1": @"test1"} forKey:@"abc"];
+  assertThat([cache testCasesForKey:@"abc"], nilValue());
+  [cache setJSONObject:@[@"Cls1/test1", @2] forKey:@"abc"];
+  assertThat([cache testCasesForKey:@"abc"], nilValue());
+}
+
+- (void)testKeyIsStableForUnchangedBundle
+{
+  TestListCache *cache = [[TestListCache alloc] initWithDirectory:MakeTemporaryDirectory(@"test-list-cache-XXXXXXX")];
+  NSDictionary *buildSettings = @{Xcode_SDK_NAME: @"macosx10.11"};
+
+  NSString *bundleA = [self makeBundleWithExecutableContents:@"binary"];
+  NSString *bundleB = [self makeBundleWithExecutableContents:@"binary"];
+  NSString *keyA = [cache keyForQueryRunnerClass:[OCUnitOSXLogicTestQueryRunner class]
+                                      bundlePath:bundleA
+                                    testHostPath:nil
+                                   buildSettings:buildSettings];
+  NSString *keyB = [cache keyForQueryRunnerClass:[OCUnitOSXLogicTestQueryRunner class]
+                                      bundlePath:bundleB
+                                    testHostPath:nil
+                                   buildSettings:buildSettings];
+  assertThat(keyA, notNilValue());
+  // Keys depend on contents, not on where the bundle was built.
+  assertThat(keyA, equalTo(keyB));
+}
+
+- (void)testKeyChangesWithExecutableContentsAndRunner
+{
+  TestListCache *cache = [[TestListCache alloc] initWithDirectory:MakeTemporaryDirectory(@"test-list-cache-XXXXXXX")];
+  NSDictionary *buildSettings = @{Xcode_SDK_NAME: @"macosx10.11"};
+
+  NSString *key = [cache keyForQueryRunnerClass:[OCUnitOSXLogicTestQueryRunner class]
+                                     bundlePath:[self makeBundleWithExecutableContents:@"binary"]
+                                   testHostPath:nil
+                                  buildSettings:buildSettings];
+  NSString *rebuiltKey = [cache keyForQueryRunnerClass:[OCUnitOSXLogicTestQueryRunner class]
+                                            bundlePath:[self makeBundleWithExecutableContents:@"rebuilt binary"]
+                                          testHostPath:nil
+                                         buildSettings:buildSettings];
+  NSString *otherRunnerKey = [cache keyForQueryRunnerClass:[OCUnitIOSLogicTestQueryRunner class]
+                                                bundlePath:[self makeBundleWithExecutableContents:@"binary"]
+                                              testHostPath:nil
+                                             buildSettings:buildSettings];
+  assertThat(rebuiltKey, isNot(equalTo(key)));
+  assertThat(otherRunnerKey, isNot(equalTo(key)));
+}
+
+- (void)testNoKeyWithoutReadableBinaries
+{
+  TestListCache *cache = [[TestListCache alloc] initWithDirectory:MakeTemporaryDirectory(@"test-list-cache-XXXXXXX")];
+  NSString *missingBundleKey = [cache keyForQueryRunnerClass:[OCUnitOSXLogicTestQueryRunner class]
+                                                  bundlePath:@"/path/to/nonexistent/SomeTests.xctest"
+                                                testHostPath:nil
+                                               buildSettings:@{}];
+  assertThat(missingBundleKey, nilValue());
+
+  NSString *missingHostKey = [cache keyForQueryRunnerClass:[OCUnitOSXLogicTestQueryRunner class]
+                                                bundlePath:[self makeBundleWithExecutableContents:@"binary"]
+                                              testHostPath:@"/path/to/nonexistent/Host.app/Host"
+                                             buildSettings:@{}];
+  assertThat(missingHostKey, nilValue());
+}
+
+- (void)testQueryRunnerOnlyQueriesOnACacheMiss
+{
+  TestListCache *cache = [[TestListCache alloc] initWithDirectory:MakeTemporaryDirectory(@"test-list-cache-XXXXXXX")];
+  [TestListCache setSharedCache:cache];
+
+  NSDictionary *buildSettings = @{
+    Xcode_BUILT_PRODUCTS_DIR : AbsolutePathFromRelative(TEST_DATA @"tests-osx-test-bundle"),
+    Xcode_FULL_PRODUCT_NAME : @"TestProject-Library-XCTest-OSXTests.xctest",
+    Xcode_SDK_NAME : GetAvailableSDKsAndAliases()[@"macosx"],
+    Xcode_TARGETED_DEVICE_FAMILY : @"1",
+  };
+  NSArray *testList = @[@"TestProject_Library_XCTest_OSXTests/testOutput",
+                        @"TestProject_Library_XCTest_OSXTests/testWillFail",
+                        @"TestProject_Library_XCTest_OSXTests/testWillPass"];
+
+  __block NSUInteger queryCount = 0;
+  void (^returnTestList)(FakeTask *) = [LaunchHandlers handlerForOtestQueryReturningTestList:testList];
+  NSArray *(^runQuery)(void) = ^{
+    __block NSArray *result = nil;
+    [[FakeTaskManager sharedManager] runBlockWithFakeTasks:^{
+      [[FakeTaskManager sharedManager] addLaunchHandlerBlocks:@[
+        ^(FakeTask *task){
+          if ([[[task launchPath] lastPathComponent] hasPrefix:@"otest-query-"]) {
+            queryCount++;
+          }
+          returnTestList(task);
+        },
+      ]];
+
+      // A fresh runner each time, so nothing is remembered between queries
+      // except what's in the cache.
+      SimulatorInfo *simulatorInfo = [[SimulatorInfo alloc] init];
+      simulatorInfo.buildSettings = buildSettings;
+      OCUnitTestQueryRunner *runner =
+      [[OCUnitOSXLogicTestQueryRunner alloc] initWithSimulatorInfo:simulatorInfo];
+      NSString *error = nil;
+      result = [runner runQueryWithError:&error];
+      assertThat(error, nilValue());
+    }];
+    return result;
+  };
+
+  // Miss: otest-query runs, and its result is stored.
+  assertThat(runQuery(), equalTo(testList));
+  assertThatInteger(queryCount, equalToInteger(1));
+  NSString *key = [cache keyForQueryRunnerClass:[OCUnitOSXLogicTestQueryRunner class]
+                                     bundlePath:[buildSettings[Xcode_BUILT_PRODUCTS_DIR]
+                                                 stringByAppendingPathComponent:buildSettings[Xcode_FULL_PRODUCT_NAME]]
+                                   testHostPath:nil
+                                  buildSettings:buildSettings];
+  assertThat([cache testCasesForKey:key], equalTo(testList));
+
+  // Hit: the list comes from the cache without launching otest-query.
+  assertThat(runQuery(), equalTo(testList));
+  assertThatInteger(queryCount, equalToInteger(1));
+}
+
+@end
@@ -0,0 +1,170 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "EventBuffer.h"
+#import "ReporterEvents.h"
+#import "TestRetryBuffer.h"
+#import "XCToolUtil.h"
+
+static void PublishTest(id<EventSink> sink, NSString *methodName, BOOL succeeded)
+{
+  PublishEventToReporters(@[sink], @{
+    kReporter_Event_Key: kReporter_Events_BeginTest,
+    kReporter_BeginTest_ClassNameKey: @"Cls",
+    kReporter_BeginTest_MethodNameKey: methodName,
+  });
+  PublishEventToReporters(@[sink], @{
+    kReporter_Event_Key: kReporter_Events_EndTest,
+    kReporter_EndTest_ClassNameKey: @"Cls",
+    kReporter_EndTest_MethodNameKey: methodName,
+    kReporter_EndTest_SucceededKey: @(succeeded),
+    kReporter_EndTest_ResultKey: succeeded ? @"success" : @"failure",
+    kReporter_EndTest_OutputKey: @"",
+  });
+}
+
+static NSArray *EventNames(NSArray *events)
+{
+  return [events valueForKey:kReporter_Event_Key];
+}
+
+@interface TestRetryBufferTests : XCTestCase
+@end
+
+@implementation TestRetryBufferTests
+
+- (void)testHoldsEverythingAfterAFailingTestUntilFlushed
+{
+  EventBuffer *reporter = [EventBuffer eventBufferForSink:nil];
+  TestRetryBuffer *retryBuffer = [[TestRetryBuffer alloc] initWithReporters:@[reporter]];
+
+  PublishTest(retryBuffer, @"testPassesFirst", YES);
+  PublishTest(retryBuffer, @"testFails", NO);
+  PublishTest(retryBuffer, @"testPasses", YES);
+  PublishEventToReporters(@[retryBuffer], @{
+    kReporter_Event_Key: kReporter_Events_EndTestSuite,
+    kReporter_EndTestSuite_TotalFailureCountKey: @1,
+    kReporter_EndTestSuite_UnexpectedExceptionCountKey: @0,
+  });
+
+  // Only the test that ran before the failure got through.
+  assertThat(EventNames([reporter events]),
+             equalTo(@[kReporter_Events_BeginTest, kReporter_Events_EndTest]));
+  assertThat([retryBuffer failedTestCases], equalTo(@[@"Cls/testFails"]));
+
+  [retryBuffer flush];
+  assertThat(EventNames([reporter events]),
+             equalTo(@[
+                       kReporter_Events_BeginTest,
+                       kReporter_Events_EndTest,
+                       kReporter_Events_BeginTest,
+                       kReporter_Events_EndTest,
+                       kReporter_Events_BeginTest,
+                       kReporter_Events_EndTest,
+                       kReporter_Events_EndTestSuite,
+                       ]));
+  // Tests are reported in the order they ran.
+  assertThat([[reporter events] valueForKey:kReporter_BeginTest_MethodNameKey],
+             equalTo(@[
+                       @"testPassesFirst",
+                       @"testPassesFirst",
+                       @"testFails",
+                       @"testFails",
+                       @"testPasses",
+                       @"testPasses",
+                       [NSNull null],
+                       ]));
+  NSDictionary *endTest = [reporter events][3];
+  assertThat(endTest[kReporter_EndTest_SucceededKey], equalTo(@NO));
+  assertThat(endTest[kReporter_EndTest_AttemptsKey], equalTo(@1));
+}
+
+- (void)testCorrectsCountsOfEachSuiteAroundAFlakyTest
+{
+  EventBuffer *reporter = [EventBuffer eventBufferForSink:nil];
+  TestRetryBuffer *retryBuffer = [[TestRetryBuffer alloc] initWithReporters:@[reporter]];
+
+  NSDictionary *(^endTestSuite)(NSNumber *) = ^(NSNumber *failureCount) {
+    return @{
+      kReporter_Event_Key: kReporter_Events_EndTestSuite,
+      kReporter_EndTestSuite_TotalFailureCountKey: failureCount,
+      kReporter_EndTestSuite_UnexpectedExceptionCountKey: @0,
+    };
+  };
+  NSDictionary *beginTestSuite = @{kReporter_Event_Key: kReporter_Events_BeginTestSuite};
+
+  PublishEventToReporters(@[retryBuffer], beginTestSuite);
+  PublishEventToReporters(@[retryBuffer], beginTestSuite);
+  PublishTest(retryBuffer, @"testFlaky", NO);
+  PublishEventToReporters(@[retryBuffer], endTestSuite(@1));
+  PublishEventToReporters(@[retryBuffer], beginTestSuite);
+  PublishTest(retryBuffer, @"testBroken", NO);
+  PublishEventToReporters(@[retryBuffer], endTestSuite(@1));
+  PublishEventToReporters(@[retryBuffer], endTestSuite(@2));
+
+  [retryBuffer recordAttemptOfTestCase:@"Cls/testFlaky" succeeded:YES output:@""];
+  [retryBuffer recordAttemptOfTestCase:@"Cls/testBroken" succeeded:NO output:@""];
+  [retryBuffer flush];
+
+  NSArray *endTestSuites = [[reporter events] filteredArrayUsingPredicate:
+                            [NSPredicate predicateWithFormat:@"%K == %@", kReporter_Event_Key, kReporter_Events_EndTestSuite]];
+  assertThat([endTestSuites valueForKey:kReporter_EndTestSuite_TotalFailureCountKey],
+             equalTo(@[@0, @1, @1]));
+}
+
+- (void)testReportsTestThatPassesOnRetryAsFlaky
+{
+  EventBuffer *reporter = [EventBuffer eventBufferForSink:nil];
+  TestRetryBuffer *retryBuffer = [[TestRetryBuffer alloc] initWithReporters:@[reporter]];
+
+  PublishTest(retryBuffer, @"testFlaky", NO);
+  PublishTest(retryBuffer, @"testBroken", NO);
+  PublishEventToReporters(@[retryBuffer], @{
+    kReporter_Event_Key: kReporter_Events_EndTestSuite,
+    kReporter_EndTestSuite_TotalFailureCountKey: @2,
+    kReporter_EndTestSuite_UnexpectedExceptionCountKey: @0,
+  });
+
+  [retryBuffer recordAttemptOfTestCase:@"Cls/testFlaky" succeeded:YES output:@""];
+  [retryBuffer recordAttemptOfTestCase:@"Cls/testBroken" succeeded:NO output:@"still broken"];
+  assertThat([retryBuffer failedTestCases], equalTo(@[@"Cls/testBroken"]));
+  [retryBuffer recordAttemptOfTestCase:@"Cls/testBroken" succeeded:NO output:@"still broken"];
+  assertThatBool([retryBuffer allFailedTestsPassedOnRetry], isFalse());
+
+  [retryBuffer flush];
+
+  NSArray *endTests = [[reporter events] filteredArrayUsingPredicate:
+                       [NSPredicate predicateWithFormat:@"%K == %@", kReporter_Event_Key, kReporter_Events_EndTest]];
+  assertThatInteger(endTests.count, equalToInteger(2));
+
+  assertThat(endTests[0][kReporter_EndTest_SucceededKey], equalTo(@YES));
+  assertThat(endTests[0][kReporter_EndTest_ResultKey], equalTo(@"success"));
+  assertThat(endTests[0][kReporter_EndTest_FlakyKey], equalTo(@YES));
+  assertThat(endTests[0][kReporter_EndTest_AttemptsKey], equalTo(@2));
+
+  assertThat(endTests[1][kReporter_EndTest_SucceededKey], equalTo(@NO));
+  assertThat(endTests[1][kReporter_EndTest_FlakyKey], equalTo(@NO));
+  assertThat(endTests[1][kReporter_EndTest_AttemptsKey], equalTo(@3));
+  assertThat(endTests[1][kReporter_EndTest_OutputKey], containsString(@"still broken"));
+
+  NSDictionary *endTestSuite = [[reporter events] lastObject];
+  assertThat(endTestSuite[kReporter_Event_Key], equalTo(kReporter_Events_EndTestSuite));
+  assertThat(endTestSuite[kReporter_EndTestSuite_TotalFailureCountKey], equalTo(@1));
+}
+
+@end
@@ -102,6 +102,23 @@ static TestRunState *TestRunStateForFakeRun(id<EventSink> sink)
   assertThat(SelectEventFields(eventBuffer.events, kReporter_Events_EndTest, @"event"), hasCountOf(7));
 }
 
+- (void)testRawOutputLinesAreReportedAsOutputOfRunningTest
+{
+  EventBuffer *eventBuffer = [[EventBuffer alloc] init];
+  TestRunState *state = TestRunStateForFakeRun(eventBuffer);
+
+  [state prepareToRun];
+  for (NSDictionary *event in [EventsForFakeRun() subarrayWithRange:NSMakeRange(0, 2)]) {
+    NSData *data = [NSJSONSerialization dataWithJSONObject:event options:0 error:nil];
+    [state handleOutput:[[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]
+                 ofType:TestOutputTypeEvent];
+  }
+  [state handleOutput:@"\e[1mpuppies!\e[0m" ofType:TestOutputTypeRawLine];
+
+  assertThat(SelectEventFields(eventBuffer.events, kReporter_Events_TestOuput, kReporter_TestOutput_OutputKey),
+             equalTo(@[@"puppies!\n"]));
+}
+
 - (void)testCrashBeforeTestsRan
 {
   void (^testCrashBeforeTestsRan)(NSArray *, NSArray *expectedEvents) =
@@ -171,6 +188,7 @@ static TestRunState *TestRunStateForFakeRun(id<EventSink> sink)
   [state prepareToRun];
   [self sendEvents:[EventsForFakeRun() subarrayWithRange:NSMakeRange(0, 2)]
           toReporter:state];
+  assertThatBool([state crashedBetweenTests], isFalse());
   [state didFinishRunWithStartupError:nil otherErrors:nil];
 
   assertThat(SelectEventFields(eventBuffer.events, nil, @"event"),
@@ -223,6 +241,59 @@ static TestRunState *TestRunStateForFakeRun(id<EventSink> sink)
                      @"Even though that test finished, it's likely responsible for the crash."));
 }
 
+- (void)testCrashBetweenTestsIsDetectedAndDiagnosisIsReported
+{
+  EventBuffer *eventBuffer = [[EventBuffer alloc] init];
+  TestRunState *state = TestRunStateForFakeRun(eventBuffer);
+
+  [state prepareToRun];
+  [self sendEvents:[EventsForFakeRun() subarrayWithRange:NSMakeRange(0, 4)]
+        toReporter:state];
+
+  assertThatBool([state crashedBetweenTests], isTrue());
+  assertThat(state.testCasesFinishedInRun, equalTo(@[@"OtherTests/testSomething"]));
+
+  state.crashDiagnosis = @"Crash bisection (1 extra launch): cupcakes.";
+  [state didFinishRunWithStartupError:nil otherErrors:nil];
+
+  NSArray *output = SelectEventFields(eventBuffer.events, kReporter_Events_TestOuput, kReporter_TestOutput_OutputKey);
+  assertThat(output[1],
+             equalTo(@"The test bundle stopped running or crashed immediately after running '-[OtherTests testSomething]'.  "
+                     @"Even though that test finished, it's likely responsible for the crash.\n\n"
+                     @"Crash bisection (1 extra launch): cupcakes."));
+}
+
+- (void)testCancelledAfterFirstTestFinishes
+{
+  EventBuffer *eventBuffer = [[EventBuffer alloc] init];
+  TestRunState *state = TestRunStateForFakeRun(eventBuffer);
+
+  [state prepareToRun];
+  [self sendEvents:[EventsForFakeRun() subarrayWithRange:NSMakeRange(0, 4)]
+        toReporter:state];
+  [state didCancelRunWithReason:@"the run was cancelled after 1 failing test (-failFast)."];
+
+  assertThat(SelectEventFields(eventBuffer.events, nil, @"event"),
+             equalTo(@[kReporter_Events_BeginTestSuite,
+                       kReporter_Events_BeginTest,
+                       kReporter_Events_TestOuput,
+                       kReporter_Events_EndTest,
+                       kReporter_Events_BeginTest,
+                       kReporter_Events_TestOuput,
+                       kReporter_Events_EndTest,
+                       kReporter_Events_EndTestSuite]));
+
+  // Unlike a crash, no "fake" test is inserted.
+  assertThat(SelectEventFields(eventBuffer.events, kReporter_Events_EndTest, kReporter_EndTest_TestKey),
+             equalTo(@[@"-[OtherTests testSomething]",
+                       @"-[OtherTests testAnother]"]));
+  assertThat(SelectEventFields(eventBuffer.events, kReporter_Events_EndTest, kReporter_EndTest_SucceededKey),
+             equalTo(@[@NO, @NO]));
+
+  NSArray *output = SelectEventFields(eventBuffer.events, kReporter_Events_TestOuput, kReporter_TestOutput_OutputKey);
+  assertThat(output[1], equalTo(@"Test did not run: the run was cancelled after 1 failing test (-failFast)."));
+}
+
 - (void)testTestsNeverRanBecauseOfStartupError
 {
   EventBuffer *eventBuffer = [[EventBuffer alloc] init];
@@ -0,0 +1,85 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "TestWorkQueue.h"
+
+static NSArray *TestCasesForClassCount(NSString *prefix, NSUInteger count)
+{
+  NSMutableArray *testCases = [NSMutableArray array];
+  for (NSUInteger i = 0; i < count; i++) {
+    [testCases addObject:[NSString stringWithFormat:@"%@%lu/test1", prefix, (unsigned long)i]];
+    [testCases addObject:[NSString stringWithFormat:@"%@%lu/test2", prefix, (unsigned long)i]];
+  }
+  return testCases;
+}
+
+@interface TestWorkQueueTests : XCTestCase
+@end
+
+@implementation TestWorkQueueTests
+
+- (void)testBatchesShrinkAsBacklogDrains
+{
+  TestWorkQueue *queue = [[TestWorkQueue alloc] initWithWorkerCount:2 maxBatchSize:0];
+  [queue addTestCases:TestCasesForClassCount(@"Cls", 16) withContext:@"A" durations:nil];
+
+  NSMutableArray *batchClassCounts = [NSMutableArray array];
+  TestWorkBatch *batch = nil;
+  while ((batch = [queue nextBatch])) {
+    assertThat(batch.context, equalTo(@"A"));
+    // Classes are never split, each has two test cases.
+    [batchClassCounts addObject:@(batch.testCases.count / 2)];
+  }
+
+  // ceil(remaining / (2 * workers)) with 16 classes and 2 workers.
+  assertThat(batchClassCounts, equalTo(@[@4, @3, @3, @2, @1, @1, @1, @1]));
+}
+
+- (void)testBatchesAreNumberedPerBundleAndBundlesDrainInOrder
+{
+  TestWorkQueue *queue = [[TestWorkQueue alloc] initWithWorkerCount:4 maxBatchSize:1];
+  [queue addTestCases:TestCasesForClassCount(@"A", 2) withContext:@"A" durations:nil];
+  [queue addTestCases:TestCasesForClassCount(@"B", 1) withContext:@"B" durations:nil];
+
+  TestWorkBatch *batch1 = [queue nextBatch];
+  TestWorkBatch *batch2 = [queue nextBatch];
+  TestWorkBatch *batch3 = [queue nextBatch];
+
+  assertThat(batch1.context, equalTo(@"A"));
+  assertThat(batch1.testCases, equalTo(@[@"A0/test1", @"A0/test2"]));
+  assertThatInteger(batch1.batchNumber, equalToInteger(1));
+  assertThat(batch2.context, equalTo(@"A"));
+  assertThatInteger(batch2.batchNumber, equalToInteger(2));
+  assertThat(batch3.context, equalTo(@"B"));
+  assertThatInteger(batch3.batchNumber, equalToInteger(1));
+  assertThat([queue nextBatch], nilValue());
+}
+
+- (void)testSlowestClassesAreHandedOutFirst
+{
+  TestWorkQueue *queue = [[TestWorkQueue alloc] initWithWorkerCount:1 maxBatchSize:1];
+  [queue addTestCases:@[@"Fast/test1", @"Unknown/test1", @"Slow/test1"]
+          withContext:@"A"
+            durations:@{@"Fast/test1": @1, @"Slow/test1": @30}];
+
+  assertThat([queue nextBatch].testCases, equalTo(@[@"Slow/test1"]));
+  assertThat([queue nextBatch].testCases, equalTo(@[@"Fast/test1"]));
+  assertThat([queue nextBatch].testCases, equalTo(@[@"Unknown/test1"]));
+}
+
+@end
@@ -16,10 +16,19 @@
 
 #import <XCTest/XCTest.h>
 
+#import "ContainsArray.h"
+#import "FakeTask.h"
+#import "FakeTaskManager.h"
+#import "OCUnitOSXLogicTestQueryRunner.h"
+#import "SimulatorInfo.h"
+#import "Swizzler.h"
+#import "Testable.h"
 #import "TestableExecutionInfo.h"
+#import "XcodeBuildSettings.h"
 
 @interface TestableExecutionInfo ()
 + (NSString *)stringWithMacrosExpanded:(NSString *)str fromBuildSettingsAndProcessEnvironment:(NSDictionary *)settings;
++ (OCUnitTestQueryRunner *)queryRunnerForSimulatorInfo:(SimulatorInfo *)simulatorInfo;
 @end
 
 @interface TestableExecutionInfoTests : XCTestCase
@@ -225,4 +234,94 @@
   }
 }
 
+- (void)testFetchesBuildSettingsForSeveralTargetsWithOneXcodebuild
+{
+  __block NSDictionary *settings = nil;
+  __block NSString *error = nil;
+  NSMutableArray *settingsTasks = [NSMutableArray array];
+  [[FakeTaskManager sharedManager] runBlockWithFakeTasks:^{
+    [[FakeTaskManager sharedManager] addLaunchHandlerBlocks:@[
+      ^(FakeTask *task){
+        if ([[task launchPath] hasSuffix:@"xcodebuild"] &&
+            [[task arguments] containsObject:@"-showBuildSettings"]) {
+          [settingsTasks addObject:task];
+          [task pretendTaskReturnsStandardOutput:
+           [NSString stringWithContentsOfFile:TEST_DATA @"TestProject-TVApp-multiple-targets-showBuildSettings.txt"
+                                     encoding:NSUTF8StringEncoding
+                                        error:nil]];
+        }
+      },
+    ]];
+
+    settings = [TestableExecutionInfo buildSettingsForProject:TEST_DATA @"TestProject-TVApp/TestProject-TVApp.xcodeproj"
+                                                      targets:@[@"TestProject-TVAppTests", @"TestProject-TVApp"]
+                                                      objRoot:@"/tmp/obj"
+                                                      symRoot:@"/tmp/sym"
+                                            sharedPrecompsDir:@"/tmp/precomps"
+                                         targetedDeviceFamily:@"3"
+                                               xcodeArguments:@[]
+                                                      testSDK:nil
+                                                        error:&error];
+  }];
+
+  // The fake task manager hides these from `launchedTasks`.
+  assertThatInteger([settingsTasks count], equalToInteger(1));
+  assertThat([settingsTasks[0] arguments],
+             containsArray(@[@"-target", @"TestProject-TVAppTests", @"-target", @"TestProject-TVApp"]));
+  assertThat([settingsTasks[0] environment][@"SHOW_ONLY_BUILD_SETTINGS_FOR_TARGETS"],
+             equalTo(@"TestProject-TVAppTests\nTestProject-TVApp"));
+
+  assertThat(error, nilValue());
+  assertThat([[settings allKeys] sortedArrayUsingSelector:@selector(compare:)],
+             equalTo(@[@"TestProject-TVApp", @"TestProject-TVAppTests"]));
+  assertThat(settings[@"TestProject-TVAppTests"][@"WRAPPER_EXTENSION"], equalTo(@"xctest"));
+}
+
+- (void)testDeferredQueriesReuseTheRunnersThatDeferredThem
+{
+  TestableExecutionInfo *(^deferredInfoForBundle)(NSString *) = ^(NSString *bundle) {
+    Testable *testable = [[Testable alloc] init];
+    testable.target = bundle;
+    return [TestableExecutionInfo infoForTestable:testable
+                                    buildSettings:@{
+                                      Xcode_BUILT_PRODUCTS_DIR : AbsolutePathFromRelative(TEST_DATA @"tests-osx-test-bundle"),
+                                      Xcode_FULL_PRODUCT_NAME : bundle,
+                                      Xcode_SDK_NAME : GetAvailableSDKsAndAliases()[@"macosx"],
+                                      Xcode_TARGETED_DEVICE_FAMILY : @"1",
+                                    }
+                                    simulatorInfo:[[SimulatorInfo alloc] init]
+                             deferBatchableQuery:YES];
+  };
+
+  __block NSUInteger runnersCreated = 0;
+  __block NSArray *infos = nil;
+  [Swizzler whileSwizzlingSelector:@selector(queryRunnerForSimulatorInfo:)
+                          forClass:[TestableExecutionInfo class]
+                         withBlock:^(id cls, SimulatorInfo *simulatorInfo){
+                           runnersCreated++;
+                           return [[OCUnitOSXLogicTestQueryRunner alloc] initWithSimulatorInfo:simulatorInfo];
+                         }
+                          runBlock:^{
+                            infos = @[
+                              deferredInfoForBundle(@"TestProject-Library-XCTest-OSXTests.xctest"),
+                              deferredInfoForBundle(@"TestProject-Library-XCTest-CustomTests.xctest"),
+                            ];
+                            assertThatBool([infos[0] needsBatchedQuery], isTrue());
+                            assertThatBool([infos[1] needsBatchedQuery], isTrue());
+
+                            [TestableExecutionInfo queryTestCasesForInfos:infos];
+                          }];
+
+  // One runner per bundle: the query must not start over with new runners.
+  assertThatInteger(runnersCreated, equalToInteger(2));
+  assertThatBool([infos[0] needsBatchedQuery], isFalse());
+  assertThat([infos[0] testCasesQueryError], nilValue());
+  assertThat([infos[0] testCases], equalTo(@[@"TestProject_Library_XCTest_OSXTests/testOutput",
+                                             @"TestProject_Library_XCTest_OSXTests/testWillFail",
+                                             @"TestProject_Library_XCTest_OSXTests/testWillPass"]));
+  assertThat([infos[1] testCasesQueryError], nilValue());
+  assertThat([infos[1] testCases], equalTo(@[@"TestProject_Library_XCTest_CustomTests/customTest",
+                                             @"TestProject_Library_XCTest_CustomTests/customTestWithInteger:"]));
+}
+
 @end
@@ -0,0 +1,68 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "WarmTestWorkerPool.h"
+#import "XCToolUtil.h"
+
+@interface WarmTestWorkerPoolTests : XCTestCase
+@end
+
+@implementation WarmTestWorkerPoolTests
+
+- (WarmTestWorker *)makeWorker
+{
+  return [[WarmTestWorker alloc] initWithControlPath:MakeTempFileWithPrefix(@"otest_worker_control")];
+}
+
+- (void)testCheckOutReturnsNilWhenNoWorkerIsIdle
+{
+  WarmTestWorkerPool *pool = [[WarmTestWorkerPool alloc] init];
+  assertThat([pool checkOutWorkerForKey:@"iphonesimulator:/path/to/Tests.xctest"], nilValue());
+}
+
+- (void)testWorkersAreOnlyHandedOutForTheirKey
+{
+  WarmTestWorkerPool *pool = [[WarmTestWorkerPool alloc] init];
+  WarmTestWorker *worker = [self makeWorker];
+  [pool checkInWorker:worker forKey:@"macosx:/path/to/A.xctest"];
+
+  assertThat([pool checkOutWorkerForKey:@"macosx:/path/to/B.xctest"], nilValue());
+  assertThat([pool checkOutWorkerForKey:@"macosx:/path/to/A.xctest"], sameInstance(worker));
+  // Checked out workers aren't handed out twice.
+  assertThat([pool checkOutWorkerForKey:@"macosx:/path/to/A.xctest"], nilValue());
+
+  [worker terminate];
+}
+
+- (void)testTerminateAllWorkersRemovesControlFiles
+{
+  WarmTestWorkerPool *pool = [[WarmTestWorkerPool alloc] init];
+  WarmTestWorker *worker1 = [self makeWorker];
+  WarmTestWorker *worker2 = [self makeWorker];
+  [pool checkInWorker:worker1 forKey:@"macosx:/path/to/A.xctest"];
+  [pool checkInWorker:worker2 forKey:@"macosx:/path/to/B.xctest"];
+
+  assertThatBool([[NSFileManager defaultManager] fileExistsAtPath:worker1.controlPath], isTrue());
+  [pool terminateAllWorkers];
+
+  assertThatBool([[NSFileManager defaultManager] fileExistsAtPath:worker1.controlPath], isFalse());
+  assertThatBool([[NSFileManager defaultManager] fileExistsAtPath:worker2.controlPath], isFalse());
+  assertThat([pool checkOutWorkerForKey:@"macosx:/path/to/A.xctest"], nilValue());
+}
+
+@end
@@ -351,6 +351,33 @@
            @"Should only have build settings for a single target.");
 }
 
+- (void)testCanParseBuildSettingsForMultipleTargets
+{
+  NSString *output = [NSString stringWithContentsOfFile:TEST_DATA @"TestProject-TVApp-multiple-targets-showBuildSettings.txt"
+                                               encoding:NSUTF8StringEncoding
+                                                  error:nil];
+  NSDictionary *settings = BuildSettingsFromOutput(output);
+  assertThat([[settings allKeys] sortedArrayUsingSelector:@selector(compare:)],
+             equalTo(@[@"TestProject-TVApp", @"TestProject-TVAppTests"]));
+  assertThat(settings[@"TestProject-TVApp"][@"FULL_PRODUCT_NAME"], equalTo(@"TestProject-TVApp.app"));
+  assertThat(settings[@"TestProject-TVAppTests"][@"FULL_PRODUCT_NAME"], equalTo(@"TestProject-TVAppTests.xctest"));
+  assertThatInteger([settings[@"TestProject-TVAppTests"] count], equalToInteger(374));
+}
+
+- (void)testCanParseInterleavedBuildSettingsForMultipleTargets
+{
+  // Same settings as above, but TestProject-TVAppTests's are split across two
+  // blocks around TestProject-TVApp's, with stray lines between blocks and no
+  // empty line after the last one.
+  NSString *output = [NSString stringWithContentsOfFile:TEST_DATA @"TestProject-TVApp-multiple-targets-interleaved-showBuildSettings.txt"
+                                               encoding:NSUTF8StringEncoding
+                                                  error:nil];
+  NSString *expectedOutput = [NSString stringWithContentsOfFile:TEST_DATA @"TestProject-TVApp-multiple-targets-showBuildSettings.txt"
+                                                       encoding:NSUTF8StringEncoding
+                                                          error:nil];
+  assertThat(BuildSettingsFromOutput(output), equalTo(BuildSettingsFromOutput(expectedOutput)));
+}
+
 - (void)testCanParseTestablesFromScheme
 {
   NSArray *testables = [XcodeSubjectInfo testablesInSchemePath:
@@ -0,0 +1,48 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "EventSink.h"
+
+/**
+ * With -streamParallelOutput, stands in for the EventBuffers a bucket's events
+ * would otherwise be held in: events are passed on to the sinks right away,
+ * tagged with the bucket's id (kReporter_BucketKey), and -finishWithSuccess:
+ * takes the place of the flush.
+ *
+ * Reporters that group their output by bucket (see +[Reporter
+ * groupsEventsByBucket]) hold the tagged events back until they see the
+ * bucket's `end-bucket` event.
+ */
+@interface BucketEventStream : NSObject <EventSink>
+
+@property (nonatomic, assign, readonly) NSUInteger bucket;
+
+/**
+ * @param lock Held while publishing, since the sinks are shared with the
+ *   other buckets.
+ */
+- (instancetype)initWithBucket:(NSUInteger)bucket
+                         sinks:(NSArray *)sinks
+                          lock:(id)lock;
+
+/**
+ * Publishes `end-bucket`.  Nothing should be published afterwards.
+ */
+- (void)finishWithSuccess:(BOOL)succeeded;
+
+@end
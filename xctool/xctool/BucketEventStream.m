@@ -0,0 +1,72 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "BucketEventStream.h"
+
+#import "EventGenerator.h"
+#import "ReporterEvents.h"
+#import "XCToolUtil.h"
+
+@interface BucketEventStream ()
+@property (nonatomic, copy) NSArray *sinks;
+@property (nonatomic, strong) id lock;
+@end
+
+@implementation BucketEventStream
+
+- (instancetype)initWithBucket:(NSUInteger)bucket
+                         sinks:(NSArray *)sinks
+                          lock:(id)lock
+{
+  if (self = [super init]) {
+    _bucket = bucket;
+    _sinks = [sinks copy];
+    _lock = lock;
+  }
+  return self;
+}
+
+- (void)publishTaggedEvent:(NSDictionary *)event
+{
+  NSMutableDictionary *taggedEvent = [event mutableCopy];
+  taggedEvent[kReporter_BucketKey] = @(_bucket);
+
+  @synchronized (_lock) {
+    PublishEventToReporters(_sinks, taggedEvent);
+  }
+}
+
+- (void)publishDataForEvent:(NSData *)data
+{
+  NSError *error = nil;
+  NSDictionary *event = [NSJSONSerialization JSONObjectWithData:data options:0 error:&error];
+  NSAssert(event != nil, @"Error decoding JSON: %@", [error localizedFailureReason]);
+  [self publishTaggedEvent:event];
+}
+
+- (void)publishEvent:(NSDictionary *)event data:(NSData *)data
+{
+  [self publishTaggedEvent:event];
+}
+
+- (void)finishWithSuccess:(BOOL)succeeded
+{
+  [self publishTaggedEvent:EventDictionaryWithNameAndContent(kReporter_Events_EndBucket, @{
+    kReporter_EndBucket_SucceededKey: @(succeeded),
+  })];
+}
+
+@end
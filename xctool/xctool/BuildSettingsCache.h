@@ -0,0 +1,73 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "ContentAddressedCache.h"
+
+/**
+ * On-disk cache of `xcodebuild -showBuildSettings` results.
+ *
+ * The key is a SHA-256 over the xcodebuild invocation (arguments, environment
+ * and working directory), the Xcode in use, the fastsettings shim, the Xcode
+ * preferences that move build locations, and the contents of everything the
+ * settings are derived from: the workspace, every project's project.pbxproj,
+ * its schemes and workspace settings, and the .xcconfig files the projects
+ * reference or that are passed with -xcconfig or XCODE_XCCONFIG_FILE
+ * (following #includes).  Editing any of those yields a new key.
+ *
+ * Entries live next to the build products, in the DerivedData directory the
+ * invocation uses, and are pruned once they haven't been used for a while.
+ */
+@interface BuildSettingsCache : ContentAddressedCache
+
+/**
+ * Cache for xcodebuild invocations with the given arguments, or nil if
+ * caching is disabled (when running under test, or when
+ * XCTOOL_DISABLE_BUILD_SETTINGS_CACHE is set).
+ */
++ (instancetype)cacheForXcodebuildArguments:(NSArray *)arguments;
+
+- (instancetype)initWithDirectory:(NSString *)directory;
+
+/**
+ * Returns the key for running xcodebuild with `arguments` and `environment`
+ * from the current directory.
+ */
+- (NSString *)keyForXcodebuildArguments:(NSArray *)arguments
+                            environment:(NSDictionary *)environment;
+
+/**
+ * Returns the cached settings, keyed by target name, or nil on a miss.
+ */
+- (NSDictionary *)buildSettingsForKey:(NSString *)key;
+
+- (void)setBuildSettings:(NSDictionary *)buildSettings forKey:(NSString *)key;
+
+@end
+
+/**
+ * Runs `task`, an `xcodebuild ... -showBuildSettings` invocation, and returns
+ * the settings it printed, keyed by target name (see BuildSettingsFromOutput).
+ * Non-empty results are cached, and the task isn't launched at all when a
+ * cached result is found.
+ *
+ * @param output Optional; set to the task's "stdout" and "stderr", which are
+ *   empty when the result came from the cache.
+ */
+NSDictionary *LaunchShowBuildSettingsTaskUsingCache(NSTask *task,
+                                                    NSString *description,
+                                                    NSDictionary **output);
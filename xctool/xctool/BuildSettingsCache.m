@@ -0,0 +1,412 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "BuildSettingsCache.h"
+
+#import <CommonCrypto/CommonDigest.h>
+
+#import "PbxprojReader.h"
+#import "TaskUtil.h"
+#import "XCToolUtil.h"
+#import "XcodeSubjectInfo.h"
+
+// Bump whenever the key derivation or the entry format changes.
+static NSString *const kBuildSettingsCacheVersion = @"1";
+
+// Entries stop matching as soon as a project is edited, so keep them two weeks.
+static const NSTimeInterval kBuildSettingsCacheMaxEntryAge = 14 * 24 * 60 * 60;
+
+/**
+ * SHA-256 of the file's contents, or "-" if it can't be read.  Digests are
+ * remembered for as long as the file's inode, size and modification date stay
+ * the same, since every testable hashes the same project files.  Files
+ * modified in the last couple of seconds are always read again, since a
+ * same-size edit within the filesystem's timestamp resolution would otherwise
+ * go unnoticed.
+ */
+static NSString *DigestForFile(NSString *path)
+{
+  static NSMutableDictionary *digestsByPath = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    digestsByPath = [NSMutableDictionary dictionary];
+  });
+
+  NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil];
+  if (attributes == nil) {
+    return @"-";
+  }
+  NSDate *modificationDate = [attributes fileModificationDate];
+  NSString *stamp = [NSString stringWithFormat:@"%lu:%llu:%f",
+                     (unsigned long)[attributes fileSystemFileNumber],
+                     [attributes fileSize],
+                     [modificationDate timeIntervalSince1970]];
+  BOOL recentlyModified = ([modificationDate timeIntervalSinceNow] > -2.0);
+
+  @synchronized (digestsByPath) {
+    NSArray *entry = digestsByPath[path];
+    if ([entry[0] isEqualToString:stamp]) {
+      return entry[1];
+    }
+  }
+
+  NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+  if (data == nil) {
+    return @"-";
+  }
+  uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256(data.bytes, (CC_LONG)data.length, digest);
+  NSString *hex = HexStringForDigest(digest, sizeof(digest));
+
+  if (!recentlyModified) {
+    @synchronized (digestsByPath) {
+      digestsByPath[path] = @[stamp, hex];
+    }
+  }
+  return hex;
+}
+
+static NSDictionary *XcodePreferences(void)
+{
+  static NSDictionary *preferences = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    preferences = [NSDictionary dictionaryWithContentsOfFile:
+                   [@"~/Library/Preferences/com.apple.dt.Xcode.plist" stringByExpandingTildeInPath]] ?: @{};
+  });
+  return preferences;
+}
+
+/**
+ * Returns the value that follows `option` in `arguments`, e.g. the path after
+ * "-project".
+ */
+static NSString *ArgumentValue(NSArray *arguments, NSString *option)
+{
+  NSUInteger index = [arguments indexOfObject:option];
+  if (index == NSNotFound || index + 1 >= arguments.count) {
+    return nil;
+  }
+  return arguments[index + 1];
+}
+
+/**
+ * Returns the workspace or project xcodebuild will read, as it would pick it.
+ */
+static NSString *ContainerPathForArguments(NSArray *arguments)
+{
+  NSString *containerPath = ArgumentValue(arguments, @"-workspace") ?: ArgumentValue(arguments, @"-project");
+  if (containerPath) {
+    return containerPath;
+  }
+
+  // Without either option, xcodebuild uses the project in the current directory.
+  NSString *currentDirectory = [[NSFileManager defaultManager] currentDirectoryPath];
+  for (NSString *name in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:currentDirectory error:nil]) {
+    if ([[name pathExtension] isEqualToString:@"xcodeproj"]) {
+      return name;
+    }
+  }
+  return nil;
+}
+
+static NSString *DerivedDataPathForArguments(NSArray *arguments)
+{
+  NSString *derivedDataPath = ArgumentValue(arguments, @"-derivedDataPath");
+  if (derivedDataPath) {
+    return AbsolutePathFromRelative(derivedDataPath);
+  }
+
+  NSString *location = XcodePreferences()[@"IDECustomDerivedDataLocation"];
+  if ([location isAbsolutePath]) {
+    return location;
+  } else if (location && ContainerPathForArguments(arguments)) {
+    // Relative locations are relative to the workspace or project.
+    NSString *containerDirectory = [AbsolutePathFromRelative(ContainerPathForArguments(arguments)) stringByDeletingLastPathComponent];
+    return [[containerDirectory stringByAppendingPathComponent:location] stringByStandardizingPath];
+  }
+  return [@"~/Library/Developer/Xcode/DerivedData" stringByExpandingTildeInPath];
+}
+
+/**
+ * Adds `path` and, recursively, the files it #includes.
+ */
+static void CollectXcconfigFile(NSString *path, NSMutableOrderedSet *paths)
+{
+  path = [path stringByStandardizingPath];
+  if ([paths containsObject:path]) {
+    return;
+  }
+  [paths addObject:path];
+
+  NSString *contents = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:nil];
+  for (NSString *line in [contents componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]]) {
+    NSString *directive = [line stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    if (![directive hasPrefix:@"#include"]) {
+      continue;
+    }
+    NSRange open = [directive rangeOfString:@"\""];
+    NSRange close = [directive rangeOfString:@"\"" options:NSBackwardsSearch];
+    if (open.location == NSNotFound || close.location <= open.location) {
+      continue;
+    }
+    NSString *includedPath = [directive substringWithRange:NSMakeRange(NSMaxRange(open), close.location - NSMaxRange(open))];
+    if ([includedPath hasPrefix:@"<"]) {
+      // e.g. "<DEVELOPER_DIR>/...", which is covered by the Xcode part of the key.
+      continue;
+    }
+    if (![includedPath isAbsolutePath]) {
+      includedPath = [[path stringByDeletingLastPathComponent] stringByAppendingPathComponent:includedPath];
+    }
+    CollectXcconfigFile(includedPath, paths);
+  }
+}
+
+/**
+ * Adds a workspace's (or a project's embedded workspace's) settings, which
+ * can change the build location.
+ */
+static void CollectWorkspaceSettingsFiles(NSString *workspacePath, NSMutableOrderedSet *paths)
+{
+  [paths addObject:[workspacePath stringByAppendingPathComponent:@"xcshareddata/WorkspaceSettings.xcsettings"]];
+  [paths addObject:[NSString pathWithComponents:@[
+    workspacePath,
+    @"xcuserdata",
+    [NSUserName() stringByAppendingPathExtension:@"xcuserdatad"],
+    @"WorkspaceSettings.xcsettings",
+  ]]];
+}
+
+/**
+ * Lists the files build settings of the workspace or project are read from.
+ */
+static NSArray *SettingsInputPathsForContainer(NSString *containerPath)
+{
+  NSMutableOrderedSet *paths = [NSMutableOrderedSet orderedSet];
+  NSArray *projectPaths = nil;
+
+  if ([[containerPath pathExtension] isEqualToString:@"xcworkspace"]) {
+    [paths addObject:[containerPath stringByAppendingPathComponent:@"contents.xcworkspacedata"]];
+    CollectWorkspaceSettingsFiles(containerPath, paths);
+    [paths addObjectsFromArray:[XcodeSubjectInfo schemePathsInContainer:containerPath]];
+    projectPaths = [XcodeSubjectInfo projectPathsInWorkspace:containerPath];
+  } else {
+    projectPaths = [[XcodeSubjectInfo projectPathsInProject:containerPath] setByAddingObject:containerPath].allObjects;
+  }
+
+  for (NSString *projectPath in [projectPaths sortedArrayUsingSelector:@selector(compare:)]) {
+    [paths addObject:[projectPath stringByAppendingPathComponent:@"project.pbxproj"]];
+    CollectWorkspaceSettingsFiles([projectPath stringByAppendingPathComponent:@"project.xcworkspace"], paths);
+    [paths addObjectsFromArray:[XcodeSubjectInfo schemePathsInContainer:projectPath]];
+    NSArray *xcconfigPaths = [XcconfigFilesReferencedInProjectAtPath(projectPath).allObjects
+                              sortedArrayUsingSelector:@selector(compare:)];
+    for (NSString *xcconfigPath in xcconfigPaths) {
+      CollectXcconfigFile(xcconfigPath, paths);
+    }
+  }
+
+  return [paths array];
+}
+
+/**
+ * Like SettingsInputPathsForContainer(), but only reads the workspace and
+ * projects again once one of the files they're listed from has changed.
+ */
+static NSArray *CachedSettingsInputPathsForContainer(NSString *containerPath)
+{
+  static NSMutableDictionary *entriesByContainer = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    entriesByContainer = [NSMutableDictionary dictionary];
+  });
+
+  NSString *(^listingStamp)(NSArray *) = ^(NSArray *paths) {
+    NSMutableString *stamp = [NSMutableString string];
+    for (NSString *path in paths) {
+      if ([[path lastPathComponent] isEqualToString:@"project.pbxproj"] ||
+          [[path lastPathComponent] isEqualToString:@"contents.xcworkspacedata"]) {
+        [stamp appendFormat:@"%@,", DigestForFile(path)];
+      }
+    }
+    return stamp;
+  };
+
+  @synchronized (entriesByContainer) {
+    NSArray *entry = entriesByContainer[containerPath];
+    if (entry && [listingStamp(entry[1]) isEqualToString:entry[0]]) {
+      return entry[1];
+    }
+  }
+
+  NSArray *paths = SettingsInputPathsForContainer(containerPath);
+  @synchronized (entriesByContainer) {
+    entriesByContainer[containerPath] = @[listingStamp(paths), paths];
+  }
+  return paths;
+}
+
+/**
+ * Identifies the xcodebuild and fastsettings shim in use.
+ */
+static NSString *ToolsIdentity(void)
+{
+  static NSString *identity = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    NSMutableArray *parts = [NSMutableArray arrayWithObjects:XcodeDeveloperDirPath(), XcodebuildVersion(), nil];
+    for (NSString *path in @[
+           [XcodeDeveloperDirPath() stringByAppendingPathComponent:@"usr/bin/xcodebuild"],
+           [XcodeDeveloperDirPath() stringByAppendingPathComponent:@"../Info.plist"],
+           [XCToolLibPath() stringByAppendingPathComponent:@"xcodebuild-fastsettings-shim.dylib"],
+         ]) {
+      NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil];
+      [parts addObject:[NSString stringWithFormat:@"%@:%llu:%f",
+                        [path lastPathComponent],
+                        [attributes fileSize],
+                        [[attributes fileModificationDate] timeIntervalSince1970]]];
+    }
+    identity = [parts componentsJoinedByString:@","];
+  });
+  return identity;
+}
+
+@implementation BuildSettingsCache
+
++ (instancetype)cacheForXcodebuildArguments:(NSArray *)arguments
+{
+  if (IsRunningUnderTest() ||
+      [[NSProcessInfo processInfo] environment][@"XCTOOL_DISABLE_BUILD_SETTINGS_CACHE"] != nil) {
+    return nil;
+  }
+
+  // One instance per directory, so that each is pruned only once per run.
+  static NSMutableDictionary *cachesByDirectory = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    cachesByDirectory = [NSMutableDictionary dictionary];
+  });
+
+  NSString *directory = [DerivedDataPathForArguments(arguments) stringByAppendingPathComponent:@"xctool/build-settings"];
+  @synchronized (cachesByDirectory) {
+    if (cachesByDirectory[directory] == nil) {
+      cachesByDirectory[directory] = [[BuildSettingsCache alloc] initWithDirectory:directory];
+    }
+    return cachesByDirectory[directory];
+  }
+}
+
+- (instancetype)initWithDirectory:(NSString *)directory
+{
+  return [super initWithDirectory:directory maxEntryAge:kBuildSettingsCacheMaxEntryAge];
+}
+
+- (NSString *)keyForXcodebuildArguments:(NSArray *)arguments
+                            environment:(NSDictionary *)environment
+{
+  CC_SHA256_CTX context;
+  CC_SHA256_Init(&context);
+  UpdateDigestWithString(&context, kBuildSettingsCacheVersion);
+  UpdateDigestWithString(&context, ToolsIdentity());
+  UpdateDigestWithString(&context, [[NSFileManager defaultManager] currentDirectoryPath]);
+
+  UpdateDigestWithString(&context, [NSString stringWithFormat:@"%lu arguments", (unsigned long)arguments.count]);
+  for (NSString *argument in arguments) {
+    UpdateDigestWithString(&context, argument);
+  }
+  for (NSString *name in [[environment allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+    UpdateDigestWithString(&context, [NSString stringWithFormat:@"%@=%@", name, environment[name]]);
+  }
+
+  // Preferences that move the build folders and so the paths in the settings.
+  for (NSString *name in @[@"IDECustomDerivedDataLocation",
+                           @"IDEBuildLocationStyle",
+                           @"IDECustomBuildLocationType",
+                           @"IDECustomBuildProductsPath",
+                           @"IDECustomBuildIntermediatesPath",
+                           @"IDESharedBuildFolderName"]) {
+    UpdateDigestWithString(&context, [NSString stringWithFormat:@"%@=%@", name, XcodePreferences()[name] ?: @""]);
+  }
+
+  NSMutableOrderedSet *inputPaths = [NSMutableOrderedSet orderedSet];
+  NSString *containerPath = ContainerPathForArguments(arguments);
+  if (containerPath) {
+    [inputPaths addObjectsFromArray:CachedSettingsInputPathsForContainer(AbsolutePathFromRelative(containerPath))];
+  }
+
+  // xcconfigs that override every target's settings, and what they include.
+  NSString *overridingXcconfigPath = ArgumentValue(arguments, @"-xcconfig");
+  if (overridingXcconfigPath) {
+    CollectXcconfigFile(AbsolutePathFromRelative(overridingXcconfigPath), inputPaths);
+  }
+  NSString *environmentXcconfigPath = (environment ?: [[NSProcessInfo processInfo] environment])[@"XCODE_XCCONFIG_FILE"];
+  if (environmentXcconfigPath) {
+    CollectXcconfigFile(AbsolutePathFromRelative(environmentXcconfigPath), inputPaths);
+  }
+
+  for (NSString *path in inputPaths) {
+    UpdateDigestWithString(&context, [NSString stringWithFormat:@"%@=%@", path, DigestForFile(path)]);
+  }
+
+  uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256_Final(digest, &context);
+  return HexStringForDigest(digest, sizeof(digest));
+}
+
+- (NSDictionary *)buildSettingsForKey:(NSString *)key
+{
+  NSDictionary *buildSettings = [self JSONObjectForKey:key];
+  if (![buildSettings isKindOfClass:[NSDictionary class]] || buildSettings.count == 0) {
+    return nil;
+  }
+  for (NSString *target in buildSettings) {
+    if (![buildSettings[target] isKindOfClass:[NSDictionary class]]) {
+      return nil;
+    }
+  }
+  return buildSettings;
+}
+
+- (void)setBuildSettings:(NSDictionary *)buildSettings forKey:(NSString *)key
+{
+  [self setJSONObject:buildSettings forKey:key];
+}
+
+@end
+
+NSDictionary *LaunchShowBuildSettingsTaskUsingCache(NSTask *task,
+                                                    NSString *description,
+                                                    NSDictionary **output)
+{
+  BuildSettingsCache *cache = [BuildSettingsCache cacheForXcodebuildArguments:task.arguments];
+  NSString *key = [cache keyForXcodebuildArguments:task.arguments environment:task.environment];
+  NSDictionary *buildSettings = key ? [cache buildSettingsForKey:key] : nil;
+  if (buildSettings) {
+    if (output) {
+      *output = @{@"stdout" : @"", @"stderr" : @""};
+    }
+    return buildSettings;
+  }
+
+  NSDictionary *taskOutput = LaunchTaskAndCaptureOutput(task, description);
+  buildSettings = BuildSettingsFromOutput(taskOutput[@"stdout"]);
+  if (key && buildSettings.count > 0) {
+    [cache setBuildSettings:buildSettings forKey:key];
+  }
+  if (output) {
+    *output = taskOutput;
+  }
+  return buildSettings;
+}
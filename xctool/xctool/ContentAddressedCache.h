@@ -0,0 +1,55 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <CommonCrypto/CommonDigest.h>
+#import <Foundation/Foundation.h>
+
+/**
+ * Directory of JSON entries named after content-addressed keys, which
+ * subclasses derive from whatever their entries depend on.  A changed input
+ * yields a new key, so stale entries are simply never looked up again.
+ *
+ * Entries are touched whenever they're read, and the first write of a run
+ * deletes entries that haven't been read or written for `maxEntryAge`.
+ */
+@interface ContentAddressedCache : NSObject
+
+- (instancetype)initWithDirectory:(NSString *)directory
+                      maxEntryAge:(NSTimeInterval)maxEntryAge;
+
+/**
+ * Returns the decoded entry for `key`, or nil on a miss.
+ */
+- (id)JSONObjectForKey:(NSString *)key;
+
+/**
+ * Writes the entry for `key`.  The cache is best effort, so failing to write
+ * is ignored.
+ */
+- (void)setJSONObject:(id)object forKey:(NSString *)key;
+
+@end
+
+/**
+ * Feeds `string` and a newline to `context`, so that consecutive strings
+ * can't run together.
+ */
+void UpdateDigestWithString(CC_SHA256_CTX *context, NSString *string);
+
+/**
+ * Returns `digest` as a lowercase hex string, e.g. for use as a cache key.
+ */
+NSString *HexStringForDigest(const uint8_t *digest, size_t length);
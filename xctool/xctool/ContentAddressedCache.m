@@ -0,0 +1,113 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "ContentAddressedCache.h"
+
+@interface ContentAddressedCache ()
+@property (nonatomic, copy) NSString *directory;
+@property (nonatomic, assign) NSTimeInterval maxEntryAge;
+@property (nonatomic, assign) BOOL pruned;
+@end
+
+@implementation ContentAddressedCache
+
+- (instancetype)initWithDirectory:(NSString *)directory
+                      maxEntryAge:(NSTimeInterval)maxEntryAge
+{
+  if (self = [super init]) {
+    _directory = [directory copy];
+    _maxEntryAge = maxEntryAge;
+  }
+  return self;
+}
+
+- (NSString *)pathForKey:(NSString *)key
+{
+  return [_directory stringByAppendingPathComponent:[key stringByAppendingPathExtension:@"json"]];
+}
+
+- (id)JSONObjectForKey:(NSString *)key
+{
+  NSString *path = [self pathForKey:key];
+  NSData *data = [NSData dataWithContentsOfFile:path];
+  if (data == nil) {
+    return nil;
+  }
+
+  id object = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+  if (object == nil) {
+    return nil;
+  }
+
+  // Keep entries that are still in use from being pruned.
+  [[NSFileManager defaultManager] setAttributes:@{NSFileModificationDate: [NSDate date]}
+                                   ofItemAtPath:path
+                                          error:nil];
+  return object;
+}
+
+- (void)setJSONObject:(id)object forKey:(NSString *)key
+{
+  NSData *data = [NSJSONSerialization dataWithJSONObject:object options:0 error:nil];
+  if (data == nil) {
+    return;
+  }
+
+  [[NSFileManager defaultManager] createDirectoryAtPath:_directory
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+  [data writeToFile:[self pathForKey:key] atomically:YES];
+
+  [self pruneStaleEntries];
+}
+
+- (void)pruneStaleEntries
+{
+  @synchronized (self) {
+    if (_pruned) {
+      return;
+    }
+    _pruned = YES;
+  }
+
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSDate *cutoff = [NSDate dateWithTimeIntervalSinceNow:-_maxEntryAge];
+  for (NSString *name in [fileManager contentsOfDirectoryAtPath:_directory error:nil]) {
+    NSString *path = [_directory stringByAppendingPathComponent:name];
+    NSDate *modified = [[fileManager attributesOfItemAtPath:path error:nil] fileModificationDate];
+    if (modified && [modified compare:cutoff] == NSOrderedAscending) {
+      [fileManager removeItemAtPath:path error:nil];
+    }
+  }
+}
+
+@end
+
+void UpdateDigestWithString(CC_SHA256_CTX *context, NSString *string)
+{
+  NSData *data = [[string stringByAppendingString:@"\n"] dataUsingEncoding:NSUTF8StringEncoding];
+  CC_SHA256_Update(context, data.bytes, (CC_LONG)data.length);
+}
+
+NSString *HexStringForDigest(const uint8_t *digest, size_t length)
+{
+  NSMutableString *output = [NSMutableString stringWithCapacity:length * 2];
+  for (size_t i = 0; i < length; i++) {
+    [output appendFormat:@"%02x", digest[i]];
+  }
+  return output;
+}
@@ -15,17 +15,35 @@
 
 #import "EventSink.h"
 
+/*!
+ Bytes of events a buffer keeps in memory unless told otherwise.
+ */
+extern const NSUInteger kEventBufferDefaultMemoryLimit;
+
 /*!
  Buffers calls to the underlying sink until this buffer is flushed.
+
+ Only the first `memoryLimit` bytes of events are kept in memory; the rest are
+ appended to a temporary file and streamed to the sink from there on flush, so
+ a bucket with huge output doesn't have to fit in RAM.
  */
 @interface EventBuffer : NSObject <EventSink>
 
+/*!
+ Defaults to kEventBufferDefaultMemoryLimit.  Events spilled to disk reach the
+ sink the same way as those kept in memory: with -publishEvent:data: if they
+ were published with their event and the sink takes events, otherwise with
+ -publishDataForEvent:.
+ */
+@property (nonatomic, assign) NSUInteger memoryLimit;
+
 + (instancetype)eventBufferForSink:(id<EventSink>)sink;
 
 /*!
  Convenience function that wraps an array of Reporters with BufferedReporters.
  */
 + (NSArray *)wrapSinks:(NSArray *)sinks;
++ (NSArray *)wrapSinks:(NSArray *)sinks memoryLimit:(NSUInteger)memoryLimit;
 
 /*!
  Atomically flush all events into the underlying reporter
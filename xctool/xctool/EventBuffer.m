@@ -16,21 +16,40 @@
 
 #import "EventBuffer.h"
 
+#import "ReportStatus.h"
 #import "XCToolUtil.h"
 
+const NSUInteger kEventBufferDefaultMemoryLimit = 16 * 1024 * 1024;
+
 @interface EventBuffer () {
   id<EventSink> _underlyingSink;
   NSMutableArray *_bufferedEventData;
+  // Parallel to _bufferedEventData: the decoded event, or NSNull if it was
+  // published as data only.
+  NSMutableArray *_bufferedEvents;
+  NSUInteger _bufferedByteCount;
+  // Events that didn't fit in memory, each as a uint32_t length, a uint8_t
+  // that's 1 if it was published with its event, and the data, in a temporary
+  // file that's already been unlinked.  They all come after the ones in memory.
+  FILE *_spillFile;
+  BOOL _spillFailed;
 }
 @end
 
 @implementation EventBuffer
 
 + (NSArray *)wrapSinks:(NSArray *)sinks
+{
+  return [self wrapSinks:sinks memoryLimit:kEventBufferDefaultMemoryLimit];
+}
+
++ (NSArray *)wrapSinks:(NSArray *)sinks memoryLimit:(NSUInteger)memoryLimit
 {
   NSMutableArray *buffers = [NSMutableArray arrayWithCapacity:sinks.count];
   for (id<EventSink> sink in sinks) {
-    [buffers addObject:[EventBuffer eventBufferForSink:sink]];
+    EventBuffer *buffer = [EventBuffer eventBufferForSink:sink];
+    buffer.memoryLimit = memoryLimit;
+    [buffers addObject:buffer];
   }
   return buffers;
 }
@@ -46,38 +65,167 @@
 {
   if (self = [super init]) {
     _bufferedEventData = [[NSMutableArray alloc] init];
+    _bufferedEvents = [[NSMutableArray alloc] init];
+    _memoryLimit = kEventBufferDefaultMemoryLimit;
   }
   return self;
 }
 
+- (void)dealloc
+{
+  if (_spillFile != NULL) {
+    fclose(_spillFile);
+  }
+}
 
-- (void)publishDataForEvent:(NSData *)data
+- (void)stopSpillingWithReason:(NSString *)reason
+{
+  _spillFailed = YES;
+  // This goes into the buffer like any other event, so the sink hears about
+  // it in order, when the bucket is flushed.
+  ReportStatusMessage(@[self], REPORTER_MESSAGE_WARNING,
+                      @"Failed to buffer events on disk (%@), keeping them in memory instead.", reason);
+}
+
+- (BOOL)spillData:(NSData *)data hasEvent:(BOOL)hasEvent
 {
+  if (_spillFile == NULL) {
+    NSString *path = MakeTempFileWithPrefix(@"event-buffer");
+    _spillFile = fopen([path fileSystemRepresentation], "w+");
+    int openErrno = errno;
+    unlink([path fileSystemRepresentation]);
+    if (_spillFile == NULL) {
+      [self stopSpillingWithReason:@(strerror(openErrno))];
+      return NO;
+    }
+  }
+
+  uint32_t length = (uint32_t)[data length];
+  uint8_t hasEventFlag = hasEvent ? 1 : 0;
+  if (fwrite(&length, sizeof(length), 1, _spillFile) == 1 &&
+      fwrite(&hasEventFlag, sizeof(hasEventFlag), 1, _spillFile) == 1 &&
+      fwrite([data bytes], 1, length, _spillFile) == length) {
+    return YES;
+  }
+
+  // Most likely out of disk space.  Take back what was spilled so far, since
+  // the events that follow will have to stay in memory after it.
+  NSString *reason = @(strerror(errno));
+  [self enumerateSpilledEventDataUsingBlock:^(NSData *spilledData, NSDictionary *event) {
+    [_bufferedEventData addObject:spilledData];
+    [_bufferedEvents addObject:event ?: (id)[NSNull null]];
+    _bufferedByteCount += [spilledData length];
+  } decodingEvents:YES];
+  fclose(_spillFile);
+  _spillFile = NULL;
+  [self stopSpillingWithReason:reason];
+  return NO;
+}
+
+/**
+ * Calls `block` with each spilled event's data and, if `decodeEvents` is YES
+ * and it was published with one, the event.
+ */
+- (void)enumerateSpilledEventDataUsingBlock:(void (^)(NSData *data, NSDictionary *event))block
+                             decodingEvents:(BOOL)decodeEvents
+{
+  if (_spillFile == NULL) {
+    return;
+  }
+
+  rewind(_spillFile);
+  uint32_t length = 0;
+  uint8_t hasEventFlag = 0;
+  while (fread(&length, sizeof(length), 1, _spillFile) == 1 &&
+         fread(&hasEventFlag, sizeof(hasEventFlag), 1, _spillFile) == 1) {
+    @autoreleasepool {
+      NSMutableData *data = [NSMutableData dataWithLength:length];
+      if (fread([data mutableBytes], 1, length, _spillFile) != length) {
+        // Only a record cut short by a failed write can end early.
+        break;
+      }
+      NSDictionary *event = nil;
+      if (decodeEvents && hasEventFlag) {
+        event = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+      }
+      block(data, event);
+    }
+  }
+  fseek(_spillFile, 0, SEEK_END);
+}
+
+- (void)bufferData:(NSData *)data event:(id)event
+{
+  // Once anything is on disk, everything after it has to go there too.
+  if (!_spillFailed && (_spillFile != NULL || _bufferedByteCount + [data length] > _memoryLimit)) {
+    if ([self spillData:data hasEvent:(event != [NSNull null])]) {
+      return;
+    }
+  }
+
   [_bufferedEventData addObject:data];
+  [_bufferedEvents addObject:event];
+  _bufferedByteCount += [data length];
+}
+
+- (void)publishDataForEvent:(NSData *)data
+{
+  [self bufferData:data event:[NSNull null]];
+}
+
+- (void)publishEvent:(NSDictionary *)event data:(NSData *)data
+{
+  [self bufferData:data event:[event copy]];
 }
 
 - (void)flush
 {
+  BOOL sinkTakesEvents = [_underlyingSink respondsToSelector:@selector(publishEvent:data:)];
+
   @synchronized(_underlyingSink) {
-    for (NSData *data in _bufferedEventData) {
-      [_underlyingSink publishDataForEvent:data];
-    }
+    [_bufferedEventData enumerateObjectsUsingBlock:^(NSData *data, NSUInteger idx, BOOL *stop) {
+      id event = _bufferedEvents[idx];
+      if (sinkTakesEvents && event != [NSNull null]) {
+        [_underlyingSink publishEvent:event data:data];
+      } else {
+        [_underlyingSink publishDataForEvent:data];
+      }
+    }];
+    // Spilled events go out the same way as the ones kept in memory, so
+    // sinks that filter on the event still get to.
+    [self enumerateSpilledEventDataUsingBlock:^(NSData *data, NSDictionary *event) {
+      if (event) {
+        [_underlyingSink publishEvent:event data:data];
+      } else {
+        [_underlyingSink publishDataForEvent:data];
+      }
+    } decodingEvents:sinkTakesEvents];
   }
   [_bufferedEventData removeAllObjects];
+  [_bufferedEvents removeAllObjects];
+  _bufferedByteCount = 0;
+  if (_spillFile != NULL) {
+    fclose(_spillFile);
+    _spillFile = NULL;
+  }
 }
 
 - (NSArray *)events
 {
   NSMutableArray *result = [NSMutableArray array];
 
-  for (NSData *data in _bufferedEventData) {
+  void (^addEvent)(NSData *, NSDictionary *) = ^(NSData *data, NSDictionary *decodedEvent) {
     NSError *error = nil;
     NSDictionary *event = [NSJSONSerialization JSONObjectWithData:data
                                                           options:0
                                                             error:&error];
     NSAssert(event != nil, @"Error encoding JSON: %@", [error localizedFailureReason]);
     [result addObject:event];
+  };
+  for (NSData *data in _bufferedEventData) {
+    addEvent(data, nil);
   }
+  [self enumerateSpilledEventDataUsingBlock:addEvent decodingEvents:NO];
 
   return result;
 }
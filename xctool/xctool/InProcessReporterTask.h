@@ -0,0 +1,42 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "ReporterPlugin.h"
+#import "ReporterTask.h"
+
+/**
+ A reporter that runs inside xctool, loaded from a ReporterPlugin bundle.
+
+ Events are delivered as dictionaries on the same kind of writer thread and
+ bounded buffer that ReporterTask uses for reporter processes, so the
+ reporter never has to decode JSON.  Since queued events aren't encoded,
+ they can't be spilled to disk; a full buffer always blocks.
+ */
+@interface InProcessReporterTask : ReporterTask
+
+/**
+ Loads the reporters bundle that ships with xctool.  Returns nil if it isn't
+ installed, in which case the built-in reporters run as separate processes.
+ */
++ (Class<ReporterPlugin>)builtinReporterPlugin;
+
+- (instancetype)initWithPlugin:(Class<ReporterPlugin>)plugin
+                  reporterName:(NSString *)reporterName
+                    outputPath:(NSString *)outputPath;
+
+@end
@@ -0,0 +1,133 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "InProcessReporterTask.h"
+
+#import "Reporter.h"
+#import "ReporterTaskInternal.h"
+#import "XCToolUtil.h"
+
+static NSString *const kBuiltinReportersBundleName = @"BuiltinReporters.bundle";
+
+@interface InProcessReporterTask ()
+@property (nonatomic, strong) Class<ReporterPlugin> plugin;
+@property (nonatomic, strong) Reporter *reporter;
+@end
+
+@implementation InProcessReporterTask
+
++ (Class<ReporterPlugin>)builtinReporterPlugin
+{
+  static Class<ReporterPlugin> plugin = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    NSString *path = [XCToolReportersPath() stringByAppendingPathComponent:kBuiltinReportersBundleName];
+    NSBundle *bundle = [NSBundle bundleWithPath:path];
+    if (bundle == nil || [bundle objectForInfoDictionaryKey:kReporterPluginBundleKey] == nil) {
+      return;
+    }
+
+    // If the bundle can't be loaded (e.g. it was built for another
+    // architecture), the reporter executables next to it are used instead.
+    if (![bundle loadAndReturnError:NULL]) {
+      return;
+    }
+
+    Class principalClass = [bundle principalClass];
+    if ([principalClass conformsToProtocol:@protocol(ReporterPlugin)]) {
+      plugin = principalClass;
+    }
+  });
+  return plugin;
+}
+
+- (instancetype)initWithPlugin:(Class<ReporterPlugin>)plugin
+                  reporterName:(NSString *)reporterName
+                    outputPath:(NSString *)outputPath
+{
+  if (self = [super initWithReporterPath:reporterName outputPath:outputPath]) {
+    _plugin = plugin;
+  }
+  return self;
+}
+
+- (BOOL)openWithStandardOutput:(NSFileHandle *)standardOutput
+                 standardError:(NSFileHandle *)standardError
+                         error:(NSString **)error
+{
+  if (![self openOutputWithStandardOutput:standardOutput
+                            standardError:standardError
+                                    error:error]) {
+    return NO;
+  }
+
+  Class reporterClass = [_plugin reporterClassNamed:self.reporterPath
+                                       outputHandle:[self outputHandle]];
+  if (![reporterClass isSubclassOfClass:[Reporter class]]) {
+    *error = [NSString stringWithFormat:@"Reporter plugin %@ doesn't provide a reporter named '%@'.",
+              NSStringFromClass(_plugin), self.reporterPath];
+    return NO;
+  }
+
+  [self setSubscribedEvents:[reporterClass subscribedEvents]];
+
+  _reporter = [reporterClass reporterWithOutputHandle:[self outputHandle]];
+  [_reporter willBeginReporting];
+
+  [self startWriterThread];
+
+  [self setWasOpened:YES];
+  return YES;
+}
+
+- (void)close
+{
+  NSAssert([self wasOpened], @"Can't close without opening first.");
+
+  if ([self wasClosed]) {
+    return;
+  }
+  [self setWasClosed:YES];
+
+  [self finishWriting];
+  [_reporter didFinishReporting];
+  [self closeOutput];
+}
+
+- (void)publishDataForEvent:(NSData *)data
+{
+  NSError *error = nil;
+  NSDictionary *event = [NSJSONSerialization JSONObjectWithData:data options:0 error:&error];
+  NSAssert(event != nil, @"Failed to decode event with error: %@", [error localizedFailureReason]);
+  if ([self isSubscribedToEvent:event]) {
+    [self enqueueEvent:event];
+  }
+}
+
+- (void)publishEvent:(NSDictionary *)event data:(NSData *)data
+{
+  if ([self isSubscribedToEvent:event]) {
+    [self enqueueEvent:[event copy]];
+  }
+}
+
+- (BOOL)deliverEvent:(id)event
+{
+  [_reporter handleEvent:event];
+  return YES;
+}
+
+@end
@@ -16,6 +16,18 @@
 
 #import "OCEventState.h"
 
+@class OCTestEventState;
+
+/**
+ * Told about every change to a test's state, so that an owner (i.e.
+ * OCTestSuiteEventState) can keep indexes and counters up to date instead of
+ * rescanning all of its tests.
+ */
+@protocol OCTestEventStateObserver <NSObject>
+- (void)testEventStateWillChange:(OCTestEventState *)test;
+- (void)testEventStateDidChange:(OCTestEventState *)test;
+@end
+
 @interface OCTestEventState : OCEventState
 
 @property (nonatomic, copy, readonly) NSString *className;
@@ -25,6 +37,7 @@
 @property (nonatomic, readonly) BOOL isFinished;
 @property (nonatomic, readonly) BOOL isSuccessful;
 @property (nonatomic, assign) double duration;
+@property (nonatomic, weak) id<OCTestEventStateObserver> observer;
 
 
 /**
@@ -22,6 +22,7 @@
 #import "ReporterEvents.h"
 
 @interface OCTestEventState () {
+  NSString *_testName;
   CFTimeInterval _beginTime;
   NSMutableString *_outputToPublish;
   NSMutableString *_outputAlreadyPublished;
@@ -55,11 +56,12 @@
   NSAssert([parts count] == 2, @"Unable to parse input name `%@`", name);
   _className = [parts[0] copy];
   _methodName = [parts[1] copy];
+  _testName = [[NSString alloc] initWithFormat:@"-[%@ %@]", _className, _methodName];
 }
 
 - (NSString *)testName
 {
-  return [NSString stringWithFormat:@"-[%@ %@]", _className, _methodName];
+  return _testName;
 }
 
 - (BOOL)isRunning
@@ -74,8 +76,10 @@
 - (void)stateBeginTest
 {
   NSAssert(!_isStarted, @"Test should not have started yet.");
+  [_observer testEventStateWillChange:self];
   _isStarted = true;
   _beginTime = CACurrentMediaTime();
+  [_observer testEventStateDidChange:self];
 }
 
 - (void)stateEndTest:(BOOL)successful result:(NSString *)result
@@ -85,10 +89,19 @@
 
 - (void)stateEndTest:(BOOL)successful result:(NSString *)result duration:(double)duration
 {
+  [_observer testEventStateWillChange:self];
   _isFinished = true;
   _isSuccessful = successful;
   _duration = duration;
   _result = [result copy];
+  [_observer testEventStateDidChange:self];
+}
+
+- (void)setDuration:(double)duration
+{
+  [_observer testEventStateWillChange:self];
+  _duration = duration;
+  [_observer testEventStateDidChange:self];
 }
 
 - (void)stateTestOutput:(NSString *)output
@@ -17,7 +17,12 @@
 #import "OCEventState.h"
 #import "OCTestEventState.h"
 
-@interface OCTestSuiteEventState : OCEventState
+/**
+ * Tracks the tests of a suite.  Lookups by name, the running test and all
+ * counters are kept up to date as tests change state, so handling an event
+ * doesn't cost more for a bundle with many tests.
+ */
+@interface OCTestSuiteEventState : OCEventState <OCTestEventStateObserver>
 
 @property (nonatomic, copy, readonly) NSString *testName;
 @property (nonatomic, readonly) BOOL isStarted;
@@ -39,6 +44,8 @@
 - (NSArray *)unfinishedTests;
 - (OCTestEventState *)getTestWithTestName:(NSString *)name;
 - (unsigned int)testCount;
+- (unsigned int)unstartedTestCount;
+- (unsigned int)totalSuccesses;
 - (unsigned int)totalFailures;
 - (unsigned int)totalErrors;
 - (double)testDuration;
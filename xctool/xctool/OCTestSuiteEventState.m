@@ -22,6 +22,14 @@
 @interface OCTestSuiteEventState ()
 @property (nonatomic, assign) double totalDuration;
 @property (nonatomic, copy) NSDictionary *beginTestSuiteInfo;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, OCTestEventState *> *testsByName;
+@property (nonatomic, weak) OCTestEventState *currentTest;
+@property (nonatomic, assign) unsigned int startedCount;
+@property (nonatomic, assign) unsigned int finishedCount;
+@property (nonatomic, assign) unsigned int successCount;
+@property (nonatomic, assign) unsigned int failureCount;
+@property (nonatomic, assign) unsigned int errorCount;
+@property (nonatomic, assign) double summedTestDuration;
 @end
 
 @implementation OCTestSuiteEventState
@@ -38,6 +46,7 @@
   if (self) {
     _testName = [name copy];
     _tests = [[NSMutableArray alloc] init];
+    _testsByName = [[NSMutableDictionary alloc] init];
   }
   return self;
 }
@@ -132,12 +141,71 @@
 {
   test.reporters = self.reporters;
   [_tests insertObject:test atIndex:index];
+  [self startTrackingTest:test];
 }
 
 - (void)addTest:(OCTestEventState *)test
 {
   test.reporters = self.reporters;
   [_tests addObject:test];
+  [self startTrackingTest:test];
+}
+
+#pragma mark - Indexes and Counters
+
+- (void)startTrackingTest:(OCTestEventState *)test
+{
+  // If two tests share a name, lookups find the first one.
+  NSString *name = [test testName];
+  if (_testsByName[name] == nil) {
+    _testsByName[name] = test;
+  }
+  test.observer = self;
+  [self testEventStateDidChange:test];
+}
+
+- (void)testEventStateWillChange:(OCTestEventState *)test
+{
+  if (test.isStarted) {
+    _startedCount--;
+  }
+  if (test.isFinished) {
+    _finishedCount--;
+  }
+  if (test.isSuccessful) {
+    _successCount--;
+  }
+  if ([test.result isEqualToString:@"failure"]) {
+    _failureCount--;
+  } else if ([test.result isEqualToString:@"error"]) {
+    _errorCount--;
+  }
+  _summedTestDuration -= test.duration;
+  if (_currentTest == test) {
+    _currentTest = nil;
+  }
+}
+
+- (void)testEventStateDidChange:(OCTestEventState *)test
+{
+  if (test.isStarted) {
+    _startedCount++;
+  }
+  if (test.isFinished) {
+    _finishedCount++;
+  }
+  if (test.isSuccessful) {
+    _successCount++;
+  }
+  if ([test.result isEqualToString:@"failure"]) {
+    _failureCount++;
+  } else if ([test.result isEqualToString:@"error"]) {
+    _errorCount++;
+  }
+  _summedTestDuration += test.duration;
+  if ([test isRunning]) {
+    _currentTest = test;
+  }
 }
 
 - (void)addTestsFromArray:(NSArray *)tests
@@ -152,19 +220,14 @@
 
 - (OCTestEventState *)runningTest
 {
-  NSUInteger idx = [_tests indexOfObjectPassingTest:^(OCTestEventState *test, NSUInteger index, BOOL *stop) {
-    return [test isRunning];
-  }];
-
-  if (idx == NSNotFound) {
-    return nil;
-  } else {
-    return _tests[idx];
-  }
+  return _currentTest;
 }
 
 - (NSArray *)unstartedTests
 {
+  if (_startedCount == _tests.count) {
+    return @[];
+  }
   return [_tests filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL (OCTestEventState *test, NSDictionary *bindings) {
     return ![test isStarted];
   }]];
@@ -172,6 +235,9 @@
 
 - (NSArray *)finishedTests
 {
+  if (_finishedCount == 0) {
+    return @[];
+  }
   return [_tests filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL (OCTestEventState *test, NSDictionary *bindings) {
     return [test isFinished];
   }]];
@@ -179,6 +245,9 @@
 
 - (NSArray *)unfinishedTests
 {
+  if (_finishedCount == _tests.count) {
+    return @[];
+  }
   return [_tests filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL (OCTestEventState *test, NSDictionary *bindings) {
     return ![test isFinished];
   }]];
@@ -186,28 +255,14 @@
 
 - (OCTestEventState *)getTestWithTestName:(NSString *)name
 {
-  NSUInteger idx = [_tests indexOfObjectPassingTest:^(OCTestEventState *test, NSUInteger index, BOOL *stop) {
-    return [[test testName] isEqualToString:name];
-  }];
-
-  if (idx == NSNotFound) {
-    return nil;
-  } else {
-    return _tests[idx];
-  }
+  return _testsByName[name];
 }
 
 #pragma mark - Counter Methods
 
 - (double)testDuration
 {
-  double __block total = 0.0;
-
-  [_tests enumerateObjectsUsingBlock:^(OCTestEventState *state, NSUInteger idx, BOOL *stop) {
-     total += state.duration;
-   }];
-
-  return total;
+  return _summedTestDuration;
 }
 
 - (double)totalDuration
@@ -220,22 +275,24 @@
   return (unsigned int)[_tests count];
 }
 
-- (unsigned int)totalFailures
+- (unsigned int)unstartedTestCount
 {
-  NSArray *failedTests = [_tests filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL (OCTestEventState *test, NSDictionary *bindings) {
-    return [test.result isEqualToString:@"failure"];
-  }]];
+  return (unsigned int)[_tests count] - _startedCount;
+}
 
-  return (unsigned int)[failedTests count];
+- (unsigned int)totalSuccesses
+{
+  return _successCount;
 }
 
-- (unsigned int)totalErrors
+- (unsigned int)totalFailures
 {
-  NSArray *erroredTests = [_tests filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL (OCTestEventState *test, NSDictionary *bindings) {
-    return [test.result isEqualToString:@"error"];
-  }]];
+  return _failureCount;
+}
 
-  return (unsigned int)[erroredTests count];
+- (unsigned int)totalErrors
+{
+  return _errorCount;
 }
 
 @end
@@ -18,6 +18,15 @@
 
 #import "OCUnitTestRunner.h"
 
+@class SimulatorPool;
+
 @interface OCUnitIOSAppTestRunner : OCUnitTestRunner
 
+/**
+ * If set, tests run on a device leased from the pool for the duration of
+ * `-runTests` instead of on the simulator info's default device, and the test
+ * host is only installed if it isn't on that device already.
+ */
+@property (nonatomic, strong) SimulatorPool *simulatorPool;
+
 @end
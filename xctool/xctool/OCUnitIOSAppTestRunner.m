@@ -17,7 +17,9 @@
 #import "OCUnitIOSAppTestRunner.h"
 
 #import "ReportStatus.h"
+#import "SimDevice.h"
 #import "SimulatorInfo.h"
+#import "SimulatorPool.h"
 #import "SimulatorUtils.h"
 #import "SimulatorWrapper.h"
 #import "XcodeBuildSettings.h"
@@ -28,9 +30,35 @@ static const NSInteger kMaxRunTestsAttempts = 3;
 
 @implementation OCUnitIOSAppTestRunner
 
-- (void)runTestsAndFeedOutputTo:(FdOutputLineFeedBlock)outputLineBlock
+- (void)runTestsAndFeedOutputTo:(TestOutputFeedBlock)outputLineBlock
                    startupError:(NSString **)startupError
                     otherErrors:(NSString **)otherErrors
+{
+  if (_simulatorPool == nil) {
+    [self runTestsOnSimulatorAndFeedOutputTo:outputLineBlock
+                                startupError:startupError
+                                 otherErrors:otherErrors];
+    return;
+  }
+
+  SimDevice *device = [_simulatorPool leaseDevice];
+  [_simulatorInfo setDeviceUDID:device.UDID];
+  ReportStatusMessage(_reporters,
+                      REPORTER_MESSAGE_INFO,
+                      @"Running tests on pooled simulator '%@' (%@).",
+                      device.name,
+                      [device.UDID UUIDString]);
+
+  [self runTestsOnSimulatorAndFeedOutputTo:outputLineBlock
+                              startupError:startupError
+                               otherErrors:otherErrors];
+
+  [_simulatorPool returnDevice:device];
+}
+
+- (void)runTestsOnSimulatorAndFeedOutputTo:(TestOutputFeedBlock)outputLineBlock
+                              startupError:(NSString **)startupError
+                               otherErrors:(NSString **)otherErrors
 {
   NSString *sdkName = _buildSettings[Xcode_SDK_NAME];
   NSAssert([sdkName hasPrefix:@"iphonesimulator"] || [sdkName hasPrefix:@"appletvsimulator"], @"Unexpected SDK: %@", sdkName);
@@ -77,15 +105,19 @@ static const NSInteger kMaxRunTestsAttempts = 3;
                                @"Failed to shut down iOS Simulator with error: %@", shutdownError);
       }
 
-      ReportStatusMessageBegin(_reporters,
+      // Other buckets are still running on the rest of the pool's devices,
+      // so only the leased device is shut down.
+      if (_simulatorPool == nil) {
+        ReportStatusMessageBegin(_reporters,
+                                 REPORTER_MESSAGE_INFO,
+                                 @"Stopping any existing iOS simulator jobs to get a "
+                                 @"fresh simulator ...");
+        KillSimulatorJobs();
+        ReportStatusMessageEnd(_reporters,
                                REPORTER_MESSAGE_INFO,
-                               @"Stopping any existing iOS simulator jobs to get a "
-                               @"fresh simulator ...");
-      KillSimulatorJobs();
-      ReportStatusMessageEnd(_reporters,
-                             REPORTER_MESSAGE_INFO,
-                             @"Stopped any existing iOS simulator jobs to get a "
-                             @"fresh simulator.");
+                               @"Stopped any existing iOS simulator jobs to get a "
+                               @"fresh simulator.");
+      }
     }
 
     if (resetSimulator) {
@@ -94,6 +126,7 @@ static const NSInteger kMaxRunTestsAttempts = 3;
                                @"Resetting iOS simulator content and settings...");
       NSString *removedPath = nil;
       NSString *removeError = nil;
+      [_simulatorPool forgetInstalledTestHostsOnDevice:[_simulatorInfo simulatedDevice]];
       if (RemoveSimulatorContentAndSettings(_simulatorInfo, &removedPath, &removeError)) {
         if (removedPath) {
           ReportStatusMessageEnd(_reporters,
@@ -114,6 +147,14 @@ static const NSInteger kMaxRunTestsAttempts = 3;
       }
     }
 
+    // Simulator.app only follows a single device, so pooled devices are
+    // booted headlessly instead.
+    if (_simulatorPool) {
+      return [SimulatorWrapper bootDevice:[_simulatorInfo simulatedDevice]
+                                reporters:_reporters
+                                    error:error];
+    }
+
    if (![SimulatorWrapper prepareSimulator:[_simulatorInfo simulatedDevice]
                       newSimulatorInstance:_newSimulatorInstance
                                  reporters:_reporters
@@ -156,19 +197,31 @@ static const NSInteger kMaxRunTestsAttempts = 3;
     //
     // By making sure the app is already installed, we guarantee the environment
     // is always set correctly.
-    if (![SimulatorWrapper installTestHostBundleID:testHostBundleID
-                                    fromBundlePath:testHostBundlePath
-                                            device:_simulatorInfo.simulatedDevice
-                                         reporters:_reporters
-                                             error:error]) {
+    //
+    // Pooled devices keep their installs between buckets, so there the app
+    // only has to be installed the first time a bucket lands on the device.
+    BOOL (^installIfNeeded)(NSString *, NSString *, NSString **) = ^BOOL(NSString *bundleID, NSString *bundlePath, NSString **error) {
+      SimDevice *device = [_simulatorInfo simulatedDevice];
+      if (!_freshInstall &&
+          [_simulatorPool isTestHostBundleID:bundleID fromBundlePath:bundlePath installedOnDevice:device]) {
+        return YES;
+      }
+      if (![SimulatorWrapper installTestHostBundleID:bundleID
+                                      fromBundlePath:bundlePath
+                                              device:device
+                                           reporters:_reporters
+                                               error:error]) {
+        return NO;
+      }
+      [_simulatorPool setTestHostBundleID:bundleID fromBundlePath:bundlePath installedOnDevice:device];
+      return YES;
+    };
+
+    if (!installIfNeeded(testHostBundleID, testHostBundlePath, error)) {
       return NO;
     }
     if (testRunnerBundleID != nil && testRunnerBundlePath != nil &&
-        ![SimulatorWrapper installTestHostBundleID:testRunnerBundleID
-                                    fromBundlePath:testRunnerBundlePath
-                                            device:[_simulatorInfo simulatedDevice]
-                                         reporters:_reporters
-                                             error:error]) {
+        !installIfNeeded(testRunnerBundleID, testRunnerBundlePath, error)) {
       return NO;
     }
     return YES;
@@ -228,6 +281,7 @@ static const NSInteger kMaxRunTestsAttempts = 3;
                                                   arguments:appLaunchArgs
                                                 environment:appLaunchEnvironment
                                           feedOutputToBlock:outputLineBlock
+                                               cancellation:self.cancellation
                                                   reporters:_reporters
                                                       error:&error];
 
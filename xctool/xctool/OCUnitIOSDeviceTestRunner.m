@@ -21,7 +21,7 @@
 
 @implementation OCUnitIOSDeviceTestRunner
 
-- (void)runTestsAndFeedOutputTo:(FdOutputLineFeedBlock)outputLineBlock
+- (void)runTestsAndFeedOutputTo:(TestOutputFeedBlock)outputLineBlock
                    startupError:(NSString **)startupError
                     otherErrors:(NSString **)otherErrors
 {
@@ -26,6 +26,29 @@ static NSString * const DYLD_INSERT_LIBRARIES = @"DYLD_INSERT_LIBRARIES";
 @implementation OCUnitIOSLogicTestQueryRunner
 
 - (NSTask *)createTaskForQuery
+{
+  return [self createTaskForQueryWithEnvironment:@{
+    // The test bundle that we want to query from, as loaded by otest-query-lib-ios.dylib.
+    @"OtestQueryBundlePath" : [_simulatorInfo productBundlePath],
+  } bundlePaths:@[[_simulatorInfo productBundlePath]]];
+}
+
+- (NSTask *)createTaskForQueryOfBundlePaths:(NSArray *)bundlePaths
+{
+  // otest-query-lib takes the list of bundles separated by colons.
+  for (NSString *bundlePath in bundlePaths) {
+    if ([bundlePath rangeOfString:@":"].location != NSNotFound) {
+      return nil;
+    }
+  }
+
+  return [self createTaskForQueryWithEnvironment:@{
+    @"OtestQueryBundlePaths" : [bundlePaths componentsJoinedByString:@":"],
+  } bundlePaths:bundlePaths];
+}
+
+- (NSTask *)createTaskForQueryWithEnvironment:(NSDictionary *)queryEnvironment
+                                  bundlePaths:(NSArray *)bundlePaths
 {
   NSMutableDictionary *environment = nil;
   NSString *launchPath = nil;
@@ -33,21 +56,22 @@ static NSString * const DYLD_INSERT_LIBRARIES = @"DYLD_INSERT_LIBRARIES";
   if ([sdkName hasPrefix:@"iphonesimulator"]) {
     environment = IOSTestEnvironment(_simulatorInfo.buildSettings);
     environment[DYLD_INSERT_LIBRARIES] = [XCToolLibPath() stringByAppendingPathComponent:@"otest-query-lib-ios.dylib"];
-    IOSInsertSanitizerLibrariesIfNeeded(environment, [_simulatorInfo productBundlePath]);
+    for (NSString *bundlePath in bundlePaths) {
+      IOSInsertSanitizerLibrariesIfNeeded(environment, bundlePath);
+    }
     launchPath = [XCToolLibExecPath() stringByAppendingPathComponent:@"otest-query-ios"];
   } else if ([sdkName hasPrefix:@"appletvsimulator"]) {
     environment = TVOSTestEnvironment(_simulatorInfo.buildSettings);
     environment[DYLD_INSERT_LIBRARIES] = [XCToolLibPath() stringByAppendingPathComponent:@"otest-query-lib-appletv.dylib"];
-    TVOSInsertSanitizerLibrariesIfNeeded(environment, [_simulatorInfo productBundlePath]);
+    for (NSString *bundlePath in bundlePaths) {
+      TVOSInsertSanitizerLibrariesIfNeeded(environment, bundlePath);
+    }
     launchPath = [XCToolLibExecPath() stringByAppendingPathComponent:@"otest-query-appletv"];
   } else {
     NSAssert(false, @"'%@' sdk is not yet supported", sdkName);
   }
-  [environment addEntriesFromDictionary:@{
-    // The test bundle that we want to query from, as loaded by otest-query-lib-ios.dylib.
-    @"OtestQueryBundlePath" : [_simulatorInfo productBundlePath],
-    @"__CFPREFERENCES_AVOID_DAEMON" : @"YES",
-  }];
+  [environment addEntriesFromDictionary:queryEnvironment];
+  environment[@"__CFPREFERENCES_AVOID_DAEMON"] = @"YES";
 
   return CreateTaskForSimulatorExecutable(
     _simulatorInfo.buildSettings[Xcode_SDK_NAME],
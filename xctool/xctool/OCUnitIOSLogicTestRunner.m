@@ -17,6 +17,7 @@
 #import "OCUnitIOSLogicTestRunner.h"
 
 #import "NSConcreteTask.h"
+#import "OCUnitTestRunnerInternal.h"
 #import "SimDevice.h"
 #import "SimulatorInfo.h"
 #import "SimulatorTaskUtils.h"
@@ -113,7 +114,7 @@ static NSString * const XCTOOL_TMPDIR = @"TMPDIR";
                                           env);
 }
 
-- (void)runTestsAndFeedOutputTo:(FdOutputLineFeedBlock)outputLineBlock
+- (void)runTestsAndFeedOutputTo:(TestOutputFeedBlock)outputLineBlock
                    startupError:(NSString **)startupError
                     otherErrors:(NSString **)otherErrors
 {
@@ -127,13 +128,9 @@ static NSString * const XCTOOL_TMPDIR = @"TMPDIR";
 
   if (bundleExists) {
     @autoreleasepool {
-      NSString *otestShimOutputPath = nil;
-      NSTask *task = [self otestTaskWithTestBundle:testBundlePath otestShimOutputPath:&otestShimOutputPath];
-      LaunchTaskAndFeedSimulatorOutputAndOtestShimEventsToBlock(
-        task,
-        @"running otest/xctest on test bundle",
-        otestShimOutputPath,
-        outputLineBlock);
+      [self runOtestTaskCreatedBy:^(NSString **otestShimOutputPath){
+        return [self otestTaskWithTestBundle:testBundlePath otestShimOutputPath:otestShimOutputPath];
+      } feedOutputTo:outputLineBlock];
     }
   } else {
     *startupError = [NSString stringWithFormat:@"Test bundle not found at: %@", testBundlePath];
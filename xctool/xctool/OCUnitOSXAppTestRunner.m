@@ -18,13 +18,14 @@
 
 #import "ReportStatus.h"
 #import "TaskUtil.h"
+#import "TestCancellation.h"
 #import "TestingFramework.h"
 #import "XCToolUtil.h"
 #import "XcodeBuildSettings.h"
 
 @implementation OCUnitOSXAppTestRunner
 
-- (void)runTestsAndFeedOutputTo:(FdOutputLineFeedBlock)outputLineBlock
+- (void)runTestsAndFeedOutputTo:(TestOutputFeedBlock)outputLineBlock
                    startupError:(NSString **)startupError
                     otherErrors:(NSString **)otherErrors
 {
@@ -73,11 +74,13 @@
   }
 
   NSString *otestShimOutputPath = outputPath;
+  [self.cancellation addTask:task];
   LaunchTaskAndFeedSimulatorOutputAndOtestShimEventsToBlock(
     task,
     @"running otest/xctest on test bundle",
     otestShimOutputPath,
     outputLineBlock);
+  [self.cancellation removeTask:task];
 }
 
 @end
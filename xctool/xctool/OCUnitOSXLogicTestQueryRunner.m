@@ -36,6 +36,11 @@
 }
 
 - (NSTask *)createTaskForQuery
+{
+  return [self createTaskForQueryOfBundlePaths:@[[_simulatorInfo productBundlePath]]];
+}
+
+- (NSTask *)createTaskForQueryOfBundlePaths:(NSArray *)bundlePaths
 {
   NSMutableDictionary *environment = OSXTestEnvironment(_simulatorInfo.buildSettings);
   [environment addEntriesFromDictionary:@{
@@ -46,7 +51,9 @@
     @"OBJC_DISABLE_GC" : @"YES",
     @"__CFPREFERENCES_AVOID_DAEMON" : @"YES",
   }];
-  OSXInsertSanitizerLibrariesIfNeeded(environment, [_simulatorInfo productBundlePath]);
+  for (NSString *bundlePath in bundlePaths) {
+    OSXInsertSanitizerLibrariesIfNeeded(environment, bundlePath);
+  }
 
   NSString *taskLaunchPath = nil;
   NSMutableArray *taskArguments = [NSMutableArray array];
@@ -71,8 +78,8 @@
   } else {
     taskLaunchPath = otestQueryExecutablePath;
   }
-  // specify test bundle to query
-  [taskArguments addObject:[_simulatorInfo productBundlePath]];
+  // specify test bundles to query
+  [taskArguments addObjectsFromArray:bundlePaths];
 
   NSTask *task = CreateTaskInSameProcessGroup();
   [task setLaunchPath:taskLaunchPath];
@@ -17,6 +17,7 @@
 
 #import "OCUnitOSXLogicTestRunner.h"
 
+#import "OCUnitTestRunnerInternal.h"
 #import "TaskUtil.h"
 #import "TestingFramework.h"
 #import "XCToolUtil.h"
@@ -96,7 +97,7 @@ static NSString * const DYLD_INSERT_LIBRARIES = @"DYLD_INSERT_LIBRARIES";
   return task;
 }
 
-- (void)runTestsAndFeedOutputTo:(FdOutputLineFeedBlock)outputLineBlock
+- (void)runTestsAndFeedOutputTo:(TestOutputFeedBlock)outputLineBlock
                    startupError:(NSString **)startupError
                     otherErrors:(NSString **)otherErrors
 {
@@ -112,13 +113,9 @@ static NSString * const DYLD_INSERT_LIBRARIES = @"DYLD_INSERT_LIBRARIES";
 
   if (bundleExists) {
     @autoreleasepool {
-      NSString *otestShimOutputPath = nil;
-      NSTask *task = [self otestTaskWithTestBundle:testBundlePath otestShimOutputPath:&otestShimOutputPath];
-      LaunchTaskAndFeedSimulatorOutputAndOtestShimEventsToBlock(
-        task,
-        @"running otest/xctest on test bundle",
-        otestShimOutputPath,
-        outputLineBlock);
+      [self runOtestTaskCreatedBy:^(NSString **otestShimOutputPath){
+        return [self otestTaskWithTestBundle:testBundlePath otestShimOutputPath:otestShimOutputPath];
+      } feedOutputTo:outputLineBlock];
     }
   } else {
     *startupError = [NSString stringWithFormat:@"Test bundle not found at: %@", testBundlePath];
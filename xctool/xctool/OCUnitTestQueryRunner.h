@@ -29,4 +29,28 @@
 - (void)prepareToRunQuery;
 - (NSArray *)runQueryWithError:(NSString **)error;
 
+/**
+ * Creates a task that has otest-query list the tests of all of `bundlePaths`
+ * in one process.  Returns nil, the default, if this runner's bundles have to
+ * be queried on their own (e.g. because they're loaded into a test host).
+ */
+- (NSTask *)createTaskForQueryOfBundlePaths:(NSArray *)bundlePaths NS_RETURNS_RETAINED;
+
+/**
+ * YES if the bundle's tests can only be found by running otest-query, and
+ * it could share that otest-query with other bundles.
+ */
+- (BOOL)needsBatchableQuery;
+
+/**
+ * Lists the tests of each runner's bundle, as -runQueryWithError: would, but
+ * with one otest-query for all bundles that can be loaded side by side.  Any
+ * bundle that can't be listed by the shared process is queried on its own.
+ *
+ * @return An array parallel to `runners` holding each bundle's test cases,
+ *   or NSNull if they couldn't be queried; `errors` holds the matching error
+ *   messages (or NSNull).
+ */
++ (NSArray *)runQueriesWithRunners:(NSArray *)runners errors:(NSArray **)errors;
+
 @end
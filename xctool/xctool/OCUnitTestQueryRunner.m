@@ -17,14 +17,61 @@
 #import "OCUnitTestQueryRunner.h"
 
 #import "SimulatorInfo.h"
+#import "StaticTestQuery.h"
 #import "TaskUtil.h"
+#import "TestListCache.h"
 #import "XCToolUtil.h"
 #import "XcodeBuildSettings.h"
 
 @interface OCUnitTestQueryRunner ()
 @property (nonatomic, copy) SimulatorInfo *simulatorInfo;
+// What -testCasesWithoutQueryingWithCacheKey: found, so that deciding how to
+// query the bundle and then querying it only read the bundle once.
+@property (nonatomic, assign) BOOL lookedUpTestCasesWithoutQuerying;
+@property (nonatomic, copy) NSArray *testCasesKnownWithoutQuerying;
+@property (nonatomic, copy) NSString *testListCacheKey;
 @end
 
+/**
+ * Launches an otest-query task and returns the JSON it wrote.
+ */
+static id RunOtestQueryTask(NSTask *task, NSString **error)
+{
+  // specify a path where to write otest-query output
+  NSString *outputPath = MakeTempFileWithPrefix(@"otest-query-output");
+  NSMutableDictionary *taskEnvironment = [task.environment mutableCopy];
+  if ([[task.launchPath lastPathComponent] isEqual:@"simctl"]) {
+    taskEnvironment[@"SIMCTL_CHILD_OTEST_QUERY_OUTPUT_FILE"] = outputPath;
+  } else {
+    taskEnvironment[@"OTEST_QUERY_OUTPUT_FILE"] = outputPath;
+  }
+  task.environment = taskEnvironment;
+
+  NSDictionary *output = LaunchTaskAndCaptureOutput(task, @"running otest-query");
+
+  int terminationStatus = [task terminationStatus];
+  task = nil;
+
+  if (terminationStatus != 0) {
+    *error = [NSString stringWithFormat:@"\nstdout:\n%@\nstderr:\n%@", output[@"stdout"], output[@"stderr"]];
+    return nil;
+  } else {
+    NSData *data = [NSData dataWithContentsOfFile:outputPath];
+    NSString *jsonOutput = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+
+    NSError *parseError = nil;
+    id result = [NSJSONSerialization JSONObjectWithData:[jsonOutput dataUsingEncoding:NSUTF8StringEncoding]
+                                                options:0
+                                                  error:&parseError];
+    if (result == nil) {
+      *error = [NSString stringWithFormat:@"Error while parsing JSON: %@: %@.\nstdout:\n%@\nstderr:\n%@",
+                [parseError localizedFailureReason],
+                jsonOutput, output[@"stdout"], output[@"stderr"]];
+    }
+    return result;
+  }
+}
+
 @implementation OCUnitTestQueryRunner
 
 // Designated initializer.
@@ -45,61 +92,238 @@
 {
 }
 
-- (NSArray *)runQueryWithError:(NSString **)error
+- (NSTask *)createTaskForQueryOfBundlePaths:(NSArray *)bundlePaths NS_RETURNS_RETAINED
+{
+  return nil;
+}
+
+- (BOOL)validateBundleWithError:(NSString **)error
 {
   BOOL bundleIsDir = NO;
   BOOL bundleExists = [[NSFileManager defaultManager] fileExistsAtPath:[_simulatorInfo productBundlePath] isDirectory:&bundleIsDir];
   if (!IsRunningUnderTest() && !(bundleExists && bundleIsDir)) {
     *error = [NSString stringWithFormat:@"Test bundle not found at: %@", [_simulatorInfo productBundlePath]];
-    return nil;
+    return NO;
   }
 
   if ([_simulatorInfo testHostPath]) {
     if (![[NSFileManager defaultManager] isExecutableFileAtPath:[_simulatorInfo testHostPath]]) {
       *error = [NSString stringWithFormat:@"The test host executable is missing: '%@'", [_simulatorInfo testHostPath]];
-      return nil;
+      return NO;
     }
   }
 
+  return YES;
+}
+
+- (NSArray *)lookUpTestCasesWithoutQueryingWithCacheKey:(NSString **)cacheKey
+{
+  // Reading the bundle's objc metadata takes microseconds and, unlike running
+  // otest-query, never needs a simulator.  Under test, keep exercising the
+  // otest-query path that the fake tasks are set up for.
+  if (!IsRunningUnderTest()) {
+    NSArray *staticList = StaticallyQueryTestBundle([_simulatorInfo productBundlePath], NULL);
+    if (staticList) {
+      return staticList;
+    }
+  }
+
+  TestListCache *cache = [TestListCache sharedCache];
+  *cacheKey = [cache keyForQueryRunnerClass:[self class]
+                                 bundlePath:[_simulatorInfo productBundlePath]
+                               testHostPath:[_simulatorInfo testHostPath]
+                              buildSettings:[_simulatorInfo buildSettings]];
+  if (*cacheKey) {
+    return [cache testCasesForKey:*cacheKey];
+  }
+  return nil;
+}
+
+/**
+ * Returns the bundle's tests if they're known without running otest-query,
+ * otherwise sets `cacheKey` to where the query's result should be cached.
+ * Only the first call reads the bundle.
+ */
+- (NSArray *)testCasesWithoutQueryingWithCacheKey:(NSString **)cacheKey
+{
+  if (!_lookedUpTestCasesWithoutQuerying) {
+    NSString *key = nil;
+    _testCasesKnownWithoutQuerying = [[self lookUpTestCasesWithoutQueryingWithCacheKey:&key] copy];
+    _testListCacheKey = [key copy];
+    _lookedUpTestCasesWithoutQuerying = YES;
+  }
+  *cacheKey = _testListCacheKey;
+  return _testCasesKnownWithoutQuerying;
+}
+
+- (void)didQueryTestCases:(NSArray *)list cacheKey:(NSString *)cacheKey
+{
+  if (cacheKey) {
+    [[TestListCache sharedCache] setTestCases:list forKey:cacheKey];
+  }
+  _testCasesKnownWithoutQuerying = [list copy];
+}
+
+- (NSArray *)runQueryWithCacheKey:(NSString *)cacheKey error:(NSString **)error
+{
   [self prepareToRunQuery];
 
-  NSTask *task = [self createTaskForQuery];
+  NSArray *list = RunOtestQueryTask([self createTaskForQuery], error);
+  if (list) {
+    [self didQueryTestCases:list cacheKey:cacheKey];
+  }
+  return list;
+}
 
-  // specify a path where to write otest-query output
-  NSString *outputPath = MakeTempFileWithPrefix(@"otest-query-output");
-  NSMutableDictionary *taskEnvironment = [task.environment mutableCopy];
-  if ([[task.launchPath lastPathComponent] isEqual:@"simctl"]) {
-    taskEnvironment[@"SIMCTL_CHILD_OTEST_QUERY_OUTPUT_FILE"] = outputPath;
-  } else {
-    taskEnvironment[@"OTEST_QUERY_OUTPUT_FILE"] = outputPath;
+- (NSArray *)runQueryWithError:(NSString **)error
+{
+  if (![self validateBundleWithError:error]) {
+    return nil;
   }
-  task.environment = taskEnvironment;
 
-  NSDictionary *output = LaunchTaskAndCaptureOutput(task, @"running otest-query");
+  NSString *cacheKey = nil;
+  NSArray *list = [self testCasesWithoutQueryingWithCacheKey:&cacheKey];
+  if (list) {
+    return list;
+  }
 
-  int terminationStatus = [task terminationStatus];
-  task = nil;
+  return [self runQueryWithCacheKey:cacheKey error:error];
+}
 
-  if (terminationStatus != 0) {
-    *error = [NSString stringWithFormat:@"\nstdout:\n%@\nstderr:\n%@", output[@"stdout"], output[@"stderr"]];
+#pragma mark Batched queries
+
+/**
+ * Runners whose bundles can share an otest-query have equal keys: their query
+ * tasks only differ in which bundles they name.  Returns nil if the bundle
+ * has to be queried on its own.
+ */
+- (id)batchQueryKey
+{
+  NSString *bundlePath = [_simulatorInfo productBundlePath];
+  NSTask *task = [self createTaskForQueryOfBundlePaths:@[bundlePath]];
+  if (task == nil) {
     return nil;
-  } else {
-    NSData *data = [NSData dataWithContentsOfFile:outputPath];
-    NSString *jsonOutput = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+  }
 
-    NSError *parseError = nil;
-    NSArray *list = [NSJSONSerialization JSONObjectWithData:[jsonOutput dataUsingEncoding:NSUTF8StringEncoding]
-                                                    options:0
-                                                      error:&parseError];
-    if (list) {
-      return list;
-    } else {
-      *error = [NSString stringWithFormat:@"Error while parsing JSON: %@: %@.\nstdout:\n%@\nstderr:\n%@",
-                [parseError localizedFailureReason],
-                jsonOutput, output[@"stdout"], output[@"stderr"]];
-      return nil;
+  NSMutableArray *arguments = [task.arguments mutableCopy];
+  [arguments removeObject:bundlePath];
+  NSMutableDictionary *environment = [task.environment mutableCopy];
+  [environment removeObjectsForKeys:[environment allKeysForObject:bundlePath]];
+
+  return @[NSStringFromClass([self class]), task.launchPath ?: @"", arguments, environment];
+}
+
+- (BOOL)needsBatchableQuery
+{
+  NSString *error = nil;
+  NSString *cacheKey = nil;
+  return ([self validateBundleWithError:&error] &&
+          [self batchQueryKey] != nil &&
+          [self testCasesWithoutQueryingWithCacheKey:&cacheKey] == nil);
+}
+
+/**
+ * Returns the test cases of each bundle the shared query could list, keyed by
+ * bundle path.
+ */
++ (NSDictionary *)runBatchQueryWithRunners:(NSArray *)runners
+{
+  NSMutableArray *bundlePaths = [NSMutableArray array];
+  for (OCUnitTestQueryRunner *runner in runners) {
+    [bundlePaths addObject:[runner.simulatorInfo productBundlePath]];
+  }
+
+  OCUnitTestQueryRunner *firstRunner = runners[0];
+  [firstRunner prepareToRunQuery];
+
+  NSString *error = nil;
+  NSDictionary *output = RunOtestQueryTask([firstRunner createTaskForQueryOfBundlePaths:bundlePaths], &error);
+  if (![output isKindOfClass:[NSDictionary class]]) {
+    // otest-query crashed, most likely while loading one of the bundles.
+    return @{};
+  }
+
+  NSMutableDictionary *testCasesByBundlePath = [NSMutableDictionary dictionary];
+  for (NSString *bundlePath in bundlePaths) {
+    NSArray *testCases = output[bundlePath][@"tests"];
+    if ([testCases isKindOfClass:[NSArray class]]) {
+      testCasesByBundlePath[bundlePath] = testCases;
     }
   }
+  return testCasesByBundlePath;
+}
+
++ (NSArray *)runQueriesWithRunners:(NSArray *)runners errors:(NSArray **)errors
+{
+  NSMutableArray *results = [NSMutableArray array];
+  NSMutableArray *errorMessages = [NSMutableArray array];
+  NSMutableArray *cacheKeys = [NSMutableArray array];
+
+  // Batch key -> indexes of the runners that still have to be queried.
+  NSMutableDictionary *batches = [NSMutableDictionary dictionary];
+
+  [runners enumerateObjectsUsingBlock:^(OCUnitTestQueryRunner *runner, NSUInteger idx, BOOL *stop) {
+    [results addObject:[NSNull null]];
+    [errorMessages addObject:[NSNull null]];
+    [cacheKeys addObject:[NSNull null]];
+
+    NSString *error = nil;
+    if (![runner validateBundleWithError:&error]) {
+      errorMessages[idx] = error;
+      return;
+    }
+
+    NSString *cacheKey = nil;
+    NSArray *list = [runner testCasesWithoutQueryingWithCacheKey:&cacheKey];
+    if (list) {
+      results[idx] = list;
+      return;
+    }
+    if (cacheKey) {
+      cacheKeys[idx] = cacheKey;
+    }
+
+    id batchKey = [runner batchQueryKey] ?: @(idx);
+    if (batches[batchKey] == nil) {
+      batches[batchKey] = [NSMutableArray array];
+    }
+    [batches[batchKey] addObject:@(idx)];
+  }];
+
+  NSArray *batchList = [batches allValues];
+  dispatch_apply(batchList.count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t batchIndex) {
+    NSArray *indexes = batchList[batchIndex];
+    NSDictionary *batchResults = @{};
+    if (indexes.count > 1) {
+      NSMutableArray *batchRunners = [NSMutableArray array];
+      for (NSNumber *index in indexes) {
+        [batchRunners addObject:runners[[index unsignedIntegerValue]]];
+      }
+      batchResults = [self runBatchQueryWithRunners:batchRunners];
+    }
+
+    for (NSNumber *index in indexes) {
+      NSUInteger idx = [index unsignedIntegerValue];
+      OCUnitTestQueryRunner *runner = runners[idx];
+      NSString *cacheKey = cacheKeys[idx] == [NSNull null] ? nil : cacheKeys[idx];
+      NSString *error = nil;
+
+      NSArray *list = batchResults[[runner.simulatorInfo productBundlePath]];
+      if (list) {
+        [runner didQueryTestCases:list cacheKey:cacheKey];
+      } else {
+        list = [runner runQueryWithCacheKey:cacheKey error:&error];
+      }
+
+      @synchronized (results) {
+        results[idx] = list ?: [NSNull null];
+        errorMessages[idx] = error ?: [NSNull null];
+      }
+    }
+  });
+
+  *errors = errorMessages;
+  return results;
 }
 
 @end
@@ -20,6 +20,9 @@
 #import "TestRunState.h"
 #import "TestingFramework.h"
 
+@class TestCancellation;
+@class WarmTestWorkerPool;
+
 @interface OCUnitTestRunner : NSObject {
 @protected
   NSDictionary *_buildSettings;
@@ -42,6 +45,34 @@
 
 @property (nonatomic, copy, readonly) NSArray *reporters;
 
+/**
+ * If set, logic tests run on a long-lived process from this pool (launching
+ * one if none is idle) rather than in a process of their own.
+ */
+@property (nonatomic, strong) WarmTestWorkerPool *warmTestWorkerPool;
+
+/**
+ * If set, test processes are registered with it so they can be killed, and
+ * once it's cancelled the remaining tests are reported as cancelled rather
+ * than run.
+ */
+@property (nonatomic, strong) TestCancellation *cancellation;
+
+/**
+ * Number of times a failing test is run again, each time in a fresh process,
+ * before it's reported as failed.  A test that passes on a retry is reported
+ * as a (flaky) success.
+ */
+@property (nonatomic, assign) NSUInteger retryFailureCount;
+
+/**
+ * If non-zero, a crash that happens between tests is bisected: the tests
+ * that ran before it are rerun in halves, in fresh processes, to find the one
+ * that leaves the process in a state to crash.  At most this many extra
+ * processes are launched over the life of the runner.
+ */
+@property (nonatomic, assign) NSUInteger crashBisectionLaunchLimit;
+
 /**
  * Filters a list of test cases by removing test cases with names matching
  * `skippedTestCases` constraints and, if set, all tests cases not matching
@@ -16,10 +16,14 @@
 
 #import <QuartzCore/QuartzCore.h>
 
+#import "EventFraming.h"
 #import "OCUnitTestRunner.h"
 #import "OCUnitTestRunnerInternal.h"
 #import "ReportStatus.h"
+#import "TestCancellation.h"
+#import "TestRetryBuffer.h"
 #import "TestRunState.h"
+#import "WarmTestWorkerPool.h"
 #import "XcodeBuildSettings.h"
 #import "XCTestConfiguration.h"
 #import "XCToolUtil.h"
@@ -42,6 +46,9 @@ static NSString * const kEnvVarPassThroughPrefix = @"XCTOOL_TEST_ENV_";
 @property (nonatomic, copy, readwrite) NSArray *reporters;
 @property (nonatomic, copy) NSDictionary *framework;
 @property (nonatomic, copy) NSDictionary *processEnvironment;
+@property (nonatomic, copy) NSString *warmTestWorkerControlPath;
+@property (nonatomic, assign) BOOL usedWarmTestWorker;
+@property (nonatomic, assign) NSUInteger crashBisectionLaunchCount;
 @end
 
 @implementation OCUnitTestRunner
@@ -176,7 +183,7 @@ static NSString * const kEnvVarPassThroughPrefix = @"XCTOOL_TEST_ENV_";
 }
 
 
-- (void)runTestsAndFeedOutputTo:(FdOutputLineFeedBlock)outputLineBlock
+- (void)runTestsAndFeedOutputTo:(TestOutputFeedBlock)outputLineBlock
                    startupError:(NSString **)startupError
                     otherErrors:(NSString **)otherErrors
 {
@@ -184,21 +191,71 @@ static NSString * const kEnvVarPassThroughPrefix = @"XCTOOL_TEST_ENV_";
 }
 
 - (BOOL)runTests
+{
+  if (_retryFailureCount == 0) {
+    return [self runFocusedTestCasesReportingTo:_reporters testSuiteState:NULL];
+  }
+
+  // Each retry focuses on the tests that still fail; the original focus list
+  // is put back once we're done.
+  NSArray *focusedTestCases = _focusedTestCases;
+  TestRetryBuffer *retryBuffer = [[TestRetryBuffer alloc] initWithReporters:_reporters];
+  BOOL allTestsPassed = [self runFocusedTestCasesReportingTo:@[retryBuffer] testSuiteState:NULL];
+
+  // Placeholder tests for crashes and the like can't be run again.
+  NSSet *allTestCases = [NSSet setWithArray:_allTestCases];
+  for (NSUInteger retry = 0; retry < _retryFailureCount && ![_cancellation isCancelled]; retry++) {
+    NSArray *testCases = [[retryBuffer failedTestCases] filteredArrayUsingPredicate:
+                          [NSPredicate predicateWithBlock:^BOOL(NSString *testCase, NSDictionary *bindings) {
+      return [allTestCases containsObject:testCase];
+    }]];
+    if (testCases.count == 0) {
+      break;
+    }
+
+    // Retries are for our own bookkeeping; only the final outcome is reported.
+    _focusedTestCases = testCases;
+    OCTestSuiteEventState *retryState = nil;
+    [self runFocusedTestCasesReportingTo:@[] testSuiteState:&retryState];
+    if ([_cancellation isCancelled]) {
+      break;
+    }
+
+    NSSet *retriedTestCases = [NSSet setWithArray:testCases];
+    for (OCTestEventState *test in retryState.tests) {
+      NSString *testCase = [NSString stringWithFormat:@"%@/%@", test.className, test.methodName];
+      if ([retriedTestCases containsObject:testCase]) {
+        [retryBuffer recordAttemptOfTestCase:testCase
+                                   succeeded:test.isSuccessful
+                                      output:[test outputAlreadyPublished]];
+      }
+    }
+  }
+  _focusedTestCases = focusedTestCases;
+
+  allTestsPassed = allTestsPassed || [retryBuffer allFailedTestsPassedOnRetry];
+  [retryBuffer flush];
+  return allTestsPassed;
+}
+
+- (BOOL)runFocusedTestCasesReportingTo:(NSArray *)reporters
+                        testSuiteState:(OCTestSuiteEventState **)testSuiteStateOut
 {
   BOOL allTestsPassed = YES;
   OCTestSuiteEventState *testSuiteState = nil;
+  NSArray *focusedTestCases = _focusedTestCases;
 
-  while (!testSuiteState || [[testSuiteState unstartedTests] count]) {
+  while (!testSuiteState || [testSuiteState unstartedTestCount] > 0) {
     TestRunState *testRunState;
     if (!testSuiteState) {
-      testRunState = [[TestRunState alloc] initWithTests:_focusedTestCases reporters:_reporters];
+      testRunState = [[TestRunState alloc] initWithTests:_focusedTestCases reporters:reporters];
       testSuiteState = testRunState.testSuiteState;
     } else {
       testRunState = [[TestRunState alloc] initWithTestSuiteEventState:testSuiteState];
     }
 
-    FdOutputLineFeedBlock feedOutputToBlock = ^(int fd, NSString *line) {
-      [testRunState parseAndHandleEvent:line];
+    TestOutputFeedBlock feedOutputToBlock = ^(TestOutputType type, id output) {
+      [testRunState handleOutput:output ofType:type];
     };
 
     NSString *runTestsError = nil;
@@ -206,14 +263,33 @@ static NSString * const kEnvVarPassThroughPrefix = @"XCTOOL_TEST_ENV_";
 
     [testRunState prepareToRun];
 
-    [self runTestsAndFeedOutputTo:feedOutputToBlock
-                     startupError:&runTestsError
-                      otherErrors:&otherErrors];
+    BOOL cancelled = [_cancellation isCancelled];
+    if (!cancelled) {
+      [self runTestsAndFeedOutputTo:feedOutputToBlock
+                       startupError:&runTestsError
+                        otherErrors:&otherErrors];
+      cancelled = [_cancellation isCancelled];
+    }
+
+    if (!cancelled && [testRunState crashedBetweenTests] &&
+        _crashBisectionLaunchCount < _crashBisectionLaunchLimit) {
+      // Bisecting crashes more processes, whose reports aren't this run's.
+      [testRunState collectCrashReportsOfRun];
+      testRunState.crashDiagnosis = [self bisectCrashAfterTestCases:testRunState.testCasesFinishedInRun];
+    }
 
-    [testRunState didFinishRunWithStartupError:runTestsError otherErrors:otherErrors];
+    if (cancelled) {
+      [testRunState didCancelRunWithReason:[_cancellation reason]];
+    } else {
+      [testRunState didFinishRunWithStartupError:runTestsError otherErrors:otherErrors];
+    }
 
     allTestsPassed &= [testRunState allTestsPassed];
 
+    if (cancelled) {
+      break;
+    }
+
     // update focused test cases
     OCTestSuiteEventState *suiteState = [testRunState testSuiteState];
     NSArray *unstartedTests = [suiteState unstartedTests];
@@ -224,11 +300,115 @@ static NSString * const kEnvVarPassThroughPrefix = @"XCTOOL_TEST_ENV_";
 
     _focusedTestCases = unstartedTestCases;
   }
+  _focusedTestCases = focusedTestCases;
 
-
+  if (testSuiteStateOut) {
+    *testSuiteStateOut = testSuiteState;
+  }
   return allTestsPassed;
 }
 
+/**
+ * Runs `testCases` in a fresh process, reporting to no one, and returns YES if
+ * the process went away before the test suite finished.
+ */
+- (BOOL)testCasesCrashTestProcess:(NSArray *)testCases
+{
+  _crashBisectionLaunchCount++;
+
+  NSArray *focusedTestCases = _focusedTestCases;
+  _focusedTestCases = testCases;
+
+  TestRunState *testRunState = [[TestRunState alloc] initWithTests:testCases reporters:@[]];
+  NSString *startupError = nil;
+  NSString *otherErrors = nil;
+  [self runTestsAndFeedOutputTo:^(TestOutputType type, id output) {
+    [testRunState handleOutput:output ofType:type];
+  }
+                   startupError:&startupError
+                    otherErrors:&otherErrors];
+
+  _focusedTestCases = focusedTestCases;
+  return (startupError == nil &&
+          [testRunState.testSuiteState isStarted] &&
+          ![testRunState.testSuiteState isFinished]);
+}
+
+/**
+ * The process crashed after running `testCases` (in that order), between the
+ * last of them and whatever was to come next.  That's usually the fault of
+ * the last test, but it can also be the delayed effect of an earlier one
+ * (e.g. an over-release that blows up in a later autorelease pool drain).
+ *
+ * Keeps the last test and searches the ones before it for a smallest set
+ * that still reproduces the crash, halving the set on each step.  Returns a
+ * description of what was found, for the crash's placeholder test.
+ */
+- (NSString *)bisectCrashAfterTestCases:(NSArray *)testCases
+{
+  NSString *lastTestCase = [testCases lastObject];
+  NSArray *suspects = [testCases subarrayWithRange:NSMakeRange(0, testCases.count - 1)];
+  NSUInteger launchCountAtStart = _crashBisectionLaunchCount;
+
+  BOOL (^canLaunch)(void) = ^{
+    return (BOOL)(_crashBisectionLaunchCount < _crashBisectionLaunchLimit &&
+                  ![_cancellation isCancelled]);
+  };
+  NSString *(^describe)(NSString *) = ^(NSString *finding) {
+    return [NSString stringWithFormat:@"Crash bisection (%lu extra launch%@): %@",
+            (unsigned long)(_crashBisectionLaunchCount - launchCountAtStart),
+            (_crashBisectionLaunchCount - launchCountAtStart) == 1 ? @"" : @"es",
+            finding];
+  };
+
+  if ([self testCasesCrashTestProcess:@[lastTestCase]]) {
+    return describe([NSString stringWithFormat:@"'%@' crashes the process when run on its own.", lastTestCase]);
+  }
+
+  // Whether running `suspects` before the last test is known to crash.
+  BOOL reproduced = NO;
+  while (suspects.count > 1 && canLaunch()) {
+    NSUInteger half = suspects.count / 2;
+    NSArray *firstHalf = [suspects subarrayWithRange:NSMakeRange(0, half)];
+    NSArray *secondHalf = [suspects subarrayWithRange:NSMakeRange(half, suspects.count - half)];
+
+    if ([self testCasesCrashTestProcess:[firstHalf arrayByAddingObject:lastTestCase]]) {
+      suspects = firstHalf;
+      reproduced = YES;
+    } else if (!canLaunch()) {
+      break;
+    } else if ([self testCasesCrashTestProcess:[secondHalf arrayByAddingObject:lastTestCase]]) {
+      suspects = secondHalf;
+      reproduced = YES;
+    } else {
+      return describe([NSString stringWithFormat:
+                       @"neither half of the %lu tests that ran before '%@' crashes the process on its own; "
+                       @"it may take tests from both, or the crash may not be deterministic. Tests: %@",
+                       (unsigned long)suspects.count, lastTestCase, [suspects componentsJoinedByString:@", "]]);
+    }
+  }
+
+  if (suspects.count == 1 && (reproduced || canLaunch())) {
+    if (reproduced || [self testCasesCrashTestProcess:@[suspects[0], lastTestCase]]) {
+      return describe([NSString stringWithFormat:
+                       @"running '%@' before '%@' crashes the process; '%@' is the likely culprit.",
+                       suspects[0], lastTestCase, suspects[0]]);
+    } else {
+      return describe([NSString stringWithFormat:
+                       @"couldn't reproduce the crash by running '%@' before '%@'; it may not be deterministic.",
+                       suspects[0], lastTestCase]);
+    }
+  }
+
+  if (suspects.count == 0) {
+    return describe([NSString stringWithFormat:@"'%@' was the only test that ran, but doesn't crash the process on its own.", lastTestCase]);
+  }
+
+  return describe([NSString stringWithFormat:
+                   @"ran out of launches; one of these %lu tests, run before '%@', is the likely culprit: %@",
+                   (unsigned long)suspects.count, lastTestCase, [suspects componentsJoinedByString:@", "]]);
+}
+
 - (NSMutableArray *)commonTestArguments
 {
   // Add any argments that might have been specifed in the scheme.
@@ -423,6 +603,10 @@ static NSString * const kEnvVarPassThroughPrefix = @"XCTOOL_TEST_ENV_";
   NSMutableDictionary *env = [NSMutableDictionary dictionary];
 
   NSMutableDictionary *internalEnvironment = [NSMutableDictionary dictionary];
+  // Only takes effect when events go to OTEST_SHIM_STDOUT_FILE; older shims
+  // ignore it and keep writing JSON lines, which the reader handles too.
+  internalEnvironment[@kOtestShimEventFramingEnvKey] = @kOtestShimEventFramingBinary;
+
   if (_testTimeout > 0) {
     internalEnvironment[@"OTEST_SHIM_TEST_TIMEOUT"] = [@(_testTimeout) stringValue];
   }
@@ -431,6 +615,10 @@ static NSString * const kEnvVarPassThroughPrefix = @"XCTOOL_TEST_ENV_";
     internalEnvironment[@"XCTOOL_WAIT_FOR_DEBUGGER"] = @"YES";
   }
 
+  if (_warmTestWorkerControlPath) {
+    internalEnvironment[[WarmTestWorker controlFileEnvironmentKey]] = _warmTestWorkerControlPath;
+  }
+
   NSArray *layers = @[
     [self _filteredProcessEnvironment],
     // Any special environment vars set in the scheme.
@@ -463,4 +651,59 @@ static NSString * const kEnvVarPassThroughPrefix = @"XCTOOL_TEST_ENV_";
   return env;
 }
 
+- (BOOL)canUseWarmTestWorker
+{
+  // Only the first attempt goes to a warm worker.  If that leaves tests
+  // unfinished (the worker crashed, or couldn't find them), the rest run in a
+  // fresh process as usual.
+  return (_warmTestWorkerPool != nil &&
+          !_usedWarmTestWorker &&
+          ToolchainIsXcode7OrBetter() &&
+          [_framework[kTestingFrameworkFilterTestArgsKey] isEqual:@"XCTest"]);
+}
+
+- (void)runOtestTaskCreatedBy:(NSTask *(^)(NSString **otestShimOutputPath))createTask
+                 feedOutputTo:(TestOutputFeedBlock)outputLineBlock
+{
+  if (![self canUseWarmTestWorker]) {
+    NSString *otestShimOutputPath = nil;
+    NSTask *task = createTask(&otestShimOutputPath);
+    [_cancellation addTask:task];
+    LaunchTaskAndFeedSimulatorOutputAndOtestShimEventsToBlock(
+      task,
+      @"running otest/xctest on test bundle",
+      otestShimOutputPath,
+      outputLineBlock);
+    [_cancellation removeTask:task];
+    return;
+  }
+
+  _usedWarmTestWorker = YES;
+  NSString *key = [NSString stringWithFormat:@"%@:%@",
+                   _buildSettings[Xcode_SDK_NAME], [_simulatorInfo productBundlePath]];
+
+  BOOL ready = NO;
+  WarmTestWorker *worker = [_warmTestWorkerPool checkOutWorkerForKey:key];
+  if (worker) {
+    [_cancellation addTask:worker.task];
+    ready = [worker runTestCases:_focusedTestCases feedOutputTo:outputLineBlock];
+  } else {
+    worker = [[WarmTestWorker alloc] initWithControlPath:MakeTempFileWithPrefix(@"otest_worker_control")];
+    NSString *otestShimOutputPath = nil;
+    _warmTestWorkerControlPath = worker.controlPath;
+    NSTask *task = createTask(&otestShimOutputPath);
+    _warmTestWorkerControlPath = nil;
+    [_cancellation addTask:task];
+    ready = [worker launchTask:task otestShimOutputPath:otestShimOutputPath feedOutputTo:outputLineBlock];
+  }
+  [_cancellation removeTask:worker.task];
+
+  if (ready) {
+    [_warmTestWorkerPool checkInWorker:worker forKey:key];
+  } else {
+    // The process is gone; a later bucket will launch a new one.
+    [worker terminate];
+  }
+}
+
 @end
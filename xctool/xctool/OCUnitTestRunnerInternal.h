@@ -24,8 +24,17 @@
  Subclasses of OCUnitTestRunner implement this method to actually
  run the tests.
  */
-- (void)runTestsAndFeedOutputTo:(FdOutputLineFeedBlock)outputLineBlock
+- (void)runTestsAndFeedOutputTo:(TestOutputFeedBlock)outputLineBlock
                    startupError:(NSString **)startupError
                     otherErrors:(NSString **)otherErrors;
 
+/**
+ Launches the otest/xctest task returned by `createTask` and feeds its output
+ to `outputLineBlock`.  If the runner has a `warmTestWorkerPool`, the focused
+ tests run on an idle worker for the same bundle instead, and the task is only
+ created (as a new worker) when there is none.
+ */
+- (void)runOtestTaskCreatedBy:(NSTask *(^)(NSString **otestShimOutputPath))createTask
+                 feedOutputTo:(TestOutputFeedBlock)outputLineBlock;
+
 @end
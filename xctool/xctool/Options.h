@@ -50,6 +50,8 @@ static NSString * const XCToolArgsFileExtension = @".xctool-args";
 @property (nonatomic, copy) NSArray *findTargetExcludePaths;
 @property (nonatomic, copy) NSString *launchTimeout;
 @property (nonatomic, copy) NSString *xctoolArgs;
+@property (nonatomic, copy) NSString *reporterBufferSize;
+@property (nonatomic, copy) NSString *reporterOverflow;
 
 @property (nonatomic, assign) BOOL showBuildSettings;
 @property (nonatomic, assign) BOOL showTasks;
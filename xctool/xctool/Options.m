@@ -21,6 +21,7 @@
 #import "BuildAction.h"
 #import "BuildTestsAction.h"
 #import "CleanAction.h"
+#import "InProcessReporterTask.h"
 #import "InstallAction.h"
 #import "ReportStatus.h"
 #import "ReporterTask.h"
@@ -143,6 +144,18 @@
                      description:@"add reporter"
                        paramName:@"TYPE[:FILE]"
                            mapTo:@selector(addReporter:)],
+    [Action actionOptionWithName:@"reporterBufferSize"
+                         aliases:nil
+                     description:@"number of events queued for each reporter before -reporterOverflow applies "
+                                  "(default is 1024)"
+                       paramName:@"NUMBER"
+                           mapTo:@selector(setReporterBufferSize:)],
+    [Action actionOptionWithName:@"reporterOverflow"
+                         aliases:nil
+                     description:@"what to do when a reporter's buffer is full: 'block' to wait for it to "
+                                  "catch up (default), or 'spill' to queue further events on disk"
+                       paramName:@"POLICY"
+                           mapTo:@selector(setReporterOverflow:)],
     [Action actionOptionWithName:@"showBuildSettings"
                          aliases:nil
                      description:@"display a list of build settings and values"
@@ -276,6 +289,31 @@
 
 - (BOOL)validateReporterOptions:(NSString **)errorMessage
 {
+  NSUInteger bufferCapacity = 0;
+  if (_reporterBufferSize) {
+    NSInteger value = [_reporterBufferSize integerValue];
+    if (value <= 0) {
+      *errorMessage = [NSString stringWithFormat:
+                       @"-reporterBufferSize must be a positive number of events, got '%@'.",
+                       _reporterBufferSize];
+      return NO;
+    }
+    bufferCapacity = (NSUInteger)value;
+  }
+
+  ReporterTaskOverflowPolicy overflowPolicy = ReporterTaskOverflowPolicyBlock;
+  if ([_reporterOverflow isEqualToString:@"spill"]) {
+    overflowPolicy = ReporterTaskOverflowPolicySpillToDisk;
+  } else if (_reporterOverflow && ![_reporterOverflow isEqualToString:@"block"]) {
+    *errorMessage = [NSString stringWithFormat:
+                     @"-reporterOverflow must be 'block' or 'spill', got '%@'.",
+                     _reporterOverflow];
+    return NO;
+  }
+
+  // Built-in reporters run inside xctool when their bundle is installed.
+  Class<ReporterPlugin> plugin = [InProcessReporterTask builtinReporterPlugin];
+
   for (NSString *reporterOption in _reporterOptions) {
     NSArray *optionParts = [reporterOption componentsSeparatedByString:@":"];
     NSString *nameOrPath = optionParts[0];
@@ -286,6 +324,12 @@
     if ([[NSFileManager defaultManager] isExecutableFileAtPath:nameOrPath]) {
       // The argument might be the path to a reporter.
       reporterPath = nameOrPath;
+    } else if ([[plugin reporterNames] containsObject:nameOrPath]) {
+      // Or one of the built-in reporters, which runs in-process.
+      [_reporters addObject:[[InProcessReporterTask alloc] initWithPlugin:plugin
+                                                              reporterName:nameOrPath
+                                                                outputPath:outputFile]];
+      continue;
     } else if ([[NSFileManager defaultManager] isExecutableFileAtPath:
                 [XCToolReportersPath() stringByAppendingPathComponent:nameOrPath]]) {
       // Or, it could be the name of one of the built-in reporters.
@@ -304,9 +348,16 @@
   }
 
   if (_reporters.count == 0) {
-    ReporterTask *reporterTask =
-    [[ReporterTask alloc] initWithReporterPath:[XCToolReportersPath() stringByAppendingPathComponent:@"pretty"]
-                                     outputPath:@"-"];
+    ReporterTask *reporterTask = nil;
+    if ([[plugin reporterNames] containsObject:@"pretty"]) {
+      reporterTask = [[InProcessReporterTask alloc] initWithPlugin:plugin
+                                                      reporterName:@"pretty"
+                                                        outputPath:@"-"];
+    } else {
+      reporterTask =
+      [[ReporterTask alloc] initWithReporterPath:[XCToolReportersPath() stringByAppendingPathComponent:@"pretty"]
+                                       outputPath:@"-"];
+    }
     [_reporters addObject:reporterTask];
 
     if (!IsRunningOnCISystem() && !IsRunningUnderTest()) {
@@ -317,6 +368,13 @@
     }
   }
 
+  for (ReporterTask *reporterTask in _reporters) {
+    if (bufferCapacity > 0) {
+      reporterTask.bufferCapacity = bufferCapacity;
+    }
+    reporterTask.overflowPolicy = overflowPolicy;
+  }
+
   return YES;
 }
 
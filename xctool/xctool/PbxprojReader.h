@@ -18,4 +18,10 @@
 
 NSSet * ProjectFilesReferencedInProjectAtPath(NSString *filePath);
 
+/**
+ * Returns the paths of the .xcconfig files referenced by the project, e.g. as
+ * base configurations.  Files included by those aren't listed.
+ */
+NSSet * XcconfigFilesReferencedInProjectAtPath(NSString *filePath);
+
 NSString * ProjectBaseDirectoryPath(NSString *projectPath);
@@ -46,13 +46,17 @@ static NSString * GetObjectFullRelativePath(NSMutableDictionary *object, NSDicti
   return object[PBXFullPathKey];
 }
 
-NSSet * ProjectFilesReferencedInProjectAtPath(NSString *filePath)
+/**
+ * Returns the full paths of the files referenced by the project whose paths
+ * have the given extension.
+ */
+static NSSet * FilesWithExtensionReferencedInProjectAtPath(NSString *filePath, NSString *extension)
 {
   NSDictionary *contents = [[NSDictionary alloc] initWithContentsOfFile:[filePath stringByAppendingPathComponent:@"project.pbxproj"]];
   NSDictionary *objects = contents[PBXObjects];
   __block NSDictionary *mainProject = nil;
   NSMutableDictionary *groupsById = [@{} mutableCopy];
-  NSMutableArray *projects = [@[] mutableCopy];
+  NSMutableArray *files = [@[] mutableCopy];
   NSMutableDictionary *childGroups = [@{} mutableCopy];
   [objects enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSDictionary *objWithoutId, BOOL *stop) {
     NSMutableDictionary *obj = [objWithoutId mutableCopy];
@@ -62,17 +66,31 @@ NSSet * ProjectFilesReferencedInProjectAtPath(NSString *filePath)
         childGroups[childId] = obj[PBXUniqueIdKey];
       }
       groupsById[key] = obj;
-    } else if ([obj[PBXIsa] isEqualToString:@"PBXFileReference"] && [[obj[PBXPathKey] pathExtension] isEqualToString:@"xcodeproj"]) {
-      [projects addObject:obj];
+    } else if ([obj[PBXIsa] isEqualToString:@"PBXFileReference"] && [[obj[PBXPathKey] pathExtension] isEqualToString:extension]) {
+      [files addObject:obj];
     } else if ([obj[PBXIsa] isEqualToString:@"PBXProject"]) {
       mainProject = obj;
     }
   }];
   NSString *mainProjectPath = [[filePath stringByDeletingLastPathComponent] stringByAppendingPathComponent:mainProject[PBXProjectDirPath] ?: @""];
-  for (NSMutableDictionary *project in projects) {
-    project[PBXFullPathKey] = [[mainProjectPath stringByAppendingPathComponent:GetObjectFullRelativePath(project, groupsById, childGroups)] stringByStandardizingPath];
+  for (NSMutableDictionary *file in files) {
+    if ([file[PBXSourceTreeKey] isEqualToString:@"<absolute>"]) {
+      file[PBXFullPathKey] = [file[PBXPathKey] stringByStandardizingPath];
+    } else {
+      file[PBXFullPathKey] = [[mainProjectPath stringByAppendingPathComponent:GetObjectFullRelativePath(file, groupsById, childGroups)] stringByStandardizingPath];
+    }
   }
-  return [NSSet setWithArray:[projects valueForKeyPath:PBXFullPathKey]];
+  return [NSSet setWithArray:[files valueForKeyPath:PBXFullPathKey]];
+}
+
+NSSet * ProjectFilesReferencedInProjectAtPath(NSString *filePath)
+{
+  return FilesWithExtensionReferencedInProjectAtPath(filePath, @"xcodeproj");
+}
+
+NSSet * XcconfigFilesReferencedInProjectAtPath(NSString *filePath)
+{
+  return FilesWithExtensionReferencedInProjectAtPath(filePath, @"xcconfig");
 }
 
 NSString * ProjectBaseDirectoryPath(NSString *filePath)
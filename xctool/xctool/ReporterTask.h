@@ -18,10 +18,55 @@
 
 #import "EventSink.h"
 
+/**
+ What `-publishDataForEvent:` does when the reporter has fallen so far behind
+ that its buffer is full.
+ */
+typedef NS_ENUM(NSInteger, ReporterTaskOverflowPolicy) {
+  // Wait for the reporter to catch up.
+  ReporterTaskOverflowPolicyBlock,
+  // Append the event to a temporary file, which is fed to the reporter once it
+  // has drained the buffer.
+  ReporterTaskOverflowPolicySpillToDisk,
+};
+
+/**
+ Feeds events to a reporter process.
+
+ Events are queued in a bounded ring buffer and written to the reporter's
+ stdin from a dedicated thread, so a slow reporter doesn't hold up whoever is
+ publishing events (and with them, every other reporter).
+ */
 @interface ReporterTask : NSObject <EventSink>
 
 @property (nonatomic, copy, readonly) NSString *reporterPath;
 
+/**
+ Names of the events the reporter handles, or nil if it takes every event.
+ Read from the reporter's embedded Info.plist (see
+ kReporterSubscribedEventsInfoKey) when it's opened.  Other events published
+ with -publishEvent:data: are dropped before they're queued.
+ */
+@property (nonatomic, copy, readonly) NSSet *subscribedEvents;
+
+/**
+ Number of events that can be queued for the reporter before the overflow
+ policy kicks in.  Defaults to 1024; must be set before opening.
+ */
+@property (nonatomic, assign) NSUInteger bufferCapacity;
+@property (nonatomic, assign) ReporterTaskOverflowPolicy overflowPolicy;
+
+/**
+ Lag statistics, final once the task is closed.
+ */
+@property (nonatomic, assign, readonly) NSUInteger publishedEventCount;
+@property (nonatomic, assign, readonly) NSUInteger maxQueuedEventCount;
+@property (nonatomic, assign, readonly) NSUInteger spilledEventCount;
+// Longest time an event sat in the buffer before it was written to the reporter.
+@property (nonatomic, assign, readonly) NSTimeInterval maxLag;
+// Total time publishers spent waiting for room in the buffer.
+@property (nonatomic, assign, readonly) NSTimeInterval blockedDuration;
+
 /**
  @param string Path to reporter executable.
  @param string Path to save output of reporter.  Can be "-" for stdout.
@@ -37,7 +82,8 @@
                          error:(NSString **)error;
 
 /**
- To be called just before xctool exits.
+ To be called just before xctool exits.  Waits for all queued events to be
+ written and, if the reporter couldn't keep up, prints its lag statistics.
  */
 - (void)close;
 
@@ -18,25 +18,61 @@
 
 #import <fcntl.h>
 #import <objc/message.h>
+#import <sys/uio.h>
 
 #import "NSFileHandle+Print.h"
+#import "Reporter.h"
+#import "ReporterEvents.h"
+#import "ReporterTaskInternal.h"
 #import "TaskUtil.h"
 #import "XCToolUtil.h"
 
-@interface ReporterTask ()
+static const NSUInteger kDefaultBufferCapacity = 1024;
+static const size_t kSpillReadChunkSize = 64 * 1024;
+
+static NSSet *SubscribedEventsOfReporterAtPath(NSString *path)
+{
+  NSDictionary *info = CFBridgingRelease(CFBundleCopyInfoDictionaryForURL((__bridge CFURLRef)[NSURL fileURLWithPath:path]));
+  NSArray *events = info[kReporterSubscribedEventsInfoKey];
+  return [events isKindOfClass:[NSArray class]] ? [NSSet setWithArray:events] : nil;
+}
+
+@interface ReporterTask () {
+  // Parallel to `ring`: when each event was published.
+  CFAbsoluteTime *_ringPublishTimes;
+}
 @property (nonatomic, copy) NSString *reporterPath;
 @property (nonatomic, copy) NSString *outputPath;
+@property (nonatomic, copy) NSSet *subscribedEvents;
 
 @property (nonatomic, strong) NSFileHandle *standardOutput;
 @property (nonatomic, strong) NSFileHandle *standardError;
+@property (nonatomic, strong) NSFileHandle *outputHandle;
 
 @property (nonatomic, assign) BOOL outputPathIsFile;
 
 @property (nonatomic, strong) NSTask *task;
 @property (nonatomic, strong) NSPipe *pipe;
 
-@property (nonatomic, assign) BOOL wasOpened;
-@property (nonatomic, assign) BOOL wasClosed;
+// Everything below is guarded by `condition`.
+@property (nonatomic, strong) NSCondition *condition;
+@property (nonatomic, strong) NSMutableArray *ring;
+@property (nonatomic, assign) NSUInteger ringHead;
+@property (nonatomic, assign) NSUInteger ringCount;
+// Events in the ring and in the spill file.
+@property (nonatomic, assign) NSUInteger queuedEventCount;
+@property (nonatomic, assign) int spillFileDescriptor;
+@property (nonatomic, assign) off_t spillReadOffset;
+@property (nonatomic, assign) off_t spillWriteOffset;
+@property (nonatomic, assign) BOOL closing;
+@property (nonatomic, assign) BOOL writerFinished;
+@property (nonatomic, assign) BOOL reporterExited;
+
+@property (nonatomic, assign) NSUInteger publishedEventCount;
+@property (nonatomic, assign) NSUInteger maxQueuedEventCount;
+@property (nonatomic, assign) NSUInteger spilledEventCount;
+@property (nonatomic, assign) NSTimeInterval maxLag;
+@property (nonatomic, assign) NSTimeInterval blockedDuration;
 @end
 
 @implementation ReporterTask
@@ -47,10 +83,21 @@
   if (self = [super init]) {
     _reporterPath = [reporterPath copy];
     _outputPath = [outputPath copy];
+    _bufferCapacity = kDefaultBufferCapacity;
+    _overflowPolicy = ReporterTaskOverflowPolicyBlock;
+    _condition = [[NSCondition alloc] init];
+    _spillFileDescriptor = -1;
   }
   return self;
 }
 
+- (void)dealloc
+{
+  free(_ringPublishTimes);
+  if (_spillFileDescriptor != -1) {
+    close(_spillFileDescriptor);
+  }
+}
 
 - (NSFileHandle *)_fileHandleForOutputPath:(NSString *)outputPath
                                      error:(NSString **)error
@@ -83,27 +130,38 @@
   return [NSFileHandle fileHandleForWritingAtPath:outputPath];
 }
 
-- (BOOL)openWithStandardOutput:(NSFileHandle *)standardOutput
-                 standardError:(NSFileHandle *)standardError
-                         error:(NSString **)error
+- (BOOL)openOutputWithStandardOutput:(NSFileHandle *)standardOutput
+                       standardError:(NSFileHandle *)standardError
+                               error:(NSString **)error
 {
   _standardOutput = standardOutput;
   _standardError = standardError;
 
-  NSFileHandle *outputHandle = nil;
-
   if ([_outputPath isEqualToString:@"-"]) {
-    outputHandle = standardOutput;
+    _outputHandle = standardOutput;
   } else {
-    outputHandle = [self _fileHandleForOutputPath:_outputPath error:error];
+    _outputHandle = [self _fileHandleForOutputPath:_outputPath error:error];
 
-    if (outputHandle == nil) {
+    if (_outputHandle == nil) {
       return NO;
     }
 
     _outputPathIsFile = YES;
   }
 
+  return YES;
+}
+
+- (BOOL)openWithStandardOutput:(NSFileHandle *)standardOutput
+                 standardError:(NSFileHandle *)standardError
+                         error:(NSString **)error
+{
+  if (![self openOutputWithStandardOutput:standardOutput
+                            standardError:standardError
+                                    error:error]) {
+    return NO;
+  }
+
   _pipe = [NSPipe pipe];
 
   // Don't generate a SIGPIPE if the we try to write() to this pipe and the
@@ -117,10 +175,12 @@
   // `+[NSTask alloc]`.
   _task = CreateConcreteTaskInSameProcessGroup();
 
+  _subscribedEvents = SubscribedEventsOfReporterAtPath(_reporterPath);
+
   [_task setLaunchPath:_reporterPath];
   [_task setArguments:@[]];
   [_task setStandardInput:_pipe];
-  [_task setStandardOutput:outputHandle];
+  [_task setStandardOutput:_outputHandle];
 
   @try {
     LaunchTaskAndMaybeLogCommand(_task, @"spawning reporter task");
@@ -132,10 +192,29 @@
     return NO;
   }
 
+  [self startWriterThread];
+
   _wasOpened = YES;
   return YES;
 }
 
+- (void)startWriterThread
+{
+  _bufferCapacity = MAX(_bufferCapacity, (NSUInteger)1);
+  _ring = [NSMutableArray arrayWithCapacity:_bufferCapacity];
+  for (NSUInteger i = 0; i < _bufferCapacity; i++) {
+    [_ring addObject:[NSNull null]];
+  }
+  _ringPublishTimes = calloc(_bufferCapacity, sizeof(CFAbsoluteTime));
+
+  NSThread *writerThread = [[NSThread alloc] initWithTarget:self
+                                                   selector:@selector(writeEventsToReporter)
+                                                     object:nil];
+  [writerThread setName:[NSString stringWithFormat:@"xctool reporter writer (%@)",
+                         [_reporterPath lastPathComponent]]];
+  [writerThread start];
+}
+
 - (void)close
 {
   NSAssert(_wasOpened, @"Can't close without opening first.");
@@ -143,22 +222,61 @@
   if (_wasClosed) {
     return;
   }
+  _wasClosed = YES;
+
+  [self finishWriting];
 
   // Close pipe so the reporter gets an EOF, and can terminate.
   [[_pipe fileHandleForWriting] closeFile];
 
   [_task waitUntilExit];
 
+  [self closeOutput];
+}
+
+- (void)closeOutput
+{
   // If we opened a file to store reporter output, make sure our handle is
   // closed.
   if (_outputPathIsFile) {
-    [[_task standardOutput] closeFile];
+    [_outputHandle closeFile];
   }
 
-  _wasClosed = YES;
+  if (_blockedDuration > 0 || _spilledEventCount > 0) {
+    [_standardError printString:
+     @"NOTE: Reporter '%@' fell behind: %lu of %lu events queued at most, "
+     @"max lag %.2fs, publishers blocked for %.2fs, %lu events spilled to disk.\n",
+     [_reporterPath lastPathComponent],
+     (unsigned long)_maxQueuedEventCount,
+     (unsigned long)_publishedEventCount,
+     _maxLag,
+     _blockedDuration,
+     (unsigned long)_spilledEventCount];
+  }
+}
+
+- (BOOL)isSubscribedToEvent:(NSDictionary *)event
+{
+  return _subscribedEvents == nil || [_subscribedEvents containsObject:event[kReporter_Event_Key]];
 }
 
 - (void)publishDataForEvent:(NSData *)data
+{
+  // Without the event we can't tell whether the reporter wants it, and
+  // decoding it just to find out would cost more than sending it along.
+  [self enqueueEvent:data];
+}
+
+- (void)publishEvent:(NSDictionary *)event data:(NSData *)data
+{
+  if ([self isSubscribedToEvent:event]) {
+    [self enqueueEvent:data];
+  }
+}
+
+#pragma mark Writer Thread
+
+- (void)enqueueEvent:(id)event
 {
   NSAssert(_wasOpened, @"Can't publish without opening first.");
 
@@ -166,37 +284,233 @@
     return;
   }
 
-  NSMutableData *buffer = [[NSMutableData alloc] initWithCapacity:[data length] + 1];
-  [buffer appendData:data];
-  [buffer appendData:[@"\n" dataUsingEncoding:NSUTF8StringEncoding]];
+  [_condition lock];
+  _publishedEventCount++;
+
+  // Once anything has been spilled, later events have to follow it to disk
+  // until the writer catches up, or they'd overtake it.  Only encoded events
+  // can be spilled.
+  BOOL spill = (_spillWriteOffset > _spillReadOffset ||
+                (_ringCount == _bufferCapacity &&
+                 _overflowPolicy == ReporterTaskOverflowPolicySpillToDisk &&
+                 [event isKindOfClass:[NSData class]]));
+
+  if (!spill && _ringCount == _bufferCapacity && !_reporterExited) {
+    CFAbsoluteTime blockedSince = CFAbsoluteTimeGetCurrent();
+    while (_ringCount == _bufferCapacity && !_reporterExited) {
+      [_condition wait];
+    }
+    _blockedDuration += CFAbsoluteTimeGetCurrent() - blockedSince;
+  }
 
-  int fd = [[_pipe fileHandleForWriting] fileDescriptor];
+  if (_reporterExited) {
+    [_condition unlock];
+    return;
+  }
 
-  NSUInteger bytesWritten = 0;
-  NSUInteger bufferLength = [buffer length];
-  const uint8_t *bufferPtr = [buffer bytes];
+  if (spill) {
+    [self spillData:event];
+    _spilledEventCount++;
+  } else {
+    NSUInteger tail = (_ringHead + _ringCount) % _bufferCapacity;
+    _ring[tail] = event;
+    _ringPublishTimes[tail] = CFAbsoluteTimeGetCurrent();
+    _ringCount++;
+  }
 
-  while (bytesWritten < bufferLength) {
-    ssize_t result = write(fd, bufferPtr + bytesWritten, (bufferLength - bytesWritten));
+  _queuedEventCount++;
+  _maxQueuedEventCount = MAX(_maxQueuedEventCount, _queuedEventCount);
+  [_condition broadcast];
+  [_condition unlock];
+}
+
+- (void)finishWriting
+{
+  [_condition lock];
+  _closing = YES;
+  [_condition broadcast];
+  while (!_writerFinished) {
+    [_condition wait];
+  }
+  [_condition unlock];
+
+  if (_spillFileDescriptor != -1) {
+    close(_spillFileDescriptor);
+    _spillFileDescriptor = -1;
+  }
+}
+
+/**
+ Appends an event to the spill file.  Must be called with `condition` held.
+ */
+- (void)spillData:(NSData *)data
+{
+  if (_spillFileDescriptor == -1) {
+    NSString *spillPath = MakeTempFileWithPrefix(
+      [NSString stringWithFormat:@"reporter-%@-spill", [_reporterPath lastPathComponent]]);
+    _spillFileDescriptor = open([spillPath fileSystemRepresentation], O_RDWR);
+    NSAssert(_spillFileDescriptor != -1,
+             @"Failed to open reporter spill file '%@': %s", spillPath, strerror(errno));
+    // Nobody else needs to see it; the space is reclaimed once we close it.
+    unlink([spillPath fileSystemRepresentation]);
+  }
+
+  struct iovec iov[2] = {
+    {(void *)[data bytes], [data length]},
+    {"\n", 1},
+  };
+  size_t length = [data length] + 1;
+  lseek(_spillFileDescriptor, _spillWriteOffset, SEEK_SET);
+  ssize_t result = writev(_spillFileDescriptor, iov, 2);
+  NSAssert(result == (ssize_t)length,
+           @"Failed while write()'ing to the reporter's spill file: %s (%d)",
+           strerror(errno), errno);
+  _spillWriteOffset += length;
+}
+
+- (BOOL)deliverEvent:(id)event
+{
+  NSData *data = event;
+  struct iovec iov[2] = {
+    {(void *)[data bytes], [data length]},
+    {"\n", 1},
+  };
+  return [self writeToReporter:iov count:2];
+}
+
+/**
+ Writes the whole of `iov` to the reporter's pipe.  Returns NO if the reporter
+ has gone away.
+ */
+- (BOOL)writeToReporter:(struct iovec *)iov count:(int)count
+{
+  int fd = [[_pipe fileHandleForWriting] fileDescriptor];
+
+  while (count > 0) {
+    ssize_t result = writev(fd, iov, count);
 
     if (result == -1) {
-      if (errno == ESRCH || errno == EPIPE) {
-        [self close];
+      if (errno == EINTR) {
+        continue;
+      } else if (errno == ESRCH || errno == EPIPE) {
+        return NO;
+      } else {
+        NSAssert(NO,
+                 @"Failed while write()'ing to the reporter's pipe: %s (%d)",
+                 strerror(errno), errno);
+        return NO;
+      }
+    }
+
+    size_t written = (size_t)result;
+    while (count > 0 && written >= iov->iov_len) {
+      written -= iov->iov_len;
+      iov++;
+      count--;
+    }
+    if (count > 0) {
+      iov->iov_base = (uint8_t *)iov->iov_base + written;
+      iov->iov_len -= written;
+    }
+  }
+
+  return YES;
+}
+
+- (void)writeEventsToReporter
+{
+  uint8_t *spillChunk = malloc(kSpillReadChunkSize);
+
+  for (;;) {
+    @autoreleasepool {
+      [_condition lock];
+      while (_queuedEventCount == 0 && !_closing) {
+        [_condition wait];
+      }
+
+      if (_queuedEventCount == 0) {
+        [_condition unlock];
+        break;
+      }
+
+      BOOL succeeded = NO;
+
+      if (_ringCount > 0) {
+        id event = _ring[_ringHead];
+        CFAbsoluteTime publishTime = _ringPublishTimes[_ringHead];
+        _ring[_ringHead] = [NSNull null];
+        _ringHead = (_ringHead + 1) % _bufferCapacity;
+        _ringCount--;
+        [_condition broadcast];
+        [_condition unlock];
+
+        succeeded = [self deliverEvent:event];
+
+        [_condition lock];
+        _queuedEventCount--;
+        _maxLag = MAX(_maxLag, CFAbsoluteTimeGetCurrent() - publishTime);
+      } else {
+        // Spilled bytes are never rewritten until we've consumed them, so it's
+        // safe to read them without holding the lock.
+        off_t offset = _spillReadOffset;
+        size_t length = (size_t)MIN(_spillWriteOffset - _spillReadOffset, (off_t)kSpillReadChunkSize);
+        [_condition unlock];
+
+        ssize_t bytesRead = pread(_spillFileDescriptor, spillChunk, length, offset);
+        NSAssert(bytesRead == (ssize_t)length,
+                 @"Failed while read()'ing the reporter's spill file: %s (%d)",
+                 strerror(errno), errno);
+
+        struct iovec iov = {spillChunk, length};
+        succeeded = [self writeToReporter:&iov count:1];
+
+        [_condition lock];
+        for (size_t i = 0; i < length; i++) {
+          if (spillChunk[i] == '\n') {
+            _queuedEventCount--;
+          }
+        }
+        _spillReadOffset += length;
+        if (_spillReadOffset == _spillWriteOffset) {
+          ftruncate(_spillFileDescriptor, 0);
+          _spillReadOffset = 0;
+          _spillWriteOffset = 0;
+        }
+      }
+
+      if (!succeeded) {
+        // Drop everything; publishers will see `reporterExited` and stop
+        // queueing.
+        _reporterExited = YES;
+        for (NSUInteger i = 0; i < _bufferCapacity; i++) {
+          _ring[i] = [NSNull null];
+        }
+        _ringCount = 0;
+        _queuedEventCount = 0;
+        _spillReadOffset = 0;
+        _spillWriteOffset = 0;
+      }
+
+      [_condition broadcast];
+      [_condition unlock];
+
+      if (!succeeded) {
+        [_task waitUntilExit];
         [_standardError printString:
          @"ERROR: Reporter '%@' exited prematurely with status (%d).\n",
          [_reporterPath lastPathComponent],
          [_task terminationStatus]];
         break;
-      } else {
-        NSAssert(NO,
-                 @"Failed while write()'ing to the reporter's pipe: %s (%d)",
-                 strerror(errno), errno);
       }
-    } else {
-      bytesWritten += (NSUInteger)result;
     }
   }
 
+  free(spillChunk);
+
+  [_condition lock];
+  _writerFinished = YES;
+  [_condition broadcast];
+  [_condition unlock];
 }
 
 @end
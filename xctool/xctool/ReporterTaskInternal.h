@@ -0,0 +1,72 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "ReporterTask.h"
+
+@interface ReporterTask (Internal)
+
+- (NSString *)outputPath;
+- (NSFileHandle *)outputHandle;
+- (NSFileHandle *)standardError;
+- (void)setSubscribedEvents:(NSSet *)subscribedEvents;
+
+- (BOOL)wasOpened;
+- (void)setWasOpened:(BOOL)wasOpened;
+- (BOOL)wasClosed;
+- (void)setWasClosed:(BOOL)wasClosed;
+
+/**
+ Sets up `outputHandle` from the output path: xctool's standard output for
+ "-", otherwise a newly created file.
+ */
+- (BOOL)openOutputWithStandardOutput:(NSFileHandle *)standardOutput
+                       standardError:(NSFileHandle *)standardError
+                               error:(NSString **)error;
+
+/**
+ Closes `outputHandle` if it's a file, and prints lag statistics if the
+ reporter fell behind.
+ */
+- (void)closeOutput;
+
+/**
+ Starts the thread that hands queued events to `-deliverEvent:`.
+ */
+- (void)startWriterThread;
+
+/**
+ Waits for every queued event to be delivered, then stops the writer thread.
+ */
+- (void)finishWriting;
+
+/**
+ Whether `event` is in `subscribedEvents`, or there's no such restriction.
+ */
+- (BOOL)isSubscribedToEvent:(NSDictionary *)event;
+
+/**
+ Queues an event for the writer thread, applying the overflow policy if the
+ buffer is full.  Only NSData events can be spilled to disk.
+ */
+- (void)enqueueEvent:(id)event;
+
+/**
+ Called on the writer thread for each queued event, in order.  Returns NO if
+ the reporter has gone away, after which no more events are delivered.
+ */
+- (BOOL)deliverEvent:(id)event;
+
+@end
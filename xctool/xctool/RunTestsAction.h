@@ -35,6 +35,45 @@ NSArray *BucketizeTestCasesByTestCase(NSArray *testCases, NSUInteger bucketSize)
  */
 NSArray *BucketizeTestCasesByTestClass(NSArray *testCases, NSUInteger bucketSize);
 
+/**
+ * Break test cases into buckets of roughly equal total duration, using
+ * previously recorded `durations` ("Class/method" -> seconds).
+ *
+ * Units (test cases, or whole test classes if `keepClassesTogether` is YES)
+ * with a known duration are packed longest-first into as many buckets as
+ * count-based chunking with `bucketSize` would have produced for them.  Test
+ * cases without a known duration in a partially known class are assumed to
+ * take the average known duration.  Units with no known duration at all are
+ * chunked by count, as with BucketizeTestCasesByTestCase/TestClass, and
+ * appended as additional buckets.
+ *
+ * Test cases keep their original relative order within each bucket.
+ */
+NSArray *BucketizeTestCasesByDuration(NSArray *testCases,
+                                      NSUInteger bucketSize,
+                                      NSDictionary<NSString *, NSNumber *> *durations,
+                                      BOOL keepClassesTogether);
+
+/**
+ * Returns the test cases that belong to shard `shardIndex` (0-based) of
+ * `shardCount`.  Test classes are never split across shards.
+ *
+ * The partition depends only on the arguments, so every host computes the
+ * same one without talking to the others.  If `durations` ("Class/method" ->
+ * seconds) knows about a class, classes are balanced across shards by
+ * duration, longest first; `seed` (e.g. the target name) picks which shard
+ * gets the first one so that many small bundles don't all land on shard 0.
+ * Classes without any known duration are placed by a stable hash of their
+ * name.
+ *
+ * Test cases keep their original relative order.
+ */
+NSArray *ShardTestCases(NSArray *testCases,
+                        NSUInteger shardIndex,
+                        NSUInteger shardCount,
+                        NSDictionary<NSString *, NSNumber *> *durations,
+                        NSString *seed);
+
 typedef NS_ENUM(NSInteger, BucketBy) {
   // Bucket by individual test case (the most granular option).  Test cases
   // within the same class may be broken into separate buckets.
@@ -48,6 +87,13 @@ typedef NS_ENUM(NSInteger, BucketBy) {
   // be in the same bucket.
   BucketByClass,
 
+  // Bucket by individual test case, balancing buckets by the durations
+  // recorded in the -testDurations store.
+  BucketByDuration,
+
+  // Like BucketByDuration, but all test cases for a given class will be in
+  // the same bucket.
+  BucketByClassDuration,
 };
 
 @class RunTestsActionUITest;
@@ -60,6 +106,10 @@ typedef NS_ENUM(NSInteger, BucketBy) {
 @property (nonatomic, assign) BOOL noResetSimulatorOnFailure;
 @property (nonatomic, assign) BOOL freshInstall;
 @property (nonatomic, assign) BOOL parallelize;
+@property (nonatomic, assign) BOOL dynamicBuckets;
+@property (nonatomic, assign) BOOL overlapAppTests;
+@property (nonatomic, assign) BOOL streamParallelOutput;
+@property (nonatomic, assign) BOOL warmTestWorkers;
 @property (nonatomic, assign) BOOL failOnEmptyTestBundles;
 @property (nonatomic, assign) BOOL listTestsOnly;
 @property (nonatomic, assign) BOOL waitForDebugger;
@@ -73,8 +123,16 @@ typedef NS_ENUM(NSInteger, BucketBy) {
 
 - (void)setLogicTestBucketSizeValue:(NSString *)str;
 - (void)setAppTestBucketSizeValue:(NSString *)str;
+- (void)setSimulatorPoolSizeValue:(NSString *)str;
+- (void)setBufferedOutputLimitValue:(NSString *)str;
+- (void)setFailFast:(BOOL)failFast;
+- (void)setFailFastValue:(NSString *)str;
+- (void)setRetryFailuresValue:(NSString *)str;
+- (void)setBisectCrashesValue:(NSString *)str;
+- (void)setShardValue:(NSString *)str;
 - (void)setBucketByValue:(NSString *)str;
 - (void)setTestTimeoutValue:(NSString *)str;
+- (void)setTestDurationsPath:(NSString *)str;
 
 @end
 
@@ -16,6 +16,7 @@
 
 #import "RunTestsAction.h"
 
+#import "BucketEventStream.h"
 #import "EventBuffer.h"
 #import "EventGenerator.h"
 #import "OCUnitIOSAppTestRunner.h"
@@ -28,7 +29,12 @@
 #import "SimDevice.h"
 #import "SimRuntime.h"
 #import "SimulatorInfo.h"
+#import "SimulatorPool.h"
+#import "TestCancellation.h"
+#import "TestDurationStore.h"
+#import "TestWorkQueue.h"
 #import "TestableExecutionInfo.h"
+#import "WarmTestWorkerPool.h"
 #import "XCToolUtil.h"
 #import "XcodeBuildSettings.h"
 #import "XcodeSubjectInfo.h"
@@ -96,7 +102,9 @@ NSArray *BucketizeTestCasesByTestCase(NSArray *testCases, NSUInteger bucketSize)
   return chunkifyArray(testCases, bucketSize);
 }
 
-NSArray *BucketizeTestCasesByTestClass(NSArray *testCases, NSUInteger bucketSize)
+/// Group "Class/method" test cases by class, preserving the order in which
+/// classes first appear.
+static NSArray<NSArray *> *TestCasesGroupedByClass(NSArray *testCases)
 {
   NSMutableArray *allTestClassNames = [NSMutableArray array];
   NSMutableDictionary *testCasesByClass = [NSMutableDictionary dictionary];
@@ -112,14 +120,23 @@ NSArray *BucketizeTestCasesByTestClass(NSArray *testCases, NSUInteger bucketSize
     [testCasesByClass[className] addObject:classAndMethod];
   }
 
-  NSArray *testClassNamesChunked = chunkifyArray(allTestClassNames, bucketSize);
+  NSMutableArray *result = [NSMutableArray arrayWithCapacity:allTestClassNames.count];
+  for (NSString *className in allTestClassNames) {
+    [result addObject:testCasesByClass[className]];
+  }
+  return result;
+}
+
+NSArray *BucketizeTestCasesByTestClass(NSArray *testCases, NSUInteger bucketSize)
+{
+  NSArray *testClassesChunked = chunkifyArray(TestCasesGroupedByClass(testCases), bucketSize);
 
   NSMutableArray *result = [NSMutableArray array];
 
-  for (NSArray *testClassNames in testClassNamesChunked) {
+  for (NSArray *testClasses in testClassesChunked) {
     NSMutableArray *testCasesForClasses = [NSMutableArray array];
-    for (NSString *testClassName in testClassNames) {
-      [testCasesForClasses addObjectsFromArray:testCasesByClass[testClassName]];
+    for (NSArray *testCasesForClass in testClasses) {
+      [testCasesForClasses addObjectsFromArray:testCasesForClass];
     }
     [result addObject:testCasesForClasses];
   }
@@ -127,13 +144,311 @@ NSArray *BucketizeTestCasesByTestClass(NSArray *testCases, NSUInteger bucketSize
   return result;
 }
 
+typedef struct {
+  double duration;
+  NSUInteger index;
+} BucketLoad;
+
+static BOOL BucketLoadIsLighter(BucketLoad a, BucketLoad b)
+{
+  return a.duration < b.duration || (a.duration == b.duration && a.index < b.index);
+}
+
+static void SiftDownBucketLoad(BucketLoad *heap, NSUInteger count, NSUInteger i)
+{
+  for (;;) {
+    NSUInteger lightest = i;
+    NSUInteger left = 2 * i + 1;
+    NSUInteger right = 2 * i + 2;
+    if (left < count && BucketLoadIsLighter(heap[left], heap[lightest])) {
+      lightest = left;
+    }
+    if (right < count && BucketLoadIsLighter(heap[right], heap[lightest])) {
+      lightest = right;
+    }
+    if (lightest == i) {
+      return;
+    }
+    BucketLoad tmp = heap[i];
+    heap[i] = heap[lightest];
+    heap[lightest] = tmp;
+    i = lightest;
+  }
+}
+
+NSArray *BucketizeTestCasesByDuration(NSArray *testCases,
+                                      NSUInteger bucketSize,
+                                      NSDictionary<NSString *, NSNumber *> *durations,
+                                      BOOL keepClassesTogether)
+{
+  if (testCases.count == 0) {
+    return @[@[]];
+  }
+
+  NSArray<NSArray *> *units = nil;
+  if (keepClassesTogether) {
+    units = TestCasesGroupedByClass(testCases);
+  } else {
+    NSMutableArray *singleTestUnits = [NSMutableArray arrayWithCapacity:testCases.count];
+    for (NSString *testCase in testCases) {
+      [singleTestUnits addObject:@[testCase]];
+    }
+    units = singleTestUnits;
+  }
+
+  double knownTotal = 0;
+  NSUInteger knownCount = 0;
+  for (NSString *testCase in testCases) {
+    NSNumber *duration = durations[testCase];
+    if (duration != nil) {
+      knownTotal += [duration doubleValue];
+      knownCount++;
+    }
+  }
+
+  if (knownCount == 0) {
+    return keepClassesTogether
+      ? BucketizeTestCasesByTestClass(testCases, bucketSize)
+      : BucketizeTestCasesByTestCase(testCases, bucketSize);
+  }
+
+  double averageDuration = knownTotal / knownCount;
+
+  // Indexes into `units`, split by whether we know anything about them.
+  NSMutableArray<NSNumber *> *knownUnitIndexes = [NSMutableArray array];
+  NSMutableArray<NSArray *> *unknownUnits = [NSMutableArray array];
+  NSMutableArray<NSNumber *> *unitDurations = [NSMutableArray arrayWithCapacity:units.count];
+
+  for (NSUInteger i = 0; i < units.count; i++) {
+    BOOL anyKnown = NO;
+    double unitDuration = 0;
+    for (NSString *testCase in units[i]) {
+      NSNumber *duration = durations[testCase];
+      if (duration != nil) {
+        anyKnown = YES;
+        unitDuration += [duration doubleValue];
+      } else {
+        unitDuration += averageDuration;
+      }
+    }
+
+    [unitDurations addObject:@(unitDuration)];
+    if (anyKnown) {
+      [knownUnitIndexes addObject:@(i)];
+    } else {
+      [unknownUnits addObject:units[i]];
+    }
+  }
+
+  // Longest-processing-time-first: place the longest unit into whichever
+  // bucket currently has the least total work.  Ties are broken by original
+  // order so the result is deterministic.
+  [knownUnitIndexes sortUsingComparator:^NSComparisonResult(NSNumber *a, NSNumber *b) {
+    NSComparisonResult result = [unitDurations[[b unsignedIntegerValue]] compare:unitDurations[[a unsignedIntegerValue]]];
+    if (result != NSOrderedSame) {
+      return result;
+    }
+    return [a compare:b];
+  }];
+
+  NSUInteger bucketCount = (knownUnitIndexes.count + bucketSize - 1) / bucketSize;
+  bucketCount = MAX(bucketCount, (NSUInteger)1);
+  // Buckets are kept in a min-heap keyed by their total duration so that
+  // packing stays O(n log k) even with very small bucket sizes.
+  BucketLoad *heap = calloc(bucketCount, sizeof(BucketLoad));
+  NSMutableArray<NSMutableIndexSet *> *bucketUnitIndexes = [NSMutableArray arrayWithCapacity:bucketCount];
+  for (NSUInteger b = 0; b < bucketCount; b++) {
+    heap[b] = (BucketLoad){0, b};
+    [bucketUnitIndexes addObject:[NSMutableIndexSet indexSet]];
+  }
+
+  for (NSNumber *unitIndex in knownUnitIndexes) {
+    heap[0].duration += [unitDurations[[unitIndex unsignedIntegerValue]] doubleValue];
+    [bucketUnitIndexes[heap[0].index] addIndex:[unitIndex unsignedIntegerValue]];
+    SiftDownBucketLoad(heap, bucketCount, 0);
+  }
+  free(heap);
+
+  NSMutableArray *result = [NSMutableArray array];
+  for (NSIndexSet *unitIndexes in bucketUnitIndexes) {
+    if (unitIndexes.count == 0) {
+      continue;
+    }
+    // NSIndexSet enumerates in ascending order, which restores original order.
+    NSMutableArray *bucket = [NSMutableArray array];
+    [unitIndexes enumerateIndexesUsingBlock:^(NSUInteger unitIndex, BOOL *stop) {
+      [bucket addObjectsFromArray:units[unitIndex]];
+    }];
+    [result addObject:bucket];
+  }
+
+  for (NSArray *unknownChunk in chunkifyArray(unknownUnits, bucketSize)) {
+    if (unknownChunk.count == 0) {
+      continue;
+    }
+    NSMutableArray *bucket = [NSMutableArray array];
+    for (NSArray *unit in unknownChunk) {
+      [bucket addObjectsFromArray:unit];
+    }
+    [result addObject:bucket];
+  }
+
+  return result;
+}
+
+/// 64-bit FNV-1a of the UTF-8 bytes of `string`.  Unlike -[NSString hash],
+/// this is guaranteed to be the same on every machine and OS version.
+static uint64_t StableHashForString(NSString *string)
+{
+  const char *bytes = [string UTF8String];
+  uint64_t hash = 14695981039346656037ULL;
+  for (const char *p = bytes; *p != '\0'; p++) {
+    hash ^= (uint8_t)*p;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+NSArray *ShardTestCases(NSArray *testCases,
+                        NSUInteger shardIndex,
+                        NSUInteger shardCount,
+                        NSDictionary<NSString *, NSNumber *> *durations,
+                        NSString *seed)
+{
+  NSCAssert(shardIndex < shardCount, @"Shard index %lu out of range for %lu shards.",
+            (unsigned long)shardIndex, (unsigned long)shardCount);
+
+  NSArray<NSArray *> *classes = TestCasesGroupedByClass(testCases);
+
+  // Sum up known durations per class; classes with none are hashed.
+  NSMutableArray<NSNumber *> *knownClassIndexes = [NSMutableArray array];
+  NSMutableArray<NSNumber *> *classDurations = [NSMutableArray arrayWithCapacity:classes.count];
+  NSMutableArray<NSString *> *classNames = [NSMutableArray arrayWithCapacity:classes.count];
+  NSMutableIndexSet *ownedClassIndexes = [NSMutableIndexSet indexSet];
+
+  for (NSUInteger i = 0; i < classes.count; i++) {
+    NSString *className = [classes[i][0] componentsSeparatedByString:@"/"][0];
+    [classNames addObject:className];
+
+    BOOL anyKnown = NO;
+    double classDuration = 0;
+    for (NSString *testCase in classes[i]) {
+      NSNumber *duration = durations[testCase];
+      if (duration != nil) {
+        anyKnown = YES;
+        classDuration += [duration doubleValue];
+      }
+    }
+    [classDurations addObject:@(classDuration)];
+
+    if (anyKnown) {
+      [knownClassIndexes addObject:@(i)];
+    } else if (StableHashForString(className) % shardCount == shardIndex) {
+      [ownedClassIndexes addIndex:i];
+    }
+  }
+
+  // Longest-processing-time-first, as in BucketizeTestCasesByDuration.  Ties
+  // are broken by class name rather than by position so that hosts agree even
+  // if otest-query lists classes in a different order.
+  [knownClassIndexes sortUsingComparator:^NSComparisonResult(NSNumber *a, NSNumber *b) {
+    NSComparisonResult result = [classDurations[[b unsignedIntegerValue]] compare:classDurations[[a unsignedIntegerValue]]];
+    if (result != NSOrderedSame) {
+      return result;
+    }
+    return [classNames[[a unsignedIntegerValue]] compare:classNames[[b unsignedIntegerValue]]];
+  }];
+
+  // Heap indexes are shards rotated by `rotation`, so that the longest classes
+  // of different bundles start out on different shards.
+  NSUInteger rotation = (NSUInteger)(StableHashForString(seed ?: @"") % shardCount);
+  BucketLoad *heap = calloc(shardCount, sizeof(BucketLoad));
+  for (NSUInteger s = 0; s < shardCount; s++) {
+    heap[s] = (BucketLoad){0, s};
+  }
+
+  for (NSNumber *classIndex in knownClassIndexes) {
+    NSUInteger shard = (heap[0].index + rotation) % shardCount;
+    if (shard == shardIndex) {
+      [ownedClassIndexes addIndex:[classIndex unsignedIntegerValue]];
+    }
+    heap[0].duration += [classDurations[[classIndex unsignedIntegerValue]] doubleValue];
+    SiftDownBucketLoad(heap, shardCount, 0);
+  }
+  free(heap);
+
+  NSMutableArray *result = [NSMutableArray array];
+  [ownedClassIndexes enumerateIndexesUsingBlock:^(NSUInteger classIndex, BOOL *stop) {
+    [result addObjectsFromArray:classes[classIndex]];
+  }];
+  return result;
+}
+
+/**
+ * Build settings of several targets of a project, fetched with one xcodebuild
+ * that starts as soon as the prefetch is created.  Callers that ask while the
+ * fetch is under way wait for it.
+ */
+@interface BuildSettingsPrefetch : NSObject
+- (instancetype)initWithFetchBlock:(NSDictionary *(^)(void))fetchBlock;
+// nil if the fetch failed.
+- (NSDictionary *)buildSettings;
+@end
+
+@implementation BuildSettingsPrefetch
+{
+  dispatch_group_t _fetchGroup;
+  NSDictionary *_buildSettings;
+}
+
+- (instancetype)initWithFetchBlock:(NSDictionary *(^)(void))fetchBlock
+{
+  if (self = [super init]) {
+    _fetchGroup = dispatch_group_create();
+    dispatch_group_async(_fetchGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+      _buildSettings = fetchBlock();
+    });
+  }
+  return self;
+}
+
+- (void)dealloc
+{
+  dispatch_release(_fetchGroup);
+}
+
+- (NSDictionary *)buildSettings
+{
+  dispatch_group_wait(_fetchGroup, DISPATCH_TIME_FOREVER);
+  return _buildSettings;
+}
+
+@end
+
 @interface RunTestsAction ()
 @property (nonatomic, strong) SimulatorInfo *simulatorInfo;
 @property (nonatomic, assign) NSUInteger logicTestBucketSize;
 @property (nonatomic, assign) NSUInteger appTestBucketSize;
 @property (nonatomic, assign) NSUInteger uiTestBucketSize;
+@property (nonatomic, assign) NSUInteger simulatorPoolSize;
+@property (nonatomic, assign) NSUInteger bufferedOutputMemoryLimit;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, SimulatorPool *> *simulatorPools;
 @property (nonatomic, assign) BucketBy bucketBy;
 @property (nonatomic, assign) int testTimeout;
+@property (nonatomic, copy) NSString *testDurationsPath;
+@property (nonatomic, strong) TestDurationStore *testDurationStore;
+@property (nonatomic, strong) WarmTestWorkerPool *warmTestWorkerPool;
+// Number of failing tests after which the run is cancelled, 0 to never cancel
+// and -1 if -failFast=N was given something other than a positive number.
+@property (nonatomic, assign) NSInteger failFastCount;
+@property (nonatomic, strong) TestCancellation *cancellation;
+@property (nonatomic, assign) NSUInteger retryFailureCount;
+@property (nonatomic, assign) NSUInteger crashBisectionLaunchLimit;
+// With -shard INDEX/COUNT, the 0-based shard this host runs and the total
+// number of shards.  `shardCount` is 0 when not sharding and -1 if the value
+// couldn't be parsed.
+@property (nonatomic, assign) NSInteger shardIndex;
+@property (nonatomic, assign) NSInteger shardCount;
 @property (nonatomic, strong) NSMutableArray *rawAppTestArgs;
 @property (nonatomic, strong) NSMutableArray *rawUITestArgs;
 @end
@@ -195,6 +510,42 @@ NSArray *BucketizeTestCasesByTestClass(NSArray *testCases, NSUInteger bucketSize
                          aliases:nil
                      description:@"Parallelize execution of tests"
                          setFlag:@selector(setParallelize:)],
+    [Action actionOptionWithName:@"dynamicBuckets"
+                         aliases:nil
+                     description:@"With -parallelize, hand out batches of logic test classes to workers as they become idle instead of precomputing buckets. -logicTestBucketSize caps the number of classes per batch."
+                         setFlag:@selector(setDynamicBuckets:)],
+    [Action actionOptionWithName:@"overlapAppTests"
+                         aliases:nil
+                     description:@"With -parallelize, run application tests concurrently with logic tests instead of after them."
+                         setFlag:@selector(setOverlapAppTests:)],
+    [Action actionOptionWithName:@"streamParallelOutput"
+                         aliases:nil
+                     description:@"With -parallelize, pass each bucket's events to reporters as they happen, tagged with a bucket id, instead of holding them back until the bucket is done. Reporters with grouped output (text, junit, teamcity) still show one bucket at a time."
+                         setFlag:@selector(setStreamParallelOutput:)],
+    [Action actionOptionWithName:@"warmTestWorkers"
+                         aliases:nil
+                     description:@"Run successive logic test buckets of a bundle in a long-lived xctest process instead of relaunching it for every bucket. Requires Xcode 7 or later and XCTest."
+                         setFlag:@selector(setWarmTestWorkers:)],
+    [Action actionOptionWithName:@"failFast"
+                         aliases:nil
+                     description:@"Stop after the first failing test: queued buckets are skipped, running test processes are killed, and the remaining tests are reported as cancelled."
+                         setFlag:@selector(setFailFast:)],
+    [Action actionOptionWithMatcher:^(NSString *argument){
+      return [argument hasPrefix:@"failFast="];
+    }
+                        description:@"Like -failFast, but stop after N failing tests."
+                          paramName:@"-failFast=N"
+                              mapTo:@selector(setFailFastValue:)],
+    [Action actionOptionWithName:@"retryFailures"
+                         aliases:nil
+                     description:@"Run each failing test up to N more times, each time in a fresh process. Tests that pass on a retry are reported as flaky passes."
+                       paramName:@"N"
+                           mapTo:@selector(setRetryFailuresValue:)],
+    [Action actionOptionWithName:@"bisectCrashes"
+                         aliases:nil
+                     description:@"When a test process crashes between tests, rerun the tests that ran before the crash in halves to find the one that caused it, launching at most N extra processes per bucket."
+                       paramName:@"N"
+                           mapTo:@selector(setBisectCrashesValue:)],
     [Action actionOptionWithName:@"logicTestBucketSize"
                          aliases:nil
                      description:@"Break logic test bundles in buckets of N test cases."
@@ -205,11 +556,31 @@ NSArray *BucketizeTestCasesByTestClass(NSArray *testCases, NSUInteger bucketSize
                      description:@"Break app test bundles in buckets of N test cases."
                        paramName:@"N"
                            mapTo:@selector(setAppTestBucketSizeValue:)],
+    [Action actionOptionWithName:@"simulatorPoolSize"
+                         aliases:nil
+                     description:@"With -parallelize, run iOS app test buckets side by side on a pool of N simulators of the requested device type and runtime."
+                       paramName:@"N"
+                           mapTo:@selector(setSimulatorPoolSizeValue:)],
+    [Action actionOptionWithName:@"bufferedOutputLimit"
+                         aliases:nil
+                     description:@"With -parallelize, keep at most MB megabytes of each running bucket's output in memory and spill the rest to a temporary file until it can be reported. Defaults to 16."
+                       paramName:@"MB"
+                           mapTo:@selector(setBufferedOutputLimitValue:)],
+    [Action actionOptionWithName:@"shard"
+                         aliases:nil
+                     description:@"Only run the tests of shard INDEX (0-based) of COUNT. Every host computes the same partition of test classes, balanced by -testDurations when given."
+                       paramName:@"INDEX/COUNT"
+                           mapTo:@selector(setShardValue:)],
     [Action actionOptionWithName:@"bucketBy"
                          aliases:nil
-                     description:@"Either 'case' (default) or 'class'."
+                     description:@"Either 'case' (default), 'class', 'duration' or 'classDuration'. The duration modes balance buckets using -testDurations."
                        paramName:@"BUCKETBY"
                            mapTo:@selector(setBucketByValue:)],
+    [Action actionOptionWithName:@"testDurations"
+                         aliases:nil
+                     description:@"Read per-test durations from (and record them back to) the JSON file at PATH. With -shard, the file is only read."
+                       paramName:@"PATH"
+                           mapTo:@selector(setTestDurationsPath:)],
     [Action actionOptionWithName:@"failOnEmptyTestBundles"
                          aliases:nil
                      description:@"Fail when an empty test bundle was run."
@@ -382,6 +753,9 @@ NSArray *BucketizeTestCasesByTestClass(NSArray *testCases, NSUInteger bucketSize
     _omitList = [NSMutableArray array];;
     _logicTestBucketSize = 0;
     _appTestBucketSize = 0;
+    _simulatorPoolSize = 0;
+    _bufferedOutputMemoryLimit = kEventBufferDefaultMemoryLimit;
+    _simulatorPools = [NSMutableDictionary dictionary];
     _bucketBy = BucketByTestCase;
     _testTimeout = 0;
     _rawAppTestArgs = [NSMutableArray array];
@@ -416,10 +790,78 @@ NSArray *BucketizeTestCasesByTestClass(NSArray *testCases, NSUInteger bucketSize
   _appTestBucketSize = (value > 0 ? (NSUInteger)value : 0);
 }
 
+- (void)setSimulatorPoolSizeValue:(NSString *)str
+{
+  NSInteger value = [str integerValue];
+  _simulatorPoolSize = (value > 0 ? (NSUInteger)value : 0);
+}
+
+- (void)setBufferedOutputLimitValue:(NSString *)str
+{
+  NSInteger value = [str integerValue];
+  _bufferedOutputMemoryLimit = (value > 0 ? (NSUInteger)value * 1024 * 1024 : kEventBufferDefaultMemoryLimit);
+}
+
+- (void)setFailFast:(BOOL)failFast
+{
+  _failFastCount = failFast ? 1 : 0;
+}
+
+- (void)setFailFastValue:(NSString *)str
+{
+  NSString *value = [str substringFromIndex:[str rangeOfString:@"="].location + 1];
+  NSScanner *scanner = [NSScanner scannerWithString:value];
+  NSInteger count = 0;
+  if ([scanner scanInteger:&count] && [scanner isAtEnd] && count > 0) {
+    _failFastCount = count;
+  } else {
+    _failFastCount = -1;
+  }
+}
+
+- (void)setRetryFailuresValue:(NSString *)str
+{
+  NSInteger value = [str integerValue];
+  _retryFailureCount = (value > 0 ? (NSUInteger)value : 0);
+}
+
+- (void)setBisectCrashesValue:(NSString *)str
+{
+  NSInteger value = [str integerValue];
+  _crashBisectionLaunchLimit = (value > 0 ? (NSUInteger)value : 0);
+}
+
+- (void)setShardValue:(NSString *)str
+{
+  NSArray *components = [str componentsSeparatedByString:@"/"];
+  NSInteger index = -1;
+  NSInteger count = -1;
+  if (components.count == 2) {
+    NSScanner *indexScanner = [NSScanner scannerWithString:components[0]];
+    NSScanner *countScanner = [NSScanner scannerWithString:components[1]];
+    if (!([indexScanner scanInteger:&index] && [indexScanner isAtEnd] &&
+          [countScanner scanInteger:&count] && [countScanner isAtEnd])) {
+      count = -1;
+    }
+  }
+
+  if (count > 0 && index >= 0 && index < count) {
+    _shardIndex = index;
+    _shardCount = count;
+  } else {
+    _shardIndex = 0;
+    _shardCount = -1;
+  }
+}
+
 - (void)setBucketByValue:(NSString *)str
 {
   if ([str isEqualToString:@"class"]) {
     _bucketBy = BucketByClass;
+  } else if ([str isEqualToString:@"duration"]) {
+    _bucketBy = BucketByDuration;
+  } else if ([str isEqualToString:@"classDuration"]) {
+    _bucketBy = BucketByClassDuration;
   } else {
     _bucketBy = BucketByTestCase;
   }
@@ -582,6 +1024,68 @@ NSArray *BucketizeTestCasesByTestClass(NSArray *testCases, NSUInteger bucketSize
     *errorMessage = @"run-tests: -only and -omit cannot both be specified.";
     return NO;
   }
+
+  if (_dynamicBuckets && !_parallelize) {
+    *errorMessage = @"run-tests: -dynamicBuckets requires -parallelize.";
+    return NO;
+  }
+
+  if (_streamParallelOutput && !_parallelize) {
+    *errorMessage = @"run-tests: -streamParallelOutput requires -parallelize.";
+    return NO;
+  }
+
+  if (_shardCount < 0) {
+    *errorMessage = @"run-tests: -shard must be of the form INDEX/COUNT with 0 <= INDEX < COUNT, e.g. -shard 0/4.";
+    return NO;
+  }
+
+  if (_failFastCount < 0) {
+    *errorMessage = @"run-tests: -failFast=N requires a positive number of failing tests.";
+    return NO;
+  }
+
+  if (_overlapAppTests) {
+    if (!_parallelize) {
+      *errorMessage = @"run-tests: -overlapAppTests requires -parallelize.";
+      return NO;
+    }
+    // Logic tests are spawned into the same simulator that application tests
+    // use, so the simulator must not be shut down while they run.
+    if (_freshSimulator || _resetSimulator || _newSimulatorInstance) {
+      *errorMessage = @"run-tests: -overlapAppTests cannot be combined with -freshSimulator, -resetSimulator or -newSimulatorInstance.";
+      return NO;
+    }
+  }
+
+  if (_simulatorPoolSize > 0) {
+    if (!_parallelize) {
+      *errorMessage = @"run-tests: -simulatorPoolSize requires -parallelize.";
+      return NO;
+    }
+    // These restart Simulator.app or kill every simulator job, which would
+    // take down buckets running on the other devices in the pool.
+    if (_freshSimulator || _resetSimulator || _newSimulatorInstance) {
+      *errorMessage = @"run-tests: -simulatorPoolSize cannot be combined with -freshSimulator, -resetSimulator or -newSimulatorInstance.";
+      return NO;
+    }
+  }
+
+  if (_bucketBy == BucketByDuration || _bucketBy == BucketByClassDuration) {
+    if (_testDurationsPath == nil) {
+      *errorMessage = @"run-tests: -bucketBy duration and classDuration require -testDurations.";
+      return NO;
+    }
+  }
+  if (_testDurationsPath != nil) {
+    NSString *storeErrorMessage = nil;
+    _testDurationStore = [TestDurationStore storeWithContentsOfFile:[_testDurationsPath stringByStandardizingPath]
+                                                       errorMessage:&storeErrorMessage];
+    if (_testDurationStore == nil) {
+      *errorMessage = [NSString stringWithFormat:@"run-tests: %@", storeErrorMessage];
+      return NO;
+    }
+  }
   for (NSString *target in [self onlyListAsTargetsAndTestCasesList]) {
     if ([[self class] _matchingTestableForTarget:target
                                       logicTests:_logicTests
@@ -780,6 +1284,14 @@ typedef BOOL (^TestableBlock)(NSArray *reporters);
                                                                       testTimeout:_testTimeout
                                                                         reporters:reporters
                                                                processEnvironment:[[NSProcessInfo processInfo] environment]];
+    testRunner.warmTestWorkerPool = _warmTestWorkerPool;
+    testRunner.cancellation = _cancellation;
+    testRunner.retryFailureCount = _retryFailureCount;
+    testRunner.crashBisectionLaunchLimit = _crashBisectionLaunchLimit;
+    if (_simulatorPoolSize > 0 && [testRunner isKindOfClass:[OCUnitIOSAppTestRunner class]]) {
+      [(OCUnitIOSAppTestRunner *)testRunner setSimulatorPool:[self simulatorPoolForBuildSettings:testableExecutionInfo.buildSettings
+                                                                                        reporters:reporters]];
+    }
 
     PublishEventToReporters(reporters,
                             [[self class] eventForBeginOCUnitFromTestableExecutionInfo:testableExecutionInfo action:self]);
@@ -796,10 +1308,48 @@ typedef BOOL (^TestableBlock)(NSArray *reporters);
   } copy];
 }
 
+/**
+ * Returns the simulator pool for the device type and runtime that the given
+ * test bundle runs on, setting it up the first time it's asked for.
+ */
+- (SimulatorPool *)simulatorPoolForBuildSettings:(NSDictionary *)buildSettings
+                                       reporters:(NSArray *)reporters
+{
+  SimulatorInfo *simulatorInfo = [_simulatorInfo copy];
+  simulatorInfo.buildSettings = buildSettings;
+  NSString *key = [NSString stringWithFormat:@"%@ (%@)",
+                   [simulatorInfo simulatedDeviceInfoName],
+                   [simulatorInfo simulatedRuntime].identifier];
+
+  @synchronized (_simulatorPools) {
+    SimulatorPool *pool = _simulatorPools[key];
+    if (pool == nil) {
+      NSString *error = nil;
+      pool = [SimulatorPool poolWithSimulatorInfo:simulatorInfo
+                                             size:_simulatorPoolSize
+                                        reporters:reporters
+                                            error:&error];
+      if (pool == nil) {
+        // Buckets still run concurrently, so they must at least take turns
+        // on the default device.
+        ReportStatusMessage(reporters, REPORTER_MESSAGE_WARNING,
+                            @"Failed to set up a simulator pool for %@, running on a single simulator: %@",
+                            key, error);
+        pool = [[SimulatorPool alloc] initWithDevices:@[[simulatorInfo simulatedDevice]]];
+      }
+      _simulatorPools[key] = pool;
+    }
+    return pool;
+  }
+}
+
 - (BOOL)runTestables:(NSArray *)testables
              options:(Options *)options
     xcodeSubjectInfo:(XcodeSubjectInfo *)xcodeSubjectInfo
 {
+  _warmTestWorkerPool = _warmTestWorkers ? [[WarmTestWorkerPool alloc] init] : nil;
+  _cancellation = _failFastCount > 0 ? [[TestCancellation alloc] initWithMaxFailures:(NSUInteger)_failFastCount] : nil;
+
   dispatch_queue_t q = dispatch_queue_create("xctool.runtests",
                                              _parallelize ? DISPATCH_QUEUE_CONCURRENT
                                                           : DISPATCH_QUEUE_SERIAL);
@@ -817,88 +1367,154 @@ typedef BOOL (^TestableBlock)(NSArray *reporters);
   // starvation since the queue may not run the release block.
   dispatch_semaphore_t queueLimiter = dispatch_semaphore_create((long)[[NSProcessInfo processInfo] processorCount]);
 
-  NSMutableArray *blocksToRunOnMainThread = [NSMutableArray array];
-  NSMutableArray *blocksToRunOnDispatchQueue = [NSMutableArray array];
+  // Info for testables is collected on a queue of its own, and each testable's
+  // buckets are scheduled as soon as its build settings and test list are in,
+  // so tests start running while slower testables are still being queried.
+  // Collection gets its own, smaller, limiter so that it never waits on (or
+  // starves) running tests.
+  dispatch_queue_t collectQueue = dispatch_queue_create("xctool.runtests.collect",
+                                                        _parallelize ? DISPATCH_QUEUE_CONCURRENT
+                                                                     : DISPATCH_QUEUE_SERIAL);
+  dispatch_group_t collectGroup = dispatch_group_create();
+  dispatch_semaphore_t collectLimiter = dispatch_semaphore_create((long)MAX([[NSProcessInfo processInfo] processorCount] / 2, (NSUInteger)1));
+
+  // Collecting blocks hand buckets to this serial queue, which waits for a
+  // free slot in `queueLimiter` on their behalf.  Buckets are therefore started
+  // in the order their testables finished collecting, which without
+  // -parallelize is the order of the testables in the scheme.
+  dispatch_queue_t schedulerQueue = dispatch_queue_create("xctool.runtests.scheduler", DISPATCH_QUEUE_SERIAL);
+
+  // Application tests that run on the main thread once everything else is
+  // done, kept per testable so they run in scheme order.
+  NSMutableArray<NSMutableArray *> *blocksToRunOnMainThreadByTestable = [NSMutableArray array];
+  NSMutableArray *testableExecutionInfos = [NSMutableArray array];
+  for (NSUInteger i = 0; i < testables.count; i++) {
+    [blocksToRunOnMainThreadByTestable addObject:[NSMutableArray array]];
+    [testableExecutionInfos addObject:[NSNull null]];
+  }
 
-  NSArray *xcodebuildArguments = [options commonXcodeBuildArgumentsForSchemeAction:@"TestAction"
-                                                                  xcodeSubjectInfo:xcodeSubjectInfo];
+  // With -dynamicBuckets, logic tests aren't bucketed up front; instead each
+  // worker pulls batches of test classes from this shared backlog.
+  NSUInteger workerCount = [[NSProcessInfo processInfo] processorCount];
+  TestWorkQueue *workQueue = [[TestWorkQueue alloc] initWithWorkerCount:workerCount
+                                                           maxBatchSize:_logicTestBucketSize];
+  __block BOOL hasDynamicWork = NO;
 
-  NSMutableArray *testableExecutionInfos = [NSMutableArray array];
+  __block BOOL succeeded = YES;
+  NSMutableArray *bundlesInProgress = [NSMutableArray array];
 
-  ReportStatusMessageBegin(options.reporters, REPORTER_MESSAGE_INFO,
-                           @"Collecting info for testables...");
+  // The duration store records `end-test` timings alongside the reporters.
+  NSArray *sinks = options.reporters;
+  if ([self recordsTestDurations]) {
+    sinks = [sinks arrayByAddingObject:_testDurationStore];
+  }
 
-  for (Testable *testable in testables) {
-    dispatch_semaphore_wait(queueLimiter, DISPATCH_TIME_FOREVER);
-    dispatch_group_async(group, q, ^{
+  __block NSUInteger nextStreamBucketId = 0;
 
-      NSDictionary *testableBuildSettings = nil;
-      NSString *buildSettingsError = nil;
-      // Skip discovering test settings from Xcode if -logicTests or -appTests are passed.
-      if ([self testsPresentInOptions]) {
-        NSDictionary *defaultTestableBuildSettings = nil;
-        NSDictionary *perTargetTestableBuildSettings = nil;
-        [[self class] _populateTestableBuildSettings:&defaultTestableBuildSettings
-                      perTargetTestableBuildSettings:&perTargetTestableBuildSettings
-                                          logicTests:_logicTests
-                                            appTests:_appTests
-                                             uiTests:_uiTests
-                                             sdkName:options.sdk
-                                             sdkPath:options.sdkPath
-                                        platformPath:options.platformPath
-                                targetedDeviceFamily:_targetedDeviceFamily];
-        NSMutableDictionary *settings = [defaultTestableBuildSettings mutableCopy];
-        [settings addEntriesFromDictionary:perTargetTestableBuildSettings[testable.target]];
-        testableBuildSettings = settings;
-      } else {
-        testableBuildSettings =
-        [TestableExecutionInfo testableBuildSettingsForProject:testable.projectPath
-                                                        target:testable.target
-                                          macroExpansionTarget:testable.macroExpansionTarget
-                                                       objRoot:xcodeSubjectInfo.objRoot
-                                                       symRoot:xcodeSubjectInfo.symRoot
-                                             sharedPrecompsDir:xcodeSubjectInfo.sharedPrecompsDir
-                                          targetedDeviceFamily:xcodeSubjectInfo.targetedDeviceFamily
-                                                xcodeArguments:xcodebuildArguments
-                                                       testSDK:_testSDK
-                                                         error:&buildSettingsError];
+  void (^runTestableBlockAndSaveSuccess)(TestableBlock, NSString *, BOOL) = ^(TestableBlock block, NSString *blockAnnotation, BOOL bufferOutput) {
+    NSArray *reporters;
+
+    if (bufferOutput) {
+      NSUInteger bucket;
+      @synchronized (self) {
+        bucket = ++nextStreamBucketId;
+        [bundlesInProgress addObject:blockAnnotation];
+        ReportStatusMessage(options.reporters, REPORTER_MESSAGE_INFO, @"Starting %@", blockAnnotation);
       }
-      TestableExecutionInfo *info;
-      if (testableBuildSettings) {
-        info = [TestableExecutionInfo infoForTestable:testable
-                                        buildSettings:testableBuildSettings
-                                        simulatorInfo:_simulatorInfo];
+      if (_streamParallelOutput) {
+        // Publish as we go, under the same lock as the status messages.
+        reporters = @[[[BucketEventStream alloc] initWithBucket:bucket sinks:sinks lock:self]];
       } else {
-        info = [[TestableExecutionInfo alloc] init];
-        info.testable = testable;
-        info.buildSettingsError = buildSettingsError ?: @"Unknown build settings error";
+        // Buffer reporter output, and we'll make sure it gets flushed serially
+        // when the block is done.
+        reporters = [EventBuffer wrapSinks:sinks memoryLimit:_bufferedOutputMemoryLimit];
       }
-      @synchronized (self) {
-        [testableExecutionInfos addObject:info];
+    } else {
+      reporters = sinks;
+    }
+
+    // The cancellation sees events as they happen, not when buffers are
+    // flushed, so that it can stop other buckets as early as possible.
+    BOOL blockSucceeded = block(_cancellation ? [reporters arrayByAddingObject:_cancellation] : reporters);
+
+    @synchronized (self) {
+      if (bufferOutput) {
+        if (_streamParallelOutput) {
+          [(BucketEventStream *)reporters[0] finishWithSuccess:blockSucceeded];
+        } else {
+          [reporters makeObjectsPerformSelector:@selector(flush)];
+        }
+
+        [bundlesInProgress removeObject:blockAnnotation];
+        if ([bundlesInProgress count] > 0) {
+          ReportStatusMessage(options.reporters, REPORTER_MESSAGE_INFO, @"In Progress [%@]", [bundlesInProgress componentsJoinedByString:@", "]);
+        }
       }
 
-      dispatch_semaphore_signal(queueLimiter);
-    });
-  }
+      succeeded &= blockSucceeded;
+    }
+  };
 
-  dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
-  ReportStatusMessageEnd(options.reporters, REPORTER_MESSAGE_INFO,
-                         @"Collecting info for testables...");
+  void (^runOnDispatchQueue)(NSArray *) = ^(NSArray *annotatedBlock) {
+    dispatch_group_async(group, schedulerQueue, ^{
+      dispatch_semaphore_wait(queueLimiter, DISPATCH_TIME_FOREVER);
+      dispatch_group_async(group, q, ^{
+        TestableBlock block = annotatedBlock[0];
+        NSString *blockAnnotation = annotatedBlock[1];
+        runTestableBlockAndSaveSuccess(block, blockAnnotation, _parallelize);
 
-  if (_listTestsOnly) {
-    return [self listTestsInTestableExecutionInfos:testableExecutionInfos options:options];
+        dispatch_semaphore_signal(queueLimiter);
+      });
+    });
+  };
+
+  // With -overlapAppTests, application tests run serially on their own queue
+  // while logic tests run on the shared pool.  Each bucket holds one of the
+  // pool's slots while it runs so that logic tests can't starve it of a core.
+  dispatch_queue_t appTestQueue = NULL;
+  if (_overlapAppTests) {
+    appTestQueue = dispatch_queue_create("xctool.runtests.apptests", DISPATCH_QUEUE_SERIAL);
   }
+  void (^runOnAppTestQueue)(NSArray *) = ^(NSArray *annotatedBlock) {
+    dispatch_group_async(group, appTestQueue, ^{
+      dispatch_semaphore_wait(queueLimiter, DISPATCH_TIME_FOREVER);
+      TestableBlock block = annotatedBlock[0];
+      NSString *blockAnnotation = annotatedBlock[1];
+      runTestableBlockAndSaveSuccess(block, blockAnnotation, YES);
+      dispatch_semaphore_signal(queueLimiter);
+    });
+  };
 
-  [xcodeSubjectInfo.actionScripts preTestWithOptions:options];
+  // With -simulatorPoolSize, iOS application test buckets each lease a device
+  // from the pool and run side by side, alongside logic tests.  They're
+  // throttled by the pool size rather than by `queueLimiter` so that buckets
+  // waiting for a device don't hold up logic tests.
+  dispatch_queue_t simulatorPoolQueue = NULL;
+  dispatch_semaphore_t simulatorPoolLimiter = NULL;
+  if (_simulatorPoolSize > 0) {
+    simulatorPoolQueue = dispatch_queue_create("xctool.runtests.simulatorpool", DISPATCH_QUEUE_SERIAL);
+    simulatorPoolLimiter = dispatch_semaphore_create((long)_simulatorPoolSize);
+  }
+  void (^runOnSimulatorPool)(NSArray *) = ^(NSArray *annotatedBlock) {
+    dispatch_group_async(group, simulatorPoolQueue, ^{
+      dispatch_semaphore_wait(simulatorPoolLimiter, DISPATCH_TIME_FOREVER);
+      dispatch_group_async(group, q, ^{
+        TestableBlock block = annotatedBlock[0];
+        NSString *blockAnnotation = annotatedBlock[1];
+        runTestableBlockAndSaveSuccess(block, blockAnnotation, YES);
+
+        dispatch_semaphore_signal(simulatorPoolLimiter);
+      });
+    });
+  };
 
-  for (TestableExecutionInfo *info in testableExecutionInfos) {
+  void (^scheduleTestableExecutionInfo)(TestableExecutionInfo *, NSUInteger) = ^(TestableExecutionInfo *info, NSUInteger testableIndex) {
     if (info.buildSettingsError) {
       TestableBlock block = [self blockToAdvertiseMessage:info.buildSettingsError
                                  forTestableExecutionInfo:info
                                                 succeeded:NO];
-      NSArray *annotatedBlock = @[block, info.testable.target];
-      [blocksToRunOnDispatchQueue addObject:annotatedBlock];
-      continue;
+      runOnDispatchQueue(@[block, info.testable.target]);
+      return;
     }
 
     if (info.testable.skipped) {
@@ -906,9 +1522,8 @@ typedef BOOL (^TestableBlock)(NSArray *reporters);
       TestableBlock block = [self blockToAdvertiseMessage:message
                                  forTestableExecutionInfo:info
                                                 succeeded:YES];
-      NSArray *annotatedBlock = @[block, info.testable.target];
-      [blocksToRunOnDispatchQueue addObject:annotatedBlock];
-      continue;
+      runOnDispatchQueue(@[block, info.testable.target]);
+      return;
     }
 
     if (info.testCasesQueryError != nil) {
@@ -917,9 +1532,8 @@ typedef BOOL (^TestableBlock)(NSArray *reporters);
                                  forTestableExecutionInfo:info
                                                 succeeded:NO];
       NSString *blockAnnotation = info.buildSettings[Xcode_FULL_PRODUCT_NAME];
-      NSArray *annotatedBlock = @[block, blockAnnotation];
-      [blocksToRunOnDispatchQueue addObject:annotatedBlock];
-      continue;
+      runOnDispatchQueue(@[block, blockAnnotation]);
+      return;
     }
 
     if (info.testCases.count == 0) {
@@ -936,9 +1550,8 @@ typedef BOOL (^TestableBlock)(NSArray *reporters);
                                     succeeded:YES];
         blockAnnotation = info.buildSettings[Xcode_FULL_PRODUCT_NAME];
       }
-      NSArray *annotatedBlock = @[block, blockAnnotation];
-      [blocksToRunOnDispatchQueue addObject:annotatedBlock];
-      continue;
+      runOnDispatchQueue(@[block, blockAnnotation]);
+      return;
     }
 
     NSString *filterError = nil;
@@ -950,21 +1563,50 @@ typedef BOOL (^TestableBlock)(NSArray *reporters);
       TestableBlock block = [self blockToAdvertiseMessage:filterError
                                  forTestableExecutionInfo:info
                                                 succeeded:NO];
-      NSArray *annotatedBlock = @[block, info.testable.target];
-      [blocksToRunOnDispatchQueue addObject:annotatedBlock];
-      continue;
+      runOnDispatchQueue(@[block, info.testable.target]);
+      return;
     } else if (testCases.count == 0) {
       NSString *message = [NSString stringWithFormat:@"skipping: No test cases to run or all test cases were skipped.\n"];
       TestableBlock block = [self blockToAdvertiseMessage:message
                                  forTestableExecutionInfo:info
                                                 succeeded:YES];
-      NSArray *annotatedBlock = @[block, info.testable.target];
-      [blocksToRunOnDispatchQueue addObject:annotatedBlock];
-      continue;
+      runOnDispatchQueue(@[block, info.testable.target]);
+      return;
+    }
+
+    if (_shardCount > 0) {
+      NSUInteger filteredCount = testCases.count;
+      testCases = [self testCasesOwnedByShard:testCases testableExecutionInfo:info];
+      @synchronized (self) {
+        ReportStatusMessage(options.reporters, REPORTER_MESSAGE_INFO,
+                            @"Shard %ld/%ld owns %lu of %lu test cases in %@.",
+                            (long)_shardIndex, (long)_shardCount,
+                            (unsigned long)testCases.count, (unsigned long)filteredCount,
+                            info.testable.target);
+      }
+      if (testCases.count == 0) {
+        NSString *message = [NSString stringWithFormat:@"skipping: No test cases belong to shard %ld/%ld.\n",
+                             (long)_shardIndex, (long)_shardCount];
+        TestableBlock block = [self blockToAdvertiseMessage:message
+                                   forTestableExecutionInfo:info
+                                                  succeeded:YES];
+        runOnDispatchQueue(@[block, info.testable.target]);
+        return;
+      }
     }
 
     Class testRunnerClass = [self testRunnerClassForBuildSettings:info.buildSettings];
     BOOL isApplicationTest = TestableSettingsIndicatesApplicationTest(info.buildSettings);
+    if (_dynamicBuckets && !isApplicationTest) {
+      [workQueue addTestCases:testCases
+                  withContext:info
+                    durations:[_testDurationStore durationsForTarget:info.testable.target]];
+      @synchronized (self) {
+        hasDynamicWork = YES;
+      }
+      return;
+    }
+
     NSUInteger bucketSize = isApplicationTest ? _appTestBucketSize : _logicTestBucketSize;
     NSArray *testChunks;
 
@@ -972,6 +1614,11 @@ typedef BOOL (^TestableBlock)(NSArray *reporters);
       testChunks = BucketizeTestCasesByTestClass(testCases, bucketSize != 0 ? bucketSize : INT_MAX);
     } else if (_bucketBy == BucketByTestCase) {
       testChunks = BucketizeTestCasesByTestCase(testCases, bucketSize != 0 ? bucketSize : INT_MAX);
+    } else if (_bucketBy == BucketByDuration || _bucketBy == BucketByClassDuration) {
+      testChunks = BucketizeTestCasesByDuration(testCases,
+                                                bucketSize != 0 ? bucketSize : INT_MAX,
+                                                [_testDurationStore durationsForTarget:info.testable.target],
+                                                _bucketBy == BucketByClassDuration);
     } else {
       NSAssert(NO, @"Unexpected value for _bucketBy: %ld", _bucketBy);
       abort();
@@ -992,57 +1639,220 @@ typedef BOOL (^TestableBlock)(NSArray *reporters);
       NSString *blockAnnotation = [NSString stringWithFormat:@"%@ (bucket #%d, %ld tests)", info.buildSettings[Xcode_FULL_PRODUCT_NAME], bucketCount, testListChunk.count];
       NSArray *annotatedBlock = @[block, blockAnnotation];
 
-      if (isApplicationTest) {
-        [blocksToRunOnMainThread addObject:annotatedBlock];
+      if (_simulatorPoolSize > 0 && testRunnerClass == [OCUnitIOSAppTestRunner class]) {
+        runOnSimulatorPool(annotatedBlock);
+      } else if (isApplicationTest && _overlapAppTests) {
+        runOnAppTestQueue(annotatedBlock);
+      } else if (isApplicationTest) {
+        @synchronized (self) {
+          [blocksToRunOnMainThreadByTestable[testableIndex] addObject:annotatedBlock];
+        }
       } else {
-        [blocksToRunOnDispatchQueue addObject:annotatedBlock];
+        runOnDispatchQueue(annotatedBlock);
       }
 
       bucketCount++;
     }
+  };
+
+  NSArray *xcodebuildArguments = [options commonXcodeBuildArgumentsForSchemeAction:@"TestAction"
+                                                                  xcodeSubjectInfo:xcodeSubjectInfo];
+
+  if (!_listTestsOnly) {
+    [xcodeSubjectInfo.actionScripts preTestWithOptions:options];
   }
 
-  __block BOOL succeeded = YES;
-  NSMutableArray *bundlesInProgress = [NSMutableArray array];
+  // Tests start running as soon as the first testable is collected, so the
+  // status is ended then rather than once every testable has been collected;
+  // reporters don't expect other output while a status is open.
+  __block BOOL collectingStatusEnded = NO;
+  void (^endCollectingStatus)(void) = ^{
+    @synchronized (self) {
+      if (!collectingStatusEnded) {
+        ReportStatusMessageEnd(options.reporters, REPORTER_MESSAGE_INFO,
+                               @"Collecting info for testables...");
+        collectingStatusEnded = YES;
+      }
+    }
+  };
 
-  void (^runTestableBlockAndSaveSuccess)(TestableBlock, NSString *) = ^(TestableBlock block, NSString *blockAnnotation) {
-    NSArray *reporters;
+  ReportStatusMessageBegin(options.reporters, REPORTER_MESSAGE_INFO,
+                           @"Collecting info for testables...");
 
-    if (_parallelize) {
-      @synchronized (self) {
-        [bundlesInProgress addObject:blockAnnotation];
-        ReportStatusMessage(options.reporters, REPORTER_MESSAGE_INFO, @"Starting %@", blockAnnotation);
+  // Build settings for every testable of a project, and for their test hosts,
+  // are fetched with one xcodebuild rather than one per target; xcodebuild's
+  // startup is most of the cost.  Targets missing from the result are fetched
+  // on their own below, which also reports any errors.
+  NSMutableDictionary *buildSettingsPrefetchesByProject = [NSMutableDictionary dictionary];
+  if (![self testsPresentInOptions]) {
+    NSMutableDictionary *targetsByProject = [NSMutableDictionary dictionary];
+    for (Testable *testable in testables) {
+      // Skipped testables are only reported, so their settings aren't needed.
+      if (testable.skipped || testable.projectPath == nil || testable.target == nil) {
+        continue;
+      }
+      NSMutableOrderedSet *targets = targetsByProject[testable.projectPath];
+      if (targets == nil) {
+        targets = [NSMutableOrderedSet orderedSet];
+        targetsByProject[testable.projectPath] = targets;
+      }
+      [targets addObject:testable.target];
+      if (testable.macroExpansionTarget != nil) {
+        [targets addObject:testable.macroExpansionTarget];
       }
-      // Buffer reporter output, and we'll make sure it gets flushed serially
-      // when the block is done.
-      reporters = [EventBuffer wrapSinks:options.reporters];
-    } else {
-      reporters = options.reporters;
     }
 
-    BOOL blockSucceeded = block(reporters);
+    // Every project's settings are fetched at once, outside `collectLimiter`.
+    [targetsByProject enumerateKeysAndObjectsUsingBlock:^(NSString *projectPath, NSOrderedSet *targets, BOOL *stop) {
+      if ([targets count] < 2) {
+        return;
+      }
+      buildSettingsPrefetchesByProject[projectPath] = [[BuildSettingsPrefetch alloc] initWithFetchBlock:^{
+        NSString *error = nil;
+        return [TestableExecutionInfo buildSettingsForProject:projectPath
+                                                      targets:[targets array]
+                                                      objRoot:xcodeSubjectInfo.objRoot
+                                                      symRoot:xcodeSubjectInfo.symRoot
+                                            sharedPrecompsDir:xcodeSubjectInfo.sharedPrecompsDir
+                                         targetedDeviceFamily:xcodeSubjectInfo.targetedDeviceFamily
+                                               xcodeArguments:xcodebuildArguments
+                                                      testSDK:_testSDK
+                                                        error:&error];
+      }];
+    }];
+  }
 
-    @synchronized (self) {
-      if (_parallelize) {
-        [reporters makeObjectsPerformSelector:@selector(flush)];
+  [testables enumerateObjectsUsingBlock:^(Testable *testable, NSUInteger testableIndex, BOOL *stop) {
+    // Wait for the project's settings before taking a slot, so that testables
+    // waiting on a prefetch don't keep others from being collected.
+    BuildSettingsPrefetch *prefetch =
+      testable.skipped ? nil : buildSettingsPrefetchesByProject[testable.projectPath];
+    [prefetch buildSettings];
 
-        [bundlesInProgress removeObject:blockAnnotation];
-        if ([bundlesInProgress count] > 0) {
-          ReportStatusMessage(options.reporters, REPORTER_MESSAGE_INFO, @"In Progress [%@]", [bundlesInProgress componentsJoinedByString:@", "]);
-        }
+    dispatch_semaphore_wait(collectLimiter, DISPATCH_TIME_FOREVER);
+    dispatch_group_async(collectGroup, collectQueue, ^{
+
+      NSDictionary *testableBuildSettings = nil;
+      NSString *buildSettingsError = nil;
+      // Skip discovering test settings from Xcode if -logicTests or -appTests are passed.
+      if ([self testsPresentInOptions]) {
+        NSDictionary *defaultTestableBuildSettings = nil;
+        NSDictionary *perTargetTestableBuildSettings = nil;
+        [[self class] _populateTestableBuildSettings:&defaultTestableBuildSettings
+                      perTargetTestableBuildSettings:&perTargetTestableBuildSettings
+                                          logicTests:_logicTests
+                                            appTests:_appTests
+                                             uiTests:_uiTests
+                                             sdkName:options.sdk
+                                             sdkPath:options.sdkPath
+                                        platformPath:options.platformPath
+                                targetedDeviceFamily:_targetedDeviceFamily];
+        NSMutableDictionary *settings = [defaultTestableBuildSettings mutableCopy];
+        [settings addEntriesFromDictionary:perTargetTestableBuildSettings[testable.target]];
+        testableBuildSettings = settings;
+      } else {
+        testableBuildSettings =
+        [TestableExecutionInfo testableBuildSettingsForProject:testable.projectPath
+                                                        target:testable.target
+                                          macroExpansionTarget:testable.macroExpansionTarget
+                                                       objRoot:xcodeSubjectInfo.objRoot
+                                                       symRoot:xcodeSubjectInfo.symRoot
+                                             sharedPrecompsDir:xcodeSubjectInfo.sharedPrecompsDir
+                                          targetedDeviceFamily:xcodeSubjectInfo.targetedDeviceFamily
+                                                xcodeArguments:xcodebuildArguments
+                                                       testSDK:_testSDK
+                                       prefetchedBuildSettings:[prefetch buildSettings]
+                                                         error:&buildSettingsError];
+      }
+      TestableExecutionInfo *info;
+      if (testableBuildSettings) {
+        info = [TestableExecutionInfo infoForTestable:testable
+                                        buildSettings:testableBuildSettings
+                                        simulatorInfo:_simulatorInfo
+                                 deferBatchableQuery:YES];
+      } else {
+        info = [[TestableExecutionInfo alloc] init];
+        info.testable = testable;
+        info.buildSettingsError = buildSettingsError ?: @"Unknown build settings error";
+      }
+      @synchronized (self) {
+        testableExecutionInfos[testableIndex] = info;
       }
 
-      succeeded &= blockSucceeded;
+      // Logic test bundles that have to be loaded to list their tests are set
+      // aside and queried together once every testable is collected, sharing
+      // otest-query processes rather than starting one per bundle.
+      if (!_listTestsOnly && !info.needsBatchedQuery) {
+        endCollectingStatus();
+        scheduleTestableExecutionInfo(info, testableIndex);
+      }
+
+      dispatch_semaphore_signal(collectLimiter);
+    });
+  }];
+
+  dispatch_group_wait(collectGroup, DISPATCH_TIME_FOREVER);
+  dispatch_release(collectGroup);
+  dispatch_release(collectLimiter);
+  dispatch_release(collectQueue);
+
+  NSMutableArray *deferredInfos = [NSMutableArray array];
+  for (id info in testableExecutionInfos) {
+    if ([info isKindOfClass:[TestableExecutionInfo class]] && [info needsBatchedQuery]) {
+      [deferredInfos addObject:info];
     }
-  };
+  }
+  if ([deferredInfos count] > 0) {
+    [TestableExecutionInfo queryTestCasesForInfos:deferredInfos];
+  }
+
+  endCollectingStatus();
 
-  for (NSArray *annotatedBlock in blocksToRunOnDispatchQueue) {
+  if (!_listTestsOnly) {
+    for (TestableExecutionInfo *info in deferredInfos) {
+      scheduleTestableExecutionInfo(info, [testableExecutionInfos indexOfObjectIdenticalTo:info]);
+    }
+  }
+
+  if (_listTestsOnly) {
+    return [self listTestsInTestableExecutionInfos:testableExecutionInfos options:options];
+  }
+
+  // Guided self-scheduling sizes batches by the amount of work left, so dynamic
+  // workers only start once every testable has been queried.
+  NSMutableArray *workerStats = [NSMutableArray array];
+  CFAbsoluteTime workersStartTime = CFAbsoluteTimeGetCurrent();
+  for (NSUInteger workerIndex = 0; hasDynamicWork && workerIndex < workerCount; workerIndex++) {
     dispatch_semaphore_wait(queueLimiter, DISPATCH_TIME_FOREVER);
     dispatch_group_async(group, q, ^{
-      TestableBlock block = annotatedBlock[0];
-      NSString *blockAnnotation = annotatedBlock[1];
-      runTestableBlockAndSaveSuccess(block, blockAnnotation);
+      CFTimeInterval busyTime = 0;
+      NSUInteger batchCount = 0;
+      TestWorkBatch *batch = nil;
+
+      while ((batch = [workQueue nextBatch])) {
+        CFAbsoluteTime batchStartTime = CFAbsoluteTimeGetCurrent();
+        TestableExecutionInfo *info = batch.context;
+        TestableBlock block = [self blockForTestable:info.testable
+                                    focusedTestCases:batch.testCases
+                                        allTestCases:info.testCases
+                               testableExecutionInfo:info
+                                      testableTarget:info.testable.target
+                                   isApplicationTest:NO
+                                           arguments:info.expandedArguments
+                                         environment:info.expandedEnvironment
+                                     testRunnerClass:[self testRunnerClassForBuildSettings:info.buildSettings]];
+        NSString *blockAnnotation = [NSString stringWithFormat:@"%@ (batch #%lu, %lu tests)",
+                                     info.buildSettings[Xcode_FULL_PRODUCT_NAME],
+                                     (unsigned long)batch.batchNumber,
+                                     (unsigned long)batch.testCases.count];
+        runTestableBlockAndSaveSuccess(block, blockAnnotation, YES);
+        busyTime += CFAbsoluteTimeGetCurrent() - batchStartTime;
+        batchCount++;
+      }
 
+      @synchronized (self) {
+        [workerStats addObject:@[@(workerIndex), @(batchCount), @(busyTime)]];
+      }
       dispatch_semaphore_signal(queueLimiter);
     });
   }
@@ -1050,35 +1860,93 @@ typedef BOOL (^TestableBlock)(NSArray *reporters);
   // Wait for logic tests to finish before we start running simulator tests.
   dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
 
-  // Resetting `_parallelize` value while running applicaiton tests.
-  //
-  // Application tests are run serially on the main thread so parallelize option
-  // will affect only the way reporters are notified about current status and
-  // test results. If parallelize is YES then reporters won't print anything to
-  // output until `block` is completed. If there is a deadlocking tests in the test
-  // suite then only `[INFO] Starting <TestSuite>` will be printed w/o specifying
-  // which test is actually locking test running.
-  BOOL originalParallelizeValue = _parallelize;
-  _parallelize = NO;
+  // Only logic tests run on warm workers, so they can all go away now.
+  [_warmTestWorkerPool terminateAllWorkers];
+  _warmTestWorkerPool = nil;
+
+  if (hasDynamicWork) {
+    CFTimeInterval wallTime = MAX(CFAbsoluteTimeGetCurrent() - workersStartTime, 0.001);
+    [workerStats sortUsingComparator:^NSComparisonResult(NSArray *a, NSArray *b) {
+      return [a[0] compare:b[0]];
+    }];
+    for (NSArray *stats in workerStats) {
+      ReportStatusMessage(options.reporters, REPORTER_MESSAGE_INFO,
+                          @"Worker #%lu ran %lu batches, busy %.1fs of %.1fs (%.0f%%)",
+                          [stats[0] unsignedLongValue] + 1,
+                          [stats[1] unsignedLongValue],
+                          [stats[2] doubleValue],
+                          wallTime,
+                          100.0 * [stats[2] doubleValue] / wallTime);
+    }
+  }
 
-  for (NSArray *annotatedBlock in blocksToRunOnMainThread) {
-    TestableBlock block = annotatedBlock[0];
-    NSString *blockAnnotation = annotatedBlock[1];
-    runTestableBlockAndSaveSuccess(block, blockAnnotation);
+  // Application tests are run serially on the main thread, unbuffered even when
+  // parallelizing, so parallelize option only affects logic tests. If output
+  // were buffered, reporters wouldn't print anything until `block` completed,
+  // and if there is a deadlocking test in the test suite then only
+  // `[INFO] Starting <TestSuite>` would be printed w/o specifying which test
+  // is actually locking test running.
+  for (NSArray *blocksToRunOnMainThread in blocksToRunOnMainThreadByTestable) {
+    for (NSArray *annotatedBlock in blocksToRunOnMainThread) {
+      TestableBlock block = annotatedBlock[0];
+      NSString *blockAnnotation = annotatedBlock[1];
+      runTestableBlockAndSaveSuccess(block, blockAnnotation, NO);
+    }
   }
 
-  // Restore `_parallelize` value.
-  _parallelize = originalParallelizeValue;
+  if ([_cancellation isCancelled]) {
+    ReportStatusMessage(options.reporters, REPORTER_MESSAGE_WARNING,
+                        @"Remaining tests were not run: %@", [_cancellation reason]);
+  }
 
+  if (appTestQueue) {
+    dispatch_release(appTestQueue);
+  }
+  if (simulatorPoolQueue) {
+    dispatch_release(simulatorPoolLimiter);
+    dispatch_release(simulatorPoolQueue);
+  }
+  dispatch_release(schedulerQueue);
   dispatch_release(group);
   dispatch_release(queueLimiter);
   dispatch_release(q);
 
+  for (SimulatorPool *pool in [_simulatorPools allValues]) {
+    [pool deleteCreatedDevicesWithReporters:options.reporters];
+  }
+
+  if ([self recordsTestDurations]) {
+    NSString *storeErrorMessage = nil;
+    if (![_testDurationStore writeWithErrorMessage:&storeErrorMessage]) {
+      ReportStatusMessage(options.reporters, REPORTER_MESSAGE_WARNING, @"%@", storeErrorMessage);
+    }
+  }
+
   [xcodeSubjectInfo.actionScripts postTestWithOptions:options];
 
   return succeeded;
 }
 
+/**
+ * Every shard balances against the same -testDurations file, so shards only
+ * read it: a shard writing back the timings of its own tests would change the
+ * partition the other shards compute.
+ */
+- (BOOL)recordsTestDurations
+{
+  return _testDurationStore != nil && _shardCount == 0;
+}
+
+- (NSArray *)testCasesOwnedByShard:(NSArray *)testCases
+              testableExecutionInfo:(TestableExecutionInfo *)info
+{
+  return ShardTestCases(testCases,
+                        (NSUInteger)_shardIndex,
+                        (NSUInteger)_shardCount,
+                        [_testDurationStore durationsForTarget:info.testable.target],
+                        info.testable.target);
+}
+
 - (BOOL)listTestsInTestableExecutionInfos:(NSArray *)testableExecutionInfos
                                   options:(Options *)options
 {
@@ -1086,7 +1954,18 @@ typedef BOOL (^TestableBlock)(NSArray *reporters);
     PublishEventToReporters(options.reporters,
                             [[self class] eventForBeginOCUnitFromTestableExecutionInfo:testableExecutionInfo action:self]);
 
-    for (NSString *testCase in testableExecutionInfo.testCases) {
+    NSArray *testCases = testableExecutionInfo.testCases;
+    if (_shardCount > 0 && testCases.count > 0) {
+      // List exactly what this shard would run, so that results from all
+      // shards can be reconciled against the lists.
+      testCases = [OCUnitTestRunner filterTestCases:testCases
+                                      onlyTestCases:testableExecutionInfo.testable.onlyTests
+                                   skippedTestCases:testableExecutionInfo.testable.skippedTests
+                                              error:nil] ?: @[];
+      testCases = [self testCasesOwnedByShard:testCases testableExecutionInfo:testableExecutionInfo];
+    }
+
+    for (NSString *testCase in testCases) {
       NSArray *components = [testCase componentsSeparatedByString:@"/"];
       NSString *className = components[0];
       NSString *methodName = components[1];
@@ -59,4 +59,13 @@
 - (NSArray *)sdksSupportedByDevice:(NSString *)deviceName;
 - (SimDevice *)deviceWithUDID:(NSUUID *)deviceUDID;
 
+/*
+ * Device instances of the same device type and runtime as `simulatedDevice`,
+ * e.g. to run several test buckets side by side.
+ */
+- (NSArray *)availableDevicesMatchingSimulatedDevice;
+- (SimDevice *)createDeviceMatchingSimulatedDeviceWithName:(NSString *)name
+                                                     error:(NSString **)error;
+- (BOOL)deleteDevice:(SimDevice *)device error:(NSString **)error;
+
 @end
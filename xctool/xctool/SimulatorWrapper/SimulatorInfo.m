@@ -115,6 +115,14 @@ static const NSInteger KProductTypeAppleTV = 3;
   _simulatedCpuType = 0;
 }
 
+- (void)setDeviceUDID:(NSUUID *)deviceUDID
+{
+  _deviceUDID = [deviceUDID copy];
+  // Forget any device resolved earlier so that a copy bound to a different
+  // device instance doesn't keep talking to the old one.
+  _simulatedDevice = nil;
+}
+
 - (NSString *)testHostPath
 {
   if (!_testHostPath) {
@@ -400,6 +408,49 @@ static const NSInteger KProductTypeAppleTV = 3;
   return nil;
 }
 
+- (NSArray *)availableDevicesMatchingSimulatedDevice
+{
+  SimDevice *simulatedDevice = [self simulatedDevice];
+  NSMutableArray *devices = [NSMutableArray array];
+  for (SimDevice *device in [_simulatedDeviceSet availableDevices]) {
+    if ([device.deviceType.identifier isEqual:simulatedDevice.deviceType.identifier] &&
+        [device.runtime.identifier isEqual:simulatedDevice.runtime.identifier]) {
+      [devices addObject:device];
+    }
+  }
+  return devices;
+}
+
+- (SimDevice *)createDeviceMatchingSimulatedDeviceWithName:(NSString *)name
+                                                     error:(NSString **)error
+{
+  SimDevice *simulatedDevice = [self simulatedDevice];
+  NSError *localError = nil;
+  SimDevice *device = [_simulatedDeviceSet createDeviceWithType:simulatedDevice.deviceType
+                                                        runtime:simulatedDevice.runtime
+                                                           name:name
+                                                          error:&localError];
+  if (device == nil && error) {
+    *error = [NSString stringWithFormat:@"Failed to create simulator '%@' (%@, %@): %@",
+              name, simulatedDevice.deviceType.name, simulatedDevice.runtime.name,
+              localError.localizedDescription ?: @"Failed for unknown reason."];
+  }
+  return device;
+}
+
+- (BOOL)deleteDevice:(SimDevice *)device error:(NSString **)error
+{
+  NSError *localError = nil;
+  if (![_simulatedDeviceSet deleteDevice:device error:&localError]) {
+    if (error) {
+      *error = [NSString stringWithFormat:@"Failed to delete simulator '%@': %@",
+                device.name, localError.localizedDescription ?: @"Failed for unknown reason."];
+    }
+    return NO;
+  }
+  return YES;
+}
+
 - (NSString *)deviceNameForAlias:(NSString *)deviceAlias
 {
   if (ToolchainIsXcode81OrBetter()) {
@@ -0,0 +1,80 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+@class SimDevice, SimulatorInfo;
+
+/**
+ * A fixed set of simulator device instances that application test buckets
+ * lease for the duration of a run, so that several buckets can run side by
+ * side, each on its own device.
+ *
+ * The pool also remembers which test hosts were installed on which device, so
+ * a test host only has to be installed once per device rather than once per
+ * bucket.
+ */
+@interface SimulatorPool : NSObject
+
+@property (nonatomic, copy, readonly) NSArray<SimDevice *> *devices;
+
+/**
+ * Builds a pool of `size` devices of the same device type and runtime as
+ * `simulatorInfo.simulatedDevice`.  Existing devices are reused; any missing
+ * ones are created and deleted again by `-deleteCreatedDevicesWithReporters:`.
+ *
+ * Returns nil and populates `error` if not a single device could be set up.
+ */
++ (instancetype)poolWithSimulatorInfo:(SimulatorInfo *)simulatorInfo
+                                 size:(NSUInteger)size
+                            reporters:(NSArray *)reporters
+                                error:(NSString **)error;
+
+- (instancetype)initWithDevices:(NSArray<SimDevice *> *)devices;
+
+/**
+ * Returns a device that no one else is using, blocking until one is returned
+ * to the pool if necessary.  The most recently returned device is handed out
+ * first since it's the most likely to still be booted with the test host
+ * installed.
+ */
+- (SimDevice *)leaseDevice;
+
+/**
+ * Returns a device obtained from `-leaseDevice` to the pool.
+ */
+- (void)returnDevice:(SimDevice *)device;
+
+- (BOOL)isTestHostBundleID:(NSString *)bundleID
+            fromBundlePath:(NSString *)bundlePath
+         installedOnDevice:(SimDevice *)device;
+
+- (void)setTestHostBundleID:(NSString *)bundleID
+             fromBundlePath:(NSString *)bundlePath
+          installedOnDevice:(SimDevice *)device;
+
+/**
+ * Forgets about test hosts installed on `device`, e.g. after its contents
+ * were erased.
+ */
+- (void)forgetInstalledTestHostsOnDevice:(SimDevice *)device;
+
+/**
+ * Deletes the devices that were created by `+poolWithSimulatorInfo:...`.
+ */
+- (void)deleteCreatedDevicesWithReporters:(NSArray *)reporters;
+
+@end
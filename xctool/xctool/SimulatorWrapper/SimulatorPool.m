@@ -0,0 +1,179 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "SimulatorPool.h"
+
+#import "ReportStatus.h"
+#import "SimDevice.h"
+#import "SimulatorInfo.h"
+
+@interface SimulatorPool ()
+@property (nonatomic, copy) NSArray<SimDevice *> *devices;
+@property (nonatomic, copy) NSArray<SimDevice *> *createdDevices;
+@property (nonatomic, strong) SimulatorInfo *simulatorInfo;
+@property (nonatomic, strong) NSMutableArray<SimDevice *> *freeDevices;
+// Map of device UDID -> set of "bundleID:bundlePath" strings.
+@property (nonatomic, strong) NSMutableDictionary<NSUUID *, NSMutableSet<NSString *> *> *installedTestHosts;
+@property (nonatomic, strong) NSCondition *freeDevicesCondition;
+@end
+
+@implementation SimulatorPool
+
++ (instancetype)poolWithSimulatorInfo:(SimulatorInfo *)simulatorInfo
+                                 size:(NSUInteger)size
+                            reporters:(NSArray *)reporters
+                                error:(NSString **)error
+{
+  NSMutableArray *devices = [NSMutableArray array];
+  for (SimDevice *device in [simulatorInfo availableDevicesMatchingSimulatedDevice]) {
+    if (devices.count == size) {
+      break;
+    }
+    [devices addObject:device];
+  }
+
+  NSMutableArray *createdDevices = [NSMutableArray array];
+  NSString *lastError = nil;
+  while (devices.count < size) {
+    NSString *name = [NSString stringWithFormat:@"xctool pool %lu (%@)",
+                      (unsigned long)devices.count + 1,
+                      [simulatorInfo simulatedDevice].name];
+    ReportStatusMessageBegin(reporters,
+                             REPORTER_MESSAGE_INFO,
+                             @"Creating simulator '%@' ...",
+                             name);
+    SimDevice *device = [simulatorInfo createDeviceMatchingSimulatedDeviceWithName:name
+                                                                              error:&lastError];
+    if (device == nil) {
+      ReportStatusMessageEnd(reporters,
+                             REPORTER_MESSAGE_WARNING,
+                             @"%@",
+                             lastError);
+      break;
+    }
+    ReportStatusMessageEnd(reporters,
+                           REPORTER_MESSAGE_INFO,
+                           @"Created simulator '%@' (%@).",
+                           name,
+                           [device.UDID UUIDString]);
+    [devices addObject:device];
+    [createdDevices addObject:device];
+  }
+
+  if (devices.count == 0) {
+    if (error) {
+      *error = lastError ?: @"No simulators available for the simulator pool.";
+    }
+    return nil;
+  }
+
+  if (devices.count < size) {
+    ReportStatusMessage(reporters,
+                        REPORTER_MESSAGE_WARNING,
+                        @"Simulator pool has %lu of %lu requested simulators.",
+                        (unsigned long)devices.count,
+                        (unsigned long)size);
+  }
+
+  SimulatorPool *pool = [[SimulatorPool alloc] initWithDevices:devices];
+  pool.createdDevices = createdDevices;
+  pool.simulatorInfo = simulatorInfo;
+  return pool;
+}
+
+- (instancetype)initWithDevices:(NSArray<SimDevice *> *)devices
+{
+  NSParameterAssert(devices.count > 0);
+  if (self = [super init]) {
+    _devices = [devices copy];
+    _createdDevices = @[];
+    // Reversed so that the first device is leased first.
+    _freeDevices = [[[devices reverseObjectEnumerator] allObjects] mutableCopy];
+    _installedTestHosts = [NSMutableDictionary dictionary];
+    _freeDevicesCondition = [[NSCondition alloc] init];
+  }
+  return self;
+}
+
+- (SimDevice *)leaseDevice
+{
+  [_freeDevicesCondition lock];
+  while (_freeDevices.count == 0) {
+    [_freeDevicesCondition wait];
+  }
+  SimDevice *device = [_freeDevices lastObject];
+  [_freeDevices removeLastObject];
+  [_freeDevicesCondition unlock];
+  return device;
+}
+
+- (void)returnDevice:(SimDevice *)device
+{
+  [_freeDevicesCondition lock];
+  NSAssert([_devices containsObject:device], @"Device %@ doesn't belong to the pool.", device);
+  NSAssert(![_freeDevices containsObject:device], @"Device %@ was returned twice.", device);
+  [_freeDevices addObject:device];
+  [_freeDevicesCondition signal];
+  [_freeDevicesCondition unlock];
+}
+
+static NSString *TestHostKey(NSString *bundleID, NSString *bundlePath)
+{
+  return [NSString stringWithFormat:@"%@:%@", bundleID, bundlePath];
+}
+
+- (BOOL)isTestHostBundleID:(NSString *)bundleID
+            fromBundlePath:(NSString *)bundlePath
+         installedOnDevice:(SimDevice *)device
+{
+  @synchronized (self) {
+    return [_installedTestHosts[device.UDID] containsObject:TestHostKey(bundleID, bundlePath)];
+  }
+}
+
+- (void)setTestHostBundleID:(NSString *)bundleID
+             fromBundlePath:(NSString *)bundlePath
+          installedOnDevice:(SimDevice *)device
+{
+  @synchronized (self) {
+    if (_installedTestHosts[device.UDID] == nil) {
+      _installedTestHosts[device.UDID] = [NSMutableSet set];
+    }
+    [_installedTestHosts[device.UDID] addObject:TestHostKey(bundleID, bundlePath)];
+  }
+}
+
+- (void)forgetInstalledTestHostsOnDevice:(SimDevice *)device
+{
+  @synchronized (self) {
+    [_installedTestHosts removeObjectForKey:device.UDID];
+  }
+}
+
+- (void)deleteCreatedDevicesWithReporters:(NSArray *)reporters
+{
+  for (SimDevice *device in _createdDevices) {
+    NSString *error = nil;
+    NSError *shutdownError = nil;
+    [device shutdownWithError:&shutdownError];
+    if (![_simulatorInfo deleteDevice:device error:&error]) {
+      ReportStatusMessage(reporters, REPORTER_MESSAGE_WARNING, @"%@", error);
+    }
+  }
+  _createdDevices = @[];
+}
+
+@end
@@ -19,6 +19,7 @@
 #import "TaskUtil.h"
 
 @class SimDevice;
+@class TestCancellation;
 
 @interface SimulatorWrapper : NSObject
 
@@ -32,6 +33,7 @@
  * @param arguments          Arguments to pass to the test host app.
  * @param environment        Environment to set of the test host app.
  * @param feedOutputToBlock  The block is called once for every line of output.
+ * @param cancellation       If set, the app is killed when it's cancelled.
  * @param testsSucceeded     If all tests ran and passed, this will be set to YES.
  *                           the tests, this will be set to YES.  Note that this
  *                           will be YES even if some tests failed.
@@ -41,7 +43,8 @@
                  device:(SimDevice *)device
               arguments:(NSArray *)arguments
             environment:(NSDictionary *)environment
-      feedOutputToBlock:(FdOutputLineFeedBlock)feedOutputToBlock
+      feedOutputToBlock:(TestOutputFeedBlock)feedOutputToBlock
+           cancellation:(TestCancellation *)cancellation
               reporters:(NSArray *)reporters
                   error:(NSError **)error;
 
@@ -50,6 +53,15 @@
                reporters:(NSArray *)reporters
                    error:(NSString **)error;
 
+/**
+ * Boots `device` headlessly, without going through Simulator.app, so that
+ * several devices can be booted side by side.  Does nothing if the device is
+ * already booted.
+ */
++ (BOOL)bootDevice:(SimDevice *)device
+         reporters:(NSArray *)reporters
+             error:(NSString **)error;
+
 + (BOOL)uninstallTestHostBundleID:(NSString *)testHostBundleID
                            device:(SimDevice *)device
                         reporters:(NSArray *)reporters
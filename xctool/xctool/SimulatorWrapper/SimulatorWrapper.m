@@ -19,11 +19,11 @@
 
 #import <sys/stat.h>
 
-#import "EventGenerator.h"
 #import "ReportStatus.h"
 #import "SimDevice.h"
 #import "SimulatorInfo.h"
 #import "SimulatorUtils.h"
+#import "TestCancellation.h"
 #import "XCToolUtil.h"
 #import "XcodeBuildSettings.h"
 
@@ -53,7 +53,8 @@ static const NSString * kOptionsWaitForDebuggerKey = @"wait_for_debugger";
                  device:(SimDevice *)device
               arguments:(NSArray *)arguments
             environment:(NSDictionary *)environment
-      feedOutputToBlock:(FdOutputLineFeedBlock)feedOutputToBlock
+      feedOutputToBlock:(TestOutputFeedBlock)feedOutputToBlock
+           cancellation:(TestCancellation *)cancellation
               reporters:(NSArray *)reporters
                   error:(NSError **)error
 {
@@ -137,23 +138,14 @@ static const NSString * kOptionsWaitForDebuggerKey = @"wait_for_debugger";
     dispatch_semaphore_signal(appSemaphore);
   });
   dispatch_resume(source);
+  [cancellation addProcessIdentifier:appPID];
 
   int otestShimOutputReadFD = open([otestShimOutputPath UTF8String], O_RDONLY);
   int simStdoutReadFD = open([simStdoutPath UTF8String], O_RDONLY);
   int fildes[2] = {simStdoutReadFD, otestShimOutputReadFD};
   dispatch_queue_t feedQueue = dispatch_queue_create("com.facebook.simulator_wrapper.feed", DISPATCH_QUEUE_SERIAL);
-  ReadOutputsAndFeedOuputLinesToBlockOnQueue(fildes, 2, ^(int fd, NSString *line) {
-    if (fd != otestShimOutputReadFD) {
-      NSDictionary *event = EventDictionaryWithNameAndContent(
-        kReporter_Events_SimulatorOuput,
-        @{kReporter_SimulatorOutput_OutputKey: StripAnsi([line stringByAppendingString:@"\n"])}
-      );
-      NSData *data = [NSJSONSerialization dataWithJSONObject:event options:0 error:nil];
-      line = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
-    }
-    if (line) {
-      feedOutputToBlock(fd, line);
-    }
+  ReadOutputsAndEventsAndFeedToBlockOnQueue(fildes, 2, otestShimOutputReadFD, ^(int fd, id output) {
+    feedOutputToBlock(fd == otestShimOutputReadFD ? TestOutputTypeEvent : TestOutputTypeRawLine, output);
   },
   // all events should be processed serially on the same queue
   feedQueue,
@@ -163,6 +155,7 @@ static const NSString * kOptionsWaitForDebuggerKey = @"wait_for_debugger";
   // simulator app doesn't close pipes properly so xctool
   // shouldn't wait for them to be closed after the app exits
   NO);
+  [cancellation removeProcessIdentifier:appPID];
 
   return  YES;
 }
@@ -197,6 +190,35 @@ static const NSString * kOptionsWaitForDebuggerKey = @"wait_for_debugger";
   return prepared;
 }
 
++ (BOOL)bootDevice:(SimDevice *)device
+         reporters:(NSArray *)reporters
+             error:(NSString **)error
+{
+  ReportStatusMessageBegin(reporters,
+                           REPORTER_MESSAGE_INFO,
+                           @"Booting '%@' (%@) ...",
+                           device.name,
+                           [device.UDID UUIDString]);
+
+  BOOL booted = [[self classBasedOnCurrentVersionOfXcode] bootDevice:device
+                                                           reporters:reporters
+                                                               error:error];
+  if (booted) {
+    ReportStatusMessageEnd(reporters,
+                           REPORTER_MESSAGE_INFO,
+                           @"Booted '%@' (%@).",
+                           device.name,
+                           [device.UDID UUIDString]);
+  } else {
+    ReportStatusMessageEnd(reporters,
+                           REPORTER_MESSAGE_WARNING,
+                           @"Failed to boot '%@' (%@).",
+                           device.name,
+                           [device.UDID UUIDString]);
+  }
+  return booted;
+}
+
 + (BOOL)uninstallTestHostBundleID:(NSString *)testHostBundleID
                            device:(SimDevice *)device
                         reporters:(NSArray *)reporters
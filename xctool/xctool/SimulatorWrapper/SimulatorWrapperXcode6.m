@@ -83,6 +83,59 @@
   return NO;
 }
 
++ (BOOL)bootDevice:(SimDevice *)device
+         reporters:(NSArray *)reporters
+             error:(NSString **)error
+{
+  if (!device.available) {
+    if (error) {
+      *error = [NSString stringWithFormat: @"Simulator '%@' is not available", device.name];
+    }
+    return NO;
+  }
+
+  if (device.state == SimDeviceStateBooted) {
+    return YES;
+  }
+
+  __block NSError *localError = nil;
+  __block BOOL booted = NO;
+  if (device.state == SimDeviceStateShutdown &&
+      !RunSimulatorBlockWithTimeout(^{
+    booted = [device bootWithOptions:nil error:&localError];
+  })) {
+    localError = [NSError errorWithDomain:@"com.facebook.xctool.sim.boot.timeout"
+                                     code:0
+                                 userInfo:@{
+      NSLocalizedDescriptionKey: @"Timed out.",
+    }];
+  }
+
+  // Another bucket may already be booting the device.
+  if (!booted && device.state != SimDeviceStateBooting) {
+    if (error) {
+      *error = [NSString stringWithFormat:@"Failed to boot simulator '%@': %@",
+                device.name, localError.localizedDescription ?: @"Failed for unknown reason."];
+    }
+    return NO;
+  }
+
+  int attempts = 300;
+  while (device.state != SimDeviceStateBooted && attempts > 0) {
+    [NSThread sleepForTimeInterval:0.1];
+    --attempts;
+  }
+
+  if (attempts > 0) {
+    return YES;
+  }
+
+  if (error) {
+    *error = @"Timed out while waiting simulator to boot.";
+  }
+  return NO;
+}
+
 #pragma mark -
 #pragma mark Main Methods
 
@@ -90,10 +90,42 @@
                          aliases:nil
                      description:@"Parallelize execution of tests"
                          setFlag:@selector(setParallelize:)],
+    [Action actionOptionWithName:@"dynamicBuckets"
+                         aliases:nil
+                     description:@"With -parallelize, hand out batches of logic test classes to workers as they become idle instead of precomputing buckets."
+                         setFlag:@selector(setDynamicBuckets:)],
+    [Action actionOptionWithName:@"overlapAppTests"
+                         aliases:nil
+                     description:@"With -parallelize, run application tests concurrently with logic tests instead of after them."
+                         setFlag:@selector(setOverlapAppTests:)],
+    [Action actionOptionWithName:@"warmTestWorkers"
+                         aliases:nil
+                     description:@"Run successive logic test buckets of a bundle in a long-lived xctest process instead of relaunching it for every bucket. Requires Xcode 7 or later and XCTest."
+                         setFlag:@selector(setWarmTestWorkers:)],
+    [Action actionOptionWithName:@"failFast"
+                         aliases:nil
+                     description:@"Stop after the first failing test: queued buckets are skipped, running test processes are killed, and the remaining tests are reported as cancelled."
+                         setFlag:@selector(setFailFast:)],
+    [Action actionOptionWithMatcher:^(NSString *argument){
+      return [argument hasPrefix:@"failFast="];
+    }
+                        description:@"Like -failFast, but stop after N failing tests."
+                          paramName:@"-failFast=N"
+                              mapTo:@selector(setFailFastValue:)],
     [Action actionOptionWithName:@"failOnEmptyTestBundles"
                          aliases:nil
                      description:@"Fail when an empty test bundle was run."
                          setFlag:@selector(setFailOnEmptyTestBundles:)],
+    [Action actionOptionWithName:@"retryFailures"
+                         aliases:nil
+                     description:@"Run each failing test up to N more times, each time in a fresh process. Tests that pass on a retry are reported as flaky passes."
+                       paramName:@"N"
+                           mapTo:@selector(setRetryFailures:)],
+    [Action actionOptionWithName:@"bisectCrashes"
+                         aliases:nil
+                     description:@"When a test process crashes between tests, rerun the tests that ran before the crash in halves to find the one that caused it, launching at most N extra processes per bucket."
+                       paramName:@"N"
+                           mapTo:@selector(setBisectCrashes:)],
     [Action actionOptionWithName:@"logicTestBucketSize"
                          aliases:nil
                      description:@"Break logic test bundles in buckets of N test cases."
@@ -104,11 +136,26 @@
                      description:@"Break app test bundles in buckets of N test cases."
                        paramName:@"N"
                            mapTo:@selector(setAppTestBucketSize:)],
+    [Action actionOptionWithName:@"simulatorPoolSize"
+                         aliases:nil
+                     description:@"With -parallelize, run iOS app test buckets side by side on a pool of N simulators of the requested device type and runtime."
+                       paramName:@"N"
+                           mapTo:@selector(setSimulatorPoolSize:)],
+    [Action actionOptionWithName:@"shard"
+                         aliases:nil
+                     description:@"Only run the tests of shard INDEX (0-based) of COUNT. Every host computes the same partition of test classes, balanced by -testDurations when given."
+                       paramName:@"INDEX/COUNT"
+                           mapTo:@selector(setShard:)],
     [Action actionOptionWithName:@"bucketBy"
                          aliases:nil
-                     description:@"Either 'case' (default) or 'class'."
+                     description:@"Either 'case' (default), 'class', 'duration' or 'classDuration'. The duration modes balance buckets using -testDurations."
                        paramName:@"BUCKETBY"
                            mapTo:@selector(setBucketBy:)],
+    [Action actionOptionWithName:@"testDurations"
+                         aliases:nil
+                     description:@"Read per-test durations from (and record them back to) the JSON file at PATH. With -shard, the file is only read."
+                       paramName:@"PATH"
+                           mapTo:@selector(setTestDurations:)],
     [Action actionOptionWithName:@"listTestsOnly"
                          aliases:nil
                      description:@"Skip actual test running and list them only."
@@ -175,6 +222,31 @@
   [_runTestsAction setParallelize:parallelize];
 }
 
+- (void)setDynamicBuckets:(BOOL)dynamicBuckets
+{
+  [_runTestsAction setDynamicBuckets:dynamicBuckets];
+}
+
+- (void)setOverlapAppTests:(BOOL)overlapAppTests
+{
+  [_runTestsAction setOverlapAppTests:overlapAppTests];
+}
+
+- (void)setWarmTestWorkers:(BOOL)warmTestWorkers
+{
+  [_runTestsAction setWarmTestWorkers:warmTestWorkers];
+}
+
+- (void)setFailFast:(BOOL)failFast
+{
+  [_runTestsAction setFailFast:failFast];
+}
+
+- (void)setFailFastValue:(NSString *)str
+{
+  [_runTestsAction setFailFastValue:str];
+}
+
 - (void)setLogicTestBucketSize:(NSString *)bucketSize
 {
   [_runTestsAction setLogicTestBucketSizeValue:bucketSize];
@@ -185,11 +257,36 @@
   [_runTestsAction setAppTestBucketSizeValue:bucketSize];
 }
 
+- (void)setSimulatorPoolSize:(NSString *)poolSize
+{
+  [_runTestsAction setSimulatorPoolSizeValue:poolSize];
+}
+
+- (void)setRetryFailures:(NSString *)str
+{
+  [_runTestsAction setRetryFailuresValue:str];
+}
+
+- (void)setBisectCrashes:(NSString *)str
+{
+  [_runTestsAction setBisectCrashesValue:str];
+}
+
+- (void)setShard:(NSString *)str
+{
+  [_runTestsAction setShardValue:str];
+}
+
 - (void)setBucketBy:(NSString *)str
 {
   [_runTestsAction setBucketByValue:str];
 }
 
+- (void)setTestDurations:(NSString *)path
+{
+  [_runTestsAction setTestDurationsPath:path];
+}
+
 - (void)setSkipDependencies:(BOOL)skipDependencies
 {
   _buildTestsAction.skipDependencies = skipDependencies;
@@ -0,0 +1,60 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "EventSink.h"
+
+/**
+ * Lets a test run be cut short, as with -failFast.
+ *
+ * As an EventSink it counts failing `end-test` events, and once `maxFailures`
+ * is reached it cancels the run: every registered NSTask and process is
+ * terminated, and test runners that check `isCancelled` report their
+ * remaining tests as cancelled instead of running them.
+ */
+@interface TestCancellation : NSObject <EventSink>
+
+@property (nonatomic, assign, readonly) NSUInteger maxFailures;
+
+- (instancetype)initWithMaxFailures:(NSUInteger)maxFailures;
+
+- (BOOL)isCancelled;
+
+/**
+ * Human readable explanation of why the run was cancelled, or nil.
+ */
+- (NSString *)reason;
+
+- (void)cancelWithReason:(NSString *)reason;
+
+/**
+ * Registers a task to be terminated if the run is cancelled.  Tasks may be
+ * added before they're launched; one cancelled before launching (or added
+ * after cancelling) is terminated as soon as it launches.  Tasks should be
+ * removed once they have exited.
+ */
+- (void)addTask:(NSTask *)task;
+- (void)removeTask:(NSTask *)task;
+
+/**
+ * Like `-addTask:`, for processes we only know by pid (e.g. test host apps
+ * launched in the simulator).
+ */
+- (void)addProcessIdentifier:(pid_t)pid;
+- (void)removeProcessIdentifier:(pid_t)pid;
+
+@end
@@ -0,0 +1,174 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "TestCancellation.h"
+
+#import <signal.h>
+
+#import "ReporterEvents.h"
+
+@interface TestCancellation ()
+@property (nonatomic, assign, readwrite) NSUInteger maxFailures;
+@property (nonatomic, assign) NSUInteger failureCount;
+@property (nonatomic, copy) NSString *cancellationReason;
+@property (nonatomic, strong) NSMutableSet<NSTask *> *tasks;
+@property (nonatomic, strong) NSMutableSet<NSNumber *> *processIdentifiers;
+@end
+
+@implementation TestCancellation
+
+- (instancetype)initWithMaxFailures:(NSUInteger)maxFailures
+{
+  if (self = [super init]) {
+    _maxFailures = MAX(maxFailures, (NSUInteger)1);
+    _tasks = [NSMutableSet set];
+    _processIdentifiers = [NSMutableSet set];
+  }
+  return self;
+}
+
+- (BOOL)isCancelled
+{
+  @synchronized (self) {
+    return _cancellationReason != nil;
+  }
+}
+
+- (NSString *)reason
+{
+  @synchronized (self) {
+    return _cancellationReason;
+  }
+}
+
+- (void)cancelWithReason:(NSString *)reason
+{
+  NSArray *tasks = nil;
+  NSArray *processIdentifiers = nil;
+
+  @synchronized (self) {
+    if (_cancellationReason != nil) {
+      return;
+    }
+    _cancellationReason = [reason copy];
+    tasks = [_tasks allObjects];
+    processIdentifiers = [_processIdentifiers allObjects];
+  }
+
+  for (NSTask *task in tasks) {
+    [self terminateTaskOnceLaunched:task];
+  }
+  for (NSNumber *pid in processIdentifiers) {
+    kill([pid intValue], SIGKILL);
+  }
+}
+
+/**
+ * Tasks are registered before they're launched, and the launch happens deep
+ * inside whatever runs them.  A task cancelled in between must still die, so
+ * if it isn't running yet, wait for it to be, until it's removed.
+ */
+- (void)terminateTaskOnceLaunched:(NSTask *)task
+{
+  if ([task isRunning]) {
+    [task terminate];
+    return;
+  }
+
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    for (;;) {
+      @synchronized (self) {
+        if (![_tasks containsObject:task]) {
+          return;
+        }
+      }
+      if ([task isRunning]) {
+        [task terminate];
+        return;
+      }
+      usleep(10 * 1000);
+    }
+  });
+}
+
+- (void)addTask:(NSTask *)task
+{
+  BOOL cancelled = NO;
+  @synchronized (self) {
+    [_tasks addObject:task];
+    cancelled = (_cancellationReason != nil);
+  }
+
+  // Added after we cancelled; don't let it run.
+  if (cancelled) {
+    [self terminateTaskOnceLaunched:task];
+  }
+}
+
+- (void)removeTask:(NSTask *)task
+{
+  @synchronized (self) {
+    [_tasks removeObject:task];
+  }
+}
+
+- (void)addProcessIdentifier:(pid_t)pid
+{
+  BOOL cancelled = NO;
+  @synchronized (self) {
+    cancelled = (_cancellationReason != nil);
+    if (!cancelled) {
+      [_processIdentifiers addObject:@(pid)];
+    }
+  }
+
+  // The process was launched after we cancelled; don't let it run.
+  if (cancelled) {
+    kill(pid, SIGKILL);
+  }
+}
+
+- (void)removeProcessIdentifier:(pid_t)pid
+{
+  @synchronized (self) {
+    [_processIdentifiers removeObject:@(pid)];
+  }
+}
+
+#pragma mark EventSink
+
+- (void)publishDataForEvent:(NSData *)data
+{
+  NSDictionary *event = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+  if (![event[kReporter_Event_Key] isEqualToString:kReporter_Events_EndTest] ||
+      [event[kReporter_EndTest_SucceededKey] boolValue]) {
+    return;
+  }
+
+  NSUInteger failureCount = 0;
+  @synchronized (self) {
+    failureCount = ++_failureCount;
+  }
+
+  if (failureCount == _maxFailures) {
+    [self cancelWithReason:[NSString stringWithFormat:
+                            @"the run was cancelled after %lu failing test%@ (-failFast).",
+                            (unsigned long)failureCount,
+                            failureCount == 1 ? @"" : @"s"]];
+  }
+}
+
+@end
@@ -0,0 +1,63 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "EventSink.h"
+
+/**
+ * Persisted per-test timings, keyed by test target and then by test case
+ * ("Class/method").
+ *
+ * The store is also an EventSink: when added to the list of reporters it
+ * records the `totalDuration` of every `end-test` event, attributing it to the
+ * target named by the enclosing `begin-ocunit` event.  Events must therefore be
+ * published in per-bundle order, which is what EventBuffer guarantees; with
+ * -streamParallelOutput, events are matched up by their bucket id instead.
+ *
+ * On disk the store is a JSON dictionary of the form:
+ *
+ *   {"TargetName": {"Class/method": 0.25, ...}, ...}
+ */
+@interface TestDurationStore : NSObject <EventSink>
+
+/**
+ * Path the store was loaded from and will be written back to.
+ */
+@property (nonatomic, copy, readonly) NSString *path;
+
+/**
+ * Loads the store at `path`.  A missing file yields an empty store; an
+ * unreadable or malformed file returns nil and populates `errorMessage`.
+ */
++ (instancetype)storeWithContentsOfFile:(NSString *)path
+                           errorMessage:(NSString **)errorMessage;
+
+/**
+ * Returns a map of "Class/method" -> duration (in seconds) for the target.
+ */
+- (NSDictionary<NSString *, NSNumber *> *)durationsForTarget:(NSString *)target;
+
+- (void)setDuration:(NSTimeInterval)duration
+        forTestCase:(NSString *)testCase
+             target:(NSString *)target;
+
+/**
+ * Atomically writes the store back to `path`.
+ */
+- (BOOL)writeWithErrorMessage:(NSString **)errorMessage;
+
+@end
@@ -0,0 +1,138 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "TestDurationStore.h"
+
+#import "ReporterEvents.h"
+
+@interface TestDurationStore ()
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, NSNumber *> *> *durationsByTarget;
+// Bucket id (or NSNull for untagged events) -> target of its current
+// begin-ocunit, since with -streamParallelOutput buckets' events interleave.
+@property (nonatomic, strong) NSMutableDictionary<id, NSString *> *currentTargets;
+@end
+
+@implementation TestDurationStore
+
++ (instancetype)storeWithContentsOfFile:(NSString *)path
+                           errorMessage:(NSString **)errorMessage
+{
+  TestDurationStore *store = [[TestDurationStore alloc] init];
+  store.path = path;
+  store.durationsByTarget = [NSMutableDictionary dictionary];
+  store.currentTargets = [NSMutableDictionary dictionary];
+
+  if (![[NSFileManager defaultManager] fileExistsAtPath:path]) {
+    return store;
+  }
+
+  NSError *error = nil;
+  NSData *data = [NSData dataWithContentsOfFile:path options:0 error:&error];
+  if (data == nil) {
+    *errorMessage = [NSString stringWithFormat:@"Failed to read test durations from '%@': %@",
+                     path, [error localizedDescription]];
+    return nil;
+  }
+
+  id contents = [NSJSONSerialization JSONObjectWithData:data options:0 error:&error];
+  if (![contents isKindOfClass:[NSDictionary class]]) {
+    *errorMessage = [NSString stringWithFormat:@"Test durations file '%@' is not a JSON dictionary: %@",
+                     path, [error localizedDescription] ?: @"unexpected top-level type"];
+    return nil;
+  }
+
+  for (NSString *target in contents) {
+    NSDictionary *durations = contents[target];
+    if (![durations isKindOfClass:[NSDictionary class]]) {
+      *errorMessage = [NSString stringWithFormat:@"Test durations file '%@' has malformed entry for target '%@'.",
+                       path, target];
+      return nil;
+    }
+    store.durationsByTarget[target] = [durations mutableCopy];
+  }
+
+  return store;
+}
+
+- (NSDictionary<NSString *, NSNumber *> *)durationsForTarget:(NSString *)target
+{
+  @synchronized (self) {
+    return [_durationsByTarget[target] copy] ?: @{};
+  }
+}
+
+- (void)setDuration:(NSTimeInterval)duration
+        forTestCase:(NSString *)testCase
+             target:(NSString *)target
+{
+  @synchronized (self) {
+    if (_durationsByTarget[target] == nil) {
+      _durationsByTarget[target] = [NSMutableDictionary dictionary];
+    }
+    _durationsByTarget[target][testCase] = @(duration);
+  }
+}
+
+- (BOOL)writeWithErrorMessage:(NSString **)errorMessage
+{
+  NSData *data = nil;
+  @synchronized (self) {
+    NSError *error = nil;
+    data = [NSJSONSerialization dataWithJSONObject:_durationsByTarget
+                                           options:NSJSONWritingPrettyPrinted
+                                             error:&error];
+    if (data == nil) {
+      *errorMessage = [NSString stringWithFormat:@"Failed to encode test durations: %@",
+                       [error localizedDescription]];
+      return NO;
+    }
+  }
+
+  NSError *error = nil;
+  if (![data writeToFile:_path options:NSDataWritingAtomic error:&error]) {
+    *errorMessage = [NSString stringWithFormat:@"Failed to write test durations to '%@': %@",
+                     _path, [error localizedDescription]];
+    return NO;
+  }
+  return YES;
+}
+
+#pragma mark EventSink
+
+- (void)publishDataForEvent:(NSData *)data
+{
+  NSDictionary *event = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+  NSString *eventName = event[kReporter_Event_Key];
+  id bucket = event[kReporter_BucketKey] ?: [NSNull null];
+
+  @synchronized (self) {
+    if ([eventName isEqualToString:kReporter_Events_BeginOCUnit]) {
+      _currentTargets[bucket] = event[kReporter_BeginOCUnit_TargetNameKey];
+    } else if ([eventName isEqualToString:kReporter_Events_EndOCUnit]) {
+      [_currentTargets removeObjectForKey:bucket];
+    } else if ([eventName isEqualToString:kReporter_Events_EndTest] && _currentTargets[bucket] != nil) {
+      NSString *testCase = [NSString stringWithFormat:@"%@/%@",
+                            event[kReporter_EndTest_ClassNameKey],
+                            event[kReporter_EndTest_MethodNameKey]];
+      [self setDuration:[event[kReporter_EndTest_TotalDurationKey] doubleValue]
+            forTestCase:testCase
+                 target:_currentTargets[bucket]];
+    }
+  }
+}
+
+@end
@@ -0,0 +1,65 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "ContentAddressedCache.h"
+
+/**
+ * On-disk cache of otest-query results.
+ *
+ * The key is a SHA-256 over the query runner class, the SDK and Xcode in use,
+ * and the contents of the test bundle's executable, the test host's
+ * executable and every framework or dylib they link from the build products.
+ */
+@interface TestListCache : ContentAddressedCache
+
+/**
+ * Cache under ~/Library/Caches/xctool/test-lists, or nil if caching is
+ * disabled (when running under test, or when XCTOOL_DISABLE_TEST_LIST_CACHE
+ * is set), unless replaced with `+setSharedCache:`.
+ */
++ (instancetype)sharedCache;
+
+/**
+ * Replaces the shared cache, e.g. so tests can exercise it against a
+ * temporary directory.  Passing nil disables caching.
+ */
++ (void)setSharedCache:(TestListCache *)cache;
+
+- (instancetype)initWithDirectory:(NSString *)directory;
+
+/**
+ * Returns the key for querying the bundle at `bundlePath` with `runnerClass`,
+ * or nil if the bundle's executable can't be read.
+ *
+ * @param testHostPath Path to the test host executable, or nil for logic tests.
+ * @param buildSettings Test target's build settings; used for the SDK and to
+ *   find linked frameworks in BUILT_PRODUCTS_DIR.
+ */
+- (NSString *)keyForQueryRunnerClass:(Class)runnerClass
+                          bundlePath:(NSString *)bundlePath
+                        testHostPath:(NSString *)testHostPath
+                       buildSettings:(NSDictionary *)buildSettings;
+
+/**
+ * Returns the cached list of "Class/method" test cases, or nil on a miss.
+ */
+- (NSArray *)testCasesForKey:(NSString *)key;
+
+- (void)setTestCases:(NSArray *)testCases forKey:(NSString *)key;
+
+@end
@@ -0,0 +1,315 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "TestListCache.h"
+
+#import <CommonCrypto/CommonDigest.h>
+#import <libkern/OSByteOrder.h>
+#import <mach-o/fat.h>
+#import <mach-o/loader.h>
+
+#import "XCToolUtil.h"
+#import "XcodeBuildSettings.h"
+
+// Bump whenever the key derivation or the entry format changes.
+static NSString *const kTestListCacheVersion = @"1";
+
+// A bundle's tests only change when it's rebuilt, so keep entries a month.
+static const NSTimeInterval kTestListCacheMaxEntryAge = 30 * 24 * 60 * 60;
+
+static NSString *DigestForData(NSData *data)
+{
+  CC_SHA256_CTX context;
+  CC_SHA256_Init(&context);
+  // CC_LONG is 32 bits wide, so feed very large binaries in chunks.
+  const size_t chunkSize = 64 * 1024 * 1024;
+  for (size_t offset = 0; offset < data.length; offset += chunkSize) {
+    CC_SHA256_Update(&context,
+                     (const uint8_t *)data.bytes + offset,
+                     (CC_LONG)MIN(chunkSize, data.length - offset));
+  }
+  uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256_Final(digest, &context);
+  return HexStringForDigest(digest, sizeof(digest));
+}
+
+/**
+ * Adds the install names of all dylibs linked by the thin Mach-O image at
+ * `bytes` that are relative to the image (@rpath, @loader_path, ...).  System
+ * libraries are covered by the SDK and Xcode parts of the key instead.
+ */
+static void CollectRelativeDylibReferencesFromImage(const uint8_t *bytes,
+                                                    size_t length,
+                                                    NSMutableOrderedSet *references)
+{
+  if (length < sizeof(struct mach_header)) {
+    return;
+  }
+
+  const struct mach_header *header = (const struct mach_header *)bytes;
+  size_t offset = 0;
+  if (header->magic == MH_MAGIC_64) {
+    offset = sizeof(struct mach_header_64);
+  } else if (header->magic == MH_MAGIC) {
+    offset = sizeof(struct mach_header);
+  } else {
+    return;
+  }
+
+  for (uint32_t i = 0; i < header->ncmds; i++) {
+    if (offset + sizeof(struct load_command) > length) {
+      return;
+    }
+    const struct load_command *command = (const struct load_command *)(bytes + offset);
+    if (command->cmdsize < sizeof(struct load_command) ||
+        offset + command->cmdsize > length) {
+      return;
+    }
+
+    switch (command->cmd) {
+      case LC_LOAD_DYLIB:
+      case LC_LOAD_WEAK_DYLIB:
+      case LC_REEXPORT_DYLIB:
+      case LC_LAZY_LOAD_DYLIB:
+      case LC_LOAD_UPWARD_DYLIB: {
+        const struct dylib_command *dylibCommand = (const struct dylib_command *)command;
+        uint32_t nameOffset = dylibCommand->dylib.name.offset;
+        if (command->cmdsize < sizeof(struct dylib_command) || nameOffset >= command->cmdsize) {
+          break;
+        }
+        const char *name = (const char *)command + nameOffset;
+        NSString *reference = [[NSString alloc] initWithBytes:name
+                                                       length:strnlen(name, command->cmdsize - nameOffset)
+                                                     encoding:NSUTF8StringEncoding];
+        if ([reference hasPrefix:@"@"]) {
+          [references addObject:reference];
+        }
+        break;
+      }
+    }
+
+    offset += command->cmdsize;
+  }
+}
+
+static NSOrderedSet *RelativeDylibReferencesForBinary(NSData *data)
+{
+  NSMutableOrderedSet *references = [NSMutableOrderedSet orderedSet];
+  const uint8_t *bytes = data.bytes;
+  size_t length = data.length;
+
+  if (length >= sizeof(struct fat_header) &&
+      OSSwapBigToHostInt32(((const struct fat_header *)bytes)->magic) == FAT_MAGIC) {
+    // Fat headers are always big-endian.
+    uint32_t archCount = OSSwapBigToHostInt32(((const struct fat_header *)bytes)->nfat_arch);
+    const struct fat_arch *archs = (const struct fat_arch *)(bytes + sizeof(struct fat_header));
+    for (uint32_t i = 0; i < archCount; i++) {
+      if (sizeof(struct fat_header) + (i + 1) * sizeof(struct fat_arch) > length) {
+        break;
+      }
+      uint32_t archOffset = OSSwapBigToHostInt32(archs[i].offset);
+      uint32_t archSize = OSSwapBigToHostInt32(archs[i].size);
+      if (archOffset > length || archSize > length - archOffset) {
+        continue;
+      }
+      CollectRelativeDylibReferencesFromImage(bytes + archOffset, archSize, references);
+    }
+  } else {
+    CollectRelativeDylibReferencesFromImage(bytes, length, references);
+  }
+
+  return references;
+}
+
+/**
+ * "@rpath/Foo.framework/Versions/A/Foo" -> "Foo.framework/Versions/A/Foo",
+ * "@executable_path/../Frameworks/libBar.dylib" -> "libBar.dylib".
+ */
+static NSString *RelativePathForDylibReference(NSString *reference)
+{
+  NSArray *components = [reference pathComponents];
+  for (NSUInteger i = 0; i < components.count; i++) {
+    if ([components[i] hasSuffix:@".framework"]) {
+      return [NSString pathWithComponents:
+              [components subarrayWithRange:NSMakeRange(i, components.count - i)]];
+    }
+  }
+  return [reference lastPathComponent];
+}
+
+/**
+ * Identifies the otest-query binaries in use, so that upgrading xctool doesn't
+ * serve listings produced by an older query tool.
+ */
+static NSString *OtestQueryIdentity(void)
+{
+  static NSString *identity = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSMutableArray *parts = [NSMutableArray array];
+    NSArray *names = [[fileManager contentsOfDirectoryAtPath:XCToolLibPath() error:nil]
+                      sortedArrayUsingSelector:@selector(compare:)];
+    for (NSString *name in names) {
+      if (![name hasPrefix:@"otest-query"]) {
+        continue;
+      }
+      NSDictionary *attributes = [fileManager attributesOfItemAtPath:[XCToolLibPath() stringByAppendingPathComponent:name]
+                                                                error:nil];
+      [parts addObject:[NSString stringWithFormat:@"%@:%llu:%f",
+                        name,
+                        [attributes fileSize],
+                        [[attributes fileModificationDate] timeIntervalSince1970]]];
+    }
+    identity = [parts componentsJoinedByString:@","];
+  });
+  return identity;
+}
+
+static TestListCache *DefaultSharedCache(void)
+{
+  if (IsRunningUnderTest() ||
+      [[NSProcessInfo processInfo] environment][@"XCTOOL_DISABLE_TEST_LIST_CACHE"] != nil) {
+    return nil;
+  }
+  NSString *cachesPath = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+  if (cachesPath == nil) {
+    return nil;
+  }
+  return [[TestListCache alloc] initWithDirectory:
+          [cachesPath stringByAppendingPathComponent:@"xctool/test-lists"]];
+}
+
+static TestListCache *__sharedCache = nil;
+static BOOL __sharedCacheIsSet = NO;
+
+@implementation TestListCache
+
++ (instancetype)sharedCache
+{
+  @synchronized ([TestListCache class]) {
+    if (!__sharedCacheIsSet) {
+      __sharedCache = DefaultSharedCache();
+      __sharedCacheIsSet = YES;
+    }
+    return __sharedCache;
+  }
+}
+
++ (void)setSharedCache:(TestListCache *)cache
+{
+  @synchronized ([TestListCache class]) {
+    __sharedCache = cache;
+    __sharedCacheIsSet = YES;
+  }
+}
+
+- (instancetype)initWithDirectory:(NSString *)directory
+{
+  return [super initWithDirectory:directory maxEntryAge:kTestListCacheMaxEntryAge];
+}
+
+- (NSString *)keyForQueryRunnerClass:(Class)runnerClass
+                          bundlePath:(NSString *)bundlePath
+                        testHostPath:(NSString *)testHostPath
+                       buildSettings:(NSDictionary *)buildSettings
+{
+  NSString *executablePath = [[NSBundle bundleWithPath:bundlePath] executablePath];
+  if (executablePath == nil) {
+    return nil;
+  }
+
+  NSMutableArray *searchDirectories = [NSMutableArray array];
+  if (buildSettings[Xcode_BUILT_PRODUCTS_DIR]) {
+    [searchDirectories addObject:buildSettings[Xcode_BUILT_PRODUCTS_DIR]];
+  }
+  [searchDirectories addObject:[bundlePath stringByAppendingPathComponent:@"Frameworks"]];
+  [searchDirectories addObject:[bundlePath stringByAppendingPathComponent:@"Contents/Frameworks"]];
+
+  NSMutableArray *binaryPaths = [NSMutableArray arrayWithObject:executablePath];
+  if (testHostPath) {
+    NSString *hostDirectory = [testHostPath stringByDeletingLastPathComponent];
+    [searchDirectories addObject:[hostDirectory stringByAppendingPathComponent:@"Frameworks"]];
+    [searchDirectories addObject:[[hostDirectory stringByAppendingPathComponent:@"../Frameworks"] stringByStandardizingPath]];
+    [binaryPaths addObject:testHostPath];
+  }
+
+  CC_SHA256_CTX context;
+  CC_SHA256_Init(&context);
+  UpdateDigestWithString(&context, kTestListCacheVersion);
+  UpdateDigestWithString(&context, NSStringFromClass(runnerClass));
+  UpdateDigestWithString(&context, buildSettings[Xcode_SDK_NAME] ?: @"");
+  UpdateDigestWithString(&context, XcodeDeveloperDirPath());
+  UpdateDigestWithString(&context, OtestQueryIdentity());
+
+  // Walk the binaries and, transitively, whatever they link from the build
+  // products.  References that don't resolve to a file are left to dyld.
+  NSMutableSet *visitedPaths = [NSMutableSet set];
+  for (NSUInteger i = 0; i < binaryPaths.count; i++) {
+    NSString *path = binaryPaths[i];
+    if ([visitedPaths containsObject:path]) {
+      continue;
+    }
+    [visitedPaths addObject:path];
+
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+    if (data == nil) {
+      // Only the bundle and the host are required; both are checked first.
+      if (i < (testHostPath ? 2 : 1)) {
+        return nil;
+      }
+      continue;
+    }
+    UpdateDigestWithString(&context, [NSString stringWithFormat:@"%@=%@",
+                                      [path lastPathComponent], DigestForData(data)]);
+
+    for (NSString *reference in RelativeDylibReferencesForBinary(data)) {
+      NSString *relativePath = RelativePathForDylibReference(reference);
+      for (NSString *directory in searchDirectories) {
+        NSString *candidate = [directory stringByAppendingPathComponent:relativePath];
+        if ([[NSFileManager defaultManager] fileExistsAtPath:candidate]) {
+          [binaryPaths addObject:candidate];
+          break;
+        }
+      }
+    }
+  }
+
+  uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256_Final(digest, &context);
+  return HexStringForDigest(digest, sizeof(digest));
+}
+
+- (NSArray *)testCasesForKey:(NSString *)key
+{
+  NSArray *testCases = [self JSONObjectForKey:key];
+  if (![testCases isKindOfClass:[NSArray class]]) {
+    return nil;
+  }
+  for (id testCase in testCases) {
+    if (![testCase isKindOfClass:[NSString class]]) {
+      return nil;
+    }
+  }
+  return testCases;
+}
+
+- (void)setTestCases:(NSArray *)testCases forKey:(NSString *)key
+{
+  [self setJSONObject:testCases forKey:key];
+}
+
+@end
@@ -0,0 +1,61 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "EventSink.h"
+
+/**
+ * Sits in front of the reporters of a test run when failed tests are retried.
+ *
+ * Events go straight through until a test fails.  From then on everything
+ * is held back until the failing tests have been retried, so reporters still
+ * see tests in the order they ran.  `-flush` then publishes the held events,
+ * with each failed test in its original place with its final outcome: a test
+ * that passed on a retry is reported as a flaky pass, one that never passed
+ * as a hard failure.  Either way its `end-test` event carries the number of
+ * attempts that were made, and the counts of the `end-test-suite` events
+ * around it are corrected to match.
+ */
+@interface TestRetryBuffer : NSObject <EventSink>
+
+- (instancetype)initWithReporters:(NSArray *)reporters;
+
+/**
+ * Held test cases ("Class/method") that haven't passed yet, in the order they
+ * originally ran.
+ */
+- (NSArray *)failedTestCases;
+
+/**
+ * Records the outcome of running `testCase` once more.  `output` is what the
+ * test printed on that attempt.
+ */
+- (void)recordAttemptOfTestCase:(NSString *)testCase
+                      succeeded:(BOOL)succeeded
+                         output:(NSString *)output;
+
+/**
+ * YES if every test that failed has since passed on a retry.
+ */
+- (BOOL)allFailedTestsPassedOnRetry;
+
+/**
+ * Publishes all held events, with final outcomes, to the reporters.
+ */
+- (void)flush;
+
+@end
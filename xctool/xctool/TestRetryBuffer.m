@@ -0,0 +1,249 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "TestRetryBuffer.h"
+
+#import "EventGenerator.h"
+#import "ReporterEvents.h"
+#import "XCToolUtil.h"
+
+@interface TestRetryBufferEntry : NSObject
+@property (nonatomic, copy) NSString *testCase;
+@property (nonatomic, strong) NSMutableArray<NSData *> *eventData;
+@property (nonatomic, copy) NSDictionary *endTestEvent;
+@property (nonatomic, assign) NSUInteger attempts;
+@property (nonatomic, assign) BOOL passed;
+@property (nonatomic, strong) NSMutableString *retryOutput;
+@end
+
+@implementation TestRetryBufferEntry
+@end
+
+/**
+ * A held `end-test-suite`, along with the range of held tests that ran inside
+ * the suite, so its counts can be corrected once those tests were retried.
+ */
+@interface TestRetryBufferSuiteEnd : NSObject
+@property (nonatomic, copy) NSDictionary *endTestSuiteEvent;
+@property (nonatomic, assign) NSRange heldTestRange;
+@end
+
+@implementation TestRetryBufferSuiteEnd
+@end
+
+@interface TestRetryBuffer ()
+@property (nonatomic, copy) NSArray *reporters;
+// Events of the test that is running, until we know whether it passed.
+@property (nonatomic, strong) NSMutableArray<NSData *> *runningTestEventData;
+@property (nonatomic, strong) NSMutableArray<TestRetryBufferEntry *> *heldTests;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, TestRetryBufferEntry *> *heldTestsByTestCase;
+// Everything held since the first failure, in order: event data, held tests
+// and held suite ends.
+@property (nonatomic, strong) NSMutableArray *heldItems;
+// For each suite that has begun but not ended, the number of tests that had
+// been held when it began.
+@property (nonatomic, strong) NSMutableArray<NSNumber *> *openSuiteHeldTestCounts;
+@end
+
+@implementation TestRetryBuffer
+
+- (instancetype)initWithReporters:(NSArray *)reporters
+{
+  if (self = [super init]) {
+    _reporters = [reporters copy];
+    _heldTests = [NSMutableArray array];
+    _heldTestsByTestCase = [NSMutableDictionary dictionary];
+    _heldItems = [NSMutableArray array];
+    _openSuiteHeldTestCounts = [NSMutableArray array];
+  }
+  return self;
+}
+
+- (void)publishDataToReporters:(NSData *)data
+{
+  for (id<EventSink> reporter in _reporters) {
+    [reporter publishDataForEvent:data];
+  }
+}
+
+- (void)publishOrHoldData:(NSData *)data
+{
+  // Once something is held, later events have to wait behind it.
+  if (_heldItems.count > 0) {
+    [_heldItems addObject:data];
+  } else {
+    [self publishDataToReporters:data];
+  }
+}
+
+- (void)publishDataForEvent:(NSData *)data
+{
+  NSDictionary *event = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+  NSString *eventName = event[kReporter_Event_Key];
+
+  if ([eventName isEqualToString:kReporter_Events_BeginTest]) {
+    _runningTestEventData = [NSMutableArray arrayWithObject:data];
+  } else if ([eventName isEqualToString:kReporter_Events_EndTest] && _runningTestEventData != nil) {
+    [_runningTestEventData addObject:data];
+    if ([event[kReporter_EndTest_SucceededKey] boolValue]) {
+      for (NSData *eventData in _runningTestEventData) {
+        [self publishOrHoldData:eventData];
+      }
+    } else {
+      TestRetryBufferEntry *test = [[TestRetryBufferEntry alloc] init];
+      test.testCase = [NSString stringWithFormat:@"%@/%@",
+                       event[kReporter_EndTest_ClassNameKey],
+                       event[kReporter_EndTest_MethodNameKey]];
+      test.eventData = _runningTestEventData;
+      test.endTestEvent = event;
+      test.attempts = 1;
+      test.retryOutput = [NSMutableString string];
+      [_heldTests addObject:test];
+      _heldTestsByTestCase[test.testCase] = test;
+      [_heldItems addObject:test];
+    }
+    _runningTestEventData = nil;
+  } else if (_runningTestEventData != nil) {
+    [_runningTestEventData addObject:data];
+  } else if ([eventName isEqualToString:kReporter_Events_BeginTestSuite]) {
+    [_openSuiteHeldTestCounts addObject:@(_heldTests.count)];
+    [self publishOrHoldData:data];
+  } else if ([eventName isEqualToString:kReporter_Events_EndTestSuite]) {
+    NSUInteger heldTestCountAtBegin = 0;
+    if (_openSuiteHeldTestCounts.count > 0) {
+      heldTestCountAtBegin = [[_openSuiteHeldTestCounts lastObject] unsignedIntegerValue];
+      [_openSuiteHeldTestCounts removeLastObject];
+    }
+    if (_heldTests.count > heldTestCountAtBegin) {
+      TestRetryBufferSuiteEnd *suiteEnd = [[TestRetryBufferSuiteEnd alloc] init];
+      suiteEnd.endTestSuiteEvent = event;
+      suiteEnd.heldTestRange = NSMakeRange(heldTestCountAtBegin, _heldTests.count - heldTestCountAtBegin);
+      [_heldItems addObject:suiteEnd];
+    } else {
+      [self publishOrHoldData:data];
+    }
+  } else {
+    [self publishOrHoldData:data];
+  }
+}
+
+- (NSArray *)failedTestCases
+{
+  NSMutableArray *testCases = [NSMutableArray array];
+  for (TestRetryBufferEntry *test in _heldTests) {
+    if (!test.passed) {
+      [testCases addObject:test.testCase];
+    }
+  }
+  return testCases;
+}
+
+- (void)recordAttemptOfTestCase:(NSString *)testCase
+                      succeeded:(BOOL)succeeded
+                         output:(NSString *)output
+{
+  TestRetryBufferEntry *test = _heldTestsByTestCase[testCase];
+  NSAssert(test != nil && !test.passed, @"%@ isn't waiting to be retried.", testCase);
+
+  test.attempts++;
+  test.passed = succeeded;
+  [test.retryOutput appendFormat:@"\nAttempt %lu %@.\n%@",
+   (unsigned long)test.attempts,
+   succeeded ? @"passed" : @"failed",
+   output ?: @""];
+}
+
+- (BOOL)allFailedTestsPassedOnRetry
+{
+  return [self failedTestCases].count == 0;
+}
+
+- (void)publishHeldTest:(TestRetryBufferEntry *)test
+{
+  // Everything up to the end-test goes out as it was recorded.
+  for (NSUInteger i = 0; i < test.eventData.count - 1; i++) {
+    [self publishDataToReporters:test.eventData[i]];
+  }
+
+  NSString *summary = nil;
+  if (test.passed) {
+    summary = [NSString stringWithFormat:@"\nFlaky: failed on the first attempt but passed on attempt %lu.\n",
+               (unsigned long)test.attempts];
+  } else if (test.attempts > 1) {
+    summary = [NSString stringWithFormat:@"\nFailed all %lu attempts.\n",
+               (unsigned long)test.attempts];
+  }
+  NSString *extraOutput = [test.retryOutput stringByAppendingString:summary ?: @""];
+  if (extraOutput.length > 0) {
+    PublishEventToReporters(_reporters,
+                            EventDictionaryWithNameAndContent(kReporter_Events_TestOuput,
+                                                              @{kReporter_TestOutput_OutputKey: extraOutput}));
+  }
+
+  NSMutableDictionary *endTestEvent = [test.endTestEvent mutableCopy];
+  endTestEvent[kReporter_EndTest_OutputKey] =
+    [endTestEvent[kReporter_EndTest_OutputKey] ?: @"" stringByAppendingString:extraOutput];
+  endTestEvent[kReporter_EndTest_AttemptsKey] = @(test.attempts);
+  endTestEvent[kReporter_EndTest_FlakyKey] = @(test.passed);
+  if (test.passed) {
+    endTestEvent[kReporter_EndTest_SucceededKey] = @YES;
+    endTestEvent[kReporter_EndTest_ResultKey] = @"success";
+  }
+  PublishEventToReporters(_reporters, endTestEvent);
+}
+
+- (void)publishHeldSuiteEnd:(TestRetryBufferSuiteEnd *)suiteEnd
+{
+  // The suite's counts were taken before the retries.
+  NSUInteger flakyFailureCount = 0;
+  NSUInteger flakyErrorCount = 0;
+  for (TestRetryBufferEntry *test in [_heldTests subarrayWithRange:suiteEnd.heldTestRange]) {
+    if (!test.passed) {
+      continue;
+    }
+    if ([test.endTestEvent[kReporter_EndTest_ResultKey] isEqualToString:@"failure"]) {
+      flakyFailureCount++;
+    } else {
+      flakyErrorCount++;
+    }
+  }
+
+  NSMutableDictionary *endTestSuiteEvent = [suiteEnd.endTestSuiteEvent mutableCopy];
+  endTestSuiteEvent[kReporter_EndTestSuite_TotalFailureCountKey] =
+    @([endTestSuiteEvent[kReporter_EndTestSuite_TotalFailureCountKey] unsignedIntegerValue] - flakyFailureCount);
+  endTestSuiteEvent[kReporter_EndTestSuite_UnexpectedExceptionCountKey] =
+    @([endTestSuiteEvent[kReporter_EndTestSuite_UnexpectedExceptionCountKey] unsignedIntegerValue] - flakyErrorCount);
+  PublishEventToReporters(_reporters, endTestSuiteEvent);
+}
+
+- (void)flush
+{
+  for (id item in _heldItems) {
+    if ([item isKindOfClass:[TestRetryBufferEntry class]]) {
+      [self publishHeldTest:item];
+    } else if ([item isKindOfClass:[TestRetryBufferSuiteEnd class]]) {
+      [self publishHeldSuiteEnd:item];
+    } else {
+      [self publishDataToReporters:item];
+    }
+  }
+
+  [_heldItems removeAllObjects];
+  [_heldTests removeAllObjects];
+  [_heldTestsByTestCase removeAllObjects];
+}
+
+@end
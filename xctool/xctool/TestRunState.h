@@ -19,18 +19,59 @@
 #import "OCTestEventState.h"
 #import "OCTestSuiteEventState.h"
 #import "Reporter.h"
+#import "TaskUtil.h"
 
 @interface TestRunState : Reporter
 
 @property (nonatomic, strong, readonly) OCTestSuiteEventState *testSuiteState;
 
+/**
+ * Test cases ("Class/method") that finished during this run, in the order
+ * they ran.
+ */
+@property (nonatomic, copy, readonly) NSArray *testCasesFinishedInRun;
+
+/**
+ * If the run crashed between tests, this is added to the output of the
+ * placeholder test that reports the crash.
+ */
+@property (nonatomic, copy) NSString *crashDiagnosis;
+
 - (instancetype)initWithTests:(NSArray *)testList
                     reporters:(NSArray *)reporters;
 
 - (instancetype)initWithTestSuiteEventState:(OCTestSuiteEventState *)suiteState;
 
+/**
+ * Entry point for the output of a test process.  Events are parsed as usual
+ * (or taken as-is if they arrived already decoded); raw stdout/stderr lines are
+ * turned straight into `simulator-output` events, so they are never
+ * JSON-encoded just to be decoded again.
+ */
+- (void)handleOutput:(id)output ofType:(TestOutputType)type;
+
 - (BOOL)allTestsPassed;
+
+/**
+ * YES if the test process went away after a test had finished but before the
+ * next one began, so the crash can't be pinned on a running test.
+ */
+- (BOOL)crashedBetweenTests;
 - (void)prepareToRun;
+
+/**
+ * Collects the crash reports written since `prepareToRun` now rather than when
+ * the run is finished, so that those of processes launched in between (e.g. to
+ * bisect a crash) aren't attributed to this run.
+ */
+- (void)collectCrashReportsOfRun;
 - (void)didFinishRunWithStartupError:(NSString *)startupError otherErrors:(NSString *)otherErrors;
 
+/**
+ * Called instead of `-didFinishRunWithStartupError:otherErrors:` when the run
+ * was cancelled (and its process possibly killed).  Reports the test that was
+ * running and all tests that hadn't started as failed with `reason`.
+ */
+- (void)didCancelRunWithReason:(NSString *)reason;
+
 @end
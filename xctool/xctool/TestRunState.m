@@ -18,6 +18,7 @@
 
 #import <QuartzCore/QuartzCore.h>
 
+#import "EventGenerator.h"
 #import "OCTestEventState.h"
 #import "OCTestSuiteEventState.h"
 #import "ReporterEvents.h"
@@ -25,10 +26,12 @@
 
 @interface TestRunState () {
   NSMutableString *_outputBeforeTestsStart;
+  NSMutableArray *_testCasesFinishedInRun;
 }
 @property (nonatomic, strong) OCTestSuiteEventState *testSuiteState;
 @property (nonatomic, strong) OCTestEventState *previousTestState;
 @property (nonatomic, copy) NSSet *crashReportsAtStart;
+@property (nonatomic, copy) NSString *crashReportsOfRun;
 @end
 
 @implementation TestRunState
@@ -43,6 +46,7 @@
                                         reporters:reporters];
     [_testSuiteState addTestsFromArray:testList];
     _outputBeforeTestsStart = [[NSMutableString alloc] init];
+    _testCasesFinishedInRun = [[NSMutableArray alloc] init];
   }
   return self;
 }
@@ -53,6 +57,7 @@
   if (self) {
     _testSuiteState = suiteState;
     _outputBeforeTestsStart = [[NSMutableString alloc] init];
+    _testCasesFinishedInRun = [[NSMutableArray alloc] init];
   }
   return self;
 }
@@ -65,15 +70,20 @@
 
 - (BOOL)allTestsPassed
 {
-  unsigned int numPassed = 0;
-  for (NSUInteger i = 0; i < [_testSuiteState.tests count]; i++) {
-    OCTestEventState *testState = _testSuiteState.tests[i];
-    if (testState.isSuccessful) {
-      numPassed++;
-    }
-  }
+  return ([_testSuiteState totalSuccesses] == [_testSuiteState testCount]) && _testSuiteState.isFinished;
+}
 
-  return (numPassed == [_testSuiteState testCount]) && _testSuiteState.isFinished;
+- (BOOL)crashedBetweenTests
+{
+  return ([_testSuiteState isStarted] &&
+          ![_testSuiteState isFinished] &&
+          [_testSuiteState runningTest] == nil &&
+          _testCasesFinishedInRun.count > 0);
+}
+
+- (NSArray *)testCasesFinishedInRun
+{
+  return [_testCasesFinishedInRun copy];
 }
 
 - (void)prepareToRun
@@ -82,6 +92,23 @@
   _crashReportsAtStart = [NSSet setWithArray:[self collectCrashReportPaths]];
 }
 
+- (void)handleOutput:(id)output ofType:(TestOutputType)type
+{
+  if (type == TestOutputTypeEvent) {
+    if ([output isKindOfClass:[NSDictionary class]]) {
+      [self handleEvent:output];
+    } else {
+      [self parseAndHandleEvent:output];
+    }
+    return;
+  }
+
+  NSString *line = output;
+  [self simulatorOutput:EventDictionaryWithNameAndContent(
+    kReporter_Events_SimulatorOuput,
+    @{kReporter_SimulatorOutput_OutputKey: StripAnsi([line stringByAppendingString:@"\n"])})];
+}
+
 - (void)publishEventToReporters:(NSDictionary *)event
 {
   PublishEventToReporters(_testSuiteState.reporters, event);
@@ -133,6 +160,7 @@
     _previousTestState = nil;
   }
   _previousTestState = state;
+  [_testCasesFinishedInRun addObject:[NSString stringWithFormat:@"%@/%@", state.className, state.methodName]];
 
   [self publishEventToReporters:event];
 }
@@ -189,7 +217,7 @@
                               @"\n"
                               @"%@",
                               startupError,
-                              [self collectCrashReports:_crashReportsAtStart]];
+                              [self crashReportsOfRun]];
   fakeTestOutput = [fakeTestOutput stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
   [fakeTest appendOutput:fakeTestOutput];
   [_testSuiteState insertTest:fakeTest atIndex:0];
@@ -211,7 +239,7 @@
   NSString *fakeTestOutput = [NSString stringWithFormat:@"%@\n%@\n%@",
                               otherErrors ?: @"",
                               _outputBeforeTestsStart,
-                              [self collectCrashReports:_crashReportsAtStart]];
+                              [self crashReportsOfRun]];
   fakeTestOutput = [fakeTestOutput stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
   [fakeTest appendOutput:[@"\n\n" stringByAppendingString:fakeTestOutput]];
 }
@@ -221,7 +249,7 @@
   // The test runner crashed while running a particular test.
   NSString *outputForCrashingTest = [NSString stringWithFormat:
                                      @"Test crashed while running.\n\n%@",
-                                     [self collectCrashReports:_crashReportsAtStart]];
+                                     [self crashReportsOfRun]];
   outputForCrashingTest = [outputForCrashingTest stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
 
   [[_testSuiteState runningTest] appendOutput:outputForCrashingTest];
@@ -244,9 +272,11 @@
                               @"The test bundle stopped running or crashed immediately after running '%@'.  Even though that test finished, it's "
                               @"likely responsible for the crash.\n"
                               @"\n"
+                              @"%@"
                               @"%@",
                               [_previousTestState testName],
-                              [self collectCrashReports:_crashReportsAtStart]];
+                              _crashDiagnosis ? [_crashDiagnosis stringByAppendingString:@"\n\n"] : @"",
+                              [self crashReportsOfRun]];
   fakeTestOutput = [fakeTestOutput stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
 
   OCTestEventState *fakeTest = [[OCTestEventState alloc] initWithInputName:fakeTestName];
@@ -260,7 +290,7 @@
   if (![_testSuiteState isStarted] && startupError != nil) {
     [self handleStartupError:startupError];
   } else if ((![_testSuiteState isStarted] && startupError == nil) ||
-             ([_testSuiteState isStarted] && [_testSuiteState unstartedTests].count == [_testSuiteState testCount])) {
+             ([_testSuiteState isStarted] && [_testSuiteState unstartedTestCount] == [_testSuiteState testCount])) {
     [self handleCrashBeforeAnyTestsRanWithOtherErrors:otherErrors];
   } else if (![_testSuiteState isFinished] && [_testSuiteState runningTest] != nil) {
     [self handleCrashDuringTest];
@@ -274,6 +304,14 @@
   [_testSuiteState publishEvents];
 }
 
+- (void)didCancelRunWithReason:(NSString *)reason
+{
+  [[_testSuiteState runningTest] appendOutput:[NSString stringWithFormat:@"Test was cancelled: %@", reason]];
+  [[_testSuiteState unstartedTests] makeObjectsPerformSelector:@selector(appendOutput:)
+                                                    withObject:[NSString stringWithFormat:@"Test did not run: %@", reason]];
+  [_testSuiteState publishEvents];
+}
+
 - (NSArray *)collectCrashReportPaths
 {
   NSFileManager *fm = [NSFileManager defaultManager];
@@ -326,6 +364,19 @@
   return buffer;
 }
 
+- (void)collectCrashReportsOfRun
+{
+  if (_crashReportsOfRun == nil) {
+    _crashReportsOfRun = [self collectCrashReports:_crashReportsAtStart];
+  }
+}
+
+- (NSString *)crashReportsOfRun
+{
+  [self collectCrashReportsOfRun];
+  return _crashReportsOfRun;
+}
+
 - (NSString *)collectCrashReports:(NSSet *)crashReportsAtStart
 {
   // Wait for a moment to see if a crash report shows up.
@@ -0,0 +1,68 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ * A batch of test cases handed out by TestWorkQueue.  All test cases in a
+ * batch belong to the same bundle.
+ */
+@interface TestWorkBatch : NSObject
+@property (nonatomic, strong, readonly) id context;
+@property (nonatomic, copy, readonly) NSArray *testCases;
+/**
+ * 1-based sequence number of this batch within its bundle.
+ */
+@property (nonatomic, assign, readonly) NSUInteger batchNumber;
+@end
+
+/**
+ * Thread-safe backlog of test classes shared by a pool of workers.
+ *
+ * Rather than cutting every bundle into fixed buckets up front, workers call
+ * `-nextBatch` whenever they become idle.  Batch size is chosen by guided
+ * self-scheduling: while there is a lot of work left, batches are large to
+ * amortize launch cost; as the backlog drains, batches shrink towards a single
+ * class so that no worker is left running one long bucket while the others
+ * sit idle.
+ */
+@interface TestWorkQueue : NSObject
+
+/**
+ * @param workerCount Number of workers that will pull from the queue.
+ * @param maxBatchSize Upper bound on the number of classes in a batch, or 0 for
+ *   no bound.
+ */
+- (instancetype)initWithWorkerCount:(NSUInteger)workerCount
+                       maxBatchSize:(NSUInteger)maxBatchSize;
+
+/**
+ * Adds a bundle's test cases ("Class/method") to the backlog.  Test cases are
+ * grouped by class; a class is never split across batches.
+ *
+ * If `durations` ("Class/method" -> seconds) is given, the slowest classes
+ * are handed out first so that they don't end up as stragglers.
+ */
+- (void)addTestCases:(NSArray *)testCases
+         withContext:(id)context
+           durations:(NSDictionary<NSString *, NSNumber *> *)durations;
+
+/**
+ * Returns the next batch of work, or nil once the backlog is empty.
+ */
+- (TestWorkBatch *)nextBatch;
+
+@end
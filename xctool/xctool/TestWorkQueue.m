@@ -0,0 +1,133 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "TestWorkQueue.h"
+
+@interface TestWorkBatch ()
+@property (nonatomic, strong) id context;
+@property (nonatomic, copy) NSArray *testCases;
+@property (nonatomic, assign) NSUInteger batchNumber;
+@end
+
+@implementation TestWorkBatch
+@end
+
+@interface TestWorkQueueBundle : NSObject
+@property (nonatomic, strong) id context;
+// Array of arrays of test cases, one per class.
+@property (nonatomic, strong) NSMutableArray<NSArray *> *classes;
+@property (nonatomic, assign) NSUInteger batchCount;
+@end
+
+@implementation TestWorkQueueBundle
+@end
+
+@interface TestWorkQueue ()
+@property (nonatomic, assign) NSUInteger workerCount;
+@property (nonatomic, assign) NSUInteger maxBatchSize;
+@property (nonatomic, strong) NSMutableArray<TestWorkQueueBundle *> *bundles;
+@property (nonatomic, assign) NSUInteger remainingClassCount;
+@end
+
+@implementation TestWorkQueue
+
+- (instancetype)initWithWorkerCount:(NSUInteger)workerCount
+                       maxBatchSize:(NSUInteger)maxBatchSize
+{
+  if (self = [super init]) {
+    _workerCount = MAX(workerCount, (NSUInteger)1);
+    _maxBatchSize = maxBatchSize;
+    _bundles = [NSMutableArray array];
+  }
+  return self;
+}
+
+- (void)addTestCases:(NSArray *)testCases
+         withContext:(id)context
+           durations:(NSDictionary<NSString *, NSNumber *> *)durations
+{
+  NSMutableArray *classNames = [NSMutableArray array];
+  NSMutableDictionary *testCasesByClass = [NSMutableDictionary dictionary];
+  NSMutableDictionary *durationByClass = [NSMutableDictionary dictionary];
+
+  for (NSString *classAndMethod in testCases) {
+    NSString *className = [classAndMethod componentsSeparatedByString:@"/"][0];
+    if (testCasesByClass[className] == nil) {
+      testCasesByClass[className] = [NSMutableArray array];
+      [classNames addObject:className];
+    }
+    [testCasesByClass[className] addObject:classAndMethod];
+    durationByClass[className] = @([durationByClass[className] doubleValue] +
+                                   [durations[classAndMethod] doubleValue]);
+  }
+
+  if (durations.count > 0) {
+    // Stable, so classes without known durations keep their original order.
+    [classNames sortWithOptions:NSSortStable
+                usingComparator:^NSComparisonResult(NSString *a, NSString *b) {
+      return [durationByClass[b] compare:durationByClass[a]];
+    }];
+  }
+
+  TestWorkQueueBundle *bundle = [[TestWorkQueueBundle alloc] init];
+  bundle.context = context;
+  bundle.classes = [NSMutableArray arrayWithCapacity:classNames.count];
+  for (NSString *className in classNames) {
+    [bundle.classes addObject:testCasesByClass[className]];
+  }
+
+  @synchronized (self) {
+    [_bundles addObject:bundle];
+    _remainingClassCount += bundle.classes.count;
+  }
+}
+
+- (TestWorkBatch *)nextBatch
+{
+  @synchronized (self) {
+    while (_bundles.count > 0 && _bundles[0].classes.count == 0) {
+      [_bundles removeObjectAtIndex:0];
+    }
+    if (_bundles.count == 0) {
+      return nil;
+    }
+
+    TestWorkQueueBundle *bundle = _bundles[0];
+
+    NSUInteger batchSize = (_remainingClassCount + 2 * _workerCount - 1) / (2 * _workerCount);
+    if (_maxBatchSize > 0) {
+      batchSize = MIN(batchSize, _maxBatchSize);
+    }
+    batchSize = MAX(MIN(batchSize, bundle.classes.count), (NSUInteger)1);
+
+    NSRange range = NSMakeRange(0, batchSize);
+    NSMutableArray *testCases = [NSMutableArray array];
+    for (NSArray *testCasesForClass in [bundle.classes subarrayWithRange:range]) {
+      [testCases addObjectsFromArray:testCasesForClass];
+    }
+    [bundle.classes removeObjectsInRange:range];
+    _remainingClassCount -= batchSize;
+    bundle.batchCount++;
+
+    TestWorkBatch *batch = [[TestWorkBatch alloc] init];
+    batch.context = bundle.context;
+    batch.testCases = testCases;
+    batch.batchNumber = bundle.batchCount;
+    return batch;
+  }
+}
+
+@end
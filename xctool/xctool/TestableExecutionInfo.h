@@ -59,6 +59,11 @@
  */
 @property (nonatomic, copy) NSString *testCasesQueryError;
 
+/**
+ * YES if the test cases have yet to be queried with `queryTestCasesForInfos:`.
+ */
+@property (nonatomic, assign) BOOL needsBatchedQuery;
+
 /**
  * Any arguments that should be passed to otest, with all macros expanded.
  */
@@ -83,6 +88,41 @@
                                           testSDK:(NSString *)testSDK
                                             error:(NSString **)error;
 
+/**
+ * Like the above, except that settings for `target` and `macroExpansionTarget`
+ * are taken from `prefetchedBuildSettings` (target name -> settings, as
+ * returned by `buildSettingsForProject:targets:...`) when present there.
+ */
++ (NSDictionary *)testableBuildSettingsForProject:(NSString *)projectPath
+                                           target:(NSString *)target
+                             macroExpansionTarget:(NSString *)macroExpansionTarget
+                                          objRoot:(NSString *)objRoot
+                                          symRoot:(NSString *)symRoot
+                                sharedPrecompsDir:(NSString *)sharedPrecompsDir
+                             targetedDeviceFamily:(NSString *)targetedDeviceFamily
+                                   xcodeArguments:(NSArray *)xcodeArguments
+                                          testSDK:(NSString *)testSDK
+                          prefetchedBuildSettings:(NSDictionary *)prefetchedBuildSettings
+                                            error:(NSString **)error;
+
+/**
+ * Fetches build settings for several targets of a project with a single
+ * `xcodebuild -showBuildSettings`, rather than paying for one xcodebuild
+ * launch per target.
+ *
+ * @return A dictionary of target name -> settings holding the targets that
+ *   settings were found for, or nil (with `error` set) if there were none.
+ */
++ (NSDictionary *)buildSettingsForProject:(NSString *)projectPath
+                                  targets:(NSArray *)targets
+                                  objRoot:(NSString *)objRoot
+                                  symRoot:(NSString *)symRoot
+                        sharedPrecompsDir:(NSString *)sharedPrecompsDir
+                     targetedDeviceFamily:(NSString *)targetedDeviceFamily
+                           xcodeArguments:(NSArray *)xcodeArguments
+                                  testSDK:(NSString *)testSDK
+                                    error:(NSString **)error;
+
 /**
  * @return A populated TestableExecutionInfo instance.
  */
@@ -90,4 +130,22 @@
                   buildSettings:(NSDictionary *)buildSettings
                   simulatorInfo:(SimulatorInfo *)simulatorInfo;
 
+/**
+ * Like `infoForTestable:buildSettings:simulatorInfo:`, except that if listing
+ * the bundle's tests takes an otest-query that could be shared with other
+ * bundles, no query is run: `testCases` is left nil and `needsBatchedQuery`
+ * is set.  Pass such infos to `queryTestCasesForInfos:`.
+ */
++ (instancetype)infoForTestable:(Testable *)testable
+                  buildSettings:(NSDictionary *)buildSettings
+                  simulatorInfo:(SimulatorInfo *)simulatorInfo
+           deferBatchableQuery:(BOOL)deferBatchableQuery;
+
+/**
+ * Populates `testCases` (or `testCasesQueryError`) of infos that have
+ * `needsBatchedQuery` set, sharing otest-query processes among their bundles
+ * where possible.
+ */
++ (void)queryTestCasesForInfos:(NSArray *)infos;
+
 @end
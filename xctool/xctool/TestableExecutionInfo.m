@@ -16,6 +16,7 @@
 
 #import "TestableExecutionInfo.h"
 
+#import "BuildSettingsCache.h"
 #import "OCUnitIOSAppTestQueryRunner.h"
 #import "OCUnitIOSLogicTestQueryRunner.h"
 #import "OCUnitOSXAppTestQueryRunner.h"
@@ -26,11 +27,30 @@
 #import "XcodeBuildSettings.h"
 #import "XcodeSubjectInfo.h"
 
+@interface TestableExecutionInfo ()
+/**
+ * The runner that found the bundle needed a query, kept until
+ * `queryTestCasesForInfos:` so the bundle isn't looked up all over again.
+ */
+@property (nonatomic, strong) OCUnitTestQueryRunner *queryRunner;
+@end
+
 @implementation TestableExecutionInfo
 
 + (instancetype)infoForTestable:(Testable *)testable
                   buildSettings:(NSDictionary *)buildSettings
                   simulatorInfo:(SimulatorInfo *)simulatorInfo
+{
+  return [self infoForTestable:testable
+                 buildSettings:buildSettings
+                 simulatorInfo:simulatorInfo
+          deferBatchableQuery:NO];
+}
+
++ (instancetype)infoForTestable:(Testable *)testable
+                  buildSettings:(NSDictionary *)buildSettings
+                  simulatorInfo:(SimulatorInfo *)simulatorInfo
+           deferBatchableQuery:(BOOL)deferBatchableQuery
 {
   TestableExecutionInfo *info = [[TestableExecutionInfo alloc] init];
   info.testable = testable;
@@ -38,13 +58,22 @@
   info.simulatorInfo = simulatorInfo;
   info.simulatorInfo.buildSettings = buildSettings;
 
-  NSString *otestQueryError = nil;
-  NSArray *testCases = [[self class] queryTestCasesWithSimulatorInfo:info.simulatorInfo
-                                                               error:&otestQueryError];
-  if (testCases) {
-    info.testCases = testCases;
+  OCUnitTestQueryRunner *runner = [[self class] queryRunnerForSimulatorInfo:info.simulatorInfo];
+  if (runner == nil) {
+    // We can't run tests on device yet, but we must return a test list here or
+    // we'll never get far enough to run OCUnitIOSDeviceTestRunner.
+    info.testCases = @[@"Placeholder/ForDeviceTests"];
+  } else if (deferBatchableQuery && [runner needsBatchableQuery]) {
+    info.needsBatchedQuery = YES;
+    info.queryRunner = runner;
   } else {
-    info.testCasesQueryError = otestQueryError;
+    NSString *otestQueryError = nil;
+    NSArray *testCases = [runner runQueryWithError:&otestQueryError];
+    if (testCases) {
+      info.testCases = testCases;
+    } else {
+      info.testCasesQueryError = otestQueryError;
+    }
   }
 
   // In Xcode, you can optionally include variables in your args or environment
@@ -77,17 +106,45 @@
                                           testSDK:(NSString *)testSDK
                                             error:(NSString **)error
 {
-  NSDictionary *testTargetSettings = [self _buildSettingsForProject:projectPath
-                                                             target:target
-                                                            objRoot:objRoot
-                                                            symRoot:symRoot
-                                                  sharedPrecompsDir:sharedPrecompsDir
-                                               targetedDeviceFamily:targetedDeviceFamily
-                                                     xcodeArguments:xcodeArguments
-                                                            testSDK:testSDK
-                                                              error:error];
-  if (*error != nil) {
-    return nil;
+  return [self testableBuildSettingsForProject:projectPath
+                                        target:target
+                          macroExpansionTarget:macroExpansionTarget
+                                       objRoot:objRoot
+                                       symRoot:symRoot
+                             sharedPrecompsDir:sharedPrecompsDir
+                          targetedDeviceFamily:targetedDeviceFamily
+                                xcodeArguments:xcodeArguments
+                                       testSDK:testSDK
+                       prefetchedBuildSettings:nil
+                                         error:error];
+}
+
++ (NSDictionary *)testableBuildSettingsForProject:(NSString *)projectPath
+                                           target:(NSString *)target
+                             macroExpansionTarget:(NSString *)macroExpansionTarget
+                                          objRoot:(NSString *)objRoot
+                                          symRoot:(NSString *)symRoot
+                                sharedPrecompsDir:(NSString *)sharedPrecompsDir
+                             targetedDeviceFamily:(NSString *)targetedDeviceFamily
+                                   xcodeArguments:(NSArray *)xcodeArguments
+                                          testSDK:(NSString *)testSDK
+                          prefetchedBuildSettings:(NSDictionary *)prefetchedBuildSettings
+                                            error:(NSString **)error
+{
+  NSDictionary *testTargetSettings = prefetchedBuildSettings[target];
+  if (testTargetSettings == nil) {
+    testTargetSettings = [self _buildSettingsForProject:projectPath
+                                                 target:target
+                                                objRoot:objRoot
+                                                symRoot:symRoot
+                                      sharedPrecompsDir:sharedPrecompsDir
+                                   targetedDeviceFamily:targetedDeviceFamily
+                                         xcodeArguments:xcodeArguments
+                                                testSDK:testSDK
+                                                  error:error];
+    if (*error != nil) {
+      return nil;
+    }
   }
   if ([testTargetSettings[Xcode_USES_XCTRUNNER] boolValue]) {
     // fetch settings for test host app target
@@ -95,17 +152,20 @@
       *error = [NSString stringWithFormat:@"Failed to find test host app for test target %@.", target];
       return nil;
     }
-    NSDictionary *buildSettings = [self _buildSettingsForProject:projectPath
-                                                          target:macroExpansionTarget
-                                                         objRoot:objRoot
-                                                         symRoot:symRoot
-                                               sharedPrecompsDir:sharedPrecompsDir
-                                            targetedDeviceFamily:targetedDeviceFamily
-                                                  xcodeArguments:xcodeArguments
-                                                         testSDK:testSDK
-                                                           error:error];
-    if (*error != nil) {
-      return nil;
+    NSDictionary *buildSettings = prefetchedBuildSettings[macroExpansionTarget];
+    if (buildSettings == nil) {
+      buildSettings = [self _buildSettingsForProject:projectPath
+                                              target:macroExpansionTarget
+                                             objRoot:objRoot
+                                             symRoot:symRoot
+                                   sharedPrecompsDir:sharedPrecompsDir
+                                targetedDeviceFamily:targetedDeviceFamily
+                                      xcodeArguments:xcodeArguments
+                                             testSDK:testSDK
+                                               error:error];
+      if (*error != nil) {
+        return nil;
+      }
     }
     NSMutableDictionary *updatedSettings = [testTargetSettings mutableCopy];
     NSString *pathToExecutable = [NSString stringWithFormat:@"%@/%@",
@@ -117,17 +177,66 @@
   return testTargetSettings;
 }
 
-+ (NSDictionary *)_buildSettingsForProject:(NSString *)projectPath
-                                    target:(NSString *)target
-                                   objRoot:(NSString *)objRoot
-                                   symRoot:(NSString *)symRoot
-                         sharedPrecompsDir:(NSString *)sharedPrecompsDir
-                      targetedDeviceFamily:(NSString *)targetedDeviceFamily
-                            xcodeArguments:(NSArray *)xcodeArguments
-                                   testSDK:(NSString *)testSDK
-                                     error:(NSString **)error
++ (NSDictionary *)buildSettingsForProject:(NSString *)projectPath
+                                  targets:(NSArray *)targets
+                                  objRoot:(NSString *)objRoot
+                                  symRoot:(NSString *)symRoot
+                        sharedPrecompsDir:(NSString *)sharedPrecompsDir
+                     targetedDeviceFamily:(NSString *)targetedDeviceFamily
+                           xcodeArguments:(NSArray *)xcodeArguments
+                                  testSDK:(NSString *)testSDK
+                                    error:(NSString **)error
+{
+  NSTask *settingsTask = [self _showBuildSettingsTaskForProject:projectPath
+                                                        targets:targets
+                                                        objRoot:objRoot
+                                                        symRoot:symRoot
+                                              sharedPrecompsDir:sharedPrecompsDir
+                                           targetedDeviceFamily:targetedDeviceFamily
+                                                 xcodeArguments:xcodeArguments
+                                                        testSDK:testSDK];
+  NSDictionary *output = nil;
+  NSDictionary *allSettings =
+    LaunchShowBuildSettingsTaskUsingCache(settingsTask,
+                                          [NSString stringWithFormat:@"running xcodebuild -showBuildSettings for %lu targets of '%@'",
+                                           (unsigned long)[targets count], projectPath],
+                                          &output);
+  settingsTask = nil;
+
+  NSMutableDictionary *settingsByTarget = [NSMutableDictionary dictionary];
+  for (NSString *target in targets) {
+    if (allSettings[target] != nil) {
+      settingsByTarget[target] = allSettings[target];
+    }
+  }
+
+  if ([settingsByTarget count] == 0) {
+    *error = [NSString stringWithFormat:
+              @"Unable to read build settings for any of the targets %@.\n"
+              @"\n"
+              @"Output from `xcodebuild -showBuildSettings`:\n\n"
+              @"STDOUT:\n"
+              @"%@\n\n"
+              @"STDERR:\n"
+              @"%@\n\n",
+              [targets componentsJoinedByString:@", "],
+              output[@"stdout"],
+              output[@"stderr"]];
+    return nil;
+  }
+
+  return settingsByTarget;
+}
+
++ (NSTask *)_showBuildSettingsTaskForProject:(NSString *)projectPath
+                                     targets:(NSArray *)targets
+                                     objRoot:(NSString *)objRoot
+                                     symRoot:(NSString *)symRoot
+                           sharedPrecompsDir:(NSString *)sharedPrecompsDir
+                        targetedDeviceFamily:(NSString *)targetedDeviceFamily
+                              xcodeArguments:(NSArray *)xcodeArguments
+                                     testSDK:(NSString *)testSDK
 {
-  // Collect build settings for this test target.
   NSTask *settingsTask = CreateTaskInSameProcessGroup();
   [settingsTask setLaunchPath:[XcodeDeveloperDirPath() stringByAppendingPathComponent:@"usr/bin/xcodebuild"]];
 
@@ -144,27 +253,60 @@
   // scheme.
   NSString *action = ToolchainIsXcode7OrBetter() ? @"build" : @"test";
 
-  [settingsTask setArguments:[xcodeArguments arrayByAddingObjectsFromArray:@[
-    @"-project", projectPath,
-    @"-target", target,
+  NSMutableArray *arguments = [xcodeArguments mutableCopy];
+  [arguments addObjectsFromArray:@[@"-project", projectPath]];
+  for (NSString *target in targets) {
+    [arguments addObjectsFromArray:@[@"-target", target]];
+  }
+  [arguments addObjectsFromArray:@[
     [NSString stringWithFormat:@"%@=%@", Xcode_OBJROOT, objRoot],
     [NSString stringWithFormat:@"%@=%@", Xcode_SYMROOT, symRoot],
     [NSString stringWithFormat:@"%@=%@", Xcode_SHARED_PRECOMPS_DIR, sharedPrecompsDir],
     [NSString stringWithFormat:@"%@=%@", Xcode_TARGETED_DEVICE_FAMILY, targetedDeviceFamily],
     action,
     @"-showBuildSettings",
-   ]]];
+  ]];
+  [settingsTask setArguments:arguments];
 
+  // The shim makes xcodebuild skip computing settings for other targets.
+  // Names are newline-separated since they may contain spaces.
+  NSString *targetsVariable = ([targets count] == 1
+                               ? @"SHOW_ONLY_BUILD_SETTINGS_FOR_TARGET"
+                               : @"SHOW_ONLY_BUILD_SETTINGS_FOR_TARGETS");
   [settingsTask setEnvironment:@{
     @"DYLD_INSERT_LIBRARIES" : [XCToolLibPath() stringByAppendingPathComponent:@"xcodebuild-fastsettings-shim.dylib"],
-    @"SHOW_ONLY_BUILD_SETTINGS_FOR_TARGET" : target,
+    targetsVariable : [targets componentsJoinedByString:@"\n"],
   }];
 
-  NSDictionary *output = LaunchTaskAndCaptureOutput(settingsTask,
-                                                    [NSString stringWithFormat:@"running xcodebuild -showBuildSettings for '%@' target", target]);
-  settingsTask = nil;
+  return settingsTask;
+}
+
++ (NSDictionary *)_buildSettingsForProject:(NSString *)projectPath
+                                    target:(NSString *)target
+                                   objRoot:(NSString *)objRoot
+                                   symRoot:(NSString *)symRoot
+                         sharedPrecompsDir:(NSString *)sharedPrecompsDir
+                      targetedDeviceFamily:(NSString *)targetedDeviceFamily
+                            xcodeArguments:(NSArray *)xcodeArguments
+                                   testSDK:(NSString *)testSDK
+                                     error:(NSString **)error
+{
+  // Collect build settings for this test target.
+  NSTask *settingsTask = [self _showBuildSettingsTaskForProject:projectPath
+                                                        targets:@[target]
+                                                        objRoot:objRoot
+                                                        symRoot:symRoot
+                                              sharedPrecompsDir:sharedPrecompsDir
+                                           targetedDeviceFamily:targetedDeviceFamily
+                                                 xcodeArguments:xcodeArguments
+                                                        testSDK:testSDK];
 
-  NSDictionary *allSettings = BuildSettingsFromOutput(output[@"stdout"]);
+  NSDictionary *output = nil;
+  NSDictionary *allSettings =
+    LaunchShowBuildSettingsTaskUsingCache(settingsTask,
+                                          [NSString stringWithFormat:@"running xcodebuild -showBuildSettings for '%@' target", target],
+                                          &output);
+  settingsTask = nil;
 
   if ([allSettings count] > 1) {
     *error = @"Should only have build settings for a single target.";
@@ -197,11 +339,10 @@
 }
 
 /**
- * Use otest-query-[ios|osx] to get a list of all SenTestCase classes in the
- * test bundle.
+ * Returns the runner that uses otest-query-[ios|osx] to get a list of all
+ * SenTestCase classes in the test bundle, or nil for device tests.
  */
-+ (NSArray *)queryTestCasesWithSimulatorInfo:(SimulatorInfo *)simulatorInfo
-                                       error:(NSString **)error
++ (OCUnitTestQueryRunner *)queryRunnerForSimulatorInfo:(SimulatorInfo *)simulatorInfo
 {
   NSString *sdkName = simulatorInfo.buildSettings[Xcode_SDK_NAME];
   BOOL isApplicationTest = TestableSettingsIndicatesApplicationTest(simulatorInfo.buildSettings);
@@ -214,9 +355,7 @@
       runnerClass = [OCUnitOSXLogicTestQueryRunner class];
     }
   } else if ([sdkName hasPrefix:@"iphoneos"]) {
-    // We can't run tests on device yet, but we must return a test list here or
-    // we'll never get far enough to run OCUnitIOSDeviceTestRunner.
-    return @[@"Placeholder/ForDeviceTests"];
+    return nil;
   } else {
     if (isApplicationTest) {
       runnerClass = [OCUnitIOSAppTestQueryRunner class];
@@ -224,8 +363,28 @@
       runnerClass = [OCUnitIOSLogicTestQueryRunner class];
     }
   }
-  OCUnitTestQueryRunner *runner = [[runnerClass alloc] initWithSimulatorInfo:simulatorInfo];
-  return [runner runQueryWithError:error];
+  return [[runnerClass alloc] initWithSimulatorInfo:simulatorInfo];
+}
+
++ (void)queryTestCasesForInfos:(NSArray *)infos
+{
+  NSMutableArray *runners = [NSMutableArray array];
+  for (TestableExecutionInfo *info in infos) {
+    [runners addObject:info.queryRunner ?: [[self class] queryRunnerForSimulatorInfo:info.simulatorInfo]];
+  }
+
+  NSArray *errors = nil;
+  NSArray *results = [OCUnitTestQueryRunner runQueriesWithRunners:runners errors:&errors];
+
+  [infos enumerateObjectsUsingBlock:^(TestableExecutionInfo *info, NSUInteger idx, BOOL *stop) {
+    if (results[idx] != [NSNull null]) {
+      info.testCases = results[idx];
+    } else {
+      info.testCasesQueryError = errors[idx] != [NSNull null] ? errors[idx] : nil;
+    }
+    info.needsBatchedQuery = NO;
+    info.queryRunner = nil;
+  }];
 }
 
 /**
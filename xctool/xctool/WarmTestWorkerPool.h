@@ -0,0 +1,101 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "TaskUtil.h"
+
+/**
+ * A long-lived otest/xctest process that runs successive batches of tests
+ * from one bundle, so the bundle (and everything it links) is only loaded once.
+ *
+ * xctool and otest-shim talk over a FIFO named by the
+ * OTEST_SHIM_WORKER_CONTROL_FILE environment variable: xctool writes the path
+ * of a file listing the next batch, and otest-shim prints a marker line on its
+ * event stream once the batch is done.
+ */
+@interface WarmTestWorker : NSObject
+
+/**
+ * Name of the environment variable that puts otest-shim into worker mode.
+ */
++ (NSString *)controlFileEnvironmentKey;
+
+@property (nonatomic, copy, readonly) NSString *controlPath;
+
+/**
+ * The worker's process, or nil until it has been launched.
+ */
+@property (nonatomic, strong, readonly) NSTask *task;
+
+/**
+ * Creates the control FIFO at `controlPath`.  No process is started until
+ * `-launchTask:...` is called.
+ */
+- (instancetype)initWithControlPath:(NSString *)controlPath;
+
+/**
+ * Launches `task` and waits for it to finish its first batch, which is
+ * whatever tests the task was told to run on its command line.  The task's
+ * environment must include `controlPath` under `+controlFileEnvironmentKey`.
+ *
+ * @return YES if the worker is ready for another batch, NO if the process
+ *   exited (e.g. it crashed).
+ */
+- (BOOL)launchTask:(NSTask *)task
+otestShimOutputPath:(NSString *)otestShimOutputPath
+      feedOutputTo:(TestOutputFeedBlock)outputLineBlock;
+
+/**
+ * Runs `testCases` ("Class/method") in the already running process and waits
+ * for them to finish.
+ *
+ * @return YES if the worker is ready for another batch, NO if the process
+ *   exited.
+ */
+- (BOOL)runTestCases:(NSArray *)testCases
+        feedOutputTo:(TestOutputFeedBlock)outputLineBlock;
+
+/**
+ * Tells the process to exit, waits for it, and removes the control FIFO.
+ */
+- (void)terminate;
+
+@end
+
+/**
+ * Thread-safe set of idle workers, keyed by whatever identifies a process that
+ * can be reused (e.g. SDK and test bundle path).
+ */
+@interface WarmTestWorkerPool : NSObject
+
+/**
+ * Returns an idle worker for `key` and removes it from the pool, or nil if
+ * there is none.
+ */
+- (WarmTestWorker *)checkOutWorkerForKey:(NSString *)key;
+
+/**
+ * Returns a worker to the pool once it has finished a batch.
+ */
+- (void)checkInWorker:(WarmTestWorker *)worker forKey:(NSString *)key;
+
+/**
+ * Terminates every idle worker.  Should be called once all tests have run.
+ */
+- (void)terminateAllWorkers;
+
+@end
@@ -0,0 +1,227 @@
+//
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "WarmTestWorkerPool.h"
+
+#import <sys/stat.h>
+
+#import "XCToolUtil.h"
+
+// Must match kWorkerBatchFinishedMarker in otest-shim.
+static NSString *const kWorkerBatchFinishedMarker = @"__XCTOOL_WORKER_BATCH_FINISHED__";
+
+@interface WarmTestWorker ()
+@property (nonatomic, copy, readwrite) NSString *controlPath;
+@property (nonatomic, assign) int controlFd;
+@property (nonatomic, strong, readwrite) NSTask *task;
+@property (nonatomic, strong) NSCondition *condition;
+@property (nonatomic, copy) TestOutputFeedBlock currentBatchBlock;
+@property (nonatomic, assign) BOOL batchFinished;
+@property (nonatomic, assign) BOOL exited;
+@end
+
+@implementation WarmTestWorker
+
++ (NSString *)controlFileEnvironmentKey
+{
+  return @"OTEST_SHIM_WORKER_CONTROL_FILE";
+}
+
+- (instancetype)initWithControlPath:(NSString *)controlPath
+{
+  if (self = [super init]) {
+    _controlPath = [controlPath copy];
+    _condition = [[NSCondition alloc] init];
+
+    [[NSFileManager defaultManager] removeItemAtPath:_controlPath error:nil];
+    int mkfifoResult = mkfifo([_controlPath UTF8String], S_IWUSR | S_IRUSR | S_IRGRP);
+    NSAssert(mkfifoResult == 0, @"Failed to create a control FIFO at path: %@", _controlPath);
+    // Opening read-write never blocks, and keeps the FIFO open for otest-shim
+    // until we close it ourselves.
+    _controlFd = open([_controlPath UTF8String], O_RDWR);
+    NSAssert(_controlFd != -1, @"Failed to open the control FIFO at path: %@", _controlPath);
+  }
+  return self;
+}
+
+- (BOOL)launchTask:(NSTask *)task
+otestShimOutputPath:(NSString *)otestShimOutputPath
+      feedOutputTo:(TestOutputFeedBlock)outputLineBlock
+{
+  NSAssert(_task == nil, @"Worker has already been launched.");
+  _task = task;
+  [self beginBatchWithBlock:outputLineBlock];
+
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    LaunchTaskAndFeedSimulatorOutputAndOtestShimEventsToBlock(
+      task,
+      @"running otest/xctest worker on test bundle",
+      otestShimOutputPath,
+      ^(TestOutputType type, id output) {
+        [self handleOutput:output ofType:type];
+      });
+
+    [_condition lock];
+    _exited = YES;
+    [_condition broadcast];
+    [_condition unlock];
+  });
+
+  return [self waitForBatchToFinish];
+}
+
+- (BOOL)runTestCases:(NSArray *)testCases
+        feedOutputTo:(TestOutputFeedBlock)outputLineBlock
+{
+  NSString *testListPath = MakeTempFileWithPrefix(@"otest_worker_batch");
+  NSError *writeError = nil;
+  BOOL writeResult = [[testCases componentsJoinedByString:@"\n"] writeToFile:testListPath
+                                                                   atomically:YES
+                                                                     encoding:NSUTF8StringEncoding
+                                                                        error:&writeError];
+  NSAssert(writeResult, @"Couldn't save list of tests to run to a file at path %@; error: %@", testListPath, writeError);
+
+  if (![self beginBatchWithBlock:outputLineBlock]) {
+    return NO;
+  }
+
+  NSData *command = [[testListPath stringByAppendingString:@"\n"] dataUsingEncoding:NSUTF8StringEncoding];
+  write(_controlFd, [command bytes], [command length]);
+
+  BOOL ready = [self waitForBatchToFinish];
+  [[NSFileManager defaultManager] removeItemAtPath:testListPath error:nil];
+  return ready;
+}
+
+- (void)terminate
+{
+  if (_controlFd == -1) {
+    return;
+  }
+
+  // An empty line tells otest-shim there is nothing left to run.
+  write(_controlFd, "\n", 1);
+
+  if (_task != nil) {
+    [_condition lock];
+    while (!_exited) {
+      [_condition wait];
+    }
+    [_condition unlock];
+  }
+
+  close(_controlFd);
+  _controlFd = -1;
+  [[NSFileManager defaultManager] removeItemAtPath:_controlPath error:nil];
+}
+
+#pragma mark Internal Methods
+
+- (BOOL)beginBatchWithBlock:(TestOutputFeedBlock)outputLineBlock
+{
+  [_condition lock];
+  BOOL alive = !_exited;
+  if (alive) {
+    _batchFinished = NO;
+    _currentBatchBlock = outputLineBlock;
+  }
+  [_condition unlock];
+  return alive;
+}
+
+- (BOOL)waitForBatchToFinish
+{
+  [_condition lock];
+  while (!_batchFinished && !_exited) {
+    [_condition wait];
+  }
+  // Anything printed between batches has no test to be attributed to.
+  _currentBatchBlock = nil;
+  BOOL ready = !_exited;
+  [_condition unlock];
+  return ready;
+}
+
+- (void)handleOutput:(id)output ofType:(TestOutputType)type
+{
+  if (type == TestOutputTypeEvent && [output isEqual:kWorkerBatchFinishedMarker]) {
+    [_condition lock];
+    _batchFinished = YES;
+    [_condition broadcast];
+    [_condition unlock];
+    return;
+  }
+
+  [_condition lock];
+  TestOutputFeedBlock block = _currentBatchBlock;
+  [_condition unlock];
+
+  if (block) {
+    block(type, output);
+  }
+}
+
+@end
+
+@interface WarmTestWorkerPool ()
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSMutableArray<WarmTestWorker *> *> *idleWorkers;
+@end
+
+@implementation WarmTestWorkerPool
+
+- (instancetype)init
+{
+  if (self = [super init]) {
+    _idleWorkers = [NSMutableDictionary dictionary];
+  }
+  return self;
+}
+
+- (WarmTestWorker *)checkOutWorkerForKey:(NSString *)key
+{
+  @synchronized (self) {
+    WarmTestWorker *worker = [_idleWorkers[key] lastObject];
+    if (worker) {
+      [_idleWorkers[key] removeLastObject];
+    }
+    return worker;
+  }
+}
+
+- (void)checkInWorker:(WarmTestWorker *)worker forKey:(NSString *)key
+{
+  @synchronized (self) {
+    if (_idleWorkers[key] == nil) {
+      _idleWorkers[key] = [NSMutableArray array];
+    }
+    [_idleWorkers[key] addObject:worker];
+  }
+}
+
+- (void)terminateAllWorkers
+{
+  NSArray *workers = nil;
+  @synchronized (self) {
+    workers = [[_idleWorkers allValues] valueForKeyPath:@"@unionOfArrays.self"];
+    [_idleWorkers removeAllObjects];
+  }
+
+  for (WarmTestWorker *worker in workers) {
+    [worker terminate];
+  }
+}
+
+@end
@@ -64,6 +64,12 @@
  */
 + (NSArray *)projectPathsInWorkspace:(NSString *)workspace;
 
+/**
+ * Returns the paths to .xcodeproj directories referenced by the project,
+ * recursively, not including the project itself.
+ */
++ (NSSet *)projectPathsInProject:(NSString *)projectPath;
+
 /**
  * Returns a list of paths to .xcscheme files contained within the workspace itself and for
  * all projects in the workspace.
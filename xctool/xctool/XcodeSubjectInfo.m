@@ -17,6 +17,7 @@
 #import "XcodeSubjectInfo.h"
 
 #import "Buildable.h"
+#import "BuildSettingsCache.h"
 #import "PbxprojReader.h"
 #import "TaskUtil.h"
 #import "Testable.h"
@@ -806,13 +807,15 @@ containsFilesModifiedSince:(NSDate *)sinceDate
                            @"SHOW_ONLY_BUILD_SETTINGS_FOR_FIRST_BUILDABLE" : @"YES"
                            }];
 
-    NSDictionary *result = LaunchTaskAndCaptureOutput(task, @"gathering build settings for a target");
+    NSDictionary *result = nil;
+    NSDictionary *buildSettings =
+      LaunchShowBuildSettingsTaskUsingCache(task, @"gathering build settings for a target", &result);
 
     if (error) {
       *error = result[@"stderr"];
     }
 
-    return BuildSettingsFromOutput(result[@"stdout"]);
+    return buildSettings;
   };
 
   // Starting with Xcode 5+, -showBuildSettings is action-dependent.  If you run